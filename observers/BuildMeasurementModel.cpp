@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "observers/MeasurementModelBuilder.h"
+#include "spdlog/spdlog.h"
+
+namespace {
+
+/*! Split a comma-separated list.
+ *
+ * \param[in] list Comma-separated list, e.g. "left,right".
+ */
+std::vector<std::string> split_list(const std::string &list) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    items.push_back(item);
+  }
+  return items;
+}
+
+/*! Collect .mpack logs.
+ *
+ * \param[in] inputs Paths to logs, or to directories searched recursively
+ * for files ending with ".mpack".
+ * \return Paths to the logs, those of each directory in sorted order.
+ */
+std::vector<std::filesystem::path> collect_logs(
+    const std::vector<std::string> &inputs) {
+  std::vector<std::filesystem::path> logs;
+  for (const auto &input : inputs) {
+    if (!std::filesystem::is_directory(input)) {
+      logs.emplace_back(input);
+      continue;
+    }
+    std::vector<std::filesystem::path> directory_logs;
+    for (const auto &entry :
+         std::filesystem::recursive_directory_iterator(input)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".mpack") {
+        directory_logs.push_back(entry.path());
+      }
+    }
+    std::sort(directory_logs.begin(), directory_logs.end());
+    logs.insert(logs.end(), directory_logs.begin(), directory_logs.end());
+  }
+  return logs;
+}
+
+}  // namespace
+
+//! Command-line arguments of the measurement model builder.
+class CommandLineArguments {
+ public:
+  /*! Read command line arguments.
+   *
+   * \param[in] args List of command-line arguments.
+   */
+  explicit CommandLineArguments(const std::vector<std::string> &args) {
+    try {
+      parse(args);
+    } catch (const std::logic_error &) {
+      spdlog::error("Invalid numeric argument!");
+      error = true;
+    }
+
+    if (input_paths.empty() && !help) {
+      spdlog::error("An output path and at least one log are required!");
+      error = true;
+    }
+
+    if (help) {
+      print_usage(args[0].c_str());
+      exit(0);
+    } else if (error) {
+      print_usage(args[0].c_str());
+      exit(1);
+    }
+  }
+
+  /*! Parse options and paths.
+   *
+   * \param[in] args List of command-line arguments.
+   * \throw std::logic_error If a numeric argument is invalid.
+   */
+  void parse(const std::vector<std::string> &args) {
+    for (size_t i = 1; i < args.size(); i++) {
+      const auto &arg = args[i];
+      if (arg == "-h" || arg == "--help") {
+        help = true;
+      } else if (arg == "--legs" && i + 1 < args.size()) {
+        params.leg_names = split_list(args.at(++i));
+      } else if (arg == "--grid" && i + 1 < args.size()) {
+        params.grid_size.clear();
+        for (const auto &item : split_list(args.at(++i))) {
+          params.grid_size.push_back(std::stoul(item));
+        }
+      } else if (arg == "--bounds" && i + 1 < args.size()) {
+        const std::vector<std::string> bounds = split_list(args.at(++i));
+        params.lower_bounds.clear();
+        params.upper_bounds.clear();
+        for (size_t k = 0; k + 1 < bounds.size(); k += 2) {
+          params.lower_bounds.push_back(std::stod(bounds[k]));
+          params.upper_bounds.push_back(std::stod(bounds[k + 1]));
+        }
+      } else if (arg == "--threads" && i + 1 < args.size()) {
+        params.num_threads = std::stoul(args.at(++i));
+      } else if (arg == "--prefilter" && i + 1 < args.size()) {
+        params.prefilter.type = TorquePrefilter::parse_type(args.at(++i));
+      } else if (output_path.empty()) {
+        output_path = arg;
+      } else {
+        input_paths.push_back(arg);
+      }
+    }
+  }
+
+  /*! Show help message.
+   *
+   * \param[in] name Binary name from argv[0].
+   */
+  inline void print_usage(const char *name) noexcept {
+    std::cout << "Usage: " << name << " <output-path> <log-path>..."
+              << " [options]\n\n";
+    std::cout << "Required arguments:\n\n";
+    std::cout << "<output-path>\n"
+              << "    Path to the .npz measurement model.\n";
+    std::cout << "<log-path>...\n"
+              << "    Paths to .mpack logs with simulation ground truth, or "
+              << "to directories\n"
+              << "    searched recursively for them.\n";
+    std::cout << "\n";
+    std::cout << "Optional arguments:\n\n";
+    std::cout << "-h, --help\n"
+              << "    Print this help and exit.\n";
+    std::cout << "--legs <leg,leg,...>\n"
+              << "    Legs whose samples are pooled (default: left).\n";
+    std::cout << "--grid <nx,ny>\n"
+              << "    Number of grid points along each axis (default: "
+              << "200,200).\n";
+    std::cout << "--bounds <x0,x1,y0,y1>\n"
+              << "    Grid bounds of the wheel and knee torques (default: "
+              << "fitted to the\n"
+              << "    samples).\n";
+    std::cout << "--threads <number>\n"
+              << "    Number of worker threads (default: one per hardware "
+              << "thread).\n";
+    std::cout << "--prefilter <type>\n"
+              << "    Torque filter, which should match the measurement "
+              << "model: first_order,\n"
+              << "    butterworth, linear_phase_fir or one_euro (default: "
+              << "first_order).\n";
+    std::cout << "\n";
+  }
+
+  //! Help flag
+  bool help = false;
+
+  //! Error flag
+  bool error = false;
+
+  //! Path to the output .npz file
+  std::string output_path;
+
+  //! Paths to logs or directories of logs
+  std::vector<std::string> input_paths;
+
+  //! Parameters of the builder
+  MeasurementModelBuilder::Parameters params;
+};
+
+int main(int argc, char **argv) {
+  CommandLineArguments args({argv, argv + argc});
+  const std::vector<std::filesystem::path> logs =
+      collect_logs(args.input_paths);
+  MeasurementModelBuilder builder(args.params);
+  builder.add_logs(logs);
+  builder.build();
+  builder.save(args.output_path);
+  spdlog::info("Built \"{}\" from {} samples in {} logs", args.output_path,
+               builder.num_samples(), logs.size());
+  return 0;
+}
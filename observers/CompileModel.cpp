@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "observers/ModelFile.h"
+#include "observers/NpzInterpolator.h"
+#include "spdlog/spdlog.h"
+
+namespace {
+
+/*! Split a comma-separated list.
+ *
+ * \param[in] list Comma-separated list, e.g. "wheel_torque,knee_torque".
+ */
+std::vector<std::string> split_keys(const std::string &list) {
+  std::vector<std::string> keys;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    keys.push_back(item);
+  }
+  return keys;
+}
+
+/*! Write a compiled model as C++ sources embedding it in a binary.
+ *
+ * The header declares a function returning the EmbeddedModel, and the source
+ * file defines it along with the bytes of the model.
+ *
+ * \param[in] model Bytes of the compiled model.
+ * \param[in] function Name of the function returning the model.
+ * \param[in] source_path Path to the .npz file the model was compiled from.
+ * \param[in] output_path Path to the source file, ending with ".cpp". The
+ * header is written next to it, with the ".h" extension.
+ */
+void write_embedded_model(const std::vector<uint8_t> &model,
+                          const std::string &function,
+                          const std::string &source_path,
+                          const std::string &output_path) {
+  const std::string stem = output_path.substr(0, output_path.rfind('.'));
+  const std::string source_name =
+      source_path.substr(source_path.rfind('/') + 1);
+  std::ofstream header(stem + ".h");
+  header << "// Generated by //observers:compile_model from " << source_name
+         << ", do not edit\n\n"
+         << "#pragma once\n\n"
+         << "#include \"observers/ModelFile.h\"\n\n"
+         << "//! Measurement model compiled from " << source_name << "\n"
+         << "EmbeddedModel " << function << "();\n";
+
+  std::ofstream source(output_path);
+  source << "// Generated by //observers:compile_model from " << source_name
+         << ", do not edit\n\n"
+         << "#include \"observers/ModelFile.h\"\n\n"
+         << "namespace {\n\n"
+         << "alignas(kModelFileAlignment) const uint8_t kModel[] = {";
+  for (size_t i = 0; i < model.size(); ++i) {
+    source << ((i % 16 == 0) ? "\n    " : " ") << static_cast<int>(model[i])
+           << ",";
+  }
+  source << "\n};\n\n"
+         << "}  // namespace\n\n"
+         << "EmbeddedModel " << function << "() {\n"
+         << "  return EmbeddedModel{kModel, sizeof(kModel), \"" << source_name
+         << "\"};\n"
+         << "}\n";
+  if (!header || !source) {
+    throw std::runtime_error("Failed to write embedded model \"" +
+                             output_path + "\"");
+  }
+}
+
+}  // namespace
+
+//! Command-line arguments of the model compiler.
+class CommandLineArguments {
+ public:
+  /*! Read command line arguments.
+   *
+   * \param[in] args List of command-line arguments.
+   */
+  explicit CommandLineArguments(const std::vector<std::string> &args) {
+    size_t num_paths = 0;
+    for (size_t i = 1; i < args.size(); i++) {
+      const auto &arg = args[i];
+      if (arg == "-h" || arg == "--help") {
+        help = true;
+      } else if (arg == "--axes" && i + 1 < args.size()) {
+        axis_keys = split_keys(args.at(++i));
+      } else if (arg == "--values" && i + 1 < args.size()) {
+        value_keys = split_keys(args.at(++i));
+      } else if (arg == "--log-ratio" && i + 1 < args.size()) {
+        log_ratio_key = args.at(++i);
+      } else if (arg == "--no-log-ratio") {
+        log_ratio_key.clear();
+      } else if (arg == "--adaptive" && i + 1 < args.size()) {
+        tolerance = std::stod(args.at(++i));
+      } else if (arg == "--embed" && i + 1 < args.size()) {
+        embed_function = args.at(++i);
+      } else if (num_paths == 0) {
+        input_path = arg;
+        num_paths++;
+      } else if (num_paths == 1) {
+        output_path = arg;
+        num_paths++;
+      } else {
+        spdlog::error("Unknown argument: {}", arg);
+        error = true;
+      }
+    }
+
+    if (num_paths != 2 && !help) {
+      spdlog::error("Input and output paths are required!");
+      error = true;
+    }
+    if (!log_ratio_key.empty() && value_keys.size() < 2) {
+      spdlog::error("The log-likelihood ratio needs two values!");
+      error = true;
+    }
+
+    if (help) {
+      print_usage(args[0].c_str());
+      exit(0);
+    } else if (error) {
+      print_usage(args[0].c_str());
+      exit(1);
+    }
+  }
+
+  /*! Show help message.
+   *
+   * \param[in] name Binary name from argv[0].
+   */
+  inline void print_usage(const char *name) noexcept {
+    std::cout << "Usage: " << name << " <input-path> <output-path>"
+              << " [options]\n\n";
+    std::cout << "Required arguments:\n\n";
+    std::cout << "<input-path>\n"
+              << "    Path to the .npz measurement model.\n";
+    std::cout << "<output-path>\n"
+              << "    Path to the compiled model, conventionally ending with "
+              << kModelFileExtension << ".\n";
+    std::cout << "\n";
+    std::cout << "Optional arguments:\n\n";
+    std::cout << "-h, --help\n"
+              << "    Print this help and exit.\n";
+    std::cout << "--axes <key,key,...>\n"
+              << "    Axis keys (default: wheel_torque,knee_torque).\n";
+    std::cout << "--values <key,key,...>\n"
+              << "    Value keys (default: contact_likelihood,"
+              << "no_contact_likelihood,P_contact).\n";
+    std::cout << "--log-ratio <key>\n"
+              << "    Key of the log-ratio of the first two values, "
+              << "precomputed in the model\n"
+              << "    (default: log_likelihood_ratio).\n";
+    std::cout << "--no-log-ratio\n"
+              << "    Do not precompute the log-likelihood ratio.\n";
+    std::cout << "--adaptive <tolerance>\n"
+              << "    Keep only the grid points needed to interpolate each "
+              << "table within\n"
+              << "    <tolerance> times its range, e.g. 1e-3.\n";
+    std::cout << "--embed <function>\n"
+              << "    Write C++ sources embedding the model instead: "
+              << "<output-path> is a .cpp\n"
+              << "    file defining <function>, declared in a header next to "
+              << "it.\n";
+    std::cout << "\n";
+  }
+
+  //! Help flag
+  bool help = false;
+
+  //! Error flag
+  bool error = false;
+
+  //! Path to the input .npz file
+  std::string input_path;
+
+  //! Path to the output compiled model
+  std::string output_path;
+
+  //! Axis keys, as in MeasurementModel::Parameters
+  std::vector<std::string> axis_keys = {"wheel_torque", "knee_torque"};
+
+  //! Value keys, as in MeasurementModel::Parameters
+  std::vector<std::string> value_keys = {"contact_likelihood",
+                                         "no_contact_likelihood", "P_contact"};
+
+  //! Value key of the log-likelihood ratio, as in MeasurementModel::Keys,
+  //! empty to skip it
+  std::string log_ratio_key = "log_likelihood_ratio";
+
+  //! Tolerance of the adaptive grid, relative to the range of each table,
+  //! zero to keep the full grid
+  double tolerance = 0.0;
+
+  //! Function returning the embedded model, empty to write a model file
+  std::string embed_function;
+};
+
+int main(int argc, char **argv) {
+  CommandLineArguments args({argv, argv + argc});
+  NpzInterpolator interpolator(args.input_path, args.axis_keys,
+                               args.value_keys);
+  if (!args.log_ratio_key.empty()) {
+    interpolator.add_log_ratio_table(args.log_ratio_key, 0, 1);
+  }
+  if (args.tolerance > 0.0) {
+    interpolator.adapt_grid(args.tolerance);
+  }
+  if (args.embed_function.empty()) {
+    interpolator.save(args.output_path);
+  } else {
+    write_embedded_model(interpolator.serialize(), args.embed_function,
+                         args.input_path, args.output_path);
+  }
+  spdlog::info("Compiled {} values from \"{}\" into \"{}\"",
+               interpolator.num_values(), args.input_path, args.output_path);
+  return 0;
+}
@@ -10,18 +10,51 @@
 
 using upkie::cpp::utils::low_pass_filter;
 
+void ContactFilter::reset(const Dictionary &config) {
+  for (InputPath *input :
+       {&contact_likelihood_input, &no_contact_likelihood_input,
+        &log_likelihood_ratio_input, &p_switch_input, &p_landing_input,
+        &power_input}) {
+    input->unbind();
+  }
+  p_contact_output.unbind();
+  p_contact_smooth_output.unbind();
+  p_contact_smoothed_lag_output.unbind();
+  if (smoother_) {
+    smoother_->reset();
+  }
+}
+
 void ContactFilter::read(const Dictionary &observation) {
+  if (log_odds) {
+    update_log_odds(observation);
+  } else {
+    update_belief(observation);
+  }
+
+  // Apply a very gentle low-pass filter to the contact belief, to smooth it
+  // out.
+  p_contact_smooth = low_pass_filter(p_contact_smooth, 1e-2, p_contact, 1e-3);
+
+  if (smoother_) {
+    smoother_->update(transition, likelihoods,
+                      HmmFilter<2>::Vector(1.0 - p_contact, p_contact));
+    p_contact_smoothed_lag = smoother_->smoothed()(1);
+  }
+}
+
+void ContactFilter::update_belief(const Dictionary &observation) {
   double contact_likelihood =
-      observation("measurement_model")("contact_likelihood");
+      contact_likelihood_input(observation).as<double>();
   double no_contact_likelihood =
-      observation("measurement_model")("no_contact_likelihood");
+      no_contact_likelihood_input(observation).as<double>();
 
   // Add a small constant to avoid division by zero.
   // We would only encounter zero if torques are outside the range of the
   // KDE, which means they are abnormally large.
   contact_likelihood += 1e-20;
 
-  spdlog::debug("p_contact: " + std::to_string(p_contact));
+  spdlog::debug("p_contact: {}", p_contact);
 
   if (std::isnan(contact_likelihood)) {
     spdlog::error("contact_likelihood is NaN!");
@@ -29,19 +62,23 @@ void ContactFilter::read(const Dictionary &observation) {
     spdlog::error("no_contact_likelihood is NaN!");
   }
 
-  double p_switch = observation("transition_model")("p_switch");
-  double p_landing =
-      observation("transition_model")("p_landing");  // CONDITIONED ON switch!
-  double power = observation("transition_model")("power");
+  double p_switch = p_switch_input(observation).as<double>();
+  // CONDITIONED ON switch!
+  double p_landing = p_landing_input(observation).as<double>();
+  double power = power_input(observation).as<double>();
 
-  spdlog::debug("p_switch: " + std::to_string(p_switch) + " p_landing: " +
-                std::to_string(p_landing) + " power: " + std::to_string(power));
+  spdlog::debug("p_switch: {} p_landing: {} power: {}", p_switch, p_landing,
+                power);
 
   double contact_belief = p_contact;
   double no_contact_belief = 1.0 - p_contact;
 
-  spdlog::debug("contact_belief: " + std::to_string(contact_belief) +
-                " no_contact_belief: " + std::to_string(no_contact_belief));
+  spdlog::debug("contact_belief: {} no_contact_belief: {}", contact_belief,
+                no_contact_belief);
+
+  transition << 1 - p_switch, p_switch * (1 - p_landing),
+      p_switch * p_landing, 1 - p_switch;
+  likelihoods << no_contact_likelihood, contact_likelihood;
 
   // Equation 1a
   double tmp_contact_belief = (p_switch * p_landing) * no_contact_belief +
@@ -52,8 +89,8 @@ void ContactFilter::read(const Dictionary &observation) {
 
   contact_belief = tmp_contact_belief;
 
-  spdlog::debug("contact_belief: " + std::to_string(contact_belief) +
-                " no_contact_belief: " + std::to_string(no_contact_belief));
+  spdlog::debug("contact_belief: {} no_contact_belief: {}", contact_belief,
+                no_contact_belief);
 
   // Equation 1b
   contact_belief = contact_likelihood * contact_belief;
@@ -70,12 +107,46 @@ void ContactFilter::read(const Dictionary &observation) {
     spdlog::error("contact_belief was NaN, p_contact was not updated!");
     exit(1);
   }
-  // Apply a very gentle low-pass filter to the contact belief, to smooth it
-  // out.
-  p_contact_smooth = low_pass_filter(p_contact_smooth, 1e-2, p_contact, 1e-3);
+}
+
+void ContactFilter::update_log_odds(const Dictionary &observation) {
+  double p_switch = p_switch_input(observation).as<double>();
+  // CONDITIONED ON switch!
+  double p_landing = p_landing_input(observation).as<double>();
+  double log_likelihood_ratio =
+      log_likelihood_ratio_input(observation).as<double>();
+
+  // Likelihoods scaled to sum to one, whose log-ratio is the input
+  transition << 1 - p_switch, p_switch * (1 - p_landing),
+      p_switch * p_landing, 1 - p_switch;
+  likelihoods << 1.0 / (1.0 + std::exp(log_likelihood_ratio)),
+      1.0 / (1.0 + std::exp(-log_likelihood_ratio));
+
+  // Equation 1a, on the beliefs of the bounded log-odds. Both predicted
+  // beliefs are positive as the switch probability is below one.
+  double contact_belief = 1.0 / (1.0 + std::exp(-contact_log_odds));
+  double no_contact_belief = 1.0 / (1.0 + std::exp(contact_log_odds));
+  double predicted_contact = (p_switch * p_landing) * no_contact_belief +
+                             (1 - p_switch) * contact_belief;
+  double predicted_no_contact = (p_switch * (1 - p_landing)) * contact_belief +
+                                (1 - p_switch) * no_contact_belief;
+
+  // Equations 1b and 2: the likelihoods add up in log-odds, and the
+  // normalization term cancels out
+  contact_log_odds =
+      std::clamp(std::log(predicted_contact / predicted_no_contact) +
+                     log_likelihood_ratio,
+                 -kMaxContactLogOdds, kMaxContactLogOdds);
+  p_contact = 1.0 / (1.0 + std::exp(-contact_log_odds));
+
+  spdlog::debug("contact_log_odds: {} p_contact: {}", contact_log_odds,
+                p_contact);
 }
 
 void ContactFilter::write(Dictionary &observation) {
-  observation(prefix())("p_contact") = p_contact;
-  observation(prefix())("p_contact_smooth") = p_contact_smooth;
+  p_contact_output(observation) = p_contact;
+  p_contact_smooth_output(observation) = p_contact_smooth;
+  if (smoother_) {
+    p_contact_smoothed_lag_output(observation) = p_contact_smoothed_lag;
+  }
 }
@@ -1,14 +1,23 @@
 // SPDX-License-Identifier: Apache-2.0
 // Copyright 2024 Inria
 #pragma once
+#include <algorithm>
+#include <cmath>
+#include <optional>
 #include <string>
 
+#include "observers/DictionaryBinding.h"
+#include "observers/FixedLagSmoother.h"
+#include "observers/HmmFilter.h"
 #include "palimpsest/Dictionary.h"
 #include "upkie/cpp/observers/Observer.h"
 
 using palimpsest::Dictionary;
 using upkie::cpp::observers::Observer;
 
+//! Bound on the contact log-odds, so that the belief can always recover
+inline constexpr double kMaxContactLogOdds = 40.0;
+
 /*! Estimate contact likelihood based on joint torque measurements.
  *
  */
@@ -17,13 +26,36 @@ class ContactFilter : public Observer {
   /*! Initialize observer.
    *
    * \param[in] p_contact Initial contact belief.
+   * \param[in] log_odds Update the belief in log-odds, from the
+   * `measurement_model/log_likelihood_ratio` input, rather than by multiplying
+   * and normalizing likelihoods.
+   * \param[in] smoother_lag Lag of the fixed-lag smoother, in ticks, whose
+   * estimate is written to `contact_filter/p_contact_smoothed_lag`. Zero
+   * disables the smoother.
    */
-  explicit ContactFilter(double p_contact = 0.5)
-      : p_contact(p_contact), p_contact_smooth(p_contact) {}
+  explicit ContactFilter(double p_contact = 0.5, bool log_odds = false,
+                         size_t smoother_lag = 0)
+      : log_odds(log_odds),
+        p_contact(p_contact),
+        p_contact_smooth(p_contact),
+        contact_log_odds(std::clamp(std::log(p_contact / (1.0 - p_contact)),
+                                    -kMaxContactLogOdds, kMaxContactLogOdds)),
+        p_contact_smoothed_lag(p_contact) {
+    if (smoother_lag > 0) {
+      smoother_.emplace(smoother_lag);
+    }
+  }
 
   //! Prefix of outputs in the observation dictionary.
   inline std::string prefix() const noexcept final { return "contact_filter"; }
 
+  /*! Unbind dictionary paths, which are bound again at the next tick, and
+   * forget the ticks of the smoother.
+   *
+   * \param[in] config Configuration dictionary.
+   */
+  void reset(const Dictionary &config) override;
+
   /*! Read inputs from other observations.
    *
    * \param[in] observation Dictionary to read other observations from.
@@ -36,8 +68,82 @@ class ContactFilter : public Observer {
    */
   void write(Dictionary &observation) override;
 
+  /*! Update the contact belief from the likelihoods of both hypotheses.
+   *
+   * \param[in] observation Dictionary to read other observations from.
+   */
+  void update_belief(const Dictionary &observation);
+
+  /*! Update the contact log-odds from the log-likelihood ratio.
+   *
+   * Bayes' rule becomes an addition in log-odds, and there is no
+   * normalization that could divide zero by zero when both likelihoods
+   * vanish outside of the support of the measurement model.
+   *
+   * \param[in] observation Dictionary to read other observations from.
+   */
+  void update_log_odds(const Dictionary &observation);
+
+  //! Input and output keys, constructed once rather than at every tick
+  struct Keys {
+    std::string prefix = "contact_filter";
+    std::string measurement_model = "measurement_model";
+    std::string contact_likelihood = "contact_likelihood";
+    std::string no_contact_likelihood = "no_contact_likelihood";
+    std::string log_likelihood_ratio = "log_likelihood_ratio";
+    std::string transition_model = "transition_model";
+    std::string p_contact_smooth = "p_contact_smooth";
+    std::string p_contact_smoothed_lag = "p_contact_smoothed_lag";
+  };
+
+  //! Dictionary keys
+  const Keys keys{};
+
+  //! Whether the belief is updated in log-odds
+  const bool log_odds;
+
   // Contact belief
   double p_contact{};
 
   double p_contact_smooth{};
+
+  //! Log-odds of the contact belief, only updated in log-odds mode
+  double contact_log_odds{};
+
+  //! Transition of the last update, from no contact (state 0) and contact
+  //! (state 1), e.g. to smooth beliefs offline
+  HmmFilter<2>::Matrix transition = HmmFilter<2>::Matrix::Identity();
+
+  //! Likelihoods of no contact and contact at the last update, up to a
+  //! common factor
+  HmmFilter<2>::Vector likelihoods = HmmFilter<2>::Vector::Ones();
+
+  //! Contact belief smoothed over the next ticks, delayed by the smoother lag
+  double p_contact_smoothed_lag{};
+
+  //! Fixed-lag smoother, if enabled
+  const std::optional<FixedLagSmoother<2>> &smoother() const {
+    return smoother_;
+  }
+
+ private:
+  //! Inputs, bound at the first tick
+  InputPath contact_likelihood_input{keys.measurement_model,
+                                     keys.contact_likelihood};
+  InputPath no_contact_likelihood_input{keys.measurement_model,
+                                        keys.no_contact_likelihood};
+  InputPath log_likelihood_ratio_input{keys.measurement_model,
+                                       keys.log_likelihood_ratio};
+  InputPath p_switch_input{keys.transition_model, "p_switch"};
+  InputPath p_landing_input{keys.transition_model, "p_landing"};
+  InputPath power_input{keys.transition_model, "power"};
+
+  //! Outputs, bound at the first tick
+  OutputPath p_contact_output{keys.prefix, "p_contact"};
+  OutputPath p_contact_smooth_output{keys.prefix, keys.p_contact_smooth};
+  OutputPath p_contact_smoothed_lag_output{keys.prefix,
+                                           keys.p_contact_smoothed_lag};
+
+  //! Fixed-lag smoother of the contact belief, if enabled
+  std::optional<FixedLagSmoother<2>> smoother_;
 };
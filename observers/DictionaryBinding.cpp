@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/DictionaryBinding.h"
+
+template <typename Dict>
+void BoundPath<Dict>::bind(Dict &root) {
+  Dict *node = &root;
+  for (const auto &key : keys_) {
+    node = &(*node)(key);
+  }
+  root_ = &root;
+  node_ = node;
+}
+
+template <typename Dict>
+bool BoundPath<Dict>::try_bind(Dict &root) {
+  Dict *node = &root;
+  for (const auto &key : keys_) {
+    if (!node->has(key)) {
+      unbind();
+      return false;
+    }
+    node = &(*node)(key);
+  }
+  root_ = &root;
+  node_ = node;
+  return true;
+}
+
+template class BoundPath<const Dictionary>;
+template class BoundPath<Dictionary>;
@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "palimpsest/Dictionary.h"
+
+using palimpsest::Dictionary;
+
+/*! Path of keys in a dictionary, resolved once into the node it leads to.
+ *
+ * Observers read and write the same entries of the observation dictionary at
+ * every tick. Walking the path key by key hashes and compares each key, while
+ * a bound path only compares the address of the dictionary with the one it
+ * was bound to, then returns the cached node. Nodes of a dictionary keep
+ * their address as long as none of their ancestors is removed. The path is
+ * bound again when it is used on a dictionary at another address, but it
+ * should be unbound when its dictionary is restructured or replaced by one at
+ * the same address, e.g. by observers on reset.
+ *
+ * \tparam Dict `const Dictionary` for inputs, whose keys should exist, or
+ * `Dictionary` for outputs, whose missing keys are inserted.
+ */
+template <typename Dict>
+class BoundPath {
+ public:
+  /*! Prepare a path, bound at its first use.
+   *
+   * \param[in] keys Keys from the root of the dictionary to the node.
+   */
+  explicit BoundPath(std::vector<std::string> keys) : keys_(std::move(keys)) {}
+
+  BoundPath(std::initializer_list<std::string> keys) : keys_(keys) {}
+
+  /*! Node at the end of the path.
+   *
+   * \param[in] root Root of the dictionary, binding the path on first use or
+   * if it differs from the last one.
+   * \throw std::out_of_range If an input key is missing, as for lookups by
+   * key.
+   */
+  Dict &operator()(Dict &root) {
+    if (&root != root_) {
+      bind(root);
+    }
+    return *node_;
+  }
+
+  /*! Node at the end of an optional path.
+   *
+   * \param[in] root Root of the dictionary.
+   * \return Node, or null if a key is missing. Missing paths are looked up
+   * again at the next call, until they are found.
+   */
+  Dict *find(Dict &root) {
+    if (&root != root_ && !try_bind(root)) {
+      return nullptr;
+    }
+    return node_;
+  }
+
+  //! Forget the bound node, e.g. after the dictionary is restructured.
+  void unbind() {
+    root_ = nullptr;
+    node_ = nullptr;
+  }
+
+  //! Keys from the root of the dictionary to the node
+  const std::vector<std::string> &keys() const { return keys_; }
+
+ private:
+  /*! Walk the path from a root, inserting missing output keys.
+   *
+   * \param[in] root Root of the dictionary.
+   */
+  void bind(Dict &root);
+
+  /*! Walk the path from a root if all its keys exist.
+   *
+   * \param[in] root Root of the dictionary.
+   * \return True if the path was bound.
+   */
+  bool try_bind(Dict &root);
+
+  //! Keys from the root of the dictionary to the node
+  const std::vector<std::string> keys_;
+
+  //! Root of the dictionary the path is bound to, null if unbound
+  Dict *root_ = nullptr;
+
+  //! Node at the end of the path, null if unbound
+  Dict *node_ = nullptr;
+};
+
+//! Path to an observation read at every tick
+using InputPath = BoundPath<const Dictionary>;
+
+//! Path to an observation written at every tick
+using OutputPath = BoundPath<Dictionary>;
+
+extern template class BoundPath<const Dictionary>;
+extern template class BoundPath<Dictionary>;
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/FixedLagSmoother.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+template <int N>
+FixedLagSmoother<N>::FixedLagSmoother(size_t lag)
+    : lag_(lag),
+      transitions_(lag + 1, Matrix::Identity()),
+      likelihoods_(lag + 1, Vector::Ones()),
+      beliefs_(lag + 1, Vector::Constant(1.0 / N)),
+      smoothed_(Vector::Constant(1.0 / N)) {}
+
+template <int N>
+void FixedLagSmoother<N>::reset() {
+  last_ = 0;
+  size_ = 0;
+  smoothed_ = Vector::Constant(1.0 / N);
+}
+
+template <int N>
+void FixedLagSmoother<N>::update(const Matrix &transition,
+                                 const Vector &likelihoods,
+                                 const Vector &belief) {
+  const size_t capacity = lag_ + 1;
+  last_ = (size_ > 0) ? (last_ + 1) % capacity : 0;
+  transitions_[last_] = transition;
+  likelihoods_[last_] = likelihoods;
+  beliefs_[last_] = belief;
+  size_ = std::min(size_ + 1, capacity);
+  if (size_ == 1) {
+    smoothed_ = belief;
+    return;
+  }
+
+  // Backward pass from the last tick to the oldest one in the buffers
+  Vector backward = Vector::Ones();
+  size_t index = last_;
+  for (size_t k = 1; k < size_; ++k) {
+    backward_step(transitions_[index], likelihoods_[index], backward);
+    index = (index + capacity - 1) % capacity;
+  }
+  smoothed_ = combine(beliefs_[index], backward);
+}
+
+template <int N>
+typename FixedLagSmoother<N>::VectorSequence FixedLagSmoother<N>::smooth(
+    const MatrixSequence &transitions, const VectorSequence &likelihoods,
+    const VectorSequence &beliefs) {
+  if (transitions.size() != beliefs.size() ||
+      likelihoods.size() != beliefs.size()) {
+    throw std::invalid_argument(
+        "Transitions, likelihoods and beliefs should have the same length");
+  }
+  VectorSequence smoothed(beliefs.size());
+  Vector backward = Vector::Ones();
+  for (size_t k = beliefs.size(); k-- > 0;) {
+    smoothed[k] = combine(beliefs[k], backward);
+    backward_step(transitions[k], likelihoods[k], backward);
+  }
+  return smoothed;
+}
+
+template <int N>
+void FixedLagSmoother<N>::backward_step(const Matrix &transition,
+                                        const Vector &likelihoods,
+                                        Vector &backward) {
+  // Fixed-size product, evaluated into a temporary on the stack. Messages
+  // are normalized so that they do not underflow over long sequences.
+  backward = transition.transpose() * likelihoods.cwiseProduct(backward);
+  const double sum = backward.sum();
+  if (sum > 0.0 && std::isfinite(sum)) {
+    backward /= sum;
+  } else {
+    backward = Vector::Ones();
+  }
+}
+
+template <int N>
+typename FixedLagSmoother<N>::Vector FixedLagSmoother<N>::combine(
+    const Vector &belief, const Vector &backward) {
+  const Vector product = belief.cwiseProduct(backward);
+  const double sum = product.sum();
+  if (!(sum > 0.0) || !std::isfinite(sum)) {
+    return belief;
+  }
+  return product / sum;
+}
+
+template class FixedLagSmoother<2>;
+template class FixedLagSmoother<4>;
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#pragma once
+
+#include <vector>
+
+#include "Eigen/Core"
+#include "observers/HmmFilter.h"
+
+/*! Fixed-lag forward-backward smoother of a hidden Markov model.
+ *
+ * Keeps the transitions, likelihoods and filtered beliefs of the last ticks
+ * of a forward filter in ring buffers allocated at construction. At every
+ * tick, a backward pass over the buffers conditions the belief of `lag` ticks
+ * ago on the observations that followed it, in O(lag) time.
+ *
+ * \tparam N Number of states.
+ */
+template <int N>
+class FixedLagSmoother {
+ public:
+  //! Distribution over states
+  using Vector = typename HmmFilter<N>::Vector;
+
+  //! Transition matrix, from column states to row states
+  using Matrix = typename HmmFilter<N>::Matrix;
+
+  //! Sequence of distributions, aligned for fixed-size Eigen types
+  using VectorSequence = std::vector<Vector, Eigen::aligned_allocator<Vector>>;
+
+  //! Sequence of transition matrices
+  using MatrixSequence = std::vector<Matrix, Eigen::aligned_allocator<Matrix>>;
+
+  /*! Allocate the ring buffers.
+   *
+   * \param[in] lag Number of ticks between the last tick and the smoothed
+   * one, zero to only copy the filtered belief.
+   */
+  explicit FixedLagSmoother(size_t lag);
+
+  //! Forget past ticks, e.g. at the start of an episode.
+  void reset();
+
+  /*! Add a tick of the forward filter, then smooth the belief of `lag` ticks
+   * ago. Does not allocate.
+   *
+   * \param[in] transition Transition from the previous tick, as passed to
+   * HmmFilter::predict.
+   * \param[in] likelihoods Likelihood of each state, as passed to
+   * HmmFilter::update.
+   * \param[in] belief Filtered belief after the update.
+   */
+  void update(const Matrix &transition, const Vector &likelihoods,
+              const Vector &belief);
+
+  /*! Smoothed belief of the tick `delay()` ticks before the last one.
+   *
+   * Uniform before the first update.
+   */
+  const Vector &smoothed() const { return smoothed_; }
+
+  //! Number of ticks between the last tick and the smoothed one
+  size_t lag() const { return lag_; }
+
+  //! Delay of the smoothed belief, below lag() until the buffers are full
+  size_t delay() const { return (size_ > 0) ? size_ - 1 : 0; }
+
+  /*! Smooth the beliefs of a whole sequence of ticks.
+   *
+   * \param[in] transitions Transition into each tick.
+   * \param[in] likelihoods Likelihoods of each tick.
+   * \param[in] beliefs Filtered belief of each tick.
+   * \return Smoothed belief of each tick, conditioned on all ticks.
+   * \throw std::invalid_argument If sequences have different lengths.
+   */
+  static VectorSequence smooth(const MatrixSequence &transitions,
+                               const VectorSequence &likelihoods,
+                               const VectorSequence &beliefs);
+
+ private:
+  /*! Propagate the backward message through a tick.
+   *
+   * \param[in] transition Transition into the tick.
+   * \param[in] likelihoods Likelihoods of the tick.
+   * \param[in,out] backward Backward message of the tick, replaced by the one
+   * of the previous tick.
+   */
+  static void backward_step(const Matrix &transition,
+                            const Vector &likelihoods, Vector &backward);
+
+  /*! Normalize the product of a filtered belief and a backward message.
+   *
+   * \param[in] belief Filtered belief.
+   * \param[in] backward Backward message.
+   * \return Smoothed belief, the filtered one if the product vanishes.
+   */
+  static Vector combine(const Vector &belief, const Vector &backward);
+
+  //! Number of ticks between the last tick and the smoothed one
+  const size_t lag_;
+
+  //! Ring buffers of the last lag + 1 ticks
+  MatrixSequence transitions_;
+  VectorSequence likelihoods_;
+  VectorSequence beliefs_;
+
+  //! Index of the last tick in the ring buffers
+  size_t last_ = 0;
+
+  //! Number of ticks in the ring buffers
+  size_t size_ = 0;
+
+  //! Smoothed belief
+  Vector smoothed_;
+};
+
+extern template class FixedLagSmoother<2>;
+extern template class FixedLagSmoother<4>;
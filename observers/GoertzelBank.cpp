@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/GoertzelBank.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+GoertzelBank::GoertzelBank(size_t window_size, const std::vector<double> &freqs,
+                           const std::vector<double> &band_edges)
+    : window_size_(window_size), freqs_(freqs), window_(window_size) {
+  if (freqs.size() < 2 || freqs.size() > window_size) {
+    throw std::invalid_argument(
+        "Number of output bins must be in [2, window_size]");
+  }
+  if (band_edges.size() < 2) {
+    throw std::invalid_argument("At least one band is required");
+  }
+
+  // Round band edges to DFT bins
+  const double df = freqs[1] - freqs[0];
+  std::vector<size_t> edge_bins;
+  for (double edge : band_edges) {
+    const long bin = std::lround(edge / df);
+    if (bin < 0 || bin > static_cast<long>(freqs.size())) {
+      throw std::invalid_argument("Band edge " + std::to_string(edge) +
+                                  " Hz is outside of the spectrum");
+    }
+    if (!edge_bins.empty() && static_cast<size_t>(bin) <= edge_bins.back()) {
+      throw std::invalid_argument("Band edge " + std::to_string(edge) +
+                                  " Hz does not start a new DFT bin");
+    }
+    edge_bins.push_back(bin);
+  }
+
+  for (size_t i = 0; i + 1 < edge_bins.size(); ++i) {
+    Band band;
+    band.first_bin = edge_bins[i];
+    band.num_bins = edge_bins[i + 1] - edge_bins[i];
+    band.center_bin = (edge_bins[i] + edge_bins[i + 1] - 1) / 2;
+    band.coeff = 2.0 * std::cos(2.0 * M_PI * band.center_bin / window_size);
+    bands_.push_back(band);
+  }
+  cumulative_mags_.resize(bands_.size(), 0.0);
+}
+
+void GoertzelBank::push(double sample) {
+  const double delta = sample - window_.oldest();
+  window_.push(sample);
+
+  for (auto &band : bands_) {
+    const double s0 = delta + band.coeff * band.s1 - band.s2;
+    band.s2 = band.s1;
+    band.s1 = s0;
+  }
+
+  // Run the shadow resonator on raw samples: after a full window, its state
+  // is the exact state of the sliding one.
+  Band &shadow = bands_[shadow_band_];
+  const double s0 = sample + shadow.coeff * shadow_s1_ - shadow_s2_;
+  shadow_s2_ = shadow_s1_;
+  shadow_s1_ = s0;
+  if (++shadow_count_ == window_size_) {
+    shadow.s1 = shadow_s1_;
+    shadow.s2 = shadow_s2_;
+    shadow_s1_ = 0.0;
+    shadow_s2_ = 0.0;
+    shadow_count_ = 0;
+    shadow_band_ = (shadow_band_ + 1) % bands_.size();
+  }
+
+  // Update band magnitudes and their sums in the same pass
+  double mag_sum{};
+  weighted_freq_sum_ = 0.0;
+  for (size_t b = 0; b < bands_.size(); ++b) {
+    update_magnitude(bands_[b]);
+    mag_sum += bands_[b].magnitude;
+    weighted_freq_sum_ += bands_[b].magnitude * freqs_[bands_[b].center_bin];
+    cumulative_mags_[b] = mag_sum;
+  }
+}
+
+void GoertzelBank::update_magnitude(Band &band) {
+  double bin_mag;
+  if (band.center_bin == 0) {
+    bin_mag = std::abs(window_.sum());
+  } else {
+    const double squared_mag =
+        band.s1 * band.s1 + band.s2 * band.s2 - band.coeff * band.s1 * band.s2;
+    bin_mag = std::sqrt(std::max(squared_mag, 0.0));
+  }
+  band.magnitude = bin_mag * band.num_bins;
+}
+
+double GoertzelBank::band_energy(size_t band) const {
+  const double bin_mag = bands_[band].magnitude / bands_[band].num_bins;
+  return bin_mag * bin_mag * bands_[band].num_bins;
+}
+
+double GoertzelBank::mean_frequency() const {
+  return weighted_freq_sum_ / cumulative_mags_.back();
+}
+
+double GoertzelBank::median_frequency() const {
+  // Same definition as TransitionModel::median_frequency, where the magnitude
+  // of each band is spread uniformly over the bins it covers.
+  const double half_sum = 0.5 * cumulative_mags_.back();
+  const Band &last_band = bands_.back();
+  const double last_freq = freqs_[last_band.first_bin + last_band.num_bins - 1];
+  if (!(half_sum > 0.0)) {
+    // Empty spectrum: same output as TransitionModel::median_frequency
+    return last_freq;
+  }
+
+  auto it = std::lower_bound(cumulative_mags_.begin(), cumulative_mags_.end(),
+                             half_sum);
+  if (it == cumulative_mags_.end()) {
+    return last_freq;
+  }
+
+  const size_t b = it - cumulative_mags_.begin();
+  const Band &band = bands_[b];
+  const double c1 = (b > 0) ? cumulative_mags_[b - 1] : 0.0;
+  const double c2 = cumulative_mags_[b];
+
+  // Linear interpolation over the bins of the band
+  const double f1 = freqs_[(band.first_bin > 0) ? band.first_bin - 1 : 0];
+  const double f2 = freqs_[band.first_bin + band.num_bins - 1];
+  return f1 + (f2 - f1) * (half_sum - c1) / (c2 - c1);
+}
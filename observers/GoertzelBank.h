@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <vector>
+
+#include "observers/RingWindow.h"
+
+/*! Bank of sliding Goertzel filters estimating band magnitudes.
+ *
+ * Each band `[f_low, f_high)` is summarized by one Goertzel resonator tuned to
+ * the DFT bin at its center. The resonator is fed with \f$ x_{new} - x_{old}
+ * \f$, so that its output has the magnitude of that DFT bin over the window,
+ * and each sample costs O(1) per band. The DC bin is read from the running sum
+ * of the window instead, as its resonator would not be stable.
+ *
+ * The magnitude of a band is the magnitude of its center bin times the number
+ * of bins in the band, i.e. the spectrum is assumed flat over each band. Mean
+ * and median frequencies follow the same definitions as the FFT ones, at the
+ * resolution of the bands: with one bin per band, they are equal.
+ *
+ * The resonators are marginally stable, so rounding errors would slowly
+ * accumulate. To bound them, a shadow resonator is run from a zero state over
+ * one full window, then replaces the state of one band, in a round-robin
+ * fashion.
+ */
+class GoertzelBank {
+ public:
+  /*! Initialize the filter bank with an all-zero window.
+   *
+   * \param[in] window_size Number of samples in the window.
+   * \param[in] freqs Frequency of each DFT bin, of size `window_size / 2`.
+   * \param[in] band_edges Increasing band edges in Hz, band i covers
+   * `[band_edges[i], band_edges[i + 1])`. Edges are rounded to the nearest
+   * DFT bin.
+   * \throw std::invalid_argument If two edges round to the same bin, or if
+   * an edge is outside of `[0, nyquist_freq]`.
+   */
+  GoertzelBank(size_t window_size, const std::vector<double> &freqs,
+               const std::vector<double> &band_edges);
+
+  /*! Slide the window by one sample and update all bands.
+   *
+   * \param[in] sample New sample, the oldest one is dropped.
+   */
+  void push(double sample);
+
+  //! Number of bands
+  size_t num_bands() const { return bands_.size(); }
+
+  /*! Energy of a band, i.e. squared magnitude of its center bin times the
+   * number of bins in the band.
+   *
+   * \param[in] band Band index.
+   */
+  double band_energy(size_t band) const;
+
+  //! Magnitude-weighted mean frequency of the bands
+  double mean_frequency() const;
+
+  //! Frequency splitting the band magnitudes in halves
+  double median_frequency() const;
+
+ private:
+  //! Goertzel resonator of a band
+  struct Band {
+    //! First DFT bin of the band
+    size_t first_bin;
+
+    //! Number of DFT bins in the band
+    size_t num_bins;
+
+    //! Center bin the resonator is tuned to
+    size_t center_bin;
+
+    //! Resonator coefficient \f$ 2 \cos(2 \pi k / N) \f$
+    double coeff;
+
+    //! Last two states of the resonator
+    double s1 = 0.0;
+    double s2 = 0.0;
+
+    //! Magnitude of the band
+    double magnitude = 0.0;
+  };
+
+  //! Update the magnitude of a band from its resonator state.
+  void update_magnitude(Band &band);
+
+  //! Number of samples in the window
+  const size_t window_size_;
+
+  //! Frequency of each DFT bin
+  const std::vector<double> freqs_;
+
+  //! Samples in the window
+  RingWindow window_;
+
+  //! Bands, in increasing frequencies
+  std::vector<Band> bands_;
+
+  //! Cumulative sum of band magnitudes
+  std::vector<double> cumulative_mags_;
+
+  //! Sum of magnitude-weighted center frequencies
+  double weighted_freq_sum_ = 0.0;
+
+  //! Band currently resynchronized by the shadow resonator
+  size_t shadow_band_ = 0;
+
+  //! Number of samples fed to the shadow resonator
+  size_t shadow_count_ = 0;
+
+  //! Last two states of the shadow resonator
+  double shadow_s1_ = 0.0;
+  double shadow_s2_ = 0.0;
+};
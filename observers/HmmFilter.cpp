@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/HmmFilter.h"
+
+#include <cmath>
+
+template <int N>
+HmmFilter<N>::HmmFilter(const Vector &belief, double min_probability)
+    : min_probability_(min_probability), belief_(belief) {}
+
+template <int N>
+void HmmFilter<N>::predict(const Matrix &transition) {
+  // Fixed-size product, evaluated into a temporary on the stack
+  belief_ = transition * belief_;
+}
+
+template <int N>
+bool HmmFilter<N>::update(const Vector &likelihoods) {
+  const Vector posterior = likelihoods.cwiseProduct(belief_);
+  const double evidence = posterior.sum();
+  if (!(evidence > 0.0) || !std::isfinite(evidence)) {
+    normalize();
+    return false;
+  }
+  belief_ = posterior / evidence;
+  if (min_probability_ > 0.0) {
+    normalize();
+  }
+  return true;
+}
+
+template <int N>
+bool HmmFilter<N>::normalize() {
+  if (min_probability_ > 0.0) {
+    belief_ = belief_.cwiseMax(min_probability_);
+  }
+  const double mass = belief_.sum();
+  if (!(mass > 0.0) || !std::isfinite(mass)) {
+    return false;
+  }
+  belief_ /= mass;
+  return true;
+}
+
+template class HmmFilter<2>;
+template class HmmFilter<4>;
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#pragma once
+
+#include "Eigen/Core"
+
+/*! Forward filter of a hidden Markov model with a fixed number of states.
+ *
+ * The belief and transition matrices have a size known at compile time, so
+ * that updates do not allocate and are unrolled for small state counts, e.g.
+ * the four contact states of two wheels.
+ *
+ * \tparam N Number of states.
+ */
+template <int N>
+class HmmFilter {
+ public:
+  static_assert(N >= 2, "Hidden Markov models need two states or more");
+
+  //! Distribution over states
+  using Vector = Eigen::Matrix<double, N, 1>;
+
+  //! Transition matrix, whose (i, j) coefficient weighs the transition from
+  //! state j to state i
+  using Matrix = Eigen::Matrix<double, N, N>;
+
+  /*! Initialize the filter.
+   *
+   * \param[in] belief Initial distribution over states.
+   * \param[in] min_probability Floor of the probability of each state after
+   * an update, so that the belief can always recover from strong evidence.
+   */
+  explicit HmmFilter(const Vector &belief, double min_probability = 0.0);
+
+  /*! Reset the belief.
+   *
+   * \param[in] belief Distribution over states.
+   */
+  void reset(const Vector &belief) { belief_ = belief; }
+
+  /*! Propagate the belief through a transition.
+   *
+   * Columns of the transition matrix need not sum to one, as the belief is
+   * normalized by the next update.
+   *
+   * \param[in] transition Transition matrix.
+   */
+  void predict(const Matrix &transition);
+
+  /*! Weigh the predicted belief by the likelihood of each state.
+   *
+   * Likelihoods only matter up to a common factor.
+   *
+   * \param[in] likelihoods Likelihood of the observation in each state.
+   * \return False if the observation has a zero or invalid likelihood in all
+   * predicted states, in which case the belief is only normalized.
+   */
+  bool update(const Vector &likelihoods);
+
+  //! Distribution over states
+  const Vector &belief() const { return belief_; }
+
+ private:
+  /*! Normalize the belief, then apply the floor of state probabilities.
+   *
+   * \return False if the belief has no valid mass to normalize.
+   */
+  bool normalize();
+
+  //! Floor of state probabilities after an update
+  const double min_probability_;
+
+  //! Distribution over states
+  Vector belief_;
+};
+
+extern template class HmmFilter<2>;
+extern template class HmmFilter<4>;
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/LiftingWavelet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/*! Number of coefficients kept at each level.
+ *
+ * \param[in] window_size Number of samples spanned by the coarsest level.
+ * \param[in] num_levels Number of decomposition levels.
+ * \throw std::invalid_argument If the window size is not a multiple of
+ * `2^num_levels`.
+ */
+size_t coefficients_per_level(size_t window_size, size_t num_levels) {
+  if (num_levels < 1 || num_levels >= 32 ||
+      window_size % (size_t{1} << num_levels) != 0 ||
+      window_size < (size_t{1} << num_levels)) {
+    throw std::invalid_argument(
+        "Window size must be a positive multiple of 2^num_levels");
+  }
+  return window_size >> num_levels;
+}
+
+}  // namespace
+
+LiftingWavelet::LiftingWavelet(size_t window_size, size_t num_levels,
+                               double dt)
+    : levels_(num_levels,
+              Level{0.0, false,
+                    RingWindow(coefficients_per_level(window_size,
+                                                      num_levels))}),
+      approximations_(coefficients_per_level(window_size, num_levels)),
+      band_edges_(num_levels + 2, 0.0),
+      band_powers_(num_levels + 1, 0.0),
+      cumulative_mags_(num_levels + 1, 0.0) {
+  if (dt <= 0.0) {
+    throw std::invalid_argument("Time step must be strictly positive!");
+  }
+  // Each level halves the bandwidth of its input
+  const double nyquist_freq = 0.5 / dt;
+  for (size_t b = 1; b < band_edges_.size(); ++b) {
+    band_edges_[b] = nyquist_freq / (size_t{1} << (num_levels + 1 - b));
+  }
+}
+
+void LiftingWavelet::push(double sample) {
+  double x = sample;
+  size_t j = 0;
+  for (; j < levels_.size(); ++j) {
+    Level &level = levels_[j];
+    if (!level.has_even) {
+      level.even = x;
+      level.has_even = true;
+      break;
+    }
+    level.has_even = false;
+
+    // Predict the odd sample from the even one, then update the even sample
+    // into the pair average
+    const double detail = x - level.even;
+    const double average = level.even + 0.5 * detail;
+
+    // Orthonormal coefficients
+    level.details.push(M_SQRT1_2 * detail);
+    x = M_SQRT2 * average;
+  }
+  if (j == levels_.size()) {
+    approximations_.push(x);
+  }
+  if (j > 0) {
+    update_bands();
+  }
+}
+
+void LiftingWavelet::update_bands() {
+  // A coefficient at level j spans 2^(j + 1) samples, and the approximation
+  // spans as many samples as the coarsest details
+  const size_t num_levels = levels_.size();
+  const double num_coeffs = approximations_.size();
+  const double approximation_span = num_coeffs * (size_t{1} << num_levels);
+  band_powers_[0] = approximations_.sum_of_squares() / approximation_span;
+  for (size_t j = 0; j < num_levels; ++j) {
+    const double span = num_coeffs * (size_t{2} << j);
+    band_powers_[num_levels - j] = levels_[j].details.sum_of_squares() / span;
+  }
+
+  // With a flat spectrum over each band, the magnitude of a band is the
+  // square root of its energy times its number of DFT bins
+  double mag_sum{};
+  weighted_freq_sum_ = 0.0;
+  for (size_t b = 0; b < band_powers_.size(); ++b) {
+    const double width = band_edges_[b + 1] - band_edges_[b];
+    const double mag = std::sqrt(band_powers_[b] * width);
+    mag_sum += mag;
+    weighted_freq_sum_ += mag * 0.5 * (band_edges_[b] + band_edges_[b + 1]);
+    cumulative_mags_[b] = mag_sum;
+  }
+}
+
+double LiftingWavelet::power() const {
+  double power{};
+  for (double band_power : band_powers_) {
+    power += band_power;
+  }
+  return power;
+}
+
+double LiftingWavelet::mean_frequency() const {
+  return weighted_freq_sum_ / cumulative_mags_.back();
+}
+
+double LiftingWavelet::median_frequency() const {
+  // Same definition as TransitionModel::median_frequency, where the magnitude
+  // of each band is spread uniformly over its frequencies.
+  const double half_sum = 0.5 * cumulative_mags_.back();
+  if (!(half_sum > 0.0)) {
+    // Empty spectrum: same output as TransitionModel::median_frequency
+    return band_edges_.back();
+  }
+
+  auto it = std::lower_bound(cumulative_mags_.begin(), cumulative_mags_.end(),
+                             half_sum);
+  if (it == cumulative_mags_.end()) {
+    return band_edges_.back();
+  }
+
+  const size_t b = it - cumulative_mags_.begin();
+  const double c1 = (b > 0) ? cumulative_mags_[b - 1] : 0.0;
+  const double c2 = cumulative_mags_[b];
+
+  // Linear interpolation over the band
+  const double f1 = band_edges_[b];
+  const double f2 = band_edges_[b + 1];
+  return f1 + (f2 - f1) * (half_sum - c1) / (c2 - c1);
+}
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <vector>
+
+#include "observers/RingWindow.h"
+
+/*! Incremental multi-level Haar wavelet transform with the lifting scheme.
+ *
+ * Each level splits its input into pairs of even and odd samples. The odd
+ * sample is predicted from the even one, leaving a detail coefficient, then
+ * the even sample is updated into the pair average, which is passed on to the
+ * next level. Coefficients are normalized so that the transform is
+ * orthonormal. A sample costs O(1) amortized, and O(num_levels) at worst.
+ *
+ * Every level keeps a window of its last `window_size / 2^num_levels`
+ * coefficients, so that the finest level only spans a few samples while the
+ * coarsest one spans the full window. Fine scales thus react to short impacts
+ * long before the full window has seen them.
+ *
+ * Bands are indexed by increasing frequencies: band 0 is the approximation,
+ * i.e. \f$ [0, f_s / 2^{L + 1}] \f$ for L levels, and band b > 0 holds the
+ * details of level L - b, i.e. \f$ [f_s / 2^{L - b + 2}, f_s / 2^{L - b + 1}]
+ * \f$.
+ */
+class LiftingWavelet {
+ public:
+  /*! Initialize the transform with all-zero windows.
+   *
+   * \param[in] window_size Number of samples spanned by the coarsest level.
+   * \param[in] num_levels Number of decomposition levels.
+   * \param[in] dt Time step between samples.
+   * \throw std::invalid_argument If the window size is not a multiple of
+   * `2^num_levels`.
+   */
+  LiftingWavelet(size_t window_size, size_t num_levels, double dt);
+
+  /*! Feed a new sample to the finest level.
+   *
+   * \param[in] sample New sample.
+   */
+  void push(double sample);
+
+  //! Number of bands, i.e. detail levels plus the approximation
+  size_t num_bands() const { return band_powers_.size(); }
+
+  /*! Power of a band, i.e. sum of its squared coefficients divided by the
+   * number of samples they span.
+   *
+   * \param[in] band Band index, by increasing frequencies.
+   */
+  double band_power(size_t band) const { return band_powers_[band]; }
+
+  //! Power of the signal, sum of the powers of all bands
+  double power() const;
+
+  //! Magnitude-weighted mean frequency of the bands
+  double mean_frequency() const;
+
+  //! Frequency splitting the band magnitudes in halves
+  double median_frequency() const;
+
+ private:
+  //! Decomposition level
+  struct Level {
+    //! Even sample waiting for its odd sample
+    double even = 0.0;
+
+    //! Whether the even sample has been received
+    bool has_even = false;
+
+    //! Last detail coefficients
+    RingWindow details;
+  };
+
+  //! Update the band statistics after a new coefficient.
+  void update_bands();
+
+  //! Decomposition levels, from the finest to the coarsest
+  std::vector<Level> levels_;
+
+  //! Last approximation coefficients of the coarsest level
+  RingWindow approximations_;
+
+  //! Band edges in Hz, by increasing frequencies
+  std::vector<double> band_edges_;
+
+  //! Power of each band, by increasing frequencies
+  std::vector<double> band_powers_;
+
+  //! Cumulative sum of band magnitudes
+  std::vector<double> cumulative_mags_;
+
+  //! Sum of magnitude-weighted band centers
+  double weighted_freq_sum_ = 0.0;
+};
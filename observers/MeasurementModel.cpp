@@ -5,68 +5,284 @@
 
 #include "observers/MeasurementModel.h"
 
+#include <algorithm>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 
 #include "Eigen/Core"
-#include "observers/utils.h"
 #include "spdlog/spdlog.h"
-#include "tools/cpp/runfiles/runfiles.h"
-#include "upkie/cpp/utils/low_pass_filter.h"
-
-using bazel::tools::cpp::runfiles::Runfiles;
-using upkie::cpp::utils::low_pass_filter;
 
 MeasurementModel::MeasurementModel(const Parameters &params)
-    : leg_name(params.leg_name),
+    : params_(params),
+      leg_names(params.leg_names.empty()
+                    ? std::vector<std::string>{params.leg_name}
+                    : params.leg_names),
       joint_names(params.joint_names),
       cutoff_periods(params.cutoff_periods),
-      filtered_torques(params.joint_names.size()),
+      raw_torques(leg_names.size() * params.joint_names.size()),
+      filtered_torques(leg_names.size() * params.joint_names.size()),
+      likelihoods(leg_names.size(), Likelihoods{0.0, 0.0}),
       dt(params.dt) {
   if (dt <= 0.0) {
     throw std::invalid_argument("Time step must be strictly positive!");
   }
-  // Load the measurement model
-  std::string model_path = find_model_path(params.argv0, params.model_path);
+  if (params.value_keys.size() < 2) {
+    throw std::invalid_argument(
+        "Value keys should start with the contact and no contact likelihoods");
+  }
+  if (params.hot_reload && params.online_adaptation) {
+    throw std::invalid_argument(
+        "Hot reload and online adaptation cannot be enabled together");
+  }
+  if (!params.model_file && !params.resolve_model_path) {
+    throw std::invalid_argument(
+        "Model path \"" + params.model_path +
+        "\" needs resolve_model_path, e.g. runfiles_resolver()");
+  }
+  for (const auto &leg_name : leg_names) {
+    for (const auto &joint_name : joint_names) {
+      servo_keys.push_back(leg_name + "_" + joint_name);
+    }
+  }
+  for (const auto &servo_key : servo_keys) {
+    torque_inputs.emplace_back(
+        std::vector<std::string>{"servo", servo_key, "torque"});
+    torque_outputs.emplace_back(
+        std::vector<std::string>{keys.prefix, servo_key, "torque"});
+  }
+  std::vector<double> channel_cutoff_periods;
+  for (size_t i = 0; i < servo_keys.size(); ++i) {
+    channel_cutoff_periods.push_back(
+        cutoff_periods.at(i % joint_names.size()));
+  }
+  prefilter_ = std::make_unique<TorquePrefilter>(params.prefilter, dt,
+                                                 channel_cutoff_periods);
+  for (size_t j = 0; j < joint_names.size(); ++j) {
+    const TorquePrefilter::Response response = prefilter_->response(j);
+    spdlog::info(
+        "Torque prefilter of the {} joint: {}, group delay {:.1f} ms, noise "
+        "rejection {:.1f} dB",
+        joint_names[j], TorquePrefilter::type_name(params.prefilter.type),
+        1e3 * response.group_delay, response.noise_rejection_db());
+  }
+  likelihood_outputs_.push_back(likelihood_outputs({keys.prefix}));
+  if (leg_names.size() > 1) {
+    for (const auto &leg_name : leg_names) {
+      likelihood_outputs_.push_back(
+          likelihood_outputs({keys.prefix, leg_name}));
+    }
+  }
+  // Load the NpzInterpolator, from the filesystem unless a compiled model is
+  // already in memory. Its path is also needed to watch it for changes.
+  const bool needs_path = !params.model_file ||
+                          (params.hot_reload && params.reload_period > 0.0);
+  const std::string model_path =
+      needs_path ? resolve_path(params.model_path) : "";
+  if (params.model_file) {
+    interpolator = std::make_unique<NpzInterpolator>(
+        /* model_file = */ params.model_file,
+        /* axis_keys = */ params.axis_keys,
+        /* value_keys = */ params.value_keys);
+  } else {
+    interpolator = std::make_unique<NpzInterpolator>(
+        /* npz_path = */ model_path,
+        /* axis_keys = */ params.axis_keys,
+        /* value_keys = */ params.value_keys);
+  }
+  interpolator = prepare_tables(std::move(interpolator), &log_ratio_index);
+  num_values_ = interpolator->num_values();
+  interpolated_values.resize(leg_names.size() * num_values_);
+
+  if (params.online_adaptation) {
+    // Re-estimated tables are stored and locked as the loaded ones
+    OnlineKde::Parameters online_kde_params = params.online_kde;
+    online_kde_params.table_precision = params.table_precision;
+    online_kde_params.lock_tables = params.lock_tables;
+    online_kde_ = std::make_unique<OnlineKde>(*interpolator, log_ratio_index,
+                                              online_kde_params);
+  }
+  if (params.hot_reload) {
+    reloader_ = std::make_unique<ModelReloader>(
+        model_path, params.reload_period,
+        [this](const std::string &path) { return reload_tables(path); });
+  }
+}
+
+std::string MeasurementModel::resolve_path(const std::string &path) const {
+  return params_.resolve_model_path ? params_.resolve_model_path(path) : path;
+}
+
+std::unique_ptr<NpzInterpolator> MeasurementModel::prepare_tables(
+    std::unique_ptr<NpzInterpolator> tables, size_t *ratio_index) const {
+  // Log-likelihood ratio for the log-odds update of the contact filter,
+  // unless the model compiler already computed it
+  const std::vector<std::string> &value_keys = tables->value_keys;
+  const auto log_ratio_key = std::find(value_keys.begin(), value_keys.end(),
+                                       keys.log_likelihood_ratio);
+  *ratio_index =
+      (log_ratio_key != value_keys.end())
+          ? static_cast<size_t>(log_ratio_key - value_keys.begin())
+          : tables->add_log_ratio_table(keys.log_likelihood_ratio, 0, 1);
+
+  if (params_.table_precision != TablePrecision::kDouble) {
+    tables->set_precision(params_.table_precision);
+  }
+  if (params_.lock_tables && !tables->lock_tables()) {
+    spdlog::warn("Failed to lock measurement model tables in RAM");
+  }
+  return tables;
+}
 
-  // Load the NpzInterpolator
-  interpolator = std::make_unique<NpzInterpolator>(
-      /* npz_path = */ model_path,
-      /* axis_keys = */ params.axis_keys,
-      /* value_keys = */ params.value_keys);
+std::unique_ptr<NpzInterpolator> MeasurementModel::reload_tables(
+    const std::string &model_path) const {
+  size_t ratio_index = 0;
+  std::unique_ptr<NpzInterpolator> tables = prepare_tables(
+      std::make_unique<NpzInterpolator>(model_path, params_.axis_keys,
+                                        params_.value_keys),
+      &ratio_index);
+
+  // Buffers of the real-time thread are sized for the current values
+  if (tables->num_values() != num_values_ || ratio_index != log_ratio_index) {
+    throw std::runtime_error(
+        "Reloaded model should have the same values as the current one");
+  }
+  return tables;
+}
+
+MeasurementModel::LikelihoodOutputs MeasurementModel::likelihood_outputs(
+    const std::vector<std::string> &node) const {
+  auto output = [&node](const std::string &key) {
+    std::vector<std::string> path = node;
+    path.push_back(key);
+    return OutputPath(std::move(path));
+  };
+  return LikelihoodOutputs{.contact = output(keys.contact_likelihood),
+                           .no_contact = output(keys.no_contact_likelihood),
+                           .log_ratio = output(keys.log_likelihood_ratio),
+                           .p_contact = output(keys.p_contact)};
+}
+
+void MeasurementModel::reset(const Dictionary &config) {
+  // The spine may restructure the observation dictionary on reset
+  for (auto &input : torque_inputs) {
+    input.unbind();
+  }
+  p_contact_input.unbind();
+  for (auto &output : torque_outputs) {
+    output.unbind();
+  }
+  for (auto &outputs : likelihood_outputs_) {
+    for (OutputPath *output : {&outputs.contact, &outputs.no_contact,
+                               &outputs.log_ratio, &outputs.p_contact}) {
+      output->unbind();
+    }
+  }
+
+  if (!reloader_ || !config.has(keys.prefix) ||
+      !config(keys.prefix).has(keys.model_path)) {
+    return;
+  }
+  // Failures to resolve the path keep the current model, as failures to load
+  // it on the loader thread do, rather than stopping the spine
+  const auto &model_path =
+      config(keys.prefix)(keys.model_path).as<std::string>();
+  std::string resolved_path;
+  try {
+    resolved_path = resolve_path(model_path);
+  } catch (const std::exception &e) {
+    spdlog::error("Failed to resolve measurement model path \"{}\": {}",
+                  model_path, e.what());
+    return;
+  }
+  reloader_->request(resolved_path);
+}
+
+NpzInterpolator *MeasurementModel::current_tables() const {
+  NpzInterpolator *tables = online_kde_ ? online_kde_->acquire() : nullptr;
+  return (tables != nullptr) ? tables : interpolator.get();
 }
 
 void MeasurementModel::read(const Dictionary &observation) {
-  // Read the torques from the observation
-  for (size_t i = 0; i < joint_names.size(); ++i) {
-    auto tau = observation("servo")(leg_name + "_" + joint_names[i])("torque")
-                   .as<double>();
-    filtered_torques[i] = low_pass_filter(
-        /* prev_output = */ filtered_torques[i],
-        /* cutoff_period = */ cutoff_periods[i],
-        /* new_input = */ tau,
-        /* dt = */ dt);
-  }
-
-  // Interpolate the contact likelihood
-  likelihoods = query_likelihoods(filtered_torques);
+  reader_thread_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+  // Swap in a reloaded model at the tick boundary, without blocking
+  if (reloader_) {
+    reloader_->swap(interpolator);
+  }
+
+  // Read the torques from the observation, then filter all of them at once
+  const size_t num_joints = joint_names.size();
+  for (size_t i = 0; i < servo_keys.size(); ++i) {
+    raw_torques[i] = torque_inputs[i](observation).as<double>();
+  }
+  prefilter_->filter(raw_torques.data(), filtered_torques.data());
+
+  // Weight torque samples by the contact posterior of the previous tick
+  const Dictionary *p_contact_node =
+      online_kde_ ? p_contact_input.find(observation) : nullptr;
+  if (p_contact_node != nullptr) {
+    const double p_contact = p_contact_node->as<double>();
+    for (size_t leg = 0; leg < leg_names.size(); ++leg) {
+      const double *point = filtered_torques.data() + leg * num_joints;
+      online_kde_->add_sample(point[0], point[1], p_contact);
+    }
+  }
+
+  // Interpolate the contact likelihoods of all legs at once, without
+  // allocating
+  NpzInterpolator *tables = current_tables();
+  tables->interpolate_points(filtered_torques, interpolated_values.data());
+  const size_t num_values = tables->num_values();
+  for (size_t leg = 0; leg < leg_names.size(); ++leg) {
+    const double *values = interpolated_values.data() + leg * num_values;
+    likelihoods[leg].contact = values[0];
+    likelihoods[leg].no_contact = values[1];
+    likelihoods[leg].log_ratio = values[log_ratio_index];
+  }
 }
 
 void MeasurementModel::write(Dictionary &observation) {
-  observation(prefix())("contact_likelihood") = likelihoods.contact;
-  observation(prefix())("no_contact_likelihood") = likelihoods.no_contact;
-  observation(prefix())("p_contact") =
-      likelihoods.contact / (likelihoods.contact + likelihoods.no_contact);
+  write_likelihoods(0, likelihood_outputs_[0], observation);
+  if (leg_names.size() > 1) {
+    for (size_t leg = 0; leg < leg_names.size(); ++leg) {
+      write_likelihoods(leg, likelihood_outputs_[leg + 1], observation);
+    }
+  }
 
-  for (size_t i = 0; i < joint_names.size(); ++i) {
-    observation(prefix())(leg_name + "_" + joint_names[i])("torque") =
-        filtered_torques[i];
+  for (size_t i = 0; i < servo_keys.size(); ++i) {
+    torque_outputs[i](observation) = filtered_torques[i];
   }
 }
 
+void MeasurementModel::write_likelihoods(size_t leg,
+                                         LikelihoodOutputs &outputs,
+                                         Dictionary &observation) {
+  const Likelihoods &current = likelihoods[leg];
+  outputs.contact(observation) = current.contact;
+  outputs.no_contact(observation) = current.no_contact;
+  outputs.log_ratio(observation) = current.log_ratio;
+  outputs.p_contact(observation) =
+      current.contact / (current.contact + current.no_contact);
+}
+
 MeasurementModel::Likelihoods MeasurementModel::query_likelihoods(
     const std::vector<double> &point) const {
-  std::vector<double> likelihoods = interpolator->interpolate(point);
-  return MeasurementModel::Likelihoods{.contact = likelihoods.at(0),
-                                       .no_contact = likelihoods.at(1)};
+  // Same interpolation as read(), between ticks: acquiring tables from
+  // another thread would release the ones read() is using
+  const std::thread::id reader_thread =
+      reader_thread_.load(std::memory_order_relaxed);
+  if (reader_thread != std::thread::id() &&
+      reader_thread != std::this_thread::get_id()) {
+    throw std::logic_error(
+        "Likelihoods should be queried from the thread that calls read()");
+  }
+  NpzInterpolator *tables = current_tables();
+  std::vector<double> likelihoods(tables->num_values());
+  tables->interpolate(point, likelihoods.data());
+  return MeasurementModel::Likelihoods{
+      .contact = likelihoods.at(0),
+      .no_contact = likelihoods.at(1),
+      .log_ratio = likelihoods.at(log_ratio_index)};
 }
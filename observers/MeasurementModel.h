@@ -3,13 +3,20 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "observers/DictionaryBinding.h"
+#include "observers/ModelReloader.h"
 #include "observers/NpzInterpolator.h"
+#include "observers/OnlineKde.h"
+#include "observers/TorquePrefilter.h"
 #include "palimpsest/Dictionary.h"
 #include "upkie/cpp/observers/Observer.h"
 
@@ -23,8 +30,12 @@ class MeasurementModel : public Observer {
  public:
   //! Parameters to the measurement model
   struct Parameters {
-    //! Path to the executable
-    std::string argv0;
+    /*! Resolve model paths to filesystem paths, e.g. in Bazel runfiles with
+     * runfiles_resolver() from observers/utils.h. Required unless model_file
+     * is set, in which case paths received by reset() are used as given if
+     * it is unset, e.g. by spines that embed their model.
+     */
+    std::function<std::string(const std::string &)> resolve_model_path;
 
     //! Time step between observations
     double dt = 0.001;
@@ -36,6 +47,15 @@ class MeasurementModel : public Observer {
     //! Name of the leg to consider
     std::string leg_name = "left";
 
+    /*! Names of the legs to consider together, e.g. {"left", "right"}.
+     *
+     * Overrides leg_name if not empty. All legs share the same tables, and
+     * their points are interpolated in a single call. Likelihoods of each leg
+     * are written under `measurement_model/<leg>`, while those of the first
+     * leg are also written at the top level as in the single-leg case.
+     */
+    std::vector<std::string> leg_names = {};
+
     //! Axis keys to be loaded from the .npz file, should be the same length as
     //! joint_names and cutoff_periods.
     std::vector<std::string> axis_keys = {"wheel_torque", "knee_torque"};
@@ -47,23 +67,85 @@ class MeasurementModel : public Observer {
     std::vector<std::string> value_keys = {
         "contact_likelihood", "no_contact_likelihood", "P_contact"};
 
-    //! Path to the measurement model
+    /*! Path to the measurement model, either a .npz file or a model compiled
+     * by //observers:compile_model, whose tables are used in place.
+     */
     std::string model_path =
         "contact_agent/observers/data/simulation_measurement_model.npz";
 
+    /*! Compiled model used instead of model_path if set, for instance one
+     * embedded in the binary by ModelFile::embedded.
+     */
+    std::shared_ptr<const ModelFile> model_file;
+
     //! Torque filter cutoff periods, should be the same length as joint_names
     //! and axis_keys
     std::vector<double> cutoff_periods = {0.025, 0.025};
+
+    /*! Filter of the torques at the cutoff periods, first-order by default.
+     * Its group delay and noise rejection are logged for each joint, so that
+     * filters can be compared at the same cutoff.
+     */
+    TorquePrefilter::Parameters prefilter;
+
+    //! Lock the interpolation tables in RAM, e.g. on the robot so that the
+    //! control loop never waits for them to be paged in
+    bool lock_tables = false;
+
+    /*! Precision of the tables read at each tick. Reduced precisions shrink
+     * the tables so that they stay in cache, their interpolation error is
+     * logged at load time.
+     */
+    TablePrecision table_precision = TablePrecision::kDouble;
+
+    /*! Re-estimate the likelihood tables online, e.g. on a new floor or with
+     * worn tires. Ticks add filtered torques to histograms weighted by the
+     * `contact_filter/p_contact` posterior, and a background thread smooths
+     * them into new tables. Needs a uniform 2-D grid.
+     */
+    bool online_adaptation = false;
+
+    //! Parameters of the online re-estimation of likelihood tables
+    OnlineKde::Parameters online_kde;
+
+    /*! Reload the model in the background when the file at model_path
+     * changes, or when reset() receives a `measurement_model/model_path`
+     * configuration, e.g. sent by the agent through the spine. Reloaded
+     * tables are swapped in at the next tick. Not compatible with online
+     * adaptation, which re-estimates the tables loaded at startup.
+     */
+    bool hot_reload = false;
+
+    //! Period between two checks of the model file for changes, in seconds,
+    //! zero to only reload on reset()
+    double reload_period = 1.0;
   };
 
   struct Likelihoods {
     double contact;
     double no_contact;
+
+    //! Log of the ratio of contact to no contact likelihoods, interpolated
+    //! from a table precomputed at load time
+    double log_ratio = 0.0;
+  };
+
+  //! Output keys, too long for the small string buffer of std::string
+  struct Keys {
+    std::string prefix = "measurement_model";
+    std::string contact_likelihood = "contact_likelihood";
+    std::string no_contact_likelihood = "no_contact_likelihood";
+    std::string log_likelihood_ratio = "log_likelihood_ratio";
+    std::string contact_filter = "contact_filter";
+    std::string p_contact = "p_contact";
+    std::string model_path = "model_path";
   };
 
   /*! Initialize observer.
    *
    * \param[in] params Observer parameters.
+   * \throw std::invalid_argument If parameters are inconsistent, e.g. a
+   *     model is loaded from model_path without resolve_model_path.
    */
   explicit MeasurementModel(const Parameters &params);
 
@@ -75,6 +157,19 @@ class MeasurementModel : public Observer {
     return "measurement_model";
   }
 
+  /*! Unbind dictionary paths, and reload the model if the configuration asks
+   * for it.
+   *
+   * Paths are bound again at the next tick. With hot reload enabled, a
+   * `measurement_model/model_path` entry in the configuration reloads the
+   * model from this path in the background, even if it is unchanged. Returns
+   * immediately, and does not throw: paths that cannot be resolved are
+   * logged and the current model is kept.
+   *
+   * \param[in] config Configuration dictionary.
+   */
+  void reset(const Dictionary &config) override;
+
   /*! Read inputs from other observations.
    *
    * \param[in] observation Dictionary to read other observations from.
@@ -88,37 +183,158 @@ class MeasurementModel : public Observer {
   void write(Dictionary &observation) override;
 
   /*! Query the likelihoods for a given point.
+   *
+   * Reads the same tables as read(), hence should be called from the thread
+   * that calls read(), e.g. between two ticks, or before the first one. Does
+   * not swap in reloaded tables, which read() does at the next tick.
    *
    * \param[in] point Point to query, should have the same length and order as
    * Parameters::axis_keys.
    *
-   * \return Pair of likelihoods: contact, no contact.
-
-  */
+   * \return Likelihoods of contact and no contact, and their log-ratio.
+   * \throw std::logic_error If called from another thread than read().
+   */
   Likelihoods query_likelihoods(const std::vector<double> &point) const;
 
+  //! Number of legs
+  size_t num_legs() const { return leg_names.size(); }
+
+  /*! Likelihoods of a leg at the last tick.
+   *
+   * \param[in] leg Leg index, in the order of the leg names.
+   */
+  const Likelihoods &leg_likelihoods(size_t leg) const {
+    return likelihoods[leg];
+  }
+
+  //! Online re-estimation of the likelihood tables, if enabled
+  OnlineKde *online_kde() const { return online_kde_.get(); }
+
+  //! Background reloader of the model, if hot reload is enabled
+  ModelReloader *reloader() const { return reloader_.get(); }
+
  private:
+  /*! Resolve a model path with Parameters::resolve_model_path, if set.
+   *
+   * \param[in] path Model path, e.g. relative to the runfiles.
+   * \return Filesystem path.
+   */
+  std::string resolve_path(const std::string &path) const;
+
+  /*! Prepare loaded tables for interpolation at each tick.
+   *
+   * Adds the log-likelihood ratio table unless the model already has it,
+   * then applies the table precision and locks tables in RAM as configured.
+   *
+   * \param[in] tables Loaded tables.
+   * \param[out] ratio_index Index of the log-likelihood ratio in the values.
+   * \return Prepared tables.
+   */
+  std::unique_ptr<NpzInterpolator> prepare_tables(
+      std::unique_ptr<NpzInterpolator> tables, size_t *ratio_index) const;
+
+  /*! Load and prepare a model for hot reload, from the loader thread.
+   *
+   * \param[in] model_path Path to the model file.
+   * \throw std::runtime_error If the values of the model differ from those
+   * of the current one.
+   */
+  std::unique_ptr<NpzInterpolator> reload_tables(
+      const std::string &model_path) const;
+
+  //! Paths to the likelihoods of a leg in the observation dictionary
+  struct LikelihoodOutputs {
+    OutputPath contact;
+    OutputPath no_contact;
+    OutputPath log_ratio;
+    OutputPath p_contact;
+  };
+
+  /*! Paths to likelihoods under a node of the observation dictionary.
+   *
+   * \param[in] node Keys from the root of the dictionary to the node.
+   */
+  LikelihoodOutputs likelihood_outputs(
+      const std::vector<std::string> &node) const;
+
+  /*! Write the likelihoods of a leg.
+   *
+   * \param[in] leg Leg index.
+   * \param[in] outputs Paths to write likelihoods to.
+   * \param[out] observation Dictionary to write observations to.
+   */
+  void write_likelihoods(size_t leg, LikelihoodOutputs &outputs,
+                         Dictionary &observation);
+
   //! Observer parameters
-  // Parameters params_;
+  const Parameters params_;
 
-  //! Name of the leg to consider
-  std::string leg_name;
+  //! Names of the legs to consider
+  std::vector<std::string> leg_names;
 
   //! List of joint names, in order of axes
   std::vector<std::string> joint_names;
 
+  //! Dictionary keys
+  const Keys keys{};
+
+  //! Servo key of each joint of each leg, e.g. "left_wheel"
+  std::vector<std::string> servo_keys;
+
+  //! Torque inputs, in the order of servo keys, bound at the first tick
+  std::vector<InputPath> torque_inputs;
+
+  //! Contact posterior of the previous tick, for online adaptation
+  InputPath p_contact_input{keys.contact_filter, keys.p_contact};
+
+  //! Filtered torque outputs, in the order of servo keys
+  std::vector<OutputPath> torque_outputs;
+
+  //! Likelihood outputs of the first leg at the top level, then of each leg
+  //! under its name if there are several legs
+  std::vector<LikelihoodOutputs> likelihood_outputs_;
+
   //! Cutoff periods for the low-pass filter
   std::vector<double> cutoff_periods;
 
-  //! Filtered torques
+  //! Torques of all legs read at this tick, in the order of servo keys
+  std::vector<double> raw_torques;
+
+  //! Filtered torques of all legs, one interpolation point per leg
   std::vector<double> filtered_torques;
 
+  //! Filter of the torques of all legs, one channel per servo key
+  std::unique_ptr<TorquePrefilter> prefilter_;
+
   //! NpzInterpolator
   std::unique_ptr<NpzInterpolator> interpolator;
 
-  //! Likelihoods
-  Likelihoods likelihoods;
+  //! Online re-estimation of the tables, if enabled
+  std::unique_ptr<OnlineKde> online_kde_;
+
+  /*! Tables to query at this tick, the latest re-estimated ones if online
+   * adaptation is enabled.
+   */
+  NpzInterpolator *current_tables() const;
+
+  //! Thread that calls read(), unset before the first tick
+  std::atomic<std::thread::id> reader_thread_{std::thread::id()};
+
+  //! Interpolated values, one per value key for each leg
+  std::vector<double> interpolated_values;
+
+  //! Index of the log-likelihood ratio in the interpolated values
+  size_t log_ratio_index{};
+
+  //! Likelihoods of each leg
+  std::vector<Likelihoods> likelihoods;
 
   //! Time step
   double dt;
+
+  //! Number of values of the tables, which reloaded models should match
+  size_t num_values_{};
+
+  //! Background reloader, declared last so that it stops first
+  std::unique_ptr<ModelReloader> reloader_;
 };
@@ -0,0 +1,533 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/MeasurementModelBuilder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#include "cnpy/cnpy.h"
+#include "kiss_fft/kiss_fft.h"
+#include "mpack/mpack.h"
+#include "spdlog/spdlog.h"
+
+namespace {
+
+//! Value keys of the built tables, as loaded by MeasurementModel
+const std::vector<std::string> kValueKeys = {
+    "contact_likelihood", "no_contact_likelihood", "P_contact"};
+
+//! Smallest FFT size of at least n with only 2, 3 and 5 as prime factors
+size_t fft_size(size_t n) {
+  for (;; ++n) {
+    size_t m = n;
+    for (size_t factor : {2, 3, 5}) {
+      while (m % factor == 0) {
+        m /= factor;
+      }
+    }
+    if (m == 1) {
+      return n;
+    }
+  }
+}
+
+/*! Normalized Gaussian kernel truncated at four standard deviations.
+ *
+ * \param[in] bandwidth Standard deviation in grid cells, zero for no
+ * smoothing.
+ * \return Weights from -radius to radius.
+ */
+std::vector<double> gaussian_kernel(double bandwidth) {
+  if (!(bandwidth > 0.0)) {
+    return {1.0};
+  }
+  const int radius = static_cast<int>(std::ceil(4.0 * bandwidth));
+  std::vector<double> kernel(2 * radius + 1);
+  double sum = 0.0;
+  for (int k = -radius; k <= radius; ++k) {
+    const double u = k / bandwidth;
+    kernel[k + radius] = std::exp(-0.5 * u * u);
+    sum += kernel[k + radius];
+  }
+  for (double &weight : kernel) {
+    weight /= sum;
+  }
+  return kernel;
+}
+
+/*! Convolve lines of a table with a symmetric kernel, by FFT.
+ *
+ * \param[in,out] data Table holding the lines.
+ * \param[in] num_lines Number of lines.
+ * \param[in] length Number of points per line.
+ * \param[in] line_stride Offset between the first points of two lines.
+ * \param[in] stride Offset between two points of a line.
+ * \param[in] kernel Kernel weights from -radius to radius.
+ */
+void convolve_lines(double *data, size_t num_lines, size_t length,
+                    size_t line_stride, size_t stride,
+                    const std::vector<double> &kernel) {
+  // Offsets beyond the line cannot move weight between its points, and zero
+  // padding to length + radius keeps circular wrap-around off the line
+  const size_t full_radius = kernel.size() / 2;
+  const size_t radius = std::min(full_radius, length - 1);
+  const size_t n = fft_size(length + radius);
+
+  // The kernel is symmetric, so its spectrum is real
+  std::vector<kiss_fft_cpx> wrapped(n, kiss_fft_cpx{0.0, 0.0});
+  std::vector<kiss_fft_cpx> buffer(n);
+  for (size_t k = 0; k <= radius; ++k) {
+    wrapped[k].r = kernel[full_radius + k];
+    wrapped[(n - k) % n].r = kernel[full_radius + k];
+  }
+  kiss_fft_cfg forward = kiss_fft_alloc(n, false, nullptr, nullptr);
+  kiss_fft_cfg inverse = kiss_fft_alloc(n, true, nullptr, nullptr);
+  kiss_fft(forward, wrapped.data(), buffer.data());
+  std::vector<double> spectrum(n);
+  for (size_t k = 0; k < n; ++k) {
+    spectrum[k] = buffer[k].r / n;
+  }
+
+  // Two lines at a time, in the real and imaginary parts
+  std::vector<kiss_fft_cpx> lines(n);
+  for (size_t line = 0; line < num_lines; line += 2) {
+    double *first = data + line * line_stride;
+    double *second = (line + 1 < num_lines) ? first + line_stride : nullptr;
+    std::fill(lines.begin(), lines.end(), kiss_fft_cpx{0.0, 0.0});
+    for (size_t t = 0; t < length; ++t) {
+      lines[t].r = first[t * stride];
+      lines[t].i = (second != nullptr) ? second[t * stride] : 0.0;
+    }
+    kiss_fft(forward, lines.data(), buffer.data());
+    for (size_t k = 0; k < n; ++k) {
+      buffer[k].r *= spectrum[k];
+      buffer[k].i *= spectrum[k];
+    }
+    kiss_fft(inverse, buffer.data(), lines.data());
+    for (size_t t = 0; t < length; ++t) {
+      first[t * stride] = lines[t].r;
+      if (second != nullptr) {
+        second[t * stride] = lines[t].i;
+      }
+    }
+  }
+  kiss_fft_free(forward);
+  kiss_fft_free(inverse);
+}
+
+/*! Quantile of a set of values.
+ *
+ * \param[in] values Values, reordered in place.
+ * \param[in] q Quantile between zero and one.
+ */
+double quantile(std::vector<double> &values, double q) {
+  const size_t k = static_cast<size_t>(q * (values.size() - 1) + 0.5);
+  std::nth_element(values.begin(), values.begin() + k, values.end());
+  return values[k];
+}
+
+/*! Cutoff period of each servo, joints of the first leg first.
+ *
+ * \param[in] params Parameters of the builder.
+ */
+std::vector<double> servo_cutoff_periods(
+    const MeasurementModelBuilder::Parameters &params) {
+  std::vector<double> cutoff_periods;
+  for (size_t leg = 0; leg < params.leg_names.size(); ++leg) {
+    cutoff_periods.insert(cutoff_periods.end(), params.cutoff_periods.begin(),
+                          params.cutoff_periods.end());
+  }
+  return cutoff_periods;
+}
+
+}  // namespace
+
+MeasurementModelBuilder::SampleReader::SampleReader(const Parameters &params)
+    : params_(params),
+      prefilter_(params.prefilter, params.dt, servo_cutoff_periods(params)) {
+  for (const auto &leg_name : params_.leg_names) {
+    for (const auto &joint_name : params_.joint_names) {
+      servo_keys_.push_back(leg_name + "_" + joint_name);
+    }
+  }
+  raw_torques_.assign(servo_keys_.size(), 0.0);
+  filtered_torques_.assign(servo_keys_.size(), 0.0);
+}
+
+void MeasurementModelBuilder::SampleReader::read(
+    const Dictionary &observation, std::vector<TorqueSample> &samples) {
+  // Same filters as MeasurementModel::read
+  const size_t num_joints = params_.joint_names.size();
+  for (size_t i = 0; i < servo_keys_.size(); ++i) {
+    raw_torques_[i] =
+        observation(keys_.servo)(servo_keys_[i])(keys_.torque).as<double>();
+  }
+  prefilter_.filter(raw_torques_.data(), filtered_torques_.data());
+
+  if (!observation.has(keys_.sim) ||
+      !observation(keys_.sim).has(keys_.contact)) {
+    return;
+  }
+  const Dictionary &contacts = observation(keys_.sim)(keys_.contact);
+  const std::vector<std::string> bodies = contacts.keys();
+  for (size_t leg = 0; leg < params_.leg_names.size(); ++leg) {
+    const std::string &leg_name = params_.leg_names[leg];
+    bool labeled = false;
+    bool contact = false;
+    for (const auto &body : bodies) {
+      if (body.compare(0, leg_name.size(), leg_name) != 0 ||
+          !contacts(body).has(keys_.num_contact_points)) {
+        continue;
+      }
+      labeled = true;
+      contact |=
+          contacts(body)(keys_.num_contact_points).as<uint64_t>() > 0;
+    }
+    if (labeled) {
+      const double *torques = filtered_torques_.data() + leg * num_joints;
+      samples.push_back(TorqueSample{torques[0], torques[1], contact});
+    }
+  }
+}
+
+MeasurementModelBuilder::MeasurementModelBuilder(const Parameters &params)
+    : params_(params) {
+  if (params_.joint_names.size() != 2 || params_.axis_keys.size() != 2 ||
+      params_.cutoff_periods.size() != 2 || params_.grid_size.size() != 2) {
+    throw std::invalid_argument(
+        "Measurement models have two axes: joint names, axis keys, cutoff "
+        "periods and grid sizes should have two entries");
+  }
+  if (params_.leg_names.empty()) {
+    throw std::invalid_argument("At least one leg is needed");
+  }
+  if (!(params_.dt > 0.0)) {
+    throw std::invalid_argument("Time step must be strictly positive!");
+  }
+  if (params_.grid_size[0] < 2 || params_.grid_size[1] < 2) {
+    throw std::invalid_argument("Grids need at least two points per axis");
+  }
+  if (!params_.lower_bounds.empty() || !params_.upper_bounds.empty()) {
+    if (params_.lower_bounds.size() != 2 || params_.upper_bounds.size() != 2 ||
+        !(params_.lower_bounds[0] < params_.upper_bounds[0]) ||
+        !(params_.lower_bounds[1] < params_.upper_bounds[1])) {
+      throw std::invalid_argument(
+          "Grid bounds should be increasing and have one entry per axis");
+    }
+  }
+  if (!(params_.tail_fraction >= 0.0 && params_.tail_fraction < 0.5)) {
+    throw std::invalid_argument("Tail fraction should be in [0, 0.5)");
+  }
+  if (params_.bandwidth_factors.empty() ||
+      *std::min_element(params_.bandwidth_factors.begin(),
+                        params_.bandwidth_factors.end()) <= 0.0) {
+    throw std::invalid_argument(
+        "Bandwidth factors should be strictly positive");
+  }
+}
+
+size_t MeasurementModelBuilder::num_workers() const {
+  if (params_.num_threads > 0) {
+    return params_.num_threads;
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void MeasurementModelBuilder::parallel_for(
+    size_t num_tasks, const std::function<void(size_t)> &task) const {
+  const size_t num_threads = std::min(num_tasks, num_workers());
+  std::atomic<size_t> next_task{0};
+  std::vector<std::exception_ptr> errors(num_threads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      try {
+        for (size_t k = next_task++; k < num_tasks; k = next_task++) {
+          task(k);
+        }
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+std::vector<TorqueSample> MeasurementModelBuilder::read_log(
+    const std::filesystem::path &path, const Parameters &params) {
+  if (!std::filesystem::is_regular_file(path)) {
+    throw std::runtime_error("Log \"" + path.string() + "\" is not a file");
+  }
+
+  // The whole log is loaded by mpack, then parsed one dictionary at a time
+  // whose observation is converted to samples before parsing the next one
+  mpack_tree_t tree;
+  mpack_tree_init_filename(&tree, path.c_str(), 0);
+  Dictionary dictionary;
+  SampleReader reader(params);
+  std::vector<TorqueSample> samples;
+  while (true) {
+    mpack_tree_parse(&tree);
+    const mpack_error_t error = mpack_tree_error(&tree);
+    if (error == mpack_error_eof) {
+      break;
+    } else if (error != mpack_ok) {
+      mpack_tree_destroy(&tree);
+      throw std::runtime_error("Log \"" + path.string() +
+                               "\" is not a valid MessagePack stream");
+    }
+    dictionary.update(mpack_tree_root(&tree));
+    if (dictionary.has("observation")) {
+      reader.read(dictionary("observation"), samples);
+    }
+  }
+  mpack_tree_destroy(&tree);
+  return samples;
+}
+
+void MeasurementModelBuilder::add_logs(
+    const std::vector<std::filesystem::path> &paths) {
+  std::vector<std::vector<TorqueSample>> log_samples(paths.size());
+  parallel_for(paths.size(), [&](size_t k) {
+    log_samples[k] = read_log(paths[k], params_);
+    spdlog::info("Read {} samples from \"{}\"", log_samples[k].size(),
+                 paths[k].string());
+  });
+
+  // Logs are appended in order, so that builds are reproducible
+  for (const auto &samples : log_samples) {
+    add_samples(samples);
+  }
+}
+
+void MeasurementModelBuilder::add_samples(
+    const std::vector<TorqueSample> &samples) {
+  samples_.insert(samples_.end(), samples.begin(), samples.end());
+}
+
+void MeasurementModelBuilder::fit_grid() {
+  std::vector<double> lower = params_.lower_bounds;
+  std::vector<double> upper = params_.upper_bounds;
+  if (lower.empty()) {
+    std::vector<double> coordinates(samples_.size());
+    for (size_t d = 0; d < 2; ++d) {
+      for (size_t k = 0; k < samples_.size(); ++k) {
+        coordinates[k] = (d == 0) ? samples_[k].x : samples_[k].y;
+      }
+      lower.push_back(quantile(coordinates, params_.tail_fraction));
+      upper.push_back(quantile(coordinates, 1.0 - params_.tail_fraction));
+      if (!(upper[d] > lower[d])) {
+        lower[d] -= 0.5;
+        upper[d] += 0.5;
+      }
+    }
+  }
+
+  axis_values_.assign(2, {});
+  for (size_t d = 0; d < 2; ++d) {
+    const size_t num_points = params_.grid_size[d];
+    const double spacing = (upper[d] - lower[d]) / (num_points - 1);
+    for (size_t k = 0; k < num_points; ++k) {
+      axis_values_[d].push_back(lower[d] + k * spacing);
+    }
+  }
+}
+
+void MeasurementModelBuilder::smooth(std::vector<double> &histogram,
+                                     size_t nx, size_t ny, double bandwidth_x,
+                                     double bandwidth_y) {
+  if (bandwidth_y > 0.0) {
+    convolve_lines(histogram.data(), nx, ny, ny, 1,
+                   gaussian_kernel(bandwidth_y));
+  }
+  if (bandwidth_x > 0.0) {
+    convolve_lines(histogram.data(), ny, nx, 1, ny,
+                   gaussian_kernel(bandwidth_x));
+  }
+}
+
+void MeasurementModelBuilder::build() {
+  if (samples_.empty()) {
+    throw std::runtime_error("No samples to build a measurement model from");
+  }
+  fit_grid();
+  const size_t nx = params_.grid_size[0];
+  const size_t ny = params_.grid_size[1];
+  const size_t num_nodes = nx * ny;
+  const double x0 = axis_values_[0].front();
+  const double y0 = axis_values_[1].front();
+  const double dx = axis_values_[0][1] - x0;
+  const double dy = axis_values_[1][1] - y0;
+  const double x1 = axis_values_[0].back();
+  const double y1 = axis_values_[1].back();
+
+  // Nearest-node histograms of both classes, as in OnlineKde::add_sample,
+  // one per chunk of samples then summed
+  const size_t num_chunks = std::min(num_workers(), samples_.size());
+  std::vector<std::vector<double>> chunk_histograms(
+      2 * num_chunks, std::vector<double>(num_nodes, 0.0));
+  parallel_for(num_chunks, [&](size_t chunk) {
+    const size_t begin = chunk * samples_.size() / num_chunks;
+    const size_t end = (chunk + 1) * samples_.size() / num_chunks;
+    for (size_t k = begin; k < end; ++k) {
+      const TorqueSample &sample = samples_[k];
+      if (!(sample.x >= x0 && sample.x <= x1 && sample.y >= y0 &&
+            sample.y <= y1)) {
+        continue;
+      }
+      const size_t i = static_cast<size_t>((sample.x - x0) / dx + 0.5);
+      const size_t j = static_cast<size_t>((sample.y - y0) / dy + 0.5);
+      const size_t c = sample.contact ? 0 : 1;
+      chunk_histograms[2 * chunk + c][i * ny + j] += 1.0;
+    }
+  });
+  std::vector<std::vector<double>> histograms(
+      2, std::vector<double>(num_nodes, 0.0));
+  for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+    for (size_t c = 0; c < 2; ++c) {
+      for (size_t node = 0; node < num_nodes; ++node) {
+        histograms[c][node] += chunk_histograms[2 * chunk + c][node];
+      }
+    }
+  }
+  chunk_histograms.clear();
+
+  // Totals include samples outside of the grid, so that densities integrate
+  // to the fraction of samples on the grid
+  std::vector<double> totals(2, 0.0);
+  for (const TorqueSample &sample : samples_) {
+    totals[sample.contact ? 0 : 1] += 1.0;
+  }
+
+  // Scott's rule from the spread of each class on the grid, in cells
+  std::vector<std::vector<double>> scott_bandwidths(2);
+  std::vector<double> grid_counts(2, 0.0);
+  for (size_t c = 0; c < 2; ++c) {
+    double sum_i = 0.0, sum_j = 0.0, sum_ii = 0.0, sum_jj = 0.0;
+    for (size_t i = 0; i < nx; ++i) {
+      for (size_t j = 0; j < ny; ++j) {
+        const double count = histograms[c][i * ny + j];
+        grid_counts[c] += count;
+        sum_i += count * i;
+        sum_j += count * j;
+        sum_ii += count * i * i;
+        sum_jj += count * j * j;
+      }
+    }
+    const double n = grid_counts[c];
+    if (n < 2.0) {
+      throw std::runtime_error(
+          std::string("Not enough ") + ((c == 0) ? "contact" : "no contact") +
+          " samples on the grid to build a measurement model");
+    }
+    const double sigma_i =
+        std::sqrt(std::max(sum_ii / n - (sum_i / n) * (sum_i / n), 0.0));
+    const double sigma_j =
+        std::sqrt(std::max(sum_jj / n - (sum_j / n) * (sum_j / n), 0.0));
+    const double scale = std::pow(n, -1.0 / 6.0);
+    scott_bandwidths[c] = {scale * sigma_i, scale * sigma_j};
+  }
+
+  // Leave-one-out log-likelihood of each class for each bandwidth, in
+  // parallel. The estimate at a sample without itself is its smoothed bin
+  // minus its own kernel weight, which is the product of the center weights
+  // along each axis.
+  const size_t num_factors = params_.bandwidth_factors.size();
+  std::vector<std::vector<double>> smoothed(2 * num_factors);
+  std::vector<double> scores(2 * num_factors);
+  parallel_for(2 * num_factors, [&](size_t task) {
+    const size_t c = task / num_factors;
+    const double factor = params_.bandwidth_factors[task % num_factors];
+    const double bandwidth_x = factor * scott_bandwidths[c][0];
+    const double bandwidth_y = factor * scott_bandwidths[c][1];
+    smoothed[task] = histograms[c];
+    smooth(smoothed[task], nx, ny, bandwidth_x, bandwidth_y);
+
+    const std::vector<double> kernel_x = gaussian_kernel(bandwidth_x);
+    const std::vector<double> kernel_y = gaussian_kernel(bandwidth_y);
+    const double self_weight =
+        kernel_x[kernel_x.size() / 2] * kernel_y[kernel_y.size() / 2];
+    const double n = grid_counts[c];
+    double score = 0.0;
+    for (size_t node = 0; node < num_nodes; ++node) {
+      const double count = histograms[c][node];
+      if (count > 0.0) {
+        const double density = (smoothed[task][node] - self_weight) /
+                               ((n - 1.0) * dx * dy);
+        score += count * std::log(std::max(density, kMinLikelihood));
+      }
+    }
+    scores[task] = score / n;
+  });
+
+  bandwidths_.assign(2, {});
+  tables_.assign(3, std::vector<double>(num_nodes, 0.0));
+  for (size_t c = 0; c < 2; ++c) {
+    const auto first_score = scores.begin() + c * num_factors;
+    const size_t best =
+        std::max_element(first_score, first_score + num_factors) - first_score;
+    const double factor = params_.bandwidth_factors[best];
+    bandwidths_[c] = {factor * scott_bandwidths[c][0],
+                      factor * scott_bandwidths[c][1]};
+    const double normalization = 1.0 / (totals[c] * dx * dy);
+    const std::vector<double> &density = smoothed[c * num_factors + best];
+    for (size_t node = 0; node < num_nodes; ++node) {
+      tables_[c][node] = std::max(density[node] * normalization, 0.0);
+    }
+    spdlog::info(
+        "{}: {:.0f} samples, bandwidth {:.3g} x Scott's rule ({:.2f} x {:.2f} "
+        "cells), leave-one-out log-likelihood {:.4g}",
+        kValueKeys[c], totals[c], factor, bandwidths_[c][0], bandwidths_[c][1],
+        scores[c * num_factors + best]);
+    if (best == 0 || best + 1 == num_factors) {
+      spdlog::warn("Best bandwidth of {} is at the edge of the candidates",
+                   kValueKeys[c]);
+    }
+  }
+
+  // Contact probability with equal priors, as in MeasurementModel::write
+  for (size_t node = 0; node < num_nodes; ++node) {
+    const double sum = tables_[0][node] + tables_[1][node];
+    tables_[2][node] = (sum > 0.0) ? tables_[0][node] / sum : 0.5;
+  }
+}
+
+void MeasurementModelBuilder::save(const std::string &npz_path) const {
+  if (tables_.empty()) {
+    throw std::runtime_error("Tables should be built before being saved");
+  }
+  const std::vector<size_t> shape = {axis_values_[0].size(),
+                                     axis_values_[1].size()};
+  std::string mode = "w";
+  for (size_t d = 0; d < 2; ++d) {
+    cnpy::npz_save(npz_path, params_.axis_keys[d], axis_values_[d].data(),
+                   {axis_values_[d].size()}, mode);
+    mode = "a";
+  }
+  for (size_t v = 0; v < kValueKeys.size(); ++v) {
+    cnpy::npz_save(npz_path, kValueKeys[v], tables_[v].data(), shape, mode);
+  }
+}
+
+std::unique_ptr<NpzInterpolator> MeasurementModelBuilder::interpolator()
+    const {
+  if (tables_.empty()) {
+    throw std::runtime_error("Tables should be built before being queried");
+  }
+  return std::make_unique<NpzInterpolator>(params_.axis_keys, axis_values_,
+                                           kValueKeys, tables_);
+}
@@ -0,0 +1,242 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "observers/NpzInterpolator.h"
+#include "observers/TorquePrefilter.h"
+#include "palimpsest/Dictionary.h"
+
+using palimpsest::Dictionary;
+
+//! Filtered torques of one leg at one tick, labeled from ground truth
+struct TorqueSample {
+  //! Filtered torque of the first joint, e.g. the wheel
+  double x;
+
+  //! Filtered torque of the second joint, e.g. the knee
+  double y;
+
+  //! Whether the leg was in contact with the ground
+  bool contact;
+};
+
+/*! Build a measurement model from labeled logs.
+ *
+ * Torques are filtered as in MeasurementModel::read and labeled from the
+ * contact points of the simulator, then binned on a uniform grid. Each class
+ * is smoothed by a Gaussian kernel, through FFT convolution, whose bandwidth
+ * maximizes the leave-one-out likelihood of its samples. The resulting tables
+ * are those of the .npz models loaded by NpzInterpolator.
+ */
+class MeasurementModelBuilder {
+ public:
+  //! Parameters of the builder
+  struct Parameters {
+    //! Time step between observations
+    double dt = 0.001;
+
+    //! Joint names, in order of axes, as in MeasurementModel::Parameters
+    std::vector<std::string> joint_names = {"wheel", "knee"};
+
+    //! Legs whose samples are pooled in the same tables
+    std::vector<std::string> leg_names = {"left"};
+
+    //! Axis keys of the tables, one per joint
+    std::vector<std::string> axis_keys = {"wheel_torque", "knee_torque"};
+
+    //! Torque filter cutoff periods, one per joint
+    std::vector<double> cutoff_periods = {0.025, 0.025};
+
+    //! Torque filter, which should be that of the measurement model
+    TorquePrefilter::Parameters prefilter;
+
+    //! Number of grid points along each axis
+    std::vector<size_t> grid_size = {200, 200};
+
+    //! First and last grid points along each axis, empty to fit the samples
+    std::vector<double> lower_bounds;
+    std::vector<double> upper_bounds;
+
+    //! Fraction of samples left out on each side when fitting the grid, so
+    //! that outliers do not stretch it
+    double tail_fraction = 1e-3;
+
+    //! Bandwidths tried by cross-validation, relative to Scott's rule
+    std::vector<double> bandwidth_factors = {0.125, 0.177, 0.25, 0.354, 0.5,
+                                             0.707, 1.0,   1.414, 2.0};
+
+    //! Number of worker threads, zero for one per hardware thread
+    size_t num_threads = 0;
+  };
+
+  //! Keys read from observations
+  struct Keys {
+    //! Torques are read from `servo/<leg>_<joint>/torque`
+    const std::string servo = "servo";
+    const std::string torque = "torque";
+
+    //! Ground truth is read from `sim/contact/<body>/num_contact_points`,
+    //! for all bodies whose name starts with the leg name, as the unsigned
+    //! integer that nonnegative MessagePack integers are deserialized to
+    const std::string sim = "sim";
+    const std::string contact = "contact";
+    const std::string num_contact_points = "num_contact_points";
+  };
+
+  /*! Filter and label the torques of a log, one observation at a time.
+   *
+   * Filter states persist between observations, hence one reader per log.
+   */
+  class SampleReader {
+   public:
+    //! Start reading a log.
+    explicit SampleReader(const Parameters &params);
+
+    /*! Filter torques of an observation and label them.
+     *
+     * Observations without ground truth update the filters but are not
+     * labeled.
+     *
+     * \param[in] observation Observation dictionary.
+     * \param[out] samples Receives one sample per leg.
+     */
+    void read(const Dictionary &observation,
+              std::vector<TorqueSample> &samples);
+
+   private:
+    //! Parameters of the builder
+    const Parameters params_;
+
+    //! Keys read from observations
+    const Keys keys_;
+
+    //! Servo keys, joints of the first leg first
+    std::vector<std::string> servo_keys_;
+
+    //! Torques read from the observation, in the order of servo keys
+    std::vector<double> raw_torques_;
+
+    //! Filtered torques, in the order of servo keys
+    std::vector<double> filtered_torques_;
+
+    //! Filter of the torques, one channel per servo key
+    TorquePrefilter prefilter_;
+  };
+
+  /*! Check parameters.
+   *
+   * \param[in] params Parameters of the builder.
+   * \throw std::invalid_argument If parameters are not those of a 2-D model.
+   */
+  explicit MeasurementModelBuilder(const Parameters &params);
+
+  /*! Read .mpack logs, in parallel.
+   *
+   * \param[in] paths Paths to the logs.
+   * \throw std::runtime_error If a log cannot be read.
+   */
+  void add_logs(const std::vector<std::filesystem::path> &paths);
+
+  /*! Read one .mpack log, see add_logs.
+   *
+   * \param[in] path Path to the log.
+   * \param[in] params Parameters of the builder.
+   * \return Labeled samples of the log.
+   * \throw std::runtime_error If the log is not a file or not a valid
+   * MessagePack stream.
+   */
+  static std::vector<TorqueSample> read_log(const std::filesystem::path &path,
+                                            const Parameters &params);
+
+  /*! Add labeled samples, e.g. extracted by a SampleReader.
+   *
+   * \param[in] samples Labeled samples.
+   */
+  void add_samples(const std::vector<TorqueSample> &samples);
+
+  /*! Estimate the tables from all samples so far.
+   *
+   * \throw std::runtime_error If there are no samples of either class.
+   */
+  void build();
+
+  /*! Save the tables built last as a .npz measurement model.
+   *
+   * \param[in] npz_path Path to the .npz file.
+   */
+  void save(const std::string &npz_path) const;
+
+  /*! Interpolator of the tables built last.
+   *
+   * Values are `contact_likelihood`, `no_contact_likelihood` and
+   * `P_contact`, as in MeasurementModel::Parameters::value_keys.
+   */
+  std::unique_ptr<NpzInterpolator> interpolator() const;
+
+  //! Number of samples so far, of both classes
+  size_t num_samples() const { return samples_.size(); }
+
+  //! Grid points along each axis, set by build()
+  const std::vector<std::vector<double>> &axis_values() const {
+    return axis_values_;
+  }
+
+  //! Bandwidths of the contact and no contact kernels, in grid cells along
+  //! each axis, set by build()
+  const std::vector<std::vector<double>> &bandwidths() const {
+    return bandwidths_;
+  }
+
+  /*! Smooth a histogram with a Gaussian kernel, by FFT convolution.
+   *
+   * The kernel is separable: each axis is convolved in turn, two rows at a
+   * time in the real and imaginary parts of a complex FFT. Weight leaving the
+   * grid is lost, as for a kernel density estimate truncated to the grid.
+   *
+   * \param[in,out] histogram Weights at grid nodes, in row-major order.
+   * \param[in] nx Number of grid points along the first axis.
+   * \param[in] ny Number of grid points along the second axis.
+   * \param[in] bandwidth_x Standard deviation along the first axis, in cells.
+   * \param[in] bandwidth_y Standard deviation along the second axis, in
+   * cells.
+   */
+  static void smooth(std::vector<double> &histogram, size_t nx, size_t ny,
+                     double bandwidth_x, double bandwidth_y);
+
+ private:
+  //! Grid of the tables, from the parameters or fitted to the samples.
+  void fit_grid();
+
+  //! Number of worker threads
+  size_t num_workers() const;
+
+  /*! Run tasks on the worker threads.
+   *
+   * \param[in] num_tasks Number of tasks.
+   * \param[in] task Function called once with each task index.
+   */
+  void parallel_for(size_t num_tasks,
+                    const std::function<void(size_t)> &task) const;
+
+  //! Parameters of the builder
+  const Parameters params_;
+
+  //! Labeled samples of all logs so far
+  std::vector<TorqueSample> samples_;
+
+  //! Grid points along each axis
+  std::vector<std::vector<double>> axis_values_;
+
+  //! Contact and no contact likelihoods, then the contact probability
+  std::vector<std::vector<double>> tables_;
+
+  //! Kernel bandwidths of each class, in cells along each axis
+  std::vector<std::vector<double>> bandwidths_;
+};
@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/ModelFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+//! Round a byte offset up to the alignment of model arrays
+size_t align_offset(size_t offset) {
+  return (offset + kModelFileAlignment - 1) / kModelFileAlignment *
+         kModelFileAlignment;
+}
+
+//! Throw an error about an invalid model.
+[[noreturn]] void invalid_model(const std::string &reason) {
+  throw std::runtime_error("Invalid compiled model: " + reason);
+}
+
+//! Copy a key into a descriptor, checking its length.
+void copy_key(const std::string &key, ModelFileArray &array) {
+  if (key.size() > kMaxModelKeyLength) {
+    throw std::invalid_argument("Key \"" + key + "\" is longer than " +
+                                std::to_string(kMaxModelKeyLength) +
+                                " characters");
+  }
+  std::memcpy(array.key, key.data(), key.size());
+}
+
+}  // namespace
+
+uint64_t fnv1a_hash(const uint8_t *data, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+ModelFile::ModelFile(const void *data, size_t size, bool verify_checksum)
+    : data_(static_cast<const uint8_t *>(data)),
+      header_(static_cast<const ModelFileHeader *>(data)),
+      arrays_(reinterpret_cast<const ModelFileArray *>(data_ +
+                                                        sizeof(*header_))),
+      num_nodes_(1) {
+  if (reinterpret_cast<uintptr_t>(data) % alignof(double) != 0) {
+    invalid_model("data is not aligned for doubles");
+  }
+  if (size < sizeof(ModelFileHeader) ||
+      std::memcmp(header_->magic, kModelFileMagic, sizeof(kModelFileMagic))) {
+    invalid_model("missing signature");
+  }
+  if (header_->version != kModelFileVersion) {
+    invalid_model("version " + std::to_string(header_->version) +
+                  " is not the supported version " +
+                  std::to_string(kModelFileVersion));
+  }
+  if (header_->byte_order != kModelFileByteOrder) {
+    invalid_model("byte order differs from the host one");
+  }
+  if (header_->file_size != size) {
+    invalid_model("expected " + std::to_string(header_->file_size) +
+                  " bytes, got " + std::to_string(size));
+  }
+
+  // Descriptors, then axes, then nodes, all within the model
+  const size_t num_arrays = size_t{header_->num_axes} + header_->num_values;
+  const size_t arrays_end =
+      sizeof(ModelFileHeader) + num_arrays * sizeof(ModelFileArray);
+  if (header_->num_axes == 0 || arrays_end > size) {
+    invalid_model("truncated array descriptors");
+  }
+  for (size_t k = 0; k < num_arrays; ++k) {
+    if (arrays_[k].key[kMaxModelKeyLength] != '\0') {
+      invalid_model("key is not null-terminated");
+    }
+  }
+  for (size_t axis = 0; axis < header_->num_axes; ++axis) {
+    const ModelFileArray &array = arrays_[axis];
+    if (array.offset % kModelFileAlignment != 0 || array.offset < arrays_end ||
+        array.offset > size || array.size == 0 ||
+        array.size > (size - array.offset) / sizeof(double)) {
+      invalid_model("axis \"" + std::string(array.key) + "\" out of bounds");
+    }
+    if (num_nodes_ > SIZE_MAX / array.size) {
+      invalid_model("number of grid nodes overflows");
+    }
+    num_nodes_ *= array.size;
+  }
+  const size_t nodes_offset = header_->nodes_offset;
+  const size_t node_size = size_t{header_->num_values} * sizeof(double);
+  if (nodes_offset % kModelFileAlignment != 0 || nodes_offset < arrays_end ||
+      nodes_offset > size ||
+      (node_size != 0 && num_nodes_ > (size - nodes_offset) / node_size) ||
+      nodes_offset + num_nodes_ * node_size != size) {
+    invalid_model("node array does not end the model");
+  }
+  for (size_t value = 0; value < header_->num_values; ++value) {
+    const ModelFileArray &array = arrays_[header_->num_axes + value];
+    if (array.offset != nodes_offset + value * sizeof(double) ||
+        array.size != num_nodes_) {
+      invalid_model("value \"" + std::string(array.key) +
+                    "\" does not match the node array");
+    }
+  }
+
+  if (verify_checksum &&
+      fnv1a_hash(data_ + sizeof(ModelFileHeader),
+                 size - sizeof(ModelFileHeader)) != header_->checksum) {
+    invalid_model("checksum mismatch");
+  }
+}
+
+std::shared_ptr<const ModelFile> ModelFile::map(const std::string &path,
+                                                bool verify_checksum) {
+  const int fildes = open(path.c_str(), O_RDONLY);
+  if (fildes == -1) {
+    throw std::runtime_error("Failed to open compiled model \"" + path + "\"");
+  }
+  struct stat sb;
+  if (fstat(fildes, &sb) == -1 || sb.st_size == 0) {
+    close(fildes);
+    throw std::runtime_error("Failed to stat compiled model \"" + path + "\"");
+  }
+  const size_t size = static_cast<size_t>(sb.st_size);
+  void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fildes, 0);
+  close(fildes);  // the mapping stays valid
+  if (addr == MAP_FAILED) {
+    throw std::runtime_error("Failed to map compiled model \"" + path + "\"");
+  }
+
+  // Unmap on the way out if validation throws
+  std::shared_ptr<const void> mapping(
+      addr, [size](const void *ptr) { munmap(const_cast<void *>(ptr), size); });
+  auto model_file = std::make_shared<ModelFile>(addr, size, verify_checksum);
+  model_file->mapping_ = std::move(mapping);
+  return model_file;
+}
+
+std::shared_ptr<const ModelFile> ModelFile::embedded(
+    const EmbeddedModel &model) {
+  return std::make_shared<const ModelFile>(model.data, model.size,
+                                           /* verify_checksum = */ false);
+}
+
+std::vector<uint8_t> serialize_model(
+    const std::vector<std::string> &axis_keys,
+    const std::vector<std::vector<double>> &axis_values,
+    const std::vector<std::string> &value_keys, const double *nodes) {
+  if (axis_keys.empty() || axis_keys.size() != axis_values.size()) {
+    throw std::invalid_argument("There should be one axis per axis key");
+  }
+
+  // Layout of the file
+  const size_t num_axes = axis_keys.size();
+  const size_t num_values = value_keys.size();
+  std::vector<ModelFileArray> arrays(num_axes + num_values, ModelFileArray{});
+  size_t offset = sizeof(ModelFileHeader) + arrays.size() * sizeof(arrays[0]);
+  size_t num_nodes = 1;
+  for (size_t axis = 0; axis < num_axes; ++axis) {
+    copy_key(axis_keys[axis], arrays[axis]);
+    arrays[axis].offset = offset;
+    arrays[axis].size = axis_values[axis].size();
+    offset = align_offset(offset + arrays[axis].size * sizeof(double));
+    num_nodes *= arrays[axis].size;
+  }
+  const size_t nodes_offset = offset;
+  for (size_t value = 0; value < num_values; ++value) {
+    ModelFileArray &array = arrays[num_axes + value];
+    copy_key(value_keys[value], array);
+    array.offset = nodes_offset + value * sizeof(double);
+    array.size = num_nodes;
+  }
+  const size_t file_size =
+      nodes_offset + num_nodes * num_values * sizeof(double);
+
+  // Fill the file in memory, then hash everything after the header
+  std::vector<uint8_t> buffer(file_size, 0);
+  std::memcpy(buffer.data() + sizeof(ModelFileHeader), arrays.data(),
+              arrays.size() * sizeof(arrays[0]));
+  for (size_t axis = 0; axis < num_axes; ++axis) {
+    std::memcpy(buffer.data() + arrays[axis].offset, axis_values[axis].data(),
+                arrays[axis].size * sizeof(double));
+  }
+  std::memcpy(buffer.data() + nodes_offset, nodes,
+              num_nodes * num_values * sizeof(double));
+  ModelFileHeader header{};
+  std::memcpy(header.magic, kModelFileMagic, sizeof(kModelFileMagic));
+  header.version = kModelFileVersion;
+  header.byte_order = kModelFileByteOrder;
+  header.num_axes = static_cast<uint32_t>(num_axes);
+  header.num_values = static_cast<uint32_t>(num_values);
+  header.file_size = file_size;
+  header.nodes_offset = nodes_offset;
+  header.checksum = fnv1a_hash(buffer.data() + sizeof(header),
+                               file_size - sizeof(header));
+  std::memcpy(buffer.data(), &header, sizeof(header));
+  return buffer;
+}
+
+void write_model_file(const std::string &path,
+                      const std::vector<uint8_t> &model) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(model.data()), model.size());
+  if (!file) {
+    throw std::runtime_error("Failed to write compiled model \"" + path +
+                             "\"");
+  }
+}
@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! Extension of compiled model files
+inline constexpr char kModelFileExtension[] = ".cmodel";
+
+//! Signature at the beginning of compiled model files
+inline constexpr char kModelFileMagic[8] = {'C', 'T', 'C', 'M',
+                                            'O', 'D', 'E', 'L'};
+
+//! Version of the compiled model format, bumped on any layout change
+inline constexpr uint32_t kModelFileVersion = 1;
+
+//! Byte-order mark, read back differently on a host of the other endianness
+inline constexpr uint32_t kModelFileByteOrder = 0x01020304;
+
+//! Alignment of the header, array descriptors and arrays, one cache line
+inline constexpr size_t kModelFileAlignment = 64;
+
+//! Maximum length of axis and value keys in compiled model files
+inline constexpr size_t kMaxModelKeyLength = 47;
+
+/*! Header of a compiled model file.
+ *
+ * The header is followed by one ModelFileArray per axis, then one per value,
+ * then by the axis arrays and finally by the node array, where the values of
+ * all tables are interleaved per grid node. All arrays hold doubles in host
+ * byte order and start at a multiple of kModelFileAlignment.
+ */
+struct ModelFileHeader {
+  //! File signature, kModelFileMagic
+  char magic[8];
+
+  //! Format version, kModelFileVersion
+  uint32_t version;
+
+  //! Byte-order mark, kModelFileByteOrder
+  uint32_t byte_order;
+
+  //! Number of grid axes
+  uint32_t num_axes;
+
+  //! Number of values per grid node
+  uint32_t num_values;
+
+  //! Size of the whole file in bytes
+  uint64_t file_size;
+
+  //! Offset of the node array in bytes
+  uint64_t nodes_offset;
+
+  //! 64-bit FNV-1a hash of all bytes after the header
+  uint64_t checksum;
+
+  //! Padding up to kModelFileAlignment, zero
+  uint8_t reserved[16];
+};
+
+static_assert(sizeof(ModelFileHeader) == kModelFileAlignment);
+
+//! Descriptor of an axis or value array in a compiled model file
+struct ModelFileArray {
+  //! Key of the array, null-terminated
+  char key[kMaxModelKeyLength + 1];
+
+  //! Offset of the first element in bytes
+  uint64_t offset;
+
+  //! Number of elements. Elements of an axis are contiguous, while those of a
+  //! value are `num_values` apart in the node array.
+  uint64_t size;
+};
+
+static_assert(sizeof(ModelFileArray) == kModelFileAlignment);
+
+//! Compiled model embedded in a binary by the embedded_model Bazel macro
+struct EmbeddedModel {
+  //! Beginning of the model, aligned to kModelFileAlignment
+  const uint8_t *data;
+
+  //! Size of the model in bytes
+  size_t size;
+
+  //! Name of the .npz file the model was compiled from
+  const char *source;
+};
+
+/*! Read-only view of a compiled model, validated once and used in place.
+ *
+ * Compiled models are produced from .npz files by //observers:compile_model.
+ * Unlike .npz files, they need neither inflation nor parsing: arrays are read
+ * directly from memory, either a read-only mapping of the file or a model
+ * embedded in the binary.
+ */
+class ModelFile {
+ public:
+  /*! Validate a compiled model held in memory, without copying it.
+   *
+   * \param[in] data Beginning of the model, aligned for doubles. The memory
+   * should outlive this object.
+   * \param[in] size Size of the model in bytes.
+   * \param[in] verify_checksum Check the hash of the whole model, which reads
+   * every byte of it once.
+   * \throw std::runtime_error If the model is truncated, inconsistent, of
+   * another version or byte order, or if its checksum does not match.
+   */
+  ModelFile(const void *data, size_t size, bool verify_checksum = true);
+
+  /*! Map a compiled model file read-only in memory.
+   *
+   * \param[in] path Path to the file.
+   * \param[in] verify_checksum Check the hash of the whole file.
+   * \return Model, which keeps the mapping alive.
+   * \throw std::runtime_error If the file cannot be mapped or is invalid.
+   */
+  static std::shared_ptr<const ModelFile> map(const std::string &path,
+                                              bool verify_checksum = true);
+
+  /*! View a model embedded in the binary, without any filesystem access.
+   *
+   * The checksum is not verified, since the model was validated when it was
+   * built into the binary.
+   *
+   * \param[in] model Embedded model.
+   * \throw std::runtime_error If the model is invalid.
+   */
+  static std::shared_ptr<const ModelFile> embedded(const EmbeddedModel &model);
+
+  //! Number of grid axes
+  size_t num_axes() const { return header_->num_axes; }
+
+  //! Number of values per grid node
+  size_t num_values() const { return header_->num_values; }
+
+  //! Number of grid nodes, the product of axis sizes
+  size_t num_nodes() const { return num_nodes_; }
+
+  //! Key of an axis
+  std::string_view axis_key(size_t axis) const { return arrays_[axis].key; }
+
+  //! Number of grid points along an axis
+  size_t axis_size(size_t axis) const { return arrays_[axis].size; }
+
+  //! Grid points along an axis
+  const double *axis(size_t axis) const {
+    return reinterpret_cast<const double *>(data_ + arrays_[axis].offset);
+  }
+
+  //! Key of a value
+  std::string_view value_key(size_t value) const {
+    return arrays_[header_->num_axes + value].key;
+  }
+
+  //! Values of all tables interleaved per grid node, in row-major order of
+  //! the nodes
+  const double *nodes() const {
+    return reinterpret_cast<const double *>(data_ + header_->nodes_offset);
+  }
+
+ private:
+  //! Beginning of the model
+  const uint8_t *data_;
+
+  //! Header of the model
+  const ModelFileHeader *header_;
+
+  //! Descriptors of the axes followed by those of the values
+  const ModelFileArray *arrays_;
+
+  //! Number of grid nodes
+  size_t num_nodes_;
+
+  //! Memory mapping of the file, if the model was mapped
+  std::shared_ptr<const void> mapping_;
+};
+
+/*! Hash bytes with 64-bit FNV-1a.
+ *
+ * \param[in] data Bytes to hash.
+ * \param[in] size Number of bytes.
+ */
+uint64_t fnv1a_hash(const uint8_t *data, size_t size);
+
+/*! Lay out axes and tables as a compiled model.
+ *
+ * \param[in] axis_keys Key of each axis.
+ * \param[in] axis_values Grid points along each axis.
+ * \param[in] value_keys Key of each value.
+ * \param[in] nodes Values of all tables interleaved per grid node, in
+ * row-major order of the nodes.
+ * \return Bytes of the compiled model.
+ * \throw std::invalid_argument If keys are too long or sizes do not match.
+ */
+std::vector<uint8_t> serialize_model(
+    const std::vector<std::string> &axis_keys,
+    const std::vector<std::vector<double>> &axis_values,
+    const std::vector<std::string> &value_keys, const double *nodes);
+
+/*! Write a compiled model file.
+ *
+ * \param[in] path Path to the output file.
+ * \param[in] model Bytes of the compiled model.
+ * \throw std::runtime_error If the file cannot be written.
+ */
+void write_model_file(const std::string &path,
+                      const std::vector<uint8_t> &model);
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/ModelReloader.h"
+
+#include <chrono>
+#include <exception>
+#include <system_error>
+#include <utility>
+
+#include "spdlog/spdlog.h"
+
+ModelReloader::ModelReloader(const std::string &path, double watch_period,
+                             Loader loader)
+    : watch_period_(watch_period),
+      loader_(std::move(loader)),
+      path_(path),
+      last_stamp_(stamp(path)) {
+  thread_ = std::thread(&ModelReloader::run, this);
+}
+
+ModelReloader::~ModelReloader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  delete pending_.load();
+  delete retired_.load();
+}
+
+void ModelReloader::request(const std::string &path) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    requested_ = true;
+  }
+  condition_.notify_all();
+}
+
+ModelReloader::FileStamp ModelReloader::stamp(const std::string &path) {
+  // Files being replaced may vanish for a moment, which is not an error
+  std::error_code error;
+  FileStamp file_stamp;
+  file_stamp.time = std::filesystem::last_write_time(path, error);
+  file_stamp.size = std::filesystem::file_size(path, error);
+  return error ? FileStamp{} : file_stamp;
+}
+
+void ModelReloader::run() {
+  const auto period = std::chrono::duration<double>(watch_period_);
+  const auto woken = [this] { return stop_ || requested_; };
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    if (watch_period_ > 0.0) {
+      condition_.wait_for(lock, period, woken);
+    } else {
+      condition_.wait(lock, woken);
+    }
+    if (stop_) {
+      return;
+    }
+    const bool requested = requested_;
+    const std::string path = path_;
+    requested_ = false;
+    lock.unlock();
+
+    // Release the tables swapped out since the last check
+    delete retired_.exchange(nullptr);
+
+    const FileStamp current_stamp = stamp(path);
+    if (requested || !(current_stamp == last_stamp_)) {
+      last_stamp_ = current_stamp;
+      reload(path);
+    }
+    lock.lock();
+  }
+}
+
+void ModelReloader::reload(const std::string &path) {
+  std::unique_ptr<NpzInterpolator> tables;
+  try {
+    tables = loader_(path);
+  } catch (const std::exception &e) {
+    spdlog::error("Failed to reload measurement model \"{}\": {}", path,
+                  e.what());
+    return;
+  }
+  num_loads_.fetch_add(1);
+
+  // Tables that the real-time thread did not swap in yet are superseded
+  delete pending_.exchange(tables.release());
+  spdlog::info("Reloaded measurement model \"{}\"", path);
+}
@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "observers/NpzInterpolator.h"
+
+/*! Reload measurement models in the background, while the real-time thread
+ * keeps interpolating the current ones.
+ *
+ * A loader thread reloads the model when its file changes, or on request,
+ * and publishes the new tables in a pending slot. At its next tick, the
+ * real-time thread swaps them with its current tables, which go to a retired
+ * slot that the loader thread releases. The swap exchanges atomic pointers:
+ * it neither blocks nor allocates, and tables are never released by the
+ * real-time thread.
+ */
+class ModelReloader {
+ public:
+  /*! Load a model from its path, e.g. a .npz file or a compiled model.
+   *
+   * Called by the loader thread. Exceptions are logged and the current
+   * tables kept.
+   */
+  using Loader =
+      std::function<std::unique_ptr<NpzInterpolator>(const std::string &)>;
+
+  /*! Start the loader thread.
+   *
+   * \param[in] path Path to the model file.
+   * \param[in] watch_period Period in seconds between two checks of the
+   * modification time of the model file, zero to only reload on request.
+   * \param[in] loader Function loading a model from its path.
+   */
+  ModelReloader(const std::string &path, double watch_period, Loader loader);
+
+  //! Stop the loader thread and release pending and retired tables.
+  ~ModelReloader();
+
+  ModelReloader(const ModelReloader &) = delete;
+  ModelReloader &operator=(const ModelReloader &) = delete;
+
+  /*! Ask the loader thread to reload a model, e.g. from a new path.
+   *
+   * Returns immediately. Subsequent file changes are watched at the new path.
+   *
+   * \param[in] path Path to the model file.
+   */
+  void request(const std::string &path);
+
+  /*! Swap in the latest reloaded tables, if any, at a tick boundary.
+   *
+   * Should only be called by the real-time thread. Does not block, allocate
+   * or release memory.
+   *
+   * \param[in,out] tables Current tables, replaced by the reloaded ones.
+   * \return True if the tables were swapped.
+   */
+  bool swap(std::unique_ptr<NpzInterpolator> &tables) {
+    // Wait for the loader thread to release the tables retired by the last
+    // swap, so that the retired slot never holds two of them
+    if (retired_.load() != nullptr || pending_.load() == nullptr) {
+      return false;
+    }
+    NpzInterpolator *reloaded = pending_.exchange(nullptr);
+    if (reloaded == nullptr) {
+      return false;
+    }
+    retired_.store(tables.release());
+    tables.reset(reloaded);
+    num_swaps_.fetch_add(1);
+    return true;
+  }
+
+  //! Number of models loaded so far, swapped in or not
+  size_t num_loads() const { return num_loads_.load(); }
+
+  //! Number of swaps so far
+  size_t num_swaps() const { return num_swaps_.load(); }
+
+ private:
+  //! Modification time and size of a file, to detect changes
+  struct FileStamp {
+    std::filesystem::file_time_type time{};
+    uintmax_t size = 0;
+
+    bool operator==(const FileStamp &other) const {
+      return time == other.time && size == other.size;
+    }
+  };
+
+  //! Stamp of the model file, or a default stamp if it cannot be read
+  static FileStamp stamp(const std::string &path);
+
+  //! Watch the model file and serve requests until stopped.
+  void run();
+
+  /*! Load a model and publish it in the pending slot.
+   *
+   * \param[in] path Path to the model file.
+   */
+  void reload(const std::string &path);
+
+  //! Period between two checks of the model file, zero to disable
+  const double watch_period_;
+
+  //! Function loading a model from its path
+  const Loader loader_;
+
+  //! Path to the model file, protected by the mutex
+  std::string path_;
+
+  //! Stamp of the model file at the last check, taken before the loader
+  //! thread starts so that no change is missed
+  FileStamp last_stamp_;
+
+  //! Whether a reload was requested, protected by the mutex
+  bool requested_ = false;
+
+  //! Stop flag, protected by the mutex
+  bool stop_ = false;
+
+  //! Protect the path, request and stop flags
+  std::mutex mutex_;
+
+  //! Wake up the loader thread on requests and when stopping
+  std::condition_variable condition_;
+
+  //! Tables loaded but not swapped in yet, owned by this object
+  std::atomic<NpzInterpolator *> pending_{nullptr};
+
+  //! Tables swapped out by the real-time thread, owned by this object
+  std::atomic<NpzInterpolator *> retired_{nullptr};
+
+  //! Number of models loaded so far
+  std::atomic<size_t> num_loads_{0};
+
+  //! Number of swaps so far
+  std::atomic<size_t> num_swaps_{0};
+
+  //! Loader thread
+  std::thread thread_;
+};
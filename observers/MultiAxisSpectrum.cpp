@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/MultiAxisSpectrum.h"
+
+MultiAxisSpectrum::MultiAxisSpectrum(size_t window_size)
+    : window_size_(window_size),
+      windows_(kNumChannels, RingWindow(window_size)),
+      interleaved_(kNumPairs * window_size, kiss_fft_cpx{0.0, 0.0}),
+      pair_spectra_(kNumPairs * window_size, kiss_fft_cpx{0.0, 0.0}),
+      channel_bins_(kNumChannels * (window_size / 2), kiss_fft_cpx{0.0, 0.0}),
+      cfg_(kiss_fft_alloc(window_size, false, nullptr, nullptr)) {}
+
+MultiAxisSpectrum::~MultiAxisSpectrum() {
+  kiss_fft_free(cfg_);
+  cfg_ = nullptr;
+}
+
+void MultiAxisSpectrum::push(const std::array<double, kNumChannels> &samples) {
+  for (size_t c = 0; c < kNumChannels; ++c) {
+    windows_[c].push(samples[c]);
+  }
+}
+
+void MultiAxisSpectrum::update() {
+  const size_t N = window_size_;
+  const size_t N_bins = N / 2;
+
+  // Pack channels (2p, 2p + 1) into the real and imaginary parts of pair p
+  for (size_t p = 0; p < kNumPairs; ++p) {
+    const double *re = windows_[2 * p].data();
+    const double *im = windows_[2 * p + 1].data();
+    for (size_t j = 0; j < N; ++j) {
+      interleaved_[j * kNumPairs + p] = kiss_fft_cpx{.r = re[j], .i = im[j]};
+    }
+  }
+
+  // Batched transform over the interleaved layout
+  for (size_t p = 0; p < kNumPairs; ++p) {
+    kiss_fft_stride(cfg_, interleaved_.data() + p,
+                    pair_spectra_.data() + p * N, kNumPairs);
+  }
+
+  // Unpack with X[k] = (Z[k] + conj(Z[N - k])) / 2 for the real part and
+  // Y[k] = (Z[k] - conj(Z[N - k])) / 2i for the imaginary part
+  for (size_t p = 0; p < kNumPairs; ++p) {
+    const kiss_fft_cpx *Z = pair_spectra_.data() + p * N;
+    kiss_fft_cpx *X = channel_bins_.data() + (2 * p) * N_bins;
+    kiss_fft_cpx *Y = channel_bins_.data() + (2 * p + 1) * N_bins;
+    for (size_t k = 0; k < N_bins; ++k) {
+      const kiss_fft_cpx &z = Z[k];
+      const kiss_fft_cpx &z_mirror = Z[(N - k) % N];
+      X[k] = kiss_fft_cpx{.r = 0.5 * (z.r + z_mirror.r),
+                          .i = 0.5 * (z.i - z_mirror.i)};
+      Y[k] = kiss_fft_cpx{.r = 0.5 * (z.i + z_mirror.i),
+                          .i = 0.5 * (z_mirror.r - z.r)};
+    }
+  }
+}
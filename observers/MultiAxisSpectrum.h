@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "kiss_fft/kiss_fft.h"
+#include "observers/RingWindow.h"
+
+/*! Spectra of the six IMU channels, computed as one batched transform.
+ *
+ * Channels are the three accelerometer axes followed by the three gyroscope
+ * axes. Since they are real, channels are packed by pairs into the real and
+ * imaginary parts of a single complex signal, stored interleaved as
+ * `[pair0[0], pair1[0], pair2[0], pair0[1], ...]`. One strided complex FFT
+ * per pair, i.e. three for six channels, yields all spectra after unpacking
+ * with the conjugate symmetry of real signals.
+ */
+class MultiAxisSpectrum {
+ public:
+  //! Number of channels
+  static constexpr size_t kNumChannels = 6;
+
+  //! Number of channel pairs, i.e. of complex transforms
+  static constexpr size_t kNumPairs = kNumChannels / 2;
+
+  //! Channel names, used as keys in the observation dictionary
+  static constexpr std::array<const char *, kNumChannels> kChannelNames = {
+      "acc_x", "acc_y", "acc_z", "gyro_x", "gyro_y", "gyro_z"};
+
+  /*! Initialize spectra with all-zero windows.
+   *
+   * \param[in] window_size Number of samples in each channel window.
+   */
+  explicit MultiAxisSpectrum(size_t window_size);
+
+  // Destructor
+  ~MultiAxisSpectrum();
+
+  MultiAxisSpectrum(const MultiAxisSpectrum &) = delete;
+  MultiAxisSpectrum &operator=(const MultiAxisSpectrum &) = delete;
+
+  /*! Append one sample to every channel window.
+   *
+   * \param[in] samples New samples, in the order of kChannelNames.
+   */
+  void push(const std::array<double, kNumChannels> &samples);
+
+  //! Compute the spectra of all channels.
+  void update();
+
+  /*! Output bins `[0, window_size / 2)` of a channel after update().
+   *
+   * \param[in] channel Channel index, in the order of kChannelNames.
+   */
+  const kiss_fft_cpx *bins(size_t channel) const {
+    return channel_bins_.data() + channel * (window_size_ / 2);
+  }
+
+  /*! Power of a channel, i.e. mean of its squared samples.
+   *
+   * \param[in] channel Channel index, in the order of kChannelNames.
+   */
+  double power(size_t channel) const { return windows_[channel].power(); }
+
+ private:
+  //! Number of samples in each window
+  const size_t window_size_;
+
+  //! Window of each channel
+  std::vector<RingWindow> windows_;
+
+  //! Interleaved pairs of channels, input of the batched transform
+  std::vector<kiss_fft_cpx> interleaved_;
+
+  //! Spectrum of each pair, stored one after the other
+  std::vector<kiss_fft_cpx> pair_spectra_;
+
+  //! Unpacked bins of each channel, stored one after the other
+  std::vector<kiss_fft_cpx> channel_bins_;
+
+  //! FFT configuration
+  kiss_fft_cfg cfg_;
+};
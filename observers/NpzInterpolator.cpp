@@ -3,6 +3,13 @@
 
 #include "observers/NpzInterpolator.h"
 
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
 #include "cnpy/cnpy.h"
 #include "spdlog/spdlog.h"
 
@@ -10,6 +17,71 @@ NpzInterpolator::NpzInterpolator(std::string npz_path,
                                  std::vector<std::string> axis_keys,
                                  std::vector<std::string> value_keys)
     : npz_path_(npz_path), axis_keys(axis_keys), value_keys(value_keys) {
+  const std::string extension = kModelFileExtension;
+  if (npz_path_.size() >= extension.size() &&
+      npz_path_.compare(npz_path_.size() - extension.size(), extension.size(),
+                        extension) == 0) {
+    load_model_file(ModelFile::map(npz_path_));
+    setup();
+    return;
+  }
+
+  // Interleave tables per grid node
+  const std::vector<std::vector<double>> tables = load_npz();
+  const size_t num_nodes = vec_prod(axis_sizes);
+  owned_nodes.resize(num_nodes * tables.size());
+  for (size_t v = 0; v < tables.size(); ++v) {
+    for (size_t node = 0; node < num_nodes; ++node) {
+      owned_nodes[node * tables.size() + v] = tables[v][node];
+    }
+  }
+  nodes = owned_nodes.data();
+  setup();
+}
+
+NpzInterpolator::NpzInterpolator(std::shared_ptr<const ModelFile> model_file,
+                                 std::vector<std::string> axis_keys,
+                                 std::vector<std::string> value_keys)
+    : axis_keys(axis_keys), value_keys(value_keys) {
+  load_model_file(std::move(model_file));
+  setup();
+}
+
+NpzInterpolator::NpzInterpolator(std::vector<std::string> axis_keys,
+                                 std::vector<std::vector<double>> axis_values,
+                                 std::vector<std::string> value_keys,
+                                 const std::vector<std::vector<double>> &tables)
+    : axis_keys(axis_keys),
+      value_keys(value_keys),
+      axis_values(std::move(axis_values)) {
+  if (this->axis_values.size() != axis_keys.size() ||
+      tables.size() != value_keys.size()) {
+    throw std::invalid_argument("There should be one array per key");
+  }
+  for (const auto &axis : this->axis_values) {
+    axes.emplace_back(
+        /* values = */ axis,
+        /* interpolation_method = */ Btwxt::InterpolationMethod::linear,
+        /* extrapolation_method = */ Btwxt::ExtrapolationMethod::constant);
+    axis_sizes.push_back(axis.size());
+  }
+  const size_t num_nodes = vec_prod(axis_sizes);
+  owned_nodes.resize(num_nodes * tables.size());
+  for (size_t v = 0; v < tables.size(); ++v) {
+    if (tables[v].size() != num_nodes) {
+      throw std::invalid_argument("Table \"" + value_keys[v] +
+                                  "\" does not match the axes' dimensions");
+    }
+    for (size_t node = 0; node < num_nodes; ++node) {
+      owned_nodes[node * tables.size() + v] = tables[v][node];
+    }
+    value_sizes.push_back(axis_sizes);
+  }
+  nodes = owned_nodes.data();
+  setup();
+}
+
+std::vector<std::vector<double>> NpzInterpolator::load_npz() {
   // Load the npz file
   cnpy::npz_t arrs = cnpy::npz_load(npz_path_);
 
@@ -42,6 +114,7 @@ NpzInterpolator::NpzInterpolator(std::string npz_path,
     double *ptr = arr.data<double>();
     size_t num_vals = arr.num_vals;
     std::vector<double> axis(ptr, ptr + num_vals);
+    axis_values.push_back(axis);
     axes.emplace_back(
         /* values = */ axis,
         /* interpolation_method = */ Btwxt::InterpolationMethod::linear,
@@ -50,6 +123,7 @@ NpzInterpolator::NpzInterpolator(std::string npz_path,
   }
 
   // Load the values
+  std::vector<std::vector<double>> tables;
   for (const auto &value_key : value_keys) {
     cnpy::NpyArray arr = arrs.at(value_key);
 
@@ -70,14 +144,608 @@ NpzInterpolator::NpzInterpolator(std::string npz_path,
     std::vector<double> data(arr.data<double>(), arr.data<double>() + num_vals);
 
     datasets.emplace_back(data, value_key);
+    tables.push_back(std::move(data));
     value_sizes.push_back(shape);
   }
+  return tables;
+}
 
-  // Create the interpolator
+void NpzInterpolator::load_model_file(std::shared_ptr<const ModelFile> model) {
+  if (model->num_axes() != axis_keys.size()) {
+    throw std::runtime_error("Compiled model has " +
+                             std::to_string(model->num_axes()) +
+                             " axes, expected " +
+                             std::to_string(axis_keys.size()));
+  }
+  for (size_t d = 0; d < axis_keys.size(); ++d) {
+    if (model->axis_key(d) != axis_keys[d]) {
+      throw std::runtime_error("Axis \"" + axis_keys[d] +
+                               "\" is not the axis " + std::to_string(d) +
+                               " of the compiled model");
+    }
+    const double *axis = model->axis(d);
+    axis_values.emplace_back(axis, axis + model->axis_size(d));
+    axes.emplace_back(
+        /* values = */ axis_values.back(),
+        /* interpolation_method = */ Btwxt::InterpolationMethod::linear,
+        /* extrapolation_method = */ Btwxt::ExtrapolationMethod::constant);
+    axis_sizes.push_back(model->axis_size(d));
+  }
+
+  // Requested values come first, further ones are appended
+  if (model->num_values() < value_keys.size()) {
+    throw std::runtime_error("Compiled model has fewer values than requested");
+  }
+  for (size_t v = 0; v < model->num_values(); ++v) {
+    if (v >= value_keys.size()) {
+      value_keys.emplace_back(model->value_key(v));
+    } else if (model->value_key(v) != value_keys[v]) {
+      throw std::runtime_error("Value key \"" + value_keys[v] +
+                               "\" is not the value " + std::to_string(v) +
+                               " of the compiled model");
+    }
+    value_sizes.push_back(axis_sizes);
+  }
+
+  nodes = model->nodes();
+  model_file = std::move(model);
+  spdlog::debug("Mapped {} values of a compiled model", value_keys.size());
+}
+
+void NpzInterpolator::setup() {
+  if (axis_sizes.size() > kMaxInterpolationAxes) {
+    throw std::invalid_argument("Grids should have at most " +
+                                std::to_string(kMaxInterpolationAxes) +
+                                " axes");
+  }
+
+  // Row-major strides, the last axis being contiguous
+  strides.assign(axis_sizes.size(), 1);
+  for (size_t d = axis_sizes.size(); d-- > 1;) {
+    strides[d - 1] = strides[d] * axis_sizes[d];
+  }
+
+  build_interpolators();
+}
+
+void NpzInterpolator::build_interpolators() {
+  // Btwxt needs a copy of every table, only build it eagerly if it has them
+  if (datasets.size() == value_keys.size()) {
+    interpolator = Btwxt::RegularGridInterpolator(axes, datasets);
+  }
+
+  // Our KDE grids are uniform in 2-D, where cells can be found in O(1)
+  warped_grid.reset();
+  uniform_grid_nd.reset();
+  if (axis_values.size() == 2 && is_uniform_axis(axis_values[0]) &&
+      is_uniform_axis(axis_values[1])) {
+    uniform_grid = std::make_unique<UniformGrid2d>(
+        axis_values[0], axis_values[1], value_keys.size(), nodes, precision);
+    quantization_errors = uniform_grid->quantization_errors();
+    spdlog::debug("Using a uniform 2-D grid for \"{}\"", npz_path_);
+    return;
+  }
+  uniform_grid.reset();
+  quantization_errors.assign(value_keys.size(), 0.0);
+
+  // Adaptive grids have non-uniform axes, still searched in O(1)
+  if (axis_values.size() == 2 && axis_sizes[0] >= 2 && axis_sizes[1] >= 2) {
+    warped_grid = std::make_unique<WarpedGrid2d>(
+        axis_values[0], axis_values[1], value_keys.size(), nodes);
+    spdlog::debug("Using a warped 2-D grid for \"{}\"", npz_path_);
+    return;
+  }
+
+  // Models with more inputs, e.g. a hip torque or a wheel velocity
+  uniform_grid_nd =
+      make_uniform_grid_nd(axis_values, value_keys.size(), nodes);
+  if (uniform_grid_nd != nullptr) {
+    spdlog::debug("Using a uniform {}-D grid for \"{}\"", axis_values.size(),
+                  npz_path_);
+  }
+}
+
+void NpzInterpolator::set_precision(TablePrecision new_precision,
+                                    bool log_errors) {
+  if (uniform_grid == nullptr) {
+    spdlog::warn("Tables are only quantized on uniform 2-D grids");
+    return;
+  }
+  precision = new_precision;
+  build_interpolators();
+  if (!log_errors) {
+    return;
+  }
+
+  // Report errors relative to the range of each table
+  const size_t num_nodes = vec_prod(axis_sizes);
+  for (size_t v = 0; v < value_keys.size(); ++v) {
+    double min_value = table_value(v, 0);
+    double max_value = min_value;
+    for (size_t node = 1; node < num_nodes; ++node) {
+      min_value = std::min(min_value, table_value(v, node));
+      max_value = std::max(max_value, table_value(v, node));
+    }
+    const double range = max_value - min_value;
+    spdlog::info(
+        "Table \"{}\": max interpolation error {:.3g}, {:.3g} of its range",
+        value_keys[v], quantization_errors[v],
+        (range > 0.0) ? quantization_errors[v] / range : 0.0);
+  }
+  spdlog::info("Tables read by queries take {} bytes, doubles take {}",
+               uniform_grid->table_bytes(),
+               num_nodes * value_keys.size() * sizeof(double));
+}
+
+void NpzInterpolator::build_btwxt() {
+  if (datasets.size() == value_keys.size()) {
+    return;
+  }
+  const size_t num_nodes = vec_prod(axis_sizes);
+  datasets.clear();
+  for (size_t v = 0; v < value_keys.size(); ++v) {
+    std::vector<double> table(num_nodes);
+    for (size_t node = 0; node < num_nodes; ++node) {
+      table[node] = table_value(v, node);
+    }
+    datasets.emplace_back(table, value_keys[v]);
+  }
   interpolator = Btwxt::RegularGridInterpolator(axes, datasets);
 }
 
+size_t NpzInterpolator::add_table(const std::string &key,
+                                  std::vector<double> table) {
+  // Interleave the new table with the existing ones
+  const size_t num_nodes = vec_prod(axis_sizes);
+  const size_t num_values = value_keys.size();
+  std::vector<double> new_nodes(num_nodes * (num_values + 1));
+  for (size_t node = 0; node < num_nodes; ++node) {
+    std::copy(nodes + node * num_values, nodes + (node + 1) * num_values,
+              new_nodes.begin() + node * (num_values + 1));
+    new_nodes[node * (num_values + 1) + num_values] = table[node];
+  }
+  owned_nodes = std::move(new_nodes);
+  nodes = owned_nodes.data();
+  model_file.reset();
+
+  if (datasets.size() == num_values) {
+    datasets.emplace_back(table, key);
+  }
+  value_keys.push_back(key);
+  value_sizes.push_back(axis_sizes);
+  build_interpolators();
+  return num_values;
+}
+
+std::vector<double> NpzInterpolator::table(size_t value) const {
+  if (value >= num_values()) {
+    throw std::out_of_range("No table at index " + std::to_string(value));
+  }
+  std::vector<double> values(vec_prod(axis_sizes));
+  for (size_t node = 0; node < values.size(); ++node) {
+    values[node] = table_value(value, node);
+  }
+  return values;
+}
+
+size_t NpzInterpolator::add_log_table(const std::string &key, size_t value) {
+  if (value >= num_values()) {
+    throw std::out_of_range("No table at index " + std::to_string(value));
+  }
+  std::vector<double> table(vec_prod(axis_sizes));
+  for (size_t k = 0; k < table.size(); ++k) {
+    table[k] = std::log(std::max(table_value(value, k), kMinLikelihood));
+  }
+  return add_table(key, std::move(table));
+}
+
+size_t NpzInterpolator::add_log_ratio_table(const std::string &key,
+                                            size_t numerator,
+                                            size_t denominator) {
+  if (numerator >= num_values() || denominator >= num_values()) {
+    throw std::out_of_range("No table at index " +
+                            std::to_string(std::max(numerator, denominator)));
+  }
+  std::vector<double> table(vec_prod(axis_sizes));
+  for (size_t k = 0; k < table.size(); ++k) {
+    table[k] = std::log(std::max(table_value(numerator, k), kMinLikelihood)) -
+               std::log(std::max(table_value(denominator, k), kMinLikelihood));
+  }
+  return add_table(key, std::move(table));
+}
+
 const std::vector<double> NpzInterpolator::interpolate(
     const std::vector<double> &point) {
+  build_btwxt();
   return interpolator.get_values_at_target(point);
 }
+
+void NpzInterpolator::interpolate(const std::vector<double> &point,
+                                  double *values) const {
+  const size_t num_axes = axis_values.size();
+  if (point.size() != num_axes) {
+    throw std::invalid_argument("Point should have one coordinate per axis");
+  }
+  if (uniform_grid != nullptr) {
+    uniform_grid->interpolate(point[0], point[1], values);
+  } else if (warped_grid != nullptr) {
+    warped_grid->interpolate(point[0], point[1], values);
+  } else if (uniform_grid_nd != nullptr) {
+    uniform_grid_nd->interpolate(point.data(), values);
+  } else {
+    interpolate_multilinear(point.data(), values);
+  }
+}
+
+void NpzInterpolator::interpolate_points(const std::vector<double> &points,
+                                         double *values) const {
+  const size_t num_axes = axis_values.size();
+  if (points.size() % num_axes != 0) {
+    throw std::invalid_argument(
+        "Points should be concatenated with one coordinate per axis");
+  }
+  const size_t num_points = points.size() / num_axes;
+  if (uniform_grid != nullptr) {
+    uniform_grid->interpolate_points(points.data(), num_points, values);
+    return;
+  }
+  if (warped_grid != nullptr) {
+    warped_grid->interpolate_points(points.data(), num_points, values);
+    return;
+  }
+  if (uniform_grid_nd != nullptr) {
+    uniform_grid_nd->interpolate_points(points.data(), num_points, values);
+    return;
+  }
+  for (size_t k = 0; k < num_points; ++k) {
+    interpolate_multilinear(points.data() + k * num_axes,
+                            values + k * num_values());
+  }
+}
+
+void NpzInterpolator::interpolate_batch(const double *const *coordinates,
+                                        size_t num_points,
+                                        double *const *values) const {
+  if (uniform_grid != nullptr) {
+    uniform_grid->interpolate_batch(coordinates[0], coordinates[1], num_points,
+                                    values);
+    return;
+  }
+  if (warped_grid != nullptr) {
+    warped_grid->interpolate_batch(coordinates[0], coordinates[1], num_points,
+                                   values);
+    return;
+  }
+  const size_t num_axes = axis_values.size();
+  std::vector<double> point(num_axes);
+  std::vector<double> point_values(num_values());
+  for (size_t k = 0; k < num_points; ++k) {
+    for (size_t d = 0; d < num_axes; ++d) {
+      point[d] = coordinates[d][k];
+    }
+    if (uniform_grid_nd != nullptr) {
+      uniform_grid_nd->interpolate(point.data(), point_values.data());
+    } else {
+      interpolate_multilinear(point.data(), point_values.data());
+    }
+    for (size_t v = 0; v < num_values(); ++v) {
+      values[v][k] = point_values[v];
+    }
+  }
+}
+
+void NpzInterpolator::interpolate_multilinear(const double *point,
+                                              double *values) const {
+  const size_t num_axes = axis_values.size();
+  size_t cell_indices[kMaxInterpolationAxes];
+  double cell_fractions[kMaxInterpolationAxes];
+
+  // Locate the cell containing the point, clamped to the grid for constant
+  // extrapolation
+  for (size_t d = 0; d < num_axes; ++d) {
+    const std::vector<double> &axis = axis_values[d];
+    if (axis.size() < 2) {
+      cell_indices[d] = 0;
+      cell_fractions[d] = 0.0;
+      continue;
+    }
+    const double x = std::clamp(point[d], axis.front(), axis.back());
+    const size_t upper = std::upper_bound(axis.begin() + 1, axis.end() - 1, x) -
+                         axis.begin();
+    cell_indices[d] = upper - 1;
+    cell_fractions[d] = (x - axis[upper - 1]) / (axis[upper] - axis[upper - 1]);
+  }
+
+  // Weighted sum over the corners of the cell
+  const size_t num_values = value_keys.size();
+  std::fill(values, values + num_values, 0.0);
+  for (size_t corner = 0; corner < (size_t{1} << num_axes); ++corner) {
+    double weight = 1.0;
+    size_t index = 0;
+    for (size_t d = 0; d < num_axes; ++d) {
+      const size_t is_upper = (corner >> d) & 1;
+      weight *= is_upper ? cell_fractions[d] : 1.0 - cell_fractions[d];
+      index += (cell_indices[d] + is_upper) * strides[d];
+    }
+    if (weight == 0.0) {
+      // Also skips corners beyond single-point axes
+      continue;
+    }
+    const double *node = nodes + index * num_values;
+    for (size_t v = 0; v < num_values; ++v) {
+      values[v] += weight * node[v];
+    }
+  }
+}
+
+std::vector<size_t> NpzInterpolator::select_breakpoints(
+    size_t axis, const std::vector<double> &tolerances) const {
+  const std::vector<double> &points = axis_values[axis];
+  const size_t size = points.size();
+  const size_t stride = strides[axis];
+  const size_t num_lines = vec_prod(axis_sizes) / size;
+  std::vector<bool> selected(size, true);
+  if (size > 2) {
+    std::fill(selected.begin() + 1, selected.end() - 1, false);
+  }
+
+  std::vector<std::pair<size_t, size_t>> intervals = {{0, size - 1}};
+  while (!intervals.empty()) {
+    const auto [a, b] = intervals.back();
+    intervals.pop_back();
+
+    // Worst point of the interval, over all lines of nodes along the axis
+    double max_excess = 1.0;
+    size_t split = b;
+    for (size_t k = a + 1; k < b; ++k) {
+      const double t = (points[k] - points[a]) / (points[b] - points[a]);
+      for (size_t line = 0; line < num_lines; ++line) {
+        const size_t start = (line / stride) * stride * size + line % stride;
+        for (size_t v = 0; v < value_keys.size(); ++v) {
+          if (tolerances[v] <= 0.0) {
+            continue;
+          }
+          const double linear =
+              (1.0 - t) * table_value(v, start + a * stride) +
+              t * table_value(v, start + b * stride);
+          const double excess =
+              std::abs(table_value(v, start + k * stride) - linear) /
+              tolerances[v];
+          if (excess > max_excess) {
+            max_excess = excess;
+            split = k;
+          }
+        }
+      }
+    }
+    if (split < b) {
+      selected[split] = true;
+      intervals.emplace_back(a, split);
+      intervals.emplace_back(split, b);
+    }
+  }
+
+  std::vector<size_t> breakpoints;
+  for (size_t k = 0; k < size; ++k) {
+    if (selected[k]) {
+      breakpoints.push_back(k);
+    }
+  }
+  return breakpoints;
+}
+
+double NpzInterpolator::reduction_error(
+    const std::vector<std::vector<size_t>> &breakpoints, size_t axis,
+    size_t begin, size_t end, const std::vector<double> &tolerances) const {
+  const size_t num_axes = axis_sizes.size();
+
+  // Cell of the reduced grid around each full grid point, along each axis
+  std::vector<std::vector<size_t>> lowers(num_axes), uppers(num_axes);
+  std::vector<std::vector<double>> fractions(num_axes);
+  for (size_t d = 0; d < num_axes; ++d) {
+    const std::vector<size_t> &kept = breakpoints[d];
+    const std::vector<double> &points = axis_values[d];
+    for (size_t k = 0; k < axis_sizes[d]; ++k) {
+      if (kept.size() < 2) {
+        lowers[d].push_back(k);
+        uppers[d].push_back(k);
+        fractions[d].push_back(0.0);
+        continue;
+      }
+      const size_t cell =
+          std::upper_bound(kept.begin() + 1, kept.end() - 1, k) - kept.begin();
+      const size_t lower = kept[cell - 1];
+      const size_t upper = kept[cell];
+      lowers[d].push_back(lower);
+      uppers[d].push_back(upper);
+      fractions[d].push_back((points[k] - points[lower]) /
+                             (points[upper] - points[lower]));
+    }
+  }
+
+  // Iterate over the slab, the index along the axis going from begin to end
+  const size_t num_values = value_keys.size();
+  std::vector<size_t> index(num_axes, 0);
+  index[axis] = begin;
+  std::vector<double> values(num_values);
+  double max_error = 0.0;
+  while (true) {
+    std::fill(values.begin(), values.end(), 0.0);
+    size_t node = 0;
+    for (size_t d = 0; d < num_axes; ++d) {
+      node += index[d] * strides[d];
+    }
+    for (size_t corner = 0; corner < (size_t{1} << num_axes); ++corner) {
+      double weight = 1.0;
+      size_t corner_node = 0;
+      for (size_t d = 0; d < num_axes; ++d) {
+        const bool is_upper = (corner >> d) & 1;
+        const double t = fractions[d][index[d]];
+        weight *= is_upper ? t : 1.0 - t;
+        corner_node +=
+            (is_upper ? uppers[d][index[d]] : lowers[d][index[d]]) * strides[d];
+      }
+      if (weight == 0.0) {
+        continue;
+      }
+      for (size_t v = 0; v < num_values; ++v) {
+        values[v] += weight * table_value(v, corner_node);
+      }
+    }
+    for (size_t v = 0; v < num_values; ++v) {
+      if (tolerances[v] > 0.0) {
+        const double error = std::abs(values[v] - table_value(v, node));
+        max_error = std::max(max_error, error / tolerances[v]);
+      }
+    }
+
+    // Next node of the slab, the last axis varying fastest
+    size_t d = num_axes;
+    while (d-- > 0) {
+      const size_t first = (d == axis) ? begin : 0;
+      const size_t last = (d == axis) ? end : axis_sizes[d] - 1;
+      if (index[d] < last) {
+        ++index[d];
+        break;
+      }
+      index[d] = first;
+    }
+    if (d > num_axes) {
+      return max_error;  // wrapped around all axes
+    }
+  }
+}
+
+std::vector<double> NpzInterpolator::adapt_grid(double tolerance) {
+  if (!(tolerance > 0.0)) {
+    throw std::invalid_argument("Tolerance should be strictly positive");
+  }
+  const size_t num_axes = axis_values.size();
+  const size_t num_values = value_keys.size();
+  const size_t num_nodes = vec_prod(axis_sizes);
+
+  // Errors along each axis add up, so that each first gets a share of the
+  // tolerance
+  std::vector<double> tolerances(num_values);
+  for (size_t v = 0; v < num_values; ++v) {
+    double min_value = table_value(v, 0);
+    double max_value = min_value;
+    for (size_t node = 1; node < num_nodes; ++node) {
+      min_value = std::min(min_value, table_value(v, node));
+      max_value = std::max(max_value, table_value(v, node));
+    }
+    tolerances[v] = tolerance * (max_value - min_value);
+  }
+  std::vector<double> axis_tolerances(num_values);
+  for (size_t v = 0; v < num_values; ++v) {
+    axis_tolerances[v] = tolerances[v] / num_axes;
+  }
+  std::vector<std::vector<size_t>> breakpoints;
+  for (size_t d = 0; d < num_axes; ++d) {
+    breakpoints.push_back(select_breakpoints(d, axis_tolerances));
+  }
+
+  // Then remove breakpoints while the actual error stays within tolerance,
+  // since errors along different axes seldom peak at the same nodes
+  bool removed = true;
+  while (removed) {
+    removed = false;
+    for (size_t d = 0; d < num_axes; ++d) {
+      for (size_t k = 1; k + 1 < breakpoints[d].size();) {
+        const size_t begin = breakpoints[d][k - 1];
+        const size_t end = breakpoints[d][k + 1];
+        const size_t kept = breakpoints[d][k];
+        breakpoints[d].erase(breakpoints[d].begin() + k);
+        if (reduction_error(breakpoints, d, begin, end, tolerances) <= 1.0) {
+          removed = true;
+        } else {
+          breakpoints[d].insert(breakpoints[d].begin() + k, kept);
+          ++k;
+        }
+      }
+    }
+  }
+
+  // Tables at the selected grid points
+  std::vector<size_t> new_sizes;
+  std::vector<std::vector<double>> new_axis_values;
+  for (size_t d = 0; d < num_axes; ++d) {
+    new_sizes.push_back(breakpoints[d].size());
+    new_axis_values.emplace_back();
+    for (size_t k : breakpoints[d]) {
+      new_axis_values.back().push_back(axis_values[d][k]);
+    }
+  }
+  const size_t new_num_nodes = vec_prod(new_sizes);
+  std::vector<double> new_nodes(new_num_nodes * num_values);
+  for (size_t node = 0; node < new_num_nodes; ++node) {
+    size_t remainder = node;
+    size_t full_node = 0;
+    for (size_t d = num_axes; d-- > 0;) {
+      full_node += breakpoints[d][remainder % new_sizes[d]] * strides[d];
+      remainder /= new_sizes[d];
+    }
+    std::copy(nodes + full_node * num_values,
+              nodes + (full_node + 1) * num_values,
+              new_nodes.begin() + node * num_values);
+  }
+
+  // Switch to the reduced grid, keeping the full one to measure errors
+  const std::vector<std::vector<double>> full_axis_values =
+      std::move(axis_values);
+  const std::vector<double> full_nodes(nodes, nodes + num_nodes * num_values);
+  axis_values = std::move(new_axis_values);
+  axis_sizes = new_sizes;
+  axes.clear();
+  for (const auto &axis : axis_values) {
+    axes.emplace_back(
+        /* values = */ axis,
+        /* interpolation_method = */ Btwxt::InterpolationMethod::linear,
+        /* extrapolation_method = */ Btwxt::ExtrapolationMethod::constant);
+  }
+  value_sizes.assign(num_values, axis_sizes);
+  datasets.clear();
+  owned_nodes = std::move(new_nodes);
+  nodes = owned_nodes.data();
+  model_file.reset();
+  setup();
+
+  // Piecewise-multilinear interpolants differ the most at full grid nodes
+  std::vector<double> errors(num_values, 0.0);
+  std::vector<double> point(num_axes);
+  std::vector<double> values(num_values);
+  for (size_t node = 0; node < num_nodes; ++node) {
+    size_t remainder = node;
+    for (size_t d = num_axes; d-- > 0;) {
+      point[d] = full_axis_values[d][remainder % full_axis_values[d].size()];
+      remainder /= full_axis_values[d].size();
+    }
+    interpolate(point, values.data());
+    for (size_t v = 0; v < num_values; ++v) {
+      errors[v] = std::max(
+          errors[v], std::abs(values[v] - full_nodes[node * num_values + v]));
+    }
+  }
+  for (size_t v = 0; v < num_values; ++v) {
+    spdlog::info("Table \"{}\": max adaptation error {:.3g}", value_keys[v],
+                 errors[v]);
+  }
+  spdlog::info("Adapted grid from {} to {} nodes", num_nodes, new_num_nodes);
+  return errors;
+}
+
+std::vector<uint8_t> NpzInterpolator::serialize() const {
+  return serialize_model(axis_keys, axis_values, value_keys, nodes);
+}
+
+void NpzInterpolator::save(const std::string &path) const {
+  write_model_file(path, serialize());
+}
+
+bool NpzInterpolator::lock_tables() const {
+  if (uniform_grid != nullptr) {
+    return mlock(uniform_grid->table_data(), uniform_grid->table_bytes()) == 0;
+  }
+  const size_t size = vec_prod(axis_sizes) * value_keys.size() * sizeof(double);
+  return mlock(nodes, size) == 0;
+}
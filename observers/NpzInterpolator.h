@@ -3,10 +3,16 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "btwxt/btwxt.h"
+#include "observers/ModelFile.h"
+#include "observers/UniformGrid2d.h"
+#include "observers/UniformGridNd.h"
+#include "observers/WarpedGrid2d.h"
+
 /*
  * Compute the product of a vector of size_t values.
  *
@@ -22,18 +28,197 @@ inline size_t vec_prod(const std::vector<size_t> &vec) {
   return prod;
 }
 
+//! Floor of likelihoods in log tables, so that their logarithms are finite
+inline constexpr double kMinLikelihood = 1e-20;
+
+//! Maximum number of grid axes, which bounds the stack buffers of
+//! multilinear interpolation
+inline constexpr size_t kMaxInterpolationAxes = 8;
+
 class NpzInterpolator {
  public:
+  /*! Load tables from a .npz file, or from a compiled model.
+   *
+   * Paths ending with kModelFileExtension are mapped as compiled models, see
+   * the constructor from a ModelFile.
+   */
   explicit NpzInterpolator(std::string npz_path,
                            std::vector<std::string> axis_keys,
                            std::vector<std::string> value_keys);
 
+  /*! Interpolate the tables of a compiled model in place.
+   *
+   * Tables are neither parsed nor copied: queries read them from the model.
+   * The Btwxt interpolator, which needs its own copies, is only built on the
+   * first call to the vector-returning interpolate().
+   *
+   * \param[in] model_file Compiled model, kept alive by the interpolator.
+   * \param[in] axis_keys Axis keys, which should match those of the model.
+   * \param[in] value_keys Value keys, which should be the first ones of the
+   * model. Further values of the model, e.g. log-likelihood ratios computed
+   * by the model compiler, are appended to them.
+   * \throw std::runtime_error If keys do not match those of the model.
+   */
+  NpzInterpolator(std::shared_ptr<const ModelFile> model_file,
+                  std::vector<std::string> axis_keys,
+                  std::vector<std::string> value_keys);
+
+  /*! Interpolate tables held in memory, e.g. re-estimated online.
+   *
+   * \param[in] axis_keys Axis keys.
+   * \param[in] axis_values Grid points along each axis.
+   * \param[in] value_keys Value keys.
+   * \param[in] tables Values at grid points, in row-major order, one table
+   * per value key.
+   * \throw std::invalid_argument If keys and arrays do not match, or if
+   * there are more than kMaxInterpolationAxes axes.
+   */
+  NpzInterpolator(std::vector<std::string> axis_keys,
+                  std::vector<std::vector<double>> axis_values,
+                  std::vector<std::string> value_keys,
+                  const std::vector<std::vector<double>> &tables);
+
   const std::vector<double> interpolate(const std::vector<double> &point);
 
+  /*! Interpolate all values at a point, without allocating.
+   *
+   * Multilinear interpolation with constant extrapolation, as the Btwxt
+   * interpolator, but on tables set up at construction. Does not modify the
+   * interpolator, so that queries from several threads need no locking.
+   * Uniform 2-D grids go through a UniformGrid2d and other 2-D grids through
+   * a WarpedGrid2d, both with O(1) cell lookup. Uniform grids with 3 to 5
+   * axes go through a UniformGridNd, also with O(1) cell lookup.
+   *
+   * \param[in] point Point to query, one coordinate per axis.
+   * \param[out] values Interpolated values, one per value key.
+   * \throw std::invalid_argument If the point does not have one coordinate
+   * per axis.
+   */
+  void interpolate(const std::vector<double> &point, double *values) const;
+
+  /*! Interpolate all values at several points in one call, without
+   * allocating.
+   *
+   * \param[in] points Points to query, concatenated, each with one coordinate
+   * per axis.
+   * \param[out] values Interpolated values, `num_values()` per point, in the
+   * order of the points.
+   * \throw std::invalid_argument If the number of coordinates is not a
+   * multiple of the number of axes.
+   */
+  void interpolate_points(const std::vector<double> &points,
+                          double *values) const;
+
+  /*! Interpolate all values at a batch of points, in structure-of-arrays
+   * layout.
+   *
+   * Meant for offline evaluation of whole logs. Uniform 2-D grids go through
+   * the vectorized UniformGrid2d::interpolate_batch, other grids through
+   * multilinear interpolation point by point.
+   *
+   * \param[in] coordinates One array per axis, e.g. wheel and knee torques,
+   * each with `num_points` coordinates.
+   * \param[in] num_points Number of points.
+   * \param[out] values One array per value key, each receiving `num_points`
+   * interpolated values.
+   */
+  void interpolate_batch(const double *const *coordinates, size_t num_points,
+                         double *const *values) const;
+
   const std::vector<double> operator()(const std::vector<double> &point) {
     return interpolate(point);
   }
 
+  /*! Add a table of log-likelihoods, computed once at load time.
+   *
+   * The new table is interpolated after all existing ones. Likelihoods are
+   * floored at kMinLikelihood, so that the table is finite.
+   *
+   * \param[in] key Value key of the new table.
+   * \param[in] value Index of the likelihood table.
+   * \return Index of the new value.
+   */
+  size_t add_log_table(const std::string &key, size_t value);
+
+  /*! Add a table of log-likelihood ratios, computed once at load time.
+   *
+   * The new table is interpolated after all existing ones. Likelihoods are
+   * floored at kMinLikelihood, so that ratios are finite, and zero where both
+   * likelihoods vanish.
+   *
+   * \param[in] key Value key of the new table.
+   * \param[in] numerator Index of the likelihood table in the numerator.
+   * \param[in] denominator Index of the likelihood table in the denominator.
+   * \return Index of the new value.
+   */
+  size_t add_log_ratio_table(const std::string &key, size_t numerator,
+                             size_t denominator);
+
+  //! Number of interpolated values, one per value key
+  size_t num_values() const { return value_keys.size(); }
+
+  /*! Values of a table at grid points.
+   *
+   * \param[in] value Index of the table.
+   * \return Values in row-major order.
+   */
+  std::vector<double> table(size_t value) const;
+
+  //! Check whether queries go through the uniform 2-D grid
+  bool has_uniform_grid() const { return uniform_grid != nullptr; }
+
+  //! Check whether queries go through the non-uniform 2-D grid
+  bool has_warped_grid() const { return warped_grid != nullptr; }
+
+  //! Check whether queries go through a uniform grid with 3 to 5 axes
+  bool has_uniform_grid_nd() const { return uniform_grid_nd != nullptr; }
+
+  /*! Reduce the grid to the points needed to interpolate all tables within a
+   * tolerance, e.g. before compiling a model.
+   *
+   * Breakpoints of each axis are selected among its grid points, denser
+   * where tables are steep, such that interpolating on the reduced grid
+   * deviates from interpolating on the full grid by at most `tolerance`
+   * times the range of each table, at any point. Constant tables are
+   * ignored. Reduced 2-D grids are interpolated by a WarpedGrid2d.
+   *
+   * \param[in] tolerance Maximum interpolation error, relative to the range
+   * of each table.
+   * \return Maximum interpolation error of each table on the reduced grid.
+   * \throw std::invalid_argument If the tolerance is not strictly positive.
+   */
+  std::vector<double> adapt_grid(double tolerance);
+
+  /*! Store the tables read by queries at a reduced precision.
+   *
+   * Only applies to uniform 2-D grids. The interpolation error of each table
+   * with respect to its double values is logged, and kept in
+   * quantization_errors. Tables added later are stored at the same
+   * precision.
+   *
+   * \param[in] precision Precision of the tables read by queries.
+   * \param[in] log_errors Log interpolation errors, e.g. false for tables
+   * re-estimated periodically.
+   */
+  void set_precision(TablePrecision precision, bool log_errors = true);
+
+  //! Lay out axes and all tables as a compiled model
+  std::vector<uint8_t> serialize() const;
+
+  /*! Save axes and all tables as a compiled model.
+   *
+   * \param[in] path Path to the output file, conventionally ending with
+   * kModelFileExtension.
+   */
+  void save(const std::string &path) const;
+
+  /*! Lock tables in RAM, so that queries never page-fault.
+   *
+   * \return True if tables were locked, false otherwise, e.g. when the
+   * process lacks the privilege or exceeds its locked memory limit.
+   */
+  bool lock_tables() const;
+
   std::string npz_path_;
   std::vector<std::string> axis_keys;
   std::vector<std::string> value_keys;
@@ -41,9 +226,118 @@ class NpzInterpolator {
   std::vector<size_t> axis_sizes;
   std::vector<std::vector<size_t>> value_sizes;
 
+  //! Grid points along each axis
+  std::vector<std::vector<double>> axis_values;
+
   std::vector<Btwxt::GridAxis> axes;
   std::vector<Btwxt::GridPointDataSet> datasets;
 
+  //! Maximum interpolation error of each table at the current precision,
+  //! with respect to its double values
+  std::vector<double> quantization_errors;
+
  private:
+  /*! Append a table of values at grid points.
+   *
+   * \param[in] key Value key of the table.
+   * \param[in] table Values at grid points, in row-major order.
+   * \return Index of the new value.
+   */
+  size_t add_table(const std::string &key, std::vector<double> table);
+
+  /*! Load axes and tables from the .npz file.
+   *
+   * \return Tables of the value keys, in row-major order.
+   */
+  std::vector<std::vector<double>> load_npz();
+
+  /*! Load axes and view tables from a compiled model.
+   *
+   * \param[in] model Compiled model.
+   */
+  void load_model_file(std::shared_ptr<const ModelFile> model);
+
+  //! Set up work buffers and build the interpolators once axes are loaded.
+  void setup();
+
+  //! Build the interpolators once all tables are loaded.
+  void build_interpolators();
+
+  //! Build the Btwxt datasets and interpolator, if not done already.
+  void build_btwxt();
+
+  /*! Select the grid points of an axis needed to interpolate linearly along
+   * it within tolerance, splitting intervals at their worst point as in the
+   * Douglas-Peucker algorithm.
+   *
+   * \param[in] axis Index of the axis.
+   * \param[in] tolerances Maximum interpolation error of each table, zero to
+   * ignore a table.
+   * \return Indices of the selected grid points, in increasing order.
+   */
+  std::vector<size_t> select_breakpoints(
+      size_t axis, const std::vector<double> &tolerances) const;
+
+  /*! Maximum error of interpolating on a reduced grid over a slab of the
+   * full grid.
+   *
+   * \param[in] breakpoints Indices of the grid points kept along each axis.
+   * \param[in] axis Axis across the slab.
+   * \param[in] begin Index of the first grid point of the slab along the
+   * axis.
+   * \param[in] end Index of the last grid point of the slab along the axis.
+   * \param[in] tolerances Maximum interpolation error of each table, zero to
+   * ignore a table.
+   * \return Maximum error at full grid nodes of the slab, relative to the
+   * tolerance of each table.
+   */
+  double reduction_error(const std::vector<std::vector<size_t>> &breakpoints,
+                         size_t axis, size_t begin, size_t end,
+                         const std::vector<double> &tolerances) const;
+
+  /*! Value of a table at a grid node.
+   *
+   * \param[in] value Index of the table.
+   * \param[in] node Index of the grid node, in row-major order.
+   */
+  double table_value(size_t value, size_t node) const {
+    return nodes[node * value_keys.size() + value];
+  }
+
+  /*! Multilinear interpolation of all values at a point.
+   *
+   * \param[in] point Point to query, one coordinate per axis.
+   * \param[out] values Interpolated values, one per value key.
+   */
+  void interpolate_multilinear(const double *point, double *values) const;
+
   Btwxt::RegularGridInterpolator interpolator;
+
+  //! Values of all tables interleaved per grid node, in row-major order of
+  //! the nodes, pointing either to owned_nodes or into model_file
+  const double *nodes = nullptr;
+
+  //! Interleaved values, when tables were not read in place
+  std::vector<double> owned_nodes;
+
+  //! Compiled model whose tables are read in place, if any
+  std::shared_ptr<const ModelFile> model_file;
+
+  //! Offset between consecutive grid points along each axis, in tables
+  std::vector<size_t> strides;
+
+  //! View of the interleaved tables, only built if the grid is 2-D and
+  //! uniform
+  std::unique_ptr<UniformGrid2d> uniform_grid;
+
+  //! View of the interleaved tables, only built if the grid is 2-D and not
+  //! uniform, e.g. after adapt_grid()
+  std::unique_ptr<WarpedGrid2d> warped_grid;
+
+  //! View of the interleaved tables, only built if the grid is uniform with
+  //! 3 to 5 axes
+  std::unique_ptr<MultilinearGrid> uniform_grid_nd;
+
+  //! Precision of the tables of the uniform grid
+  TablePrecision precision = TablePrecision::kDouble;
 };
@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/OnlineKde.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+#include "spdlog/spdlog.h"
+
+OnlineKde::OnlineKde(const NpzInterpolator &prior, size_t log_ratio_index,
+                     const Parameters &params)
+    : params_(params),
+      log_ratio_index_(log_ratio_index),
+      axis_keys_(prior.axis_keys),
+      value_keys_(prior.value_keys),
+      axis_values_(prior.axis_values) {
+  if (!prior.has_uniform_grid()) {
+    throw std::invalid_argument(
+        "Online adaptation needs a uniform 2-D grid, as in KDE models");
+  }
+  if (!(params_.prior_weight > 0.0)) {
+    throw std::invalid_argument("Prior weight should be strictly positive");
+  }
+  if (prior.num_values() < 2 || log_ratio_index_ >= prior.num_values()) {
+    throw std::invalid_argument(
+        "Prior should start with the contact and no contact likelihoods");
+  }
+  for (size_t v = 0; v < prior.num_values(); ++v) {
+    prior_tables_.push_back(prior.table(v));
+  }
+
+  nx_ = axis_values_[0].size();
+  ny_ = axis_values_[1].size();
+  x0_ = axis_values_[0].front();
+  x1_ = axis_values_[0].back();
+  y0_ = axis_values_[1].front();
+  y1_ = axis_values_[1].back();
+  inv_dx_ = (nx_ - 1) / (x1_ - x0_);
+  inv_dy_ = (ny_ - 1) / (y1_ - y0_);
+
+  const size_t num_nodes = nx_ * ny_;
+  contact_counts_ = std::make_unique<std::atomic<double>[]>(num_nodes);
+  no_contact_counts_ = std::make_unique<std::atomic<double>[]>(num_nodes);
+  for (size_t node = 0; node < num_nodes; ++node) {
+    contact_counts_[node].store(0.0);
+    no_contact_counts_[node].store(0.0);
+  }
+  last_contact_counts_.assign(num_nodes, 0.0);
+  last_no_contact_counts_.assign(num_nodes, 0.0);
+  contact_weights_.assign(num_nodes, 0.0);
+  no_contact_weights_.assign(num_nodes, 0.0);
+
+  if (params_.update_period > 0.0) {
+    thread_ = std::thread(&OnlineKde::run, this);
+  }
+}
+
+OnlineKde::~OnlineKde() {
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex_);
+    stop_ = true;
+  }
+  stop_condition_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  delete published_.load();
+}
+
+void OnlineKde::run() {
+  const auto period = std::chrono::duration<double>(params_.update_period);
+  std::unique_lock<std::mutex> lock(stop_mutex_);
+  while (!stop_condition_.wait_for(lock, period, [this] { return stop_; })) {
+    lock.unlock();
+    update();
+    lock.lock();
+  }
+}
+
+void OnlineKde::smooth(std::vector<double> &histogram) const {
+  if (params_.bandwidth <= 0.0) {
+    return;
+  }
+
+  // Normalized kernel truncated at three standard deviations
+  const int radius = static_cast<int>(std::ceil(3.0 * params_.bandwidth));
+  std::vector<double> kernel(2 * radius + 1);
+  double kernel_sum = 0.0;
+  for (int k = -radius; k <= radius; ++k) {
+    const double u = k / params_.bandwidth;
+    kernel[k + radius] = std::exp(-0.5 * u * u);
+    kernel_sum += kernel[k + radius];
+  }
+  for (double &weight : kernel) {
+    weight /= kernel_sum;
+  }
+
+  // Separable convolution, along y then along x
+  const int nx = static_cast<int>(nx_);
+  const int ny = static_cast<int>(ny_);
+  std::vector<double> buffer(histogram.size(), 0.0);
+  for (int i = 0; i < nx; ++i) {
+    for (int j = 0; j < ny; ++j) {
+      double sum = 0.0;
+      for (int k = std::max(-radius, -j); k <= std::min(radius, ny - 1 - j);
+           ++k) {
+        sum += kernel[k + radius] * histogram[i * ny + j + k];
+      }
+      buffer[i * ny + j] = sum;
+    }
+  }
+  for (int i = 0; i < nx; ++i) {
+    for (int j = 0; j < ny; ++j) {
+      double sum = 0.0;
+      for (int k = std::max(-radius, -i); k <= std::min(radius, nx - 1 - i);
+           ++k) {
+        sum += kernel[k + radius] * buffer[(i + k) * ny + j];
+      }
+      histogram[i * ny + j] = sum;
+    }
+  }
+}
+
+void OnlineKde::update() {
+  std::lock_guard<std::mutex> lock(update_mutex_);
+
+  // Decay older samples and add those since the last update
+  const double decay =
+      (params_.half_life > 0.0) ? std::exp2(-1.0 / params_.half_life) : 1.0;
+  const size_t num_nodes = nx_ * ny_;
+  double contact_weight = 0.0;
+  double no_contact_weight = 0.0;
+  for (size_t node = 0; node < num_nodes; ++node) {
+    const double contact =
+        contact_counts_[node].load(std::memory_order_relaxed);
+    const double no_contact =
+        no_contact_counts_[node].load(std::memory_order_relaxed);
+    contact_weights_[node] = decay * contact_weights_[node] + contact -
+                             last_contact_counts_[node];
+    no_contact_weights_[node] = decay * no_contact_weights_[node] +
+                                no_contact - last_no_contact_counts_[node];
+    last_contact_counts_[node] = contact;
+    last_no_contact_counts_[node] = no_contact;
+    contact_weight += contact_weights_[node];
+    no_contact_weight += no_contact_weights_[node];
+  }
+
+  // Blend the smoothed densities with the prior, weighted by their number of
+  // samples: (w0 * prior + w * density) / (w0 + w), where w * density is the
+  // smoothed histogram divided by the area of a cell
+  std::vector<double> contact_density = contact_weights_;
+  std::vector<double> no_contact_density = no_contact_weights_;
+  smooth(contact_density);
+  smooth(no_contact_density);
+  const double inv_cell_area = inv_dx_ * inv_dy_;
+  const double w0 = params_.prior_weight;
+  std::vector<std::vector<double>> tables = prior_tables_;
+  for (size_t node = 0; node < num_nodes; ++node) {
+    tables[0][node] = (w0 * prior_tables_[0][node] +
+                       inv_cell_area * contact_density[node]) /
+                      (w0 + contact_weight);
+    tables[1][node] = (w0 * prior_tables_[1][node] +
+                       inv_cell_area * no_contact_density[node]) /
+                      (w0 + no_contact_weight);
+    tables[log_ratio_index_][node] =
+        std::log(std::max(tables[0][node], kMinLikelihood)) -
+        std::log(std::max(tables[1][node], kMinLikelihood));
+  }
+
+  // Publish the new tables, then release replaced ones that the real-time
+  // thread no longer uses
+  auto next = std::make_unique<NpzInterpolator>(axis_keys_, axis_values_,
+                                                value_keys_, tables);
+  if (params_.table_precision != TablePrecision::kDouble) {
+    next->set_precision(params_.table_precision, /* log_errors = */ false);
+  }
+  if (params_.lock_tables && !next->lock_tables()) {
+    spdlog::warn("Failed to lock re-estimated likelihood tables in RAM");
+  }
+  NpzInterpolator *previous = published_.exchange(next.release());
+  if (previous != nullptr) {
+    retired_.emplace_back(previous);
+  }
+  NpzInterpolator *in_use = in_use_.load();
+  retired_.erase(
+      std::remove_if(retired_.begin(), retired_.end(),
+                     [in_use](const std::unique_ptr<NpzInterpolator> &tables) {
+                       return tables.get() != in_use;
+                     }),
+      retired_.end());
+  num_updates_.fetch_add(1);
+  spdlog::debug(
+      "Re-estimated likelihood tables from {:.0f} contact and {:.0f} no "
+      "contact samples",
+      contact_weight, no_contact_weight);
+}
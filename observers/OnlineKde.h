@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "observers/NpzInterpolator.h"
+
+/*! Re-estimate contact likelihood tables online from filtered torques.
+ *
+ * The real-time thread adds each torque sample to two histograms on the grid
+ * of the measurement model, weighted by the contact posterior and its
+ * complement. A background thread periodically smooths them with a Gaussian
+ * kernel, blends the resulting densities with the loaded tables, and
+ * publishes the new tables by swapping an atomic pointer. Samples and
+ * publications are lock-free on the real-time side.
+ *
+ * Only the contact and no contact likelihoods, the first two values of the
+ * prior, and their log-likelihood ratio are re-estimated. Other tables are
+ * kept as loaded. Published tables are stored at the precision of the
+ * parameters, and locked in RAM if requested, as the loaded ones.
+ */
+class OnlineKde {
+ public:
+  //! Parameters of the online re-estimation
+  struct Parameters {
+    //! Period between two re-estimations in seconds, zero to only
+    //! re-estimate on calls to update()
+    double update_period = 5.0;
+
+    //! Number of updates after which the weight of a sample halves, so that
+    //! tables follow drifting torque distributions
+    double half_life = 12.0;
+
+    //! Standard deviation of the Gaussian kernel, in grid cells
+    double bandwidth = 2.0;
+
+    //! Weight of the loaded tables, in number of samples, strictly positive
+    double prior_weight = 5000.0;
+
+    //! Precision of the published tables, set by MeasurementModel to the
+    //! precision of its loaded tables
+    TablePrecision table_precision = TablePrecision::kDouble;
+
+    //! Lock the published tables in RAM, set by MeasurementModel as for its
+    //! loaded tables
+    bool lock_tables = false;
+  };
+
+  /*! Start re-estimating tables from a prior model.
+   *
+   * \param[in] prior Loaded measurement model, whose first two values are the
+   * contact and no contact likelihoods. Its tables are copied.
+   * \param[in] log_ratio_index Index of the log-likelihood ratio in the
+   * values of the prior.
+   * \param[in] params Parameters of the re-estimation.
+   * \throw std::invalid_argument If the prior grid is not uniform and 2-D,
+   * or if the prior weight is not strictly positive.
+   */
+  OnlineKde(const NpzInterpolator &prior, size_t log_ratio_index,
+            const Parameters &params);
+
+  //! Stop the background thread and release all tables.
+  ~OnlineKde();
+
+  OnlineKde(const OnlineKde &) = delete;
+  OnlineKde &operator=(const OnlineKde &) = delete;
+
+  /*! Add a torque sample, in O(1) and without locking.
+   *
+   * Should only be called by the real-time thread. Samples outside of the
+   * grid are ignored.
+   *
+   * \param[in] x First coordinate, e.g. filtered wheel torque.
+   * \param[in] y Second coordinate, e.g. filtered knee torque.
+   * \param[in] p_contact Posterior probability of contact.
+   */
+  void add_sample(double x, double y, double p_contact) {
+    if (!(x >= x0_ && x <= x1_ && y >= y0_ && y <= y1_)) {
+      return;
+    }
+    const size_t i = static_cast<size_t>((x - x0_) * inv_dx_ + 0.5);
+    const size_t j = static_cast<size_t>((y - y0_) * inv_dy_ + 0.5);
+    const size_t node = i * ny_ + j;
+
+    // Single writer, readers only need each count to be consistent
+    std::atomic<double> &contact = contact_counts_[node];
+    std::atomic<double> &no_contact = no_contact_counts_[node];
+    contact.store(contact.load(std::memory_order_relaxed) + p_contact,
+                  std::memory_order_relaxed);
+    no_contact.store(
+        no_contact.load(std::memory_order_relaxed) + (1.0 - p_contact),
+        std::memory_order_relaxed);
+  }
+
+  /*! Latest re-estimated tables, without locking.
+   *
+   * Should only be called by the real-time thread. The returned tables stay
+   * valid until the next call.
+   *
+   * \return Interpolator of the latest tables, or nullptr before the first
+   * update.
+   */
+  NpzInterpolator *acquire() {
+    NpzInterpolator *tables = published_.load();
+    for (;;) {
+      // Announce the tables before using them, then check they were not
+      // swapped in between, so that update() never releases them
+      in_use_.store(tables);
+      NpzInterpolator *latest = published_.load();
+      if (latest == tables) {
+        return tables;
+      }
+      tables = latest;
+    }
+  }
+
+  /*! Re-estimate tables from the samples so far and publish them.
+   *
+   * Called periodically by the background thread, or by the user if the
+   * update period is zero.
+   */
+  void update();
+
+  //! Number of updates so far
+  size_t num_updates() const { return num_updates_.load(); }
+
+ private:
+  //! Periodically call update() until stopped.
+  void run();
+
+  /*! Smooth a histogram in place with the Gaussian kernel.
+   *
+   * \param[in,out] histogram Weights at grid nodes, in row-major order.
+   */
+  void smooth(std::vector<double> &histogram) const;
+
+  //! Parameters of the re-estimation
+  const Parameters params_;
+
+  //! Index of the log-likelihood ratio in the values
+  const size_t log_ratio_index_;
+
+  //! Axis keys of the prior
+  std::vector<std::string> axis_keys_;
+
+  //! Value keys of the prior
+  std::vector<std::string> value_keys_;
+
+  //! Grid points along each axis
+  std::vector<std::vector<double>> axis_values_;
+
+  //! Tables of the prior, in row-major order
+  std::vector<std::vector<double>> prior_tables_;
+
+  //! Number of grid points along each axis
+  size_t nx_;
+  size_t ny_;
+
+  //! First and last grid points along each axis
+  double x0_, x1_;
+  double y0_, y1_;
+
+  //! Inverse of the grid spacing along each axis
+  double inv_dx_;
+  double inv_dy_;
+
+  //! Total weights of contact samples at each node, only written by the
+  //! real-time thread
+  std::unique_ptr<std::atomic<double>[]> contact_counts_;
+
+  //! Total weights of no contact samples at each node, only written by the
+  //! real-time thread
+  std::unique_ptr<std::atomic<double>[]> no_contact_counts_;
+
+  //! Counts at the last update
+  std::vector<double> last_contact_counts_;
+  std::vector<double> last_no_contact_counts_;
+
+  //! Weights of samples at each node, decayed at each update
+  std::vector<double> contact_weights_;
+  std::vector<double> no_contact_weights_;
+
+  //! Latest tables, owned by this object
+  std::atomic<NpzInterpolator *> published_{nullptr};
+
+  //! Tables used by the real-time thread since its last acquire()
+  std::atomic<NpzInterpolator *> in_use_{nullptr};
+
+  //! Replaced tables, released once the real-time thread moved on
+  std::vector<std::unique_ptr<NpzInterpolator>> retired_;
+
+  //! Serialize updates
+  std::mutex update_mutex_;
+
+  //! Number of updates so far
+  std::atomic<size_t> num_updates_{0};
+
+  //! Stop flag of the background thread
+  bool stop_ = false;
+
+  //! Protect the stop flag
+  std::mutex stop_mutex_;
+
+  //! Wake up the background thread when stopping
+  std::condition_variable stop_condition_;
+
+  //! Background thread, if the update period is positive
+  std::thread thread_;
+};
@@ -6,16 +6,23 @@
 #include <sys/mman.h>
 #include <sys/types.h>
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <optional>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include "mpack/mpack.h"
 #include "mpacklog/Logger.h"
 #include "observers/ContactFilter.h"
+#include "observers/FixedLagSmoother.h"
 #include "observers/MeasurementModel.h"
 #include "observers/TransitionModel.h"
+#include "observers/WheelContactFilter.h"
+#include "observers/utils.h"
 #include "palimpsest/Dictionary.h"
 
 MemoryMappedFile::MemoryMappedFile(const std::filesystem::path &path,
@@ -66,6 +73,10 @@ static bool validate_path(const std::filesystem::path &path,
   return true;
 }
 
+//! Largest lag of the fixed-lag smoother, ten seconds at 1 kHz, as its ring
+//! buffers are allocated at once
+constexpr size_t kMaxSmootherLag = 10000;
+
 //! Command-line arguments for the mock spine.
 class CommandLineArguments {
  public:
@@ -74,18 +85,57 @@ class CommandLineArguments {
    * \param[in] args List of command-line arguments.
    */
   explicit CommandLineArguments(const std::vector<std::string> &args) {
+    size_t num_paths = 0;
     for (size_t i = 1; i < args.size(); i++) {
       const auto &arg = args[i];
-      if (arg == "-h" || arg == "--help") {
+      if ((arg == "--hop" || arg == "--hop-sweep" ||
+           arg == "--smoother-lag") &&
+          i + 1 >= args.size()) {
+        spdlog::error("Missing value after {}", arg);
+        error = true;
+      } else if (arg == "-h" || arg == "--help") {
         help = true;
+      } else if (arg == "--hop") {
+        if (const auto parsed_hop = parse_hop(args.at(++i))) {
+          hop = *parsed_hop;
+          spdlog::info("Command line: hop = {}", hop);
+        }
+      } else if (arg == "--hop-sweep") {
+        std::stringstream hops(args.at(++i));
+        std::string item;
+        bool valid = true;
+        while (std::getline(hops, item, ',')) {
+          const auto parsed_hop = parse_hop(item);
+          valid = valid && parsed_hop.has_value();
+          if (parsed_hop) {
+            hop_sweep.push_back(*parsed_hop);
+          }
+        }
+        if (valid) {
+          spdlog::info("Command line: hop_sweep = {}", args.at(i));
+        }
+      } else if (arg == "--smoother-lag") {
+        if (const auto parsed_lag =
+                parse_ticks("Smoother lag", args.at(++i), 0, kMaxSmootherLag)) {
+          smoother_lag = *parsed_lag;
+          spdlog::info("Command line: smoother_lag = {}", smoother_lag);
+        }
+      } else if (arg == "--smooth") {
+        smooth = true;
+        spdlog::info("Command line: smooth = true");
+      } else if (arg == "--both-legs") {
+        both_legs = true;
+        spdlog::info("Command line: both_legs = true");
       } else if (arg == "") {
         error = true;
         spdlog::error("Path cannot be empty!");
-      } else if (i == 1) {
+      } else if (num_paths == 0) {
         input_path = args.at(i);
+        num_paths++;
         spdlog::info("Command line: input_path = {}", args.at(i));
-      } else if (i == 2) {
+      } else if (num_paths == 1) {
         output_path = args.at(i);
+        num_paths++;
         spdlog::info("Command line: output_path = {}", args.at(i));
       } else {
         spdlog::error("Unknown argument: {}", arg);
@@ -98,6 +148,11 @@ class CommandLineArguments {
       error = true;
     }
 
+    if (both_legs && (smoother_lag > 0 || smooth)) {
+      spdlog::error("Smoothing is only available for a single leg");
+      error = true;
+    }
+
     if (input_path == output_path && !help) {
       spdlog::error("Input and output paths cannot be the same!");
       error = true;
@@ -120,6 +175,47 @@ class CommandLineArguments {
     }
   }
 
+  /*! Parse a number of ticks, setting the error flag if it is invalid.
+   *
+   * \param[in] name Name of the number, for error messages.
+   * \param[in] arg Command-line argument.
+   * \param[in] min_ticks Smallest valid number of ticks.
+   * \param[in] max_ticks Largest valid number of ticks.
+   * \return Number of ticks, or nothing if the argument is invalid.
+   */
+  std::optional<size_t> parse_ticks(const std::string &name,
+                                    const std::string &arg, size_t min_ticks,
+                                    size_t max_ticks) {
+    // Only digits, as std::stoul accepts signs and wraps negative numbers
+    bool valid = !arg.empty() &&
+                 arg.find_first_not_of("0123456789") == std::string::npos;
+    size_t ticks = 0;
+    if (valid) {
+      try {
+        ticks = std::stoul(arg);
+      } catch (const std::out_of_range &) {
+        valid = false;
+      }
+    }
+    if (!valid || ticks < min_ticks || ticks > max_ticks) {
+      spdlog::error("{} must be an integer between {} and {}, got '{}'", name,
+                    min_ticks, max_ticks, arg);
+      error = true;
+      return std::nullopt;
+    }
+    return ticks;
+  }
+
+  /*! Parse a number of ticks between two spectral updates.
+   *
+   * \param[in] arg Command-line argument.
+   * \return Hop, or nothing if the argument is not an integer between one
+   * and the window size of the transition model.
+   */
+  std::optional<size_t> parse_hop(const std::string &arg) {
+    return parse_ticks("Hop", arg, 1, static_cast<size_t>(kWindowSize));
+  }
+
   /*! Show help message
    *
    * \param[in] name Binary name from argv[0].
@@ -136,6 +232,28 @@ class CommandLineArguments {
     std::cout << "Optional arguments:\n\n";
     std::cout << "-h, --help\n"
               << "    Print this help and exit.\n";
+    std::cout << "--hop <ticks>\n"
+              << "    Ticks between two spectral updates of the transition "
+              << "model, from 1 to\n"
+              << "    its window size of " << kWindowSize << " ticks.\n";
+    std::cout << "--hop-sweep <ticks,ticks,...>\n"
+              << "    Report how the contact probability changes for each "
+              << "hop, compared to\n"
+              << "    a spectral update at every tick.\n";
+    std::cout << "--smoother-lag <ticks>\n"
+              << "    Also write contact_filter/p_contact_smoothed_lag, "
+              << "smoothed over the\n"
+              << "    next ticks by a fixed-lag smoother, up to "
+              << kMaxSmootherLag << " ticks.\n";
+    std::cout << "--smooth\n"
+              << "    Also write contact_filter/p_contact_smoothed, smoothed "
+              << "over the whole\n"
+              << "    log by a forward-backward pass.\n";
+    std::cout << "--both-legs\n"
+              << "    Estimate the contacts of both wheels jointly, writing "
+              << "contact_filter/left\n"
+              << "    and contact_filter/right. Not compatible with "
+              << "smoothing.\n";
     std::cout << "\n";
   }
 
@@ -154,9 +272,24 @@ class CommandLineArguments {
 
   //! Version flag
   bool version = false;
+
+  //! Ticks between two spectral updates of the transition model
+  size_t hop = 1;
+
+  //! Hops to compare against a spectral update at every tick
+  std::vector<size_t> hop_sweep;
+
+  //! Lag of the fixed-lag smoother, zero to disable it
+  size_t smoother_lag = 0;
+
+  //! Smoothing over the whole log flag
+  bool smooth = false;
+
+  //! Joint contact estimation of both wheels flag
+  bool both_legs = false;
 };
 
-Replay::Replay(const Parameters &parameters) {
+Replay::Replay(const Parameters &parameters) : parameters(parameters) {
   //! Check if the paths are valid
   if (!validate_path(parameters.input_path)) return;
 
@@ -169,50 +302,88 @@ Replay::Replay(const Parameters &parameters) {
   std::cout << "argv0: " << parameters.argv0 << std::endl;
 
   // Initialize observers
+  observers = make_observers(parameters.hop);
+}
+
+std::vector<std::shared_ptr<Observer>> Replay::make_observers(
+    size_t hop) const {
+  std::vector<std::shared_ptr<Observer>> pipeline;
+
+  // Observation: Transition model
   TransitionModel::Parameters transition_model_params;
   transition_model_params.dt = 0.001;
-  transition_model_params.window_size = 128;
+  transition_model_params.window_size = kWindowSize;
+  transition_model_params.hop = hop;
   auto transition_model =
       std::make_shared<TransitionModel>(transition_model_params);
-  observers.push_back(transition_model);
+  pipeline.push_back(transition_model);
 
   // Observation: Measurement model
   MeasurementModel::Parameters measurement_model_params;
-  measurement_model_params.argv0 = parameters.argv0;
+  measurement_model_params.resolve_model_path =
+      runfiles_resolver(parameters.argv0);
   measurement_model_params.dt = 0.001;
   measurement_model_params.cutoff_periods = {0.025, 0.025};
+  if (parameters.both_legs) {
+    measurement_model_params.leg_names = {"left", "right"};
+  }
   auto measurement_model =
       std::make_shared<MeasurementModel>(measurement_model_params);
-  observers.push_back(measurement_model);
-
-  // Observation: Contact filter
-  ContactFilter contact_filter(0.5);
-  observers.push_back(std::make_shared<ContactFilter>(contact_filter));
+  pipeline.push_back(measurement_model);
+
+  // Observation: Contact filter, of both wheels at once if requested
+  if (parameters.both_legs) {
+    WheelContactFilter::Parameters wheel_contact_filter_params;
+    wheel_contact_filter_params.leg_names = measurement_model_params.leg_names;
+    pipeline.push_back(
+        std::make_shared<WheelContactFilter>(wheel_contact_filter_params));
+    return pipeline;
+  }
+  ContactFilter contact_filter(0.5, /* log_odds = */ false,
+                               parameters.smoother_lag);
+  pipeline.push_back(std::make_shared<ContactFilter>(contact_filter));
+  return pipeline;
 }
 
-void Replay::process() {
-  // Read the input file
+void Replay::for_each_dictionary(
+    const std::function<void(palimpsest::Dictionary &)> &callback) const {
   mpack_tree_t tree;
   mpack_tree_init_data(&tree, (const char *)input_file->mmap_addr,
                        input_file->sb.st_size);
 
   palimpsest::Dictionary dictionary;
-  int i = 0;
   while (true) {
     mpack_tree_parse(&tree);
-
     if (mpack_tree_error(&tree) != mpack_ok) {
-      spdlog::info("End of file reached, terminating...");
       break;
     }
-    mpack_node_t root = mpack_tree_root(&tree);
-    dictionary.update(root);
+    dictionary.update(mpack_tree_root(&tree));
+    callback(dictionary);
+  }
+  mpack_tree_destroy(&tree);
+}
+
+void Replay::process() {
+  // Smoothing over the whole log needs a first pass over it
+  std::vector<double> p_contact_smoothed;
+  if (parameters.smooth) {
+    smooth_contact(p_contact_smoothed);
+  }
 
+  // Read the input file
+  int i = 0;
+  size_t tick = 0;
+  for_each_dictionary([&](palimpsest::Dictionary &dictionary) {
     // Update observers
     for (auto &observer : observers) {
       observer->read(dictionary("observation"));
       observer->write(dictionary("observation"));
     }
+    if (tick < p_contact_smoothed.size()) {
+      dictionary("observation")("contact_filter")("p_contact_smoothed") =
+          p_contact_smoothed[tick];
+    }
+    ++tick;
 
     if (i >= 1) {
       // Delete the config key
@@ -223,18 +394,114 @@ void Replay::process() {
     if (!logger->put(dictionary)) {
       spdlog::error("Failed to write dictionary to output file");
       exit(1);
-      break;
     }
+  });
+  spdlog::info("End of file reached, terminating...");
+}
+
+std::chrono::nanoseconds Replay::replay_contact(
+    size_t hop, std::vector<double> &p_contact) {
+  auto pipeline = make_observers(hop);
+  std::chrono::nanoseconds transition_time{};
+  p_contact.clear();
+  for_each_dictionary([&](palimpsest::Dictionary &dictionary) {
+    auto &observation = dictionary("observation");
+    for (size_t i = 0; i < pipeline.size(); ++i) {
+      auto start_time = std::chrono::steady_clock::now();
+      pipeline[i]->read(observation);
+      pipeline[i]->write(observation);
+      if (i == 0) {
+        transition_time += std::chrono::steady_clock::now() - start_time;
+      }
+    }
+    p_contact.push_back(
+        observation("contact_filter")("p_contact").as<double>());
+  });
+  return transition_time;
+}
+
+void Replay::smooth_contact(std::vector<double> &p_contact_smoothed) {
+  auto pipeline = make_observers(parameters.hop);
+  auto contact_filter =
+      std::dynamic_pointer_cast<ContactFilter>(pipeline.back());
+  FixedLagSmoother<2>::MatrixSequence transitions;
+  FixedLagSmoother<2>::VectorSequence likelihoods, beliefs;
+  for_each_dictionary([&](palimpsest::Dictionary &dictionary) {
+    auto &observation = dictionary("observation");
+    for (auto &observer : pipeline) {
+      observer->read(observation);
+      observer->write(observation);
+    }
+    transitions.push_back(contact_filter->transition);
+    likelihoods.push_back(contact_filter->likelihoods);
+    beliefs.emplace_back(1.0 - contact_filter->p_contact,
+                         contact_filter->p_contact);
+  });
+
+  const auto smoothed =
+      FixedLagSmoother<2>::smooth(transitions, likelihoods, beliefs);
+  p_contact_smoothed.clear();
+  size_t num_flips = 0;
+  for (size_t t = 0; t < smoothed.size(); ++t) {
+    p_contact_smoothed.push_back(smoothed[t](1));
+    num_flips += (smoothed[t](1) > 0.5) != (beliefs[t](1) > 0.5);
+  }
+  spdlog::info(
+      "Smoothed contact state differs from the filtered one on {:.2f}% of "
+      "{} ticks",
+      smoothed.empty() ? 0.0 : 100.0 * num_flips / smoothed.size(),
+      smoothed.size());
+}
+
+void Replay::sweep_hops() {
+  if (parameters.hop_sweep.empty() || input_file == nullptr) {
+    return;
+  }
+
+  std::vector<double> reference, p_contact;
+  const auto reference_time = replay_contact(1, reference);
+  if (reference.empty()) {
+    spdlog::warn("No observation to sweep hops over");
+    return;
+  }
+  const double num_ticks = reference.size();
+  spdlog::info("hop = 1: transition model {:.2f} us/tick (reference)",
+               1e-3 * reference_time.count() / num_ticks);
+
+  for (size_t hop : parameters.hop_sweep) {
+    const auto transition_time = replay_contact(hop, p_contact);
+
+    // Deviation from the reference, and ticks where the estimated contact
+    // state, i.e. p_contact thresholded at 0.5, differs
+    double sum_error{}, max_error{};
+    size_t num_flips = 0;
+    for (size_t t = 0; t < reference.size(); ++t) {
+      const double error = std::abs(p_contact[t] - reference[t]);
+      sum_error += error;
+      max_error = std::max(max_error, error);
+      num_flips += (p_contact[t] > 0.5) != (reference[t] > 0.5);
+    }
+    spdlog::info(
+        "hop = {}: transition model {:.2f} us/tick, p_contact mean abs error "
+        "{:.3e}, max abs error {:.3e}, contact state differs on {:.2f}% of "
+        "ticks",
+        hop, 1e-3 * transition_time.count() / num_ticks, sum_error / num_ticks,
+        max_error, 100.0 * num_flips / num_ticks);
   }
-  mpack_tree_destroy(&tree);
 }
 
 // Main function
 int main(int argc, char **argv) {
   CommandLineArguments args({argv, argv + argc});
   Replay::Parameters parameters(args.input_path, args.output_path, argv[0]);
+  parameters.hop = args.hop;
+  parameters.hop_sweep = args.hop_sweep;
+  parameters.smoother_lag = args.smoother_lag;
+  parameters.smooth = args.smooth;
+  parameters.both_legs = args.both_legs;
   Replay replay(parameters);
   replay.process();
+  replay.sweep_hops();
 
   return 0;
 }
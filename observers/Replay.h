@@ -2,7 +2,9 @@
 // Copyright 2024 Inria
 #pragma once
 
+#include <chrono>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -34,6 +36,26 @@ class Replay {
     std::filesystem::path input_path;
     std::filesystem::path output_path;
     std::filesystem::path argv0;
+
+    //! Number of ticks between two spectral updates of the transition model
+    size_t hop = 1;
+
+    //! Hops to compare against `hop = 1` after processing, if any
+    std::vector<size_t> hop_sweep;
+
+    //! Lag of the fixed-lag smoother of the contact filter in ticks, zero to
+    //! disable it
+    size_t smoother_lag = 0;
+
+    //! Also write the contact belief smoothed over the whole input file, to
+    //! `contact_filter/p_contact_smoothed`
+    bool smooth = false;
+
+    /*! Estimate the contacts of both wheels jointly, with a measurement model
+     * of both legs and a WheelContactFilter instead of a ContactFilter. Not
+     * compatible with smoothing, which is implemented by ContactFilter.
+     */
+    bool both_legs = false;
   };
 
   palimpsest::Dictionary current_dictionary;
@@ -42,9 +64,18 @@ class Replay {
 
   void process();
 
+  /*! Replay the input file for each hop in Parameters::hop_sweep, and report
+   * how the contact probability and the transition model time per tick
+   * deviate from the ones with `hop = 1`.
+   */
+  void sweep_hops();
+
   std::filesystem::path input_path;
   std::filesystem::path output_path;
 
+  //! Replay parameters
+  Parameters parameters;
+
   //! Vector of observers, a polymorphic container.
   std::vector<std::shared_ptr<Observer>> observers;
 
@@ -53,4 +84,38 @@ class Replay {
 
   //! Output file
   std::unique_ptr<mpacklog::Logger> logger;
+
+ private:
+  /*! Create the observer pipeline.
+   *
+   * \param[in] hop Number of ticks between two spectral updates of the
+   * transition model.
+   * \return Observers, the transition model being the first one.
+   */
+  std::vector<std::shared_ptr<Observer>> make_observers(size_t hop) const;
+
+  /*! Parse the input file one dictionary at a time, until its end.
+   *
+   * \param[in] callback Function called on each dictionary once updated from
+   * the input file.
+   */
+  void for_each_dictionary(
+      const std::function<void(palimpsest::Dictionary &)> &callback) const;
+
+  /*! Run an observer pipeline over the input file without logging it.
+   *
+   * \param[in] hop Number of ticks between two spectral updates.
+   * \param[out] p_contact Contact probability at each tick.
+   * \return Time spent in the transition model.
+   */
+  std::chrono::nanoseconds replay_contact(size_t hop,
+                                          std::vector<double> &p_contact);
+
+  /*! Run an observer pipeline over the input file, then smooth its contact
+   * belief forward and backward over all ticks.
+   *
+   * \param[out] p_contact_smoothed Smoothed contact probability at each
+   * tick.
+   */
+  void smooth_contact(std::vector<double> &p_contact_smoothed);
 };
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/RingWindow.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+void CompensatedSum::add(double value) {
+  const double new_sum = sum + value;
+  if (std::abs(sum) >= std::abs(value)) {
+    compensation += (sum - new_sum) + value;
+  } else {
+    compensation += (value - new_sum) + sum;
+  }
+  sum = new_sum;
+}
+
+RingWindow::RingWindow(size_t size) : size_(size), buffer_(2 * size, 0.0) {
+  if (size == 0) {
+    throw std::invalid_argument("Window size must be strictly positive!");
+  }
+}
+
+void RingWindow::push(double sample) {
+  const double dropped = buffer_[head_];
+  buffer_[head_] = sample;
+  buffer_[head_ + size_] = sample;
+  head_ = (head_ + 1) % size_;
+
+  sum_.add(sample);
+  sum_.add(-dropped);
+  sum_of_squares_.add(sample * sample);
+  sum_of_squares_.add(-dropped * dropped);
+}
+
+double RingWindow::sum_of_squares() const {
+  // Rounding may leave a tiny negative residual on an all-zero window
+  return std::max(sum_of_squares_.value(), 0.0);
+}
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/*! Sum of floating-point values with Neumaier compensation.
+ *
+ * The compensation term keeps track of the low-order bits lost at each
+ * addition, so that long sequences of additions and subtractions do not
+ * drift.
+ */
+struct CompensatedSum {
+  //! Add a value to the sum.
+  void add(double value);
+
+  //! Current value of the sum
+  double value() const { return sum + compensation; }
+
+  //! Running sum
+  double sum = 0.0;
+
+  //! Accumulated rounding errors
+  double compensation = 0.0;
+};
+
+/*! Fixed-size window over the last samples of a signal.
+ *
+ * Samples are stored twice in a buffer of size `2 * size`, so that the window
+ * is always available as a contiguous array from the oldest to the newest
+ * sample, without shifting the buffer. The sum and sum of squares of the
+ * window are updated at every push, so that the mean and power come out in
+ * O(1).
+ */
+class RingWindow {
+ public:
+  /*! Initialize a window filled with zeros.
+   *
+   * \param[in] size Number of samples in the window.
+   */
+  explicit RingWindow(size_t size);
+
+  /*! Append a new sample to the window, dropping the oldest one.
+   *
+   * \param[in] sample New sample.
+   */
+  void push(double sample);
+
+  //! Number of samples in the window
+  size_t size() const { return size_; }
+
+  //! Contiguous samples of the window, from the oldest to the newest
+  const double *data() const { return buffer_.data() + head_; }
+
+  //! Sample at index i, 0 being the oldest and `size() - 1` the newest
+  double operator[](size_t i) const { return data()[i]; }
+
+  //! Oldest sample in the window
+  double oldest() const { return buffer_[head_]; }
+
+  //! Newest sample in the window
+  double newest() const { return buffer_[head_ + size_ - 1]; }
+
+  //! Sum of the samples in the window
+  double sum() const { return sum_.value(); }
+
+  //! Sum of the squared samples in the window
+  double sum_of_squares() const;
+
+  //! Mean of the samples in the window
+  double mean() const { return sum() / size_; }
+
+  //! Mean of the squared samples in the window
+  double power() const { return sum_of_squares() / size_; }
+
+ private:
+  //! Number of samples in the window
+  const size_t size_;
+
+  //! Mirrored buffer, sample i is stored at both i and i + size
+  std::vector<double> buffer_;
+
+  //! Index of the oldest sample in the buffer
+  size_t head_ = 0;
+
+  //! Running sum of the samples
+  CompensatedSum sum_;
+
+  //! Running sum of the squared samples
+  CompensatedSum sum_of_squares_;
+};
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/SlidingDft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+SlidingDft::SlidingDft(size_t window_size, const std::vector<double> &freqs)
+    : window_size_(window_size),
+      freqs_(freqs),
+      window_(window_size),
+      bins_(freqs.size(), 0.0),
+      phases_(window_size),
+      cumulative_mags_(freqs.size(), 0.0) {
+  if (freqs.empty() || freqs.size() > window_size) {
+    throw std::invalid_argument(
+        "Number of output bins must be in [1, window_size]");
+  }
+  for (size_t m = 0; m < window_size; ++m) {
+    phases_[m] = std::polar(1.0, -2.0 * M_PI * m / window_size);
+  }
+}
+
+void SlidingDft::push(double sample) {
+  const double delta = sample - window_.oldest();
+  window_.push(sample);
+
+  // Slide every bin, and accumulate the magnitude sums in the same pass
+  double mag_sum{};
+  weighted_freq_sum_ = 0.0;
+  for (size_t k = 0; k < bins_.size(); ++k) {
+    bins_[k] = (bins_[k] + delta) * std::conj(phases_[k]);
+    if (k == next_resync_) {
+      resync(k);
+    }
+    const double mag = std::abs(bins_[k]);
+    mag_sum += mag;
+    weighted_freq_sum_ += mag * freqs_[k];
+    cumulative_mags_[k] = mag_sum;
+  }
+  next_resync_ = (next_resync_ + 1) % bins_.size();
+}
+
+void SlidingDft::resync(size_t k) {
+  const double *samples = window_.data();
+  std::complex<double> bin{};
+  for (size_t j = 0; j < window_size_; ++j) {
+    bin += samples[j] * phases_[(k * j) % window_size_];
+  }
+  bins_[k] = bin;
+}
+
+double SlidingDft::mean_frequency() const {
+  return weighted_freq_sum_ / cumulative_mags_.back();
+}
+
+double SlidingDft::median_frequency() const {
+  // Same definition as TransitionModel::median_frequency, on unnormalized
+  // cumulative sums. They are sorted, so we can bisect for the first bin
+  // reaching half of the total magnitude.
+  const double half_sum = 0.5 * cumulative_mags_.back();
+  if (!(half_sum > 0.0)) {
+    // Empty spectrum: same output as TransitionModel::median_frequency
+    return freqs_.back();
+  }
+
+  auto it = std::lower_bound(cumulative_mags_.begin(), cumulative_mags_.end(),
+                             half_sum);
+  if (it == cumulative_mags_.end()) {
+    return freqs_.back();
+  } else if (it == cumulative_mags_.begin()) {
+    return freqs_.front();
+  }
+
+  const size_t i = it - cumulative_mags_.begin();
+  const double c1 = cumulative_mags_[i - 1];
+  const double c2 = cumulative_mags_[i];
+
+  // Linear interpolation
+  const double f1 = freqs_[i - 1];
+  const double f2 = freqs_[i];
+  return f1 + (f2 - f1) * (half_sum - c1) / (c2 - c1);
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <complex>
+#include <vector>
+
+#include "observers/RingWindow.h"
+
+/*! Sliding discrete Fourier transform over a fixed-size window.
+ *
+ * Each new sample updates the first `N / 2` bins of the DFT of the last `N`
+ * samples in O(N), using \f$ X_k \leftarrow (X_k - x_{old} + x_{new}) e^{2 \pi
+ * i k / N} \f$. The bins follow the same convention as `kiss_fft`, i.e. the
+ * oldest sample of the window has index 0.
+ *
+ * The recursion is marginally stable, so rounding errors would slowly
+ * accumulate. To bound them, one bin is recomputed exactly from the window at
+ * every sample, in a round-robin fashion. The magnitude sums used by the mean
+ * and median frequencies are accumulated in the same pass as the update.
+ */
+class SlidingDft {
+ public:
+  /*! Initialize the sliding DFT with an all-zero window.
+   *
+   * \param[in] window_size Number of samples in the window.
+   * \param[in] freqs Frequency of each output bin, of size `window_size / 2`.
+   */
+  SlidingDft(size_t window_size, const std::vector<double> &freqs);
+
+  /*! Slide the window by one sample and update the spectrum.
+   *
+   * \param[in] sample New sample, the oldest one is dropped.
+   */
+  void push(double sample);
+
+  //! Magnitude-weighted mean frequency of the current spectrum
+  double mean_frequency() const;
+
+  //! Frequency splitting the magnitude of the current spectrum in halves
+  double median_frequency() const;
+
+  //! Output bins, the first `window_size / 2` bins of the DFT
+  const std::vector<std::complex<double>> &bins() const { return bins_; }
+
+ private:
+  //! Recompute bin k from the samples in the window.
+  void resync(size_t k);
+
+  //! Number of samples in the window
+  const size_t window_size_;
+
+  //! Frequency of each output bin
+  const std::vector<double> freqs_;
+
+  //! Samples in the window
+  RingWindow window_;
+
+  //! Output bins
+  std::vector<std::complex<double>> bins_;
+
+  //! Table of \f$ e^{-2 \pi i m / N} \f$ for m in [0, N)
+  std::vector<std::complex<double>> phases_;
+
+  //! Cumulative sum of bin magnitudes
+  std::vector<double> cumulative_mags_;
+
+  //! Sum of magnitude-weighted frequencies
+  double weighted_freq_sum_ = 0.0;
+
+  //! Next bin to recompute exactly
+  size_t next_resync_ = 0;
+};
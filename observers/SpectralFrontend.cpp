@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/SpectralFrontend.h"
+
+#include <stdexcept>
+#include <string>
+
+std::unique_ptr<SpectralFrontend> make_real_fft_frontend(
+    size_t window_size, bool apply_hann_window) {
+  switch (window_size) {
+    case 32:
+      return std::make_unique<RealFftFrontend<32>>(apply_hann_window);
+    case 64:
+      return std::make_unique<RealFftFrontend<64>>(apply_hann_window);
+    case 128:
+      return std::make_unique<RealFftFrontend<128>>(apply_hann_window);
+    case 256:
+      return std::make_unique<RealFftFrontend<256>>(apply_hann_window);
+    case 512:
+      return std::make_unique<RealFftFrontend<512>>(apply_hann_window);
+    case 1024:
+      return std::make_unique<RealFftFrontend<1024>>(apply_hann_window);
+    default:
+      throw std::invalid_argument(
+          "No real FFT specialization for window size " +
+          std::to_string(window_size));
+  }
+}
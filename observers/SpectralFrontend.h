@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <memory>
+
+#include "kiss_fft/kiss_fftr.h"
+
+//! Compute the spectrum of a window of real samples.
+class SpectralFrontend {
+ public:
+  virtual ~SpectralFrontend() = default;
+
+  /*! Compute the spectrum of a window.
+   *
+   * \param[in] window Samples of the window, from the oldest to the newest.
+   * Should hold `window_size()` values.
+   */
+  virtual void transform(const double *window) = 0;
+
+  //! Number of samples in the window
+  virtual size_t window_size() const = 0;
+
+  //! Output bins `[0, window_size() / 2]` of the last transform
+  virtual const kiss_fft_cpx *bins() const = 0;
+};
+
+/*! Real-input FFT specialized on the window size.
+ *
+ * All buffers have a size fixed at compile time and are stored inline,
+ * aligned to a cache line. The optional Hann window is a periodic window
+ * computed once at construction, then applied while copying the input.
+ *
+ * \tparam N Number of samples in the window, should be even.
+ */
+template <size_t N>
+class RealFftFrontend : public SpectralFrontend {
+  static_assert(N >= 2 && N % 2 == 0, "kiss_fftr requires an even size");
+
+ public:
+  /*! Initialize the frontend.
+   *
+   * \param[in] apply_hann_window Apply a Hann window to the input.
+   */
+  explicit RealFftFrontend(bool apply_hann_window)
+      : apply_hann_window_(apply_hann_window),
+        cfg_(kiss_fftr_alloc(N, false, nullptr, nullptr)) {
+    for (size_t i = 0; i < N; ++i) {
+      hann_table_[i] = 0.5 * (1.0 - std::cos(2.0 * M_PI * i / N));
+    }
+  }
+
+  ~RealFftFrontend() override {
+    kiss_fftr_free(cfg_);
+    cfg_ = nullptr;
+  }
+
+  RealFftFrontend(const RealFftFrontend &) = delete;
+  RealFftFrontend &operator=(const RealFftFrontend &) = delete;
+
+  void transform(const double *window) final {
+    if (apply_hann_window_) {
+      for (size_t i = 0; i < N; ++i) {
+        input_[i] = window[i] * hann_table_[i];
+      }
+    } else {
+      for (size_t i = 0; i < N; ++i) {
+        input_[i] = window[i];
+      }
+    }
+    kiss_fftr(cfg_, input_.data(), output_.data());
+  }
+
+  size_t window_size() const final { return N; }
+
+  const kiss_fft_cpx *bins() const final { return output_.data(); }
+
+ private:
+  //! Apply the Hann window to the input
+  const bool apply_hann_window_;
+
+  //! Real FFT configuration
+  kiss_fftr_cfg cfg_;
+
+  //! Periodic Hann window coefficients
+  alignas(64) std::array<double, N> hann_table_{};
+
+  //! Windowed input samples
+  alignas(64) std::array<double, N> input_{};
+
+  //! Output bins, up to and including the Nyquist frequency
+  alignas(64) std::array<kiss_fft_cpx, N / 2 + 1> output_{};
+};
+
+/*! Create a real-input FFT frontend for a window size known at runtime.
+ *
+ * \param[in] window_size Number of samples in the window, should be a power
+ * of two between 32 and 1024.
+ * \param[in] apply_hann_window Apply a Hann window to the input.
+ * \throw std::invalid_argument If there is no specialization for this size.
+ */
+std::unique_ptr<SpectralFrontend> make_real_fft_frontend(
+    size_t window_size, bool apply_hann_window);
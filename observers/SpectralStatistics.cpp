@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/SpectralStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+double fused_spectral_pass_scalar(const double *re, const double *im,
+                                  const double *freqs, size_t n, double *mags,
+                                  double *cumulative_mags) {
+  double mag_sum{}, weighted_freq_sum{};
+  for (size_t i = 0; i < n; ++i) {
+    const double mag = std::sqrt(re[i] * re[i] + im[i] * im[i]);
+    mags[i] = mag;
+    mag_sum += mag;
+    cumulative_mags[i] = mag_sum;
+    weighted_freq_sum += mag * freqs[i];
+  }
+  return weighted_freq_sum;
+}
+
+#if defined(__AVX2__)
+
+double fused_spectral_pass(const double *re, const double *im,
+                           const double *freqs, size_t n, double *mags,
+                           double *cumulative_mags) {
+  const __m256d zero = _mm256_setzero_pd();
+  __m256d carry = zero;
+  __m256d weighted_sum = zero;
+  for (size_t i = 0; i < n; i += 4) {
+    const __m256d x = _mm256_loadu_pd(re + i);
+    const __m256d y = _mm256_loadu_pd(im + i);
+    const __m256d squared_mag =
+        _mm256_add_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(y, y));
+    const __m256d mag = _mm256_sqrt_pd(squared_mag);
+    const __m256d freq = _mm256_loadu_pd(freqs + i);
+    _mm256_storeu_pd(mags + i, mag);
+    weighted_sum = _mm256_add_pd(weighted_sum, _mm256_mul_pd(mag, freq));
+
+    // In-register prefix sum: add the vector shifted by one, then by two lanes
+    __m256d scan = _mm256_add_pd(
+        mag, _mm256_blend_pd(_mm256_permute4x64_pd(mag, 0x90), zero, 0x1));
+    scan = _mm256_add_pd(
+        scan, _mm256_blend_pd(_mm256_permute4x64_pd(scan, 0x40), zero, 0x3));
+    scan = _mm256_add_pd(scan, carry);
+    _mm256_storeu_pd(cumulative_mags + i, scan);
+    carry = _mm256_permute4x64_pd(scan, 0xFF);
+  }
+  const __m128d pair_sum = _mm_add_pd(_mm256_castpd256_pd128(weighted_sum),
+                                      _mm256_extractf128_pd(weighted_sum, 1));
+  return _mm_cvtsd_f64(
+      _mm_add_sd(pair_sum, _mm_unpackhi_pd(pair_sum, pair_sum)));
+}
+
+#elif defined(__SSE2__)
+
+double fused_spectral_pass(const double *re, const double *im,
+                           const double *freqs, size_t n, double *mags,
+                           double *cumulative_mags) {
+  const __m128d zero = _mm_setzero_pd();
+  __m128d carry = zero;
+  __m128d weighted_sum = zero;
+  for (size_t i = 0; i < n; i += 2) {
+    const __m128d x = _mm_loadu_pd(re + i);
+    const __m128d y = _mm_loadu_pd(im + i);
+    const __m128d mag =
+        _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(x, x), _mm_mul_pd(y, y)));
+    _mm_storeu_pd(mags + i, mag);
+    weighted_sum =
+        _mm_add_pd(weighted_sum, _mm_mul_pd(mag, _mm_loadu_pd(freqs + i)));
+
+    // In-register prefix sum: add the vector shifted by one lane
+    __m128d scan = _mm_add_pd(mag, _mm_unpacklo_pd(zero, mag));
+    scan = _mm_add_pd(scan, carry);
+    _mm_storeu_pd(cumulative_mags + i, scan);
+    carry = _mm_unpackhi_pd(scan, scan);
+  }
+  return _mm_cvtsd_f64(
+      _mm_add_sd(weighted_sum, _mm_unpackhi_pd(weighted_sum, weighted_sum)));
+}
+
+#elif defined(__ARM_NEON)
+
+double fused_spectral_pass(const double *re, const double *im,
+                           const double *freqs, size_t n, double *mags,
+                           double *cumulative_mags) {
+  const float64x2_t zero = vdupq_n_f64(0.0);
+  float64x2_t carry = zero;
+  float64x2_t weighted_sum = zero;
+  for (size_t i = 0; i < n; i += 2) {
+    const float64x2_t x = vld1q_f64(re + i);
+    const float64x2_t y = vld1q_f64(im + i);
+    const float64x2_t mag = vsqrtq_f64(vfmaq_f64(vmulq_f64(x, x), y, y));
+    vst1q_f64(mags + i, mag);
+    weighted_sum = vfmaq_f64(weighted_sum, mag, vld1q_f64(freqs + i));
+
+    // In-register prefix sum: add the vector shifted by one lane
+    float64x2_t scan = vaddq_f64(mag, vextq_f64(zero, mag, 1));
+    scan = vaddq_f64(scan, carry);
+    vst1q_f64(cumulative_mags + i, scan);
+    carry = vdupq_laneq_f64(scan, 1);
+  }
+  return vaddvq_f64(weighted_sum);
+}
+
+#else
+
+double fused_spectral_pass(const double *re, const double *im,
+                           const double *freqs, size_t n, double *mags,
+                           double *cumulative_mags) {
+  return fused_spectral_pass_scalar(re, im, freqs, n, mags, cumulative_mags);
+}
+
+#endif
+
+SpectralStatistics::SpectralStatistics(const std::vector<double> &freqs)
+    : num_bins_(freqs.size()),
+      padded_size_((freqs.size() + kSpectralLanes - 1) / kSpectralLanes *
+                   kSpectralLanes),
+      freqs_(allocate()),
+      re_(allocate()),
+      im_(allocate()),
+      mags_(allocate()),
+      cumulative_mags_(allocate()) {
+  if (freqs.empty()) {
+    throw std::invalid_argument("Spectrum must have at least one bin");
+  }
+  std::copy(freqs.begin(), freqs.end(), freqs_.get());
+}
+
+SpectralStatistics::AlignedBuffer SpectralStatistics::allocate() const {
+  auto *ptr = static_cast<double *>(::operator new[](
+      padded_size_ * sizeof(double), std::align_val_t{kSpectralAlignment}));
+  std::fill(ptr, ptr + padded_size_, 0.0);
+  return AlignedBuffer(ptr);
+}
+
+void SpectralStatistics::compute(const kiss_fft_cpx *bins) {
+  // Deinterleave the bins, the padding stays zero
+  for (size_t i = 0; i < num_bins_; ++i) {
+    re_[i] = bins[i].r;
+    im_[i] = bins[i].i;
+  }
+  weighted_freq_sum_ =
+      fused_spectral_pass(re_.get(), im_.get(), freqs_.get(), padded_size_,
+                          mags_.get(), cumulative_mags_.get());
+}
+
+double SpectralStatistics::mean_frequency() const {
+  return weighted_freq_sum_ / magnitude_sum();
+}
+
+double SpectralStatistics::median_frequency() const {
+  // Same definition as ::median_frequency, on unnormalized cumulative sums.
+  // They are sorted, so we can bisect for the first bin reaching half of the
+  // total magnitude.
+  const double *begin = cumulative_mags_.get();
+  const double *end = begin + num_bins_;
+  const double half_sum = 0.5 * magnitude_sum();
+  if (!(half_sum > 0.0)) {
+    // Empty spectrum: same output as ::median_frequency
+    return freqs_[num_bins_ - 1];
+  }
+
+  const double *it = std::lower_bound(begin, end, half_sum);
+  if (it == end) {
+    return freqs_[num_bins_ - 1];
+  } else if (it == begin) {
+    return freqs_[0];
+  }
+
+  const size_t i = it - begin;
+  const double c1 = cumulative_mags_[i - 1];
+  const double c2 = cumulative_mags_[i];
+
+  // Linear interpolation
+  const double f1 = freqs_[i - 1];
+  const double f2 = freqs_[i];
+  return f1 + (f2 - f1) * (half_sum - c1) / (c2 - c1);
+}
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "kiss_fft/kiss_fft.h"
+
+//! Alignment of spectral buffers, one cache line
+inline constexpr size_t kSpectralAlignment = 64;
+
+//! Number of doubles processed at once by the fused spectral kernel
+#if defined(__AVX2__)
+inline constexpr size_t kSpectralLanes = 4;
+#elif defined(__SSE2__) || defined(__ARM_NEON)
+inline constexpr size_t kSpectralLanes = 2;
+#else
+inline constexpr size_t kSpectralLanes = 1;
+#endif
+
+/*! Fused pass over a spectrum in SoA layout, vectorized when possible.
+ *
+ * Computes in a single pass the magnitude of every bin, their prefix sums,
+ * and the sum of magnitude-weighted frequencies. Uses AVX2, SSE2 or NEON
+ * intrinsics depending on the target, see kSpectralLanes.
+ *
+ * \param[in] re Real parts of the bins.
+ * \param[in] im Imaginary parts of the bins.
+ * \param[in] freqs Frequency of each bin.
+ * \param[in] n Number of bins, should be a multiple of kSpectralLanes.
+ * \param[out] mags Magnitude of each bin.
+ * \param[out] cumulative_mags Prefix sums of the magnitudes.
+ * \return Sum of magnitude-weighted frequencies.
+ */
+double fused_spectral_pass(const double *re, const double *im,
+                           const double *freqs, size_t n, double *mags,
+                           double *cumulative_mags);
+
+//! Scalar fallback of fused_spectral_pass, for any number of bins.
+double fused_spectral_pass_scalar(const double *re, const double *im,
+                                  const double *freqs, size_t n, double *mags,
+                                  double *cumulative_mags);
+
+/*! Mean and median frequencies of a spectrum from a single fused pass.
+ *
+ * Output bins are deinterleaved into aligned real and imaginary arrays, padded
+ * with zeros to a multiple of kSpectralLanes, then fused_spectral_pass
+ * computes the magnitudes and their sums shared by both statistics. The
+ * definitions are the ones of ::mean_frequency and ::median_frequency.
+ */
+class SpectralStatistics {
+ public:
+  /*! Allocate buffers for a given set of bins.
+   *
+   * \param[in] freqs Frequency of each bin.
+   */
+  explicit SpectralStatistics(const std::vector<double> &freqs);
+
+  /*! Compute statistics of a spectrum.
+   *
+   * \param[in] bins Output bins of the FFT, at least `num_bins()` of them.
+   */
+  void compute(const kiss_fft_cpx *bins);
+
+  //! Number of bins
+  size_t num_bins() const { return num_bins_; }
+
+  //! Magnitude-weighted mean frequency, after compute()
+  double mean_frequency() const;
+
+  //! Frequency splitting the magnitude in halves, after compute()
+  double median_frequency() const;
+
+  //! Sum of the magnitudes of all bins, after compute()
+  double magnitude_sum() const { return cumulative_mags_[num_bins_ - 1]; }
+
+ private:
+  //! Deleter of aligned buffers
+  struct AlignedDelete {
+    void operator()(double *ptr) const {
+      ::operator delete[](ptr, std::align_val_t{kSpectralAlignment});
+    }
+  };
+
+  //! Buffer aligned on kSpectralAlignment
+  using AlignedBuffer = std::unique_ptr<double[], AlignedDelete>;
+
+  //! Allocate a zero-initialized aligned buffer.
+  AlignedBuffer allocate() const;
+
+  //! Number of bins
+  const size_t num_bins_;
+
+  //! Number of bins, padded to a multiple of kSpectralLanes
+  const size_t padded_size_;
+
+  //! Frequency of each bin, zero in the padding
+  AlignedBuffer freqs_;
+
+  //! Real parts of the bins
+  AlignedBuffer re_;
+
+  //! Imaginary parts of the bins
+  AlignedBuffer im_;
+
+  //! Magnitude of each bin
+  AlignedBuffer mags_;
+
+  //! Prefix sums of the magnitudes
+  AlignedBuffer cumulative_mags_;
+
+  //! Sum of magnitude-weighted frequencies
+  double weighted_freq_sum_ = 0.0;
+};
@@ -0,0 +1,271 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/TorquePrefilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+double TorquePrefilter::Response::noise_rejection_db() const {
+  return -10.0 * std::log10(noise_gain);
+}
+
+TorquePrefilter::TorquePrefilter(const Parameters &params, double dt,
+                                 const std::vector<double> &cutoff_periods)
+    : params_(params),
+      dt_(dt),
+      cutoff_periods_(cutoff_periods),
+      num_channels_(cutoff_periods.size()) {
+  if (dt <= 0.0) {
+    throw std::invalid_argument("Time step must be strictly positive");
+  }
+  for (double cutoff_period : cutoff_periods_) {
+    if (cutoff_period <= 2.0 * dt) {
+      throw std::invalid_argument(
+          "Cutoff periods should be above twice the time step");
+    }
+  }
+  switch (params_.type) {
+    case PrefilterType::kFirstOrder:
+    case PrefilterType::kOneEuro:
+      design_first_order();
+      break;
+    case PrefilterType::kButterworth:
+      design_butterworth();
+      break;
+    case PrefilterType::kLinearPhaseFir:
+      design_fir();
+      break;
+  }
+}
+
+void TorquePrefilter::design_first_order() {
+  // Same gain as upkie::cpp::utils::low_pass_filter
+  alpha_.resize(num_channels_);
+  for (size_t c = 0; c < num_channels_; ++c) {
+    alpha_[c] = dt_ / cutoff_periods_[c];
+  }
+  outputs_.assign(num_channels_, 0.0);
+  if (params_.type != PrefilterType::kOneEuro) {
+    return;
+  }
+
+  // Gains are 2 pi dt f, the cutoff frequency f of the one-euro filter
+  // rising linearly with the torque rate
+  if (params_.speed_coefficient < 0.0 || params_.rate_cutoff_frequency <= 0.0) {
+    throw std::invalid_argument(
+        "One-euro filters need a nonnegative speed coefficient and a "
+        "strictly positive rate cutoff frequency");
+  }
+  rate_alpha_ = std::min(2.0 * M_PI * dt_ * params_.rate_cutoff_frequency, 1.0);
+  speed_gain_ = 2.0 * M_PI * dt_ * params_.speed_coefficient;
+  rates_.assign(num_channels_, 0.0);
+}
+
+void TorquePrefilter::design_butterworth() {
+  const size_t num_sections = params_.num_sections;
+  if (num_sections < 1) {
+    throw std::invalid_argument("Butterworth filters need one section or more");
+  }
+  const size_t size = num_sections * num_channels_;
+  for (auto *coefficients : {&b0_, &b1_, &b2_, &a1_, &a2_}) {
+    coefficients->resize(size);
+  }
+  z1_.assign(size, 0.0);
+  z2_.assign(size, 0.0);
+
+  // Bilinear transform of each pair of Butterworth poles, see the Audio EQ
+  // Cookbook by Robert Bristow-Johnson
+  const double order = 2.0 * num_sections;
+  for (size_t s = 0; s < num_sections; ++s) {
+    const double quality =
+        1.0 / (2.0 * std::cos(M_PI * (2 * s + 1) / (2.0 * order)));
+    for (size_t c = 0; c < num_channels_; ++c) {
+      const double omega = dt_ / cutoff_periods_[c];
+      const double cos_omega = std::cos(omega);
+      const double alpha = std::sin(omega) / (2.0 * quality);
+      const double a0 = 1.0 + alpha;
+      const size_t i = s * num_channels_ + c;
+      b0_[i] = 0.5 * (1.0 - cos_omega) / a0;
+      b1_[i] = (1.0 - cos_omega) / a0;
+      b2_[i] = b0_[i];
+      a1_[i] = -2.0 * cos_omega / a0;
+      a2_[i] = (1.0 - alpha) / a0;
+    }
+  }
+}
+
+void TorquePrefilter::design_fir() {
+  // Shorter windows cut off above the cutoff frequency, e.g. 31 taps at 1 kHz
+  // have their -3 dB point at 22 Hz for a 6.4 Hz cutoff
+  const double max_cutoff_period =
+      *std::max_element(cutoff_periods_.begin(), cutoff_periods_.end());
+  const size_t min_taps =
+      static_cast<size_t>(std::ceil(2.0 * M_PI * max_cutoff_period / dt_)) | 1;
+  num_taps_ = (params_.num_taps > 0) ? params_.num_taps : min_taps;
+  const size_t num_taps = num_taps_;
+  if (num_taps % 2 == 0) {
+    throw std::invalid_argument("FIR filters need an odd number of taps");
+  }
+  if (num_taps < min_taps) {
+    throw std::invalid_argument(
+        "FIR filters need " + std::to_string(min_taps) +
+        " taps or more, so that their window spans one period of the cutoff "
+        "frequency");
+  }
+
+  // Hamming-windowed sinc, symmetric hence with a linear phase, normalized to
+  // a unit gain at DC
+  const double middle = 0.5 * (num_taps - 1);
+  taps_.resize(num_taps * num_channels_);
+  for (size_t c = 0; c < num_channels_; ++c) {
+    const double cutoff = dt_ / (2.0 * M_PI * cutoff_periods_[c]);
+    double sum = 0.0;
+    for (size_t k = 0; k < num_taps; ++k) {
+      const double x = 2.0 * cutoff * (k - middle);
+      const double sinc = (x == 0.0) ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+      const double window = 0.54 - 0.46 * std::cos(M_PI * k / middle);
+      taps_[k * num_channels_ + c] = 2.0 * cutoff * sinc * window;
+      sum += taps_[k * num_channels_ + c];
+    }
+    for (size_t k = 0; k < num_taps; ++k) {
+      taps_[k * num_channels_ + c] /= sum;
+    }
+  }
+  history_.assign(2 * num_taps * num_channels_, 0.0);
+  history_start_ = 0;
+}
+
+void TorquePrefilter::filter(const double *inputs, double *outputs) {
+  const size_t num_channels = num_channels_;
+  switch (params_.type) {
+    case PrefilterType::kFirstOrder:
+      for (size_t c = 0; c < num_channels; ++c) {
+        outputs_[c] += alpha_[c] * (inputs[c] - outputs_[c]);
+        outputs[c] = outputs_[c];
+      }
+      return;
+
+    case PrefilterType::kOneEuro:
+      for (size_t c = 0; c < num_channels; ++c) {
+        const double rate = (inputs[c] - outputs_[c]) / dt_;
+        rates_[c] += rate_alpha_ * (rate - rates_[c]);
+        const double alpha =
+            std::min(alpha_[c] + speed_gain_ * std::abs(rates_[c]), 1.0);
+        outputs_[c] += alpha * (inputs[c] - outputs_[c]);
+        outputs[c] = outputs_[c];
+      }
+      return;
+
+    case PrefilterType::kButterworth:
+      std::copy(inputs, inputs + num_channels, outputs);
+      for (size_t s = 0; s < params_.num_sections; ++s) {
+        const size_t offset = s * num_channels;
+        double *z1 = z1_.data() + offset;
+        double *z2 = z2_.data() + offset;
+        for (size_t c = 0; c < num_channels; ++c) {
+          const double x = outputs[c];
+          const double y = b0_[offset + c] * x + z1[c];
+          z1[c] = b1_[offset + c] * x - a1_[offset + c] * y + z2[c];
+          z2[c] = b2_[offset + c] * x - a2_[offset + c] * y;
+          outputs[c] = y;
+        }
+      }
+      return;
+
+    case PrefilterType::kLinearPhaseFir: {
+      const size_t num_taps = num_taps_;
+      history_start_ = (history_start_ == 0 ? num_taps : history_start_) - 1;
+      double *newest = history_.data() + history_start_ * num_channels;
+      std::copy(inputs, inputs + num_channels, newest);
+      std::copy(inputs, inputs + num_channels,
+                newest + num_taps * num_channels);
+      std::fill(outputs, outputs + num_channels, 0.0);
+      for (size_t k = 0; k < num_taps; ++k) {
+        const double *sample = newest + k * num_channels;
+        const double *tap = taps_.data() + k * num_channels;
+        for (size_t c = 0; c < num_channels; ++c) {
+          outputs[c] += tap[c] * sample[c];
+        }
+      }
+      return;
+    }
+  }
+}
+
+TorquePrefilter::Response TorquePrefilter::response(size_t channel) const {
+  // Linear filter of the channel alone, the one-euro filter at rest, with the
+  // same taps as the other channels
+  Parameters params = params_;
+  params.speed_coefficient = 0.0;
+  params.num_taps = num_taps_;
+  const double cutoff_period = cutoff_periods_.at(channel);
+  TorquePrefilter prefilter(params, dt_, {cutoff_period});
+
+  // Impulse response, long enough for IIR filters to settle
+  const size_t num_samples =
+      static_cast<size_t>(
+          std::ceil(50.0 * params.num_sections * cutoff_period / dt_)) +
+      num_taps_;
+  double weighted_sum = 0.0, sum = 0.0, energy = 0.0;
+  for (size_t n = 0; n < num_samples; ++n) {
+    const double impulse = (n == 0) ? 1.0 : 0.0;
+    double output;
+    prefilter.filter(&impulse, &output);
+    weighted_sum += n * output;
+    sum += output;
+    energy += output * output;
+  }
+  Response response{.group_delay = dt_ * weighted_sum / sum,
+                    .noise_gain = energy};
+  if (params_.type != PrefilterType::kOneEuro) {
+    return response;
+  }
+
+  // The energy of the impulse response only gives the noise gain of linear
+  // filters: measure that of the one-euro filter on white noise instead,
+  // after a settling time
+  TorquePrefilter one_euro(params_, dt_, {cutoff_period});
+  std::mt19937 generator(42);
+  std::normal_distribution<double> noise;
+  const size_t num_noise_samples = num_samples + 100000;
+  double noise_energy = 0.0;
+  for (size_t n = 0; n < num_noise_samples; ++n) {
+    const double input = noise(generator);
+    double output;
+    one_euro.filter(&input, &output);
+    if (n >= num_samples) {
+      noise_energy += output * output;
+    }
+  }
+  response.noise_gain = noise_energy / (num_noise_samples - num_samples);
+  return response;
+}
+
+std::string TorquePrefilter::type_name(PrefilterType type) {
+  switch (type) {
+    case PrefilterType::kFirstOrder:
+      return "first_order";
+    case PrefilterType::kButterworth:
+      return "butterworth";
+    case PrefilterType::kLinearPhaseFir:
+      return "linear_phase_fir";
+    case PrefilterType::kOneEuro:
+      return "one_euro";
+  }
+  return "unknown";
+}
+
+PrefilterType TorquePrefilter::parse_type(const std::string &name) {
+  for (PrefilterType type :
+       {PrefilterType::kFirstOrder, PrefilterType::kButterworth,
+        PrefilterType::kLinearPhaseFir, PrefilterType::kOneEuro}) {
+    if (type_name(type) == name) {
+      return type;
+    }
+  }
+  throw std::invalid_argument("Unknown prefilter type \"" + name + "\"");
+}
@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+//! Filters available to the torque prefilter
+enum class PrefilterType {
+  //! First-order low-pass filter, as upkie::cpp::utils::low_pass_filter
+  kFirstOrder,
+
+  //! Butterworth low-pass filter, as a cascade of second-order sections
+  kButterworth,
+
+  //! Linear-phase FIR low-pass filter, a windowed sinc
+  kLinearPhaseFir,
+
+  //! One-euro filter, a first-order filter whose cutoff frequency rises with
+  //! the rate of change of its input
+  kOneEuro,
+};
+
+/*! Low-pass filters of joint torques, before the likelihood lookup.
+ *
+ * All channels, e.g. every joint of every leg, are filtered in one call. The
+ * state and coefficients of each filter stage are stored contiguously across
+ * channels, so that loops over channels are vectorized. Each channel has its
+ * own cutoff period, which sets the cutoff frequency \f$ 1 / (2 \pi T) \f$ of
+ * every filter type, so that filters can be swapped at the same cutoff and
+ * compared by their response().
+ *
+ * First-order filters lag by about one cutoff period at low frequencies.
+ * Butterworth filters roll off faster above the cutoff frequency but lag
+ * more, linear-phase FIR filters delay all frequencies by the same half
+ * window, and the one-euro filter only lags while torques are steady, so that
+ * contact changes reach the likelihood lookup earlier.
+ */
+class TorquePrefilter {
+ public:
+  //! Parameters of the prefilter
+  struct Parameters {
+    //! Filter type, the default one being that of upkie observers
+    PrefilterType type = PrefilterType::kFirstOrder;
+
+    //! Number of second-order sections of the Butterworth filter, whose
+    //! order is twice as large
+    size_t num_sections = 1;
+
+    /*! Number of taps of the FIR filter, odd so that its delay is a whole
+     * number of samples. The window should span at least one period of the
+     * cutoff frequency of every channel, i.e. \f$ 2 \pi T / dt \f$ taps,
+     * below which the window rather than the sinc sets the cutoff. Zero for
+     * the smallest such number of taps.
+     */
+    size_t num_taps = 0;
+
+    //! Increase of the cutoff frequency of the one-euro filter per unit of
+    //! torque rate, in Hz per N.m/s
+    double speed_coefficient = 0.5;
+
+    //! Cutoff frequency of the torque rate estimated by the one-euro filter,
+    //! in Hz
+    double rate_cutoff_frequency = 10.0;
+  };
+
+  //! Response of the filter of a channel to small signals
+  struct Response {
+    //! Group delay at low frequencies, in seconds
+    double group_delay;
+
+    //! Variance of the output for a white input noise of unit variance
+    double noise_gain;
+
+    //! Noise rejection in decibels
+    double noise_rejection_db() const;
+  };
+
+  /*! Initialize filters with zero outputs.
+   *
+   * \param[in] params Parameters of the prefilter.
+   * \param[in] dt Time step between samples, in seconds.
+   * \param[in] cutoff_periods Cutoff period of each channel, in seconds.
+   * \throw std::invalid_argument If a cutoff period is not above twice the
+   * time step, or if parameters of the filter type are invalid.
+   */
+  TorquePrefilter(const Parameters &params, double dt,
+                  const std::vector<double> &cutoff_periods);
+
+  //! Number of channels
+  size_t num_channels() const { return num_channels_; }
+
+  /*! Filter one sample of every channel.
+   *
+   * Does not allocate.
+   *
+   * \param[in] inputs New sample of each channel.
+   * \param[out] outputs Filtered sample of each channel.
+   */
+  void filter(const double *inputs, double *outputs);
+
+  /*! Response of the filter of a channel, estimated from its impulse
+   * response.
+   *
+   * The one-euro filter is nonlinear. Its group delay is that of the
+   * first-order filter it reduces to when its input is steady, while its
+   * noise gain is measured on white noise of unit variance, which raises its
+   * cutoff frequency as torque noise would.
+   *
+   * \param[in] channel Channel index.
+   */
+  Response response(size_t channel) const;
+
+  //! Number of taps of the FIR filters, zero for other filter types
+  size_t num_taps() const { return num_taps_; }
+
+  /*! Name of a filter type, e.g. for logging.
+   *
+   * \param[in] type Filter type.
+   */
+  static std::string type_name(PrefilterType type);
+
+  /*! Filter type from its name.
+   *
+   * \param[in] name Name returned by type_name().
+   * \throw std::invalid_argument If no filter type has this name.
+   */
+  static PrefilterType parse_type(const std::string &name);
+
+ private:
+  //! Design the first-order and one-euro filters.
+  void design_first_order();
+
+  //! Design the second-order sections of the Butterworth filters.
+  void design_butterworth();
+
+  //! Design the taps of the FIR filters.
+  void design_fir();
+
+  //! Parameters of the prefilter
+  const Parameters params_;
+
+  //! Time step between samples
+  const double dt_;
+
+  //! Cutoff period of each channel
+  const std::vector<double> cutoff_periods_;
+
+  //! Number of channels
+  const size_t num_channels_;
+
+  //! Gain of the first-order filter of each channel, also the gain of the
+  //! one-euro filter at rest
+  std::vector<double> alpha_;
+
+  //! Last output of each channel, for first-order and one-euro filters
+  std::vector<double> outputs_;
+
+  //! Gain of the filter of the torque rate, for one-euro filters
+  double rate_alpha_ = 0.0;
+
+  //! Increase of the one-euro gain per unit of torque rate
+  double speed_gain_ = 0.0;
+
+  //! Torque rate estimated by the one-euro filter of each channel
+  std::vector<double> rates_;
+
+  //! Coefficients of the second-order sections, indexed by section then
+  //! channel, with a0 normalized to one
+  std::vector<double> b0_, b1_, b2_, a1_, a2_;
+
+  //! States of the second-order sections in transposed direct form II,
+  //! indexed by section then channel
+  std::vector<double> z1_, z2_;
+
+  //! Number of taps of the FIR filters
+  size_t num_taps_ = 0;
+
+  //! FIR taps, indexed by tap then channel
+  std::vector<double> taps_;
+
+  /*! Input history of the FIR filters, indexed by sample then channel from
+   * the newest sample at history_start_. Samples are written twice, one
+   * window apart, so that the window is contiguous.
+   */
+  std::vector<double> history_;
+
+  //! Index of the newest sample in the history
+  size_t history_start_ = 0;
+};
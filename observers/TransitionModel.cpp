@@ -4,7 +4,6 @@
 
 #include <algorithm>
 #include <iostream>
-#include <numeric>
 
 #include "Eigen/Core"
 #include "kiss_fft/kiss_fft.h"
@@ -44,62 +43,157 @@ TransitionModel::~TransitionModel() {
   cfg = nullptr;
 }
 
+TransitionModel::OutputPaths::OutputPaths(const Keys &keys)
+    : mean_frequency{keys.prefix, "mean_frequency"},
+      median_frequency{keys.prefix, keys.median_frequency},
+      power{keys.prefix, "power"},
+      acc_buf{keys.prefix, "acc_buf"},
+      power_freq{keys.prefix, "power_freq"},
+      filtered_median_freq{keys.prefix, keys.filtered_median_freq},
+      filtered_mean_freq{keys.prefix, keys.filtered_mean_freq},
+      p_switch{keys.prefix, "p_switch"},
+      p_landing{keys.prefix, "p_landing"},
+      p_landing_p_switch{keys.prefix, keys.p_landing_p_switch},
+      p_takeoff_p_switch{keys.prefix, keys.p_takeoff_p_switch} {}
+
+void TransitionModel::OutputPaths::unbind() {
+  for (OutputPath *output :
+       {&mean_frequency, &median_frequency, &power, &acc_buf, &power_freq,
+        &filtered_median_freq, &filtered_mean_freq, &p_switch, &p_landing,
+        &p_landing_p_switch, &p_takeoff_p_switch}) {
+    output->unbind();
+  }
+}
+
+TransitionModel::AxisOutputPaths::AxisOutputPaths(
+    const Keys &keys, const std::string &channel_name)
+    : mean_frequency{keys.prefix, channel_name, "mean_frequency"},
+      median_frequency{keys.prefix, channel_name, keys.median_frequency},
+      power{keys.prefix, channel_name, "power"} {}
+
+void TransitionModel::reset(const Dictionary &config) {
+  pitch_input.unbind();
+  linear_acceleration_input.unbind();
+  angular_velocity_input.unbind();
+  outputs.unbind();
+  for (auto &axis_output : axis_outputs) {
+    axis_output.mean_frequency.unbind();
+    axis_output.median_frequency.unbind();
+    axis_output.power.unbind();
+  }
+}
+
 void TransitionModel::read(const Dictionary &observation) {
   // Read the z-component of the linear acceleration.
   double pitch = 0.0;
 
   // Check if base_orientation is in the observation dictionary.
-  auto keys = observation.keys();
-  if (std::find(keys.begin(), keys.end(), "base_orientation") != keys.end()) {
-    pitch = observation("base_orientation")("pitch");
+  const Dictionary *pitch_node = pitch_input.find(observation);
+  if (pitch_node != nullptr) {
+    pitch = pitch_node->as<double>();
   }
 
-  double acc_z =
-      observation("imu")("linear_acceleration").as<Eigen::Vector3d>()(2);
+  const Eigen::Vector3d &linear_acceleration =
+      linear_acceleration_input(observation).as<Eigen::Vector3d>();
+  double acc_z = linear_acceleration(2);
 
   acc_z = acc_z * std::cos(pitch);
 
-  double acc_xy_norm = observation("imu")("linear_acceleration")
-                           .as<Eigen::Vector3d>()
-                           .head<2>()
-                           .norm();
+  double acc_xy_norm = linear_acceleration.head<2>().norm();
 
   acc_z += acc_xy_norm * std::sin(pitch);
 
   // Very lightly filter the acceleration.
   // acc_z =
-  //    low_pass_filter(acc_buf.back(), 3e-3, acc_z, 1e-3);
+  //    low_pass_filter(acc_window.newest(), 3e-3, acc_z, 1e-3);
+
+  // Add the new data point to the window, dropping the oldest one.
+  acc_window.push(acc_z);
+
+  if (multi_axis_spectrum != nullptr) {
+    const Eigen::Vector3d &acc = linear_acceleration;
+    Eigen::Vector3d gyro = Eigen::Vector3d::Zero();
+    const Dictionary *angular_velocity =
+        angular_velocity_input.find(observation);
+    if (angular_velocity != nullptr) {
+      gyro = angular_velocity->as<Eigen::Vector3d>();
+    }
+    multi_axis_spectrum->push({acc.x(), acc.y(), acc.z(), gyro.x(), gyro.y(),
+                               gyro.z()});
+  }
+
+  // The sliding DFT consumes samples one at a time, skip the FFT input buffer.
+  if (sliding_dft != nullptr) {
+    sliding_dft->push(acc_z);
+    return;
+  }
 
-  // Rotate the buffer to the left.
-  std::rotate(acc_buf.begin(), acc_buf.begin() + 1, acc_buf.end());
+  // Same for the Goertzel filter bank and the wavelet transform.
+  if (goertzel_bank != nullptr) {
+    goertzel_bank->push(acc_z);
+    return;
+  }
+  if (lifting_wavelet != nullptr) {
+    lifting_wavelet->push(acc_z);
+    return;
+  }
 
-  // Add the new data point to the buffer.
-  acc_buf[kWindowSize - 1] = acc_z;
+  // The real FFT frontend reads the window directly at update time.
+  if (spectral_frontend != nullptr) {
+    return;
+  }
+
+  // The input buffer is only consumed by spectral updates.
+  if (!is_update_tick()) {
+    return;
+  }
 
   // Compute the mean of the acceleration.
   double mean_acc = 0.0;
-  // std::accumulate(acc_buf.begin(), acc_buf.end(), 0.0) / kWindowSize;
+  // acc_window.mean();
 
   // Subtract the mean from the acceleration, and write it to the input buffer.
-  for (int i = 0; i < kWindowSize; ++i) {
-    in[i] = kiss_fft_cpx{.r = acc_buf[i] - mean_acc, .i = 0.0};
+  const double *samples = acc_window.data();
+  for (size_t i = 0; i < acc_window.size(); ++i) {
+    in[i] = kiss_fft_cpx{.r = samples[i] - mean_acc, .i = 0.0};
   }
 }
 
 void TransitionModel::write(Dictionary &observation) {
-  // Update the model.
-  update();
+  // Update the model every params.hop ticks. In between, the power is still
+  // updated but the spectral features are held or extrapolated.
+  const size_t ticks_since_update = tick_count % params.hop;
+  if (ticks_since_update == 0) {
+    update();
+    if (tick_count > 0) {
+      mean_freq_slope = (mean_freq - updated_mean_freq) / params.hop;
+      median_freq_slope = (median_freq - updated_median_freq) / params.hop;
+    }
+    updated_mean_freq = mean_freq;
+    updated_median_freq = median_freq;
+  } else {
+    power = compute_power();
+    if (params.extrapolate_features) {
+      mean_freq = std::clamp(
+          updated_mean_freq + ticks_since_update * mean_freq_slope, 0.0,
+          nyquist_freq);
+      median_freq = std::clamp(
+          updated_median_freq + ticks_since_update * median_freq_slope, 0.0,
+          nyquist_freq);
+    }
+  }
+  ++tick_count;
 
   // Write the mean and median frequencies to the observation dictionary.
-  observation(prefix())("mean_frequency") = mean_freq;
-  observation(prefix())("median_frequency") = median_freq;
-  observation(prefix())("power") = power;
-  observation(prefix())("acc_buf") = acc_buf.back();
+  outputs.mean_frequency(observation) = mean_freq;
+  outputs.median_frequency(observation) = median_freq;
+  outputs.power(observation) = power;
+  outputs.acc_buf(observation) = acc_window.newest();
 
   // Compute the power times the median frequency.
   // This is just a heuristic that we monitor, and is not used in the transition
   // model.
-  observation(prefix())("power_freq") = power * median_freq;
+  outputs.power_freq(observation) = power * median_freq;
 
   // Compute transition probabilities
   double p_switch = sigmoid(power, params.switch_offset, params.switch_scale);
@@ -110,7 +204,7 @@ void TransitionModel::write(Dictionary &observation) {
   filtered_median_freq =
       low_pass_filter(filtered_median_freq, 1e-1, median_freq * p_switch, 1e-3);
 
-  observation(prefix())("filtered_median_freq") = filtered_median_freq;
+  outputs.filtered_median_freq(observation) = filtered_median_freq;
 
   // Filter the median frequency, to have some memory of the previous
   // transitions. Do not include the median frequency if the power is low (i.e.
@@ -121,8 +215,8 @@ void TransitionModel::write(Dictionary &observation) {
   filtered_mean_freq =
       low_pass_filter(filtered_mean_freq, 1e-1, mean_freq * p_switch, 1e-3);
 
-  observation(prefix())("filtered_median_freq") = filtered_median_freq;
-  observation(prefix())("filtered_mean_freq") = filtered_mean_freq;
+  outputs.filtered_median_freq(observation) = filtered_median_freq;
+  outputs.filtered_mean_freq(observation) = filtered_mean_freq;
 
   // Compute the takeoff probability conditioned on the switch probability
   double p_landing = sigmoid(filtered_median_freq, params.landing_offset,
@@ -132,71 +226,124 @@ void TransitionModel::write(Dictionary &observation) {
   double p_takeoff_p_switch = (1.0 - p_landing) * p_switch;
 
   // Write the probabilities to the observation dictionary.
-  observation(prefix())("p_switch") = p_switch;
-  observation(prefix())("p_landing") = p_landing;
-  observation(prefix())("p_landing_p_switch") = p_landing_p_switch;
-  observation(prefix())("p_takeoff_p_switch") = p_takeoff_p_switch;
+  outputs.p_switch(observation) = p_switch;
+  outputs.p_landing(observation) = p_landing;
+  outputs.p_landing_p_switch(observation) = p_landing_p_switch;
+  outputs.p_takeoff_p_switch(observation) = p_takeoff_p_switch;
+
+  // Write the spectral features of every IMU axis
+  if (multi_axis_spectrum != nullptr) {
+    for (size_t c = 0; c < MultiAxisSpectrum::kNumChannels; ++c) {
+      AxisOutputPaths &axis_output = axis_outputs[c];
+      axis_output.mean_frequency(observation) = axis_features[c].mean_freq;
+      axis_output.median_frequency(observation) = axis_features[c].median_freq;
+      axis_output.power(observation) = axis_features[c].power;
+    }
+  }
 }
 
 void TransitionModel::update() {
+  if (multi_axis_spectrum != nullptr) {
+    update_multi_axis();
+  }
+
+  if (sliding_dft != nullptr) {
+    // The spectrum is already up to date, as well as its magnitude sums.
+    mean_freq = sliding_dft->mean_frequency();
+    median_freq = sliding_dft->median_frequency();
+    power = compute_power();
+    return;
+  }
+
+  if (goertzel_bank != nullptr) {
+    // Band magnitudes are already up to date, as well as their sums.
+    mean_freq = goertzel_bank->mean_frequency();
+    median_freq = goertzel_bank->median_frequency();
+    power = compute_power();
+    return;
+  }
+
+  if (lifting_wavelet != nullptr) {
+    // Fine scales span fewer samples than the window, so that their power
+    // reacts earlier to impacts.
+    mean_freq = lifting_wavelet->mean_frequency();
+    median_freq = lifting_wavelet->median_frequency();
+    power = compute_power();
+    return;
+  }
+
+  if (spectral_frontend != nullptr) {
+    spectral_frontend->transform(acc_window.data());
+    spectral_statistics.compute(spectral_frontend->bins());
+    mean_freq = spectral_statistics.mean_frequency();
+    median_freq = spectral_statistics.median_frequency();
+    power = compute_power();
+    return;
+  }
+
   // Perform the FFT
   kiss_fft(cfg, in.data(), out.data());
 
-  // Compute the mean and median frequencies.
-  mean_freq = mean_frequency();
-  median_freq = median_frequency();
+  // Compute the mean and median frequencies in one pass over the bins.
+  spectral_statistics.compute(out.data());
+  mean_freq = spectral_statistics.mean_frequency();
+  median_freq = spectral_statistics.median_frequency();
   power = compute_power();
 }
 
-double TransitionModel::mean_frequency() const {
+void TransitionModel::update_multi_axis() {
+  multi_axis_spectrum->update();
+  for (size_t c = 0; c < MultiAxisSpectrum::kNumChannels; ++c) {
+    spectral_statistics.compute(multi_axis_spectrum->bins(c));
+    axis_features[c].mean_freq = spectral_statistics.mean_frequency();
+    axis_features[c].median_freq = spectral_statistics.median_frequency();
+    axis_features[c].power = multi_axis_spectrum->power(c);
+  }
+}
+
+double mean_frequency(const kiss_fft_cpx *bins,
+                      const std::vector<double> &freqs) {
   int N_bins = freqs.size();
   double weight_sum{}, mean_freq{};
 
   // Compute the magnitude-weigted mean of frequencies
   for (int i = 0; i < N_bins; ++i) {
-    double weight = cpx_mag(out.at(i));
+    double weight = cpx_mag(bins[i]);
     weight_sum += weight;
     mean_freq += weight * freqs.at(i);
   }
   return mean_freq / weight_sum;
 }
 
-double TransitionModel::median_frequency() const {
+double median_frequency(const kiss_fft_cpx *bins,
+                        const std::vector<double> &freqs) {
   int N_bins = freqs.size();
-  std::vector<double> mags(N_bins);
 
   // Compute the magnitude of the FFT
   double mag_sum{};
   for (int i = 0; i < N_bins; ++i) {
-    double mag = cpx_mag(out.at(i));
-    mags[i] = mag;
-    mag_sum += mag;
-  }
-
-  // Normalize the magnitudes
-  for (int i = 0; i < N_bins; ++i) {
-    mags[i] /= mag_sum;
-  }
-
-  // Cumsum
-  for (int i = 1; i < N_bins; ++i) {
-    mags[i] += mags[i - 1];
+    mag_sum += cpx_mag(bins[i]);
   }
 
   // Find the median frequency, which is the frequency where the cumulative sum
-  // is 0.5. This is found by linear interpolation, as the cumulative sum is not
-  // guaranteed to be exactly 0.5 for any frequency bin.
-  if (mags[0] >= 0.5) {
+  // of normalized magnitudes is 0.5. This is found by linear interpolation, as
+  // the cumulative sum is not guaranteed to be exactly 0.5 for any frequency
+  // bin. Magnitudes are recomputed rather than stored so that this function
+  // does not allocate.
+  double cumsum = cpx_mag(bins[0]) / mag_sum;
+  if (cumsum >= 0.5) {
     return freqs.at(0);
   }
 
   for (int i = 1; i < N_bins; ++i) {
-    if (mags[i] >= 0.5) {
+    const double prev_cumsum = cumsum;
+    cumsum += cpx_mag(bins[i]) / mag_sum;
+    if (cumsum >= 0.5) {
       double f1 = freqs.at(i - 1);
       double f2 = freqs.at(i);
 
-      double c1 = mags.at(i - 1);
-      double c2 = mags.at(i);
+      double c1 = prev_cumsum;
+      double c2 = cumsum;
 
       // Linear interpolation
       return f1 + (f2 - f1) * (0.5 - c1) / (c2 - c1);
@@ -205,13 +352,19 @@ double TransitionModel::median_frequency() const {
   return freqs.back();
 }
 
-double TransitionModel::compute_power() const {
-  double energy = std::accumulate(acc_buf.begin(), acc_buf.end(), 0.0,
-                                  [](const double &acc_sum, const double &acc) {
-                                    return acc_sum + pow(acc, 2);
-                                  });
+double TransitionModel::mean_frequency() const {
+  return ::mean_frequency(out.data(), freqs);
+}
+
+double TransitionModel::median_frequency() const {
+  return ::median_frequency(out.data(), freqs);
+}
 
-  return energy / params.window_size;
+double TransitionModel::compute_power() const {
+  if (lifting_wavelet != nullptr) {
+    return lifting_wavelet->power();
+  }
+  return acc_window.power();
 }
 
 void print_vector(const std::vector<double> &vec, const std::string &name) {
@@ -3,12 +3,23 @@
 
 #pragma once
 
+#include <array>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "kiss_fft/kiss_fft.h"
+#include "observers/DictionaryBinding.h"
+#include "observers/GoertzelBank.h"
+#include "observers/LiftingWavelet.h"
+#include "observers/MultiAxisSpectrum.h"
+#include "observers/RingWindow.h"
+#include "observers/SlidingDft.h"
+#include "observers/SpectralFrontend.h"
+#include "observers/SpectralStatistics.h"
 #include "palimpsest/Dictionary.h"
 #include "upkie/cpp/observers/Observer.h"
 
@@ -17,6 +28,24 @@ using upkie::cpp::observers::Observer;
 
 inline constexpr int kWindowSize = 128;
 
+//! Spectral engines available to the transition model
+enum class SpectralEngine {
+  //! Full kiss_fft of the window at every update
+  kKissFft,
+
+  //! Sliding DFT, updated one sample at a time
+  kSlidingDft,
+
+  //! Real-input FFT specialized on the window size
+  kRealFft,
+
+  //! Bank of sliding Goertzel filters over frequency bands, no FFT
+  kGoertzel,
+
+  //! Multi-resolution Haar wavelet transform, no FFT
+  kWavelet,
+};
+
 // Apply a Hann window to the input signal in place.
 void hann_window(std::vector<kiss_fft_cpx> *in);
 
@@ -44,14 +73,67 @@ double sigmoid(double x, double offset, double scale, double margin = 1e-10);
 std::vector<double> output_frequencies(double dt,
                                        size_t window_size = kWindowSize);
 
+/*! Compute the magnitude-weighted mean frequency of a spectrum.
+ * \param[in] bins Output bins of the FFT, at least `freqs.size()` of them.
+ * \param[in] freqs Frequency of each bin.
+ * \return Mean frequency.
+ */
+double mean_frequency(const kiss_fft_cpx *bins,
+                      const std::vector<double> &freqs);
+
+/*! Compute the frequency splitting the magnitude of a spectrum in halves.
+ * \param[in] bins Output bins of the FFT, at least `freqs.size()` of them.
+ * \param[in] freqs Frequency of each bin.
+ * \return Median frequency.
+ */
+double median_frequency(const kiss_fft_cpx *bins,
+                        const std::vector<double> &freqs);
+
 //! Observe contact between the wheels and the floor.
 class TransitionModel : public Observer {
  public:
+  //! Spectral features of one IMU axis
+  struct AxisFeatures {
+    double mean_freq;
+    double median_freq;
+    double power;
+  };
+
   struct Parameters {
     //! Time step between observations
     double dt = 0.001;
     size_t window_size = kWindowSize;
 
+    //! Engine used to compute the spectrum of the window
+    SpectralEngine spectral_engine = SpectralEngine::kKissFft;
+
+    //! Apply a Hann window before the transform, only supported by
+    //! SpectralEngine::kRealFft
+    bool apply_hann_window = false;
+
+    //! Band edges in Hz for SpectralEngine::kGoertzel, finer at low
+    //! frequencies where the median frequency lies
+    std::vector<double> band_edges = {0.0,   8.0,   16.0,  24.0,  32.0,
+                                      48.0,  64.0,  96.0,  128.0, 192.0,
+                                      256.0, 384.0, 500.0};
+
+    //! Number of wavelet levels for SpectralEngine::kWavelet. The coarsest
+    //! level spans the window, the finest one `window_size / 2^(levels - 1)`
+    //! samples.
+    size_t wavelet_levels = 5;
+
+    //! Number of ticks between two spectral updates. The power is still
+    //! updated at every tick, as it comes in O(1) from the running sums.
+    size_t hop = 1;
+
+    //! Linearly extrapolate the mean and median frequencies between spectral
+    //! updates, rather than holding their last values
+    bool extrapolate_features = false;
+
+    //! Also compute spectral features of every accelerometer and gyroscope
+    //! axis, written under `transition_model/<axis>`
+    bool multi_axis = false;
+
     // Sigmoid parameters for the transition model
     double switch_offset = 50.0;
     double switch_scale = 5.0;
@@ -59,20 +141,61 @@ class TransitionModel : public Observer {
     double landing_scale = 3;
   };
 
+  /*! Keys read and written at every tick.
+   *
+   * Most of them do not fit in the small string buffer, so they are built
+   * once here rather than as temporaries at every dictionary lookup.
+   */
+  struct Keys {
+    std::string prefix = "transition_model";
+    std::string base_orientation = "base_orientation";
+    std::string linear_acceleration = "linear_acceleration";
+    std::string angular_velocity = "angular_velocity";
+    std::string median_frequency = "median_frequency";
+    std::string filtered_median_freq = "filtered_median_freq";
+    std::string filtered_mean_freq = "filtered_mean_freq";
+    std::string p_landing_p_switch = "p_landing_p_switch";
+    std::string p_takeoff_p_switch = "p_takeoff_p_switch";
+  };
+
   /*! Initialize observer.
    *
    */
   explicit TransitionModel(const Parameters &params)
       : params(params),
-        acc_buf(params.window_size, 0.0),
+        acc_window(params.window_size),
         in(params.window_size, kiss_fft_cpx{0.0, 0.0}),
         out(params.window_size, kiss_fft_cpx{0.0, 0.0}),
         filtered_median_freq(0.0),
         filtered_mean_freq(0.0),
-        freqs(output_frequencies(params.dt)),
+        freqs(output_frequencies(params.dt, params.window_size)),
         sampling_freq(1 / params.dt),
         nyquist_freq(sampling_freq / 2),
-        cfg(kiss_fft_alloc(params.window_size, false, nullptr, nullptr)) {}
+        cfg(kiss_fft_alloc(params.window_size, false, nullptr, nullptr)),
+        spectral_statistics(freqs) {
+    if (params.hop < 1) {
+      throw std::invalid_argument("Hop must be at least one tick");
+    }
+    if (params.spectral_engine == SpectralEngine::kSlidingDft) {
+      sliding_dft = std::make_unique<SlidingDft>(params.window_size, freqs);
+    } else if (params.spectral_engine == SpectralEngine::kRealFft) {
+      spectral_frontend = make_real_fft_frontend(params.window_size,
+                                                 params.apply_hann_window);
+    } else if (params.spectral_engine == SpectralEngine::kGoertzel) {
+      goertzel_bank = std::make_unique<GoertzelBank>(params.window_size, freqs,
+                                                     params.band_edges);
+    } else if (params.spectral_engine == SpectralEngine::kWavelet) {
+      lifting_wavelet = std::make_unique<LiftingWavelet>(
+          params.window_size, params.wavelet_levels, params.dt);
+    }
+    if (params.multi_axis) {
+      multi_axis_spectrum =
+          std::make_unique<MultiAxisSpectrum>(params.window_size);
+      for (const char *channel_name : MultiAxisSpectrum::kChannelNames) {
+        axis_outputs.push_back(AxisOutputPaths(keys, channel_name));
+      }
+    }
+  }
 
   // Destructor
   ~TransitionModel() override;
@@ -82,6 +205,12 @@ class TransitionModel : public Observer {
     return "transition_model";
   }
 
+  /*! Unbind dictionary paths, which are bound again at the next tick.
+   *
+   * \param[in] config Configuration dictionary.
+   */
+  void reset(const Dictionary &config) override;
+
   /*! Read inputs from other observations.
    * \param[in] observation Dictionary to read other observations from.
    */
@@ -96,13 +225,19 @@ class TransitionModel : public Observer {
   //! Update the internal state of the observer, e.g. perform an FFT.
   void update();
 
+  //! Check whether the spectrum is updated at the current tick.
+  bool is_update_tick() const { return tick_count % params.hop == 0; }
+
+  //! Update the spectral features of every IMU axis.
+  void update_multi_axis();
+
   //! Compute the mean frequency
   double mean_frequency() const;
 
   //! Compute the median frequency
   double median_frequency() const;
 
-  //! Compute the power of the signal
+  //! Compute the power of the signal, in O(1) from the running sums
   double compute_power() const;
 
   // private:
@@ -110,8 +245,11 @@ class TransitionModel : public Observer {
   //! Parameters of the model
   const Parameters params{};
 
-  //! Accelerometer buffer
-  std::vector<double> acc_buf{};
+  //! Dictionary keys
+  const Keys keys{};
+
+  //! Accelerometer window, with running sums for the mean and power
+  RingWindow acc_window;
 
   //! FFT input buffer
   std::vector<kiss_fft_cpx> in{};
@@ -124,6 +262,18 @@ class TransitionModel : public Observer {
   double median_freq{};
   double power{};
 
+  //! Number of ticks written so far
+  size_t tick_count{};
+
+  //! Mean and median frequencies at the last spectral update
+  double updated_mean_freq{};
+  double updated_median_freq{};
+
+  //! Change of the mean and median frequencies per tick, estimated from the
+  //! last two spectral updates
+  double mean_freq_slope{};
+  double median_freq_slope{};
+
   //! Filter the median frequency
   double filtered_median_freq{};
 
@@ -141,6 +291,83 @@ class TransitionModel : public Observer {
 
   //! FFT configuration
   kiss_fft_cfg cfg;
+
+  //! Mean and median frequencies of FFT outputs, from one fused pass
+  SpectralStatistics spectral_statistics;
+
+  //! Sliding DFT, only allocated for SpectralEngine::kSlidingDft. This engine
+  //! does not use the `in` and `out` buffers.
+  std::unique_ptr<SlidingDft> sliding_dft;
+
+  //! Real FFT frontend, only allocated for SpectralEngine::kRealFft. This
+  //! engine reads the accelerometer window directly and does not use the `in`
+  //! and `out` buffers.
+  std::unique_ptr<SpectralFrontend> spectral_frontend;
+
+  //! Goertzel filter bank, only allocated for SpectralEngine::kGoertzel. This
+  //! engine does not use the `in` and `out` buffers.
+  std::unique_ptr<GoertzelBank> goertzel_bank;
+
+  //! Wavelet transform, only allocated for SpectralEngine::kWavelet. This
+  //! engine does not use the `in` and `out` buffers, and estimates the power
+  //! from its bands rather than from the accelerometer window.
+  std::unique_ptr<LiftingWavelet> lifting_wavelet;
+
+  //! Spectra of all IMU axes, only allocated if Parameters::multi_axis is set
+  std::unique_ptr<MultiAxisSpectrum> multi_axis_spectrum;
+
+  //! Spectral features of all IMU axes, in the order of
+  //! MultiAxisSpectrum::kChannelNames
+  std::array<AxisFeatures, MultiAxisSpectrum::kNumChannels> axis_features{};
+
+  //! Paths to the outputs of the model
+  struct OutputPaths {
+    /*! Prepare paths under the output prefix.
+     *
+     * \param[in] keys Dictionary keys.
+     */
+    explicit OutputPaths(const Keys &keys);
+
+    //! Unbind all paths.
+    void unbind();
+
+    OutputPath mean_frequency;
+    OutputPath median_frequency;
+    OutputPath power;
+    OutputPath acc_buf;
+    OutputPath power_freq;
+    OutputPath filtered_median_freq;
+    OutputPath filtered_mean_freq;
+    OutputPath p_switch;
+    OutputPath p_landing;
+    OutputPath p_landing_p_switch;
+    OutputPath p_takeoff_p_switch;
+  };
+
+  //! Paths to the spectral features of an IMU axis
+  struct AxisOutputPaths {
+    /*! Prepare paths under the output prefix.
+     *
+     * \param[in] keys Dictionary keys.
+     * \param[in] channel_name Name of the IMU axis.
+     */
+    AxisOutputPaths(const Keys &keys, const std::string &channel_name);
+
+    OutputPath mean_frequency;
+    OutputPath median_frequency;
+    OutputPath power;
+  };
+
+  //! Inputs, bound at the first tick
+  InputPath pitch_input{keys.base_orientation, "pitch"};
+  InputPath linear_acceleration_input{"imu", keys.linear_acceleration};
+  InputPath angular_velocity_input{"imu", keys.angular_velocity};
+
+  //! Outputs, bound at the first tick
+  OutputPaths outputs{keys};
+
+  //! Outputs of each IMU axis, only used if Parameters::multi_axis is set
+  std::vector<AxisOutputPaths> axis_outputs;
 };
 
 void print_vector(const std::vector<double> &vec, const std::string &name);
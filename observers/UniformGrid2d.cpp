@@ -0,0 +1,506 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/UniformGrid2d.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+bool is_uniform_axis(const std::vector<double> &axis, double tolerance) {
+  if (axis.size() < 2 || !(axis.back() > axis.front())) {
+    return false;
+  }
+  const double range = axis.back() - axis.front();
+  const double spacing = range / (axis.size() - 1);
+  for (size_t k = 0; k < axis.size(); ++k) {
+    if (std::abs(axis[k] - (axis.front() + k * spacing)) > tolerance * range) {
+      return false;
+    }
+  }
+  return true;
+}
+
+namespace {
+
+//! Check that an axis is uniform before the interpolator is built from it.
+const std::vector<double> &checked_axis(const std::vector<double> &axis) {
+  if (!is_uniform_axis(axis)) {
+    throw std::invalid_argument("Grid axis is not uniform");
+  }
+  return axis;
+}
+
+}  // namespace
+
+UniformGrid2d::UniformGrid2d(const std::vector<double> &x_axis,
+                             const std::vector<double> &y_axis,
+                             const std::vector<std::vector<double>> &tables)
+    : num_values_(tables.size()),
+      nx_(checked_axis(x_axis).size()),
+      ny_(checked_axis(y_axis).size()),
+      x0_(x_axis.front()),
+      y0_(y_axis.front()),
+      x1_(x_axis.back()),
+      y1_(y_axis.back()),
+      inv_dx_((nx_ - 1) / (x1_ - x0_)),
+      inv_dy_((ny_ - 1) / (y1_ - y0_)),
+      storage_(nx_ * ny_ * tables.size()),
+      nodes_(storage_.data()),
+      precision_(TablePrecision::kDouble) {
+  for (size_t v = 0; v < num_values_; ++v) {
+    if (tables[v].size() != nx_ * ny_) {
+      throw std::invalid_argument("Table size does not match the grid");
+    }
+    for (size_t node = 0; node < nx_ * ny_; ++node) {
+      storage_[node * num_values_ + v] = tables[v][node];
+    }
+  }
+}
+
+UniformGrid2d::UniformGrid2d(const std::vector<double> &x_axis,
+                             const std::vector<double> &y_axis,
+                             size_t num_values, const double *nodes,
+                             TablePrecision precision)
+    : num_values_(num_values),
+      nx_(checked_axis(x_axis).size()),
+      ny_(checked_axis(y_axis).size()),
+      x0_(x_axis.front()),
+      y0_(y_axis.front()),
+      x1_(x_axis.back()),
+      y1_(y_axis.back()),
+      inv_dx_((nx_ - 1) / (x1_ - x0_)),
+      inv_dy_((ny_ - 1) / (y1_ - y0_)),
+      nodes_(nodes),
+      precision_(precision) {
+  const size_t size = nx_ * ny_ * num_values_;
+  if (precision_ == TablePrecision::kFloat32) {
+    float_nodes_.assign(nodes_, nodes_ + size);
+  } else if (precision_ == TablePrecision::kLogUint16) {
+    for (size_t v = 0; v < num_values_; ++v) {
+      quantizers_.push_back(make_quantizer(v));
+    }
+    code_nodes_.resize(size);
+    for (size_t k = 0; k < size; ++k) {
+      code_nodes_[k] = quantizers_[k % num_values_].encode(nodes_[k]);
+    }
+  }
+}
+
+UniformGrid2d::Quantizer UniformGrid2d::make_quantizer(size_t value) const {
+  double min_value = std::numeric_limits<double>::infinity();
+  double max_value = -min_value;
+  double min_positive = min_value;
+  for (size_t node = 0; node < nx_ * ny_; ++node) {
+    const double x = nodes_[node * num_values_ + value];
+    min_value = std::min(min_value, x);
+    max_value = std::max(max_value, x);
+    if (x > 0.0) {
+      min_positive = std::min(min_positive, x);
+    }
+  }
+
+  constexpr double kMaxCode = std::numeric_limits<uint16_t>::max();
+  Quantizer quantizer{};
+  if (min_value >= 0.0 && max_value > 0.0) {
+    // Code zero is reserved for zero, e.g. outside of the support of a KDE
+    quantizer.log_scale = true;
+    quantizer.offset =
+        std::log(std::max(min_positive, max_value * kLogQuantizationFloor));
+    const double range = std::log(max_value) - quantizer.offset;
+    quantizer.scale = (range > 0.0) ? range / (kMaxCode - 1.0) : 1.0;
+  } else {
+    quantizer.log_scale = false;
+    quantizer.offset = min_value;
+    const double range = max_value - min_value;
+    quantizer.scale = (range > 0.0) ? range / kMaxCode : 1.0;
+  }
+  return quantizer;
+}
+
+uint16_t UniformGrid2d::Quantizer::encode(double value) const {
+  constexpr double kMaxCode = std::numeric_limits<uint16_t>::max();
+  if (log_scale) {
+    if (value <= 0.0) {
+      return 0;
+    }
+    const double code = std::round((std::log(value) - offset) / scale);
+    if (code < 0.0) {
+      return 0;  // below the floor
+    }
+    return static_cast<uint16_t>(1.0 + std::min(code, kMaxCode - 1.0));
+  }
+  const double code = std::round((value - offset) / scale);
+  return static_cast<uint16_t>(std::clamp(code, 0.0, kMaxCode));
+}
+
+double UniformGrid2d::Quantizer::decode(uint16_t code) const {
+  if (log_scale) {
+    return (code == 0) ? 0.0 : std::exp(offset + scale * (code - 1));
+  }
+  return offset + scale * code;
+}
+
+const void *UniformGrid2d::table_data() const {
+  switch (precision_) {
+    case TablePrecision::kFloat32:
+      return float_nodes_.data();
+    case TablePrecision::kLogUint16:
+      return code_nodes_.data();
+    default:
+      return nodes_;
+  }
+}
+
+size_t UniformGrid2d::table_bytes() const {
+  const size_t size = nx_ * ny_ * num_values_;
+  switch (precision_) {
+    case TablePrecision::kFloat32:
+      return size * sizeof(float);
+    case TablePrecision::kLogUint16:
+      return size * sizeof(uint16_t);
+    default:
+      return size * sizeof(double);
+  }
+}
+
+std::vector<double> UniformGrid2d::quantization_errors() const {
+  std::vector<double> errors(num_values_, 0.0);
+  if (precision_ == TablePrecision::kDouble) {
+    return errors;
+  }
+
+  // Grid nodes, midpoints of cell edges and cell centers
+  for (size_t i = 0; i < 2 * nx_ - 1; ++i) {
+    for (size_t j = 0; j < 2 * ny_ - 1; ++j) {
+      const double x = x0_ + 0.5 * i / inv_dx_;
+      const double y = y0_ + 0.5 * j / inv_dy_;
+      const Cell cell = locate(x, y);
+      for (size_t v = 0; v < num_values_; ++v) {
+        const size_t next = num_values_ + v;
+        const double *lower = nodes_ + cell.lower;
+        const double *upper = nodes_ + cell.upper;
+        const double reference = cell.w00 * lower[v] + cell.w01 * lower[next] +
+                                  cell.w10 * upper[v] + cell.w11 * upper[next];
+        errors[v] = std::max(errors[v], std::abs(blend(cell, v) - reference));
+      }
+    }
+  }
+  return errors;
+}
+
+UniformGrid2d::Cell UniformGrid2d::locate(double x, double y) const {
+  // Cell coordinates, clamped for constant extrapolation
+  const double u = (std::clamp(x, x0_, x1_) - x0_) * inv_dx_;
+  const double w = (std::clamp(y, y0_, y1_) - y0_) * inv_dy_;
+  const size_t i = std::min(static_cast<size_t>(u), nx_ - 2);
+  const size_t j = std::min(static_cast<size_t>(w), ny_ - 2);
+  const double tx = u - i;
+  const double ty = w - j;
+
+  // Nodes (i, j) and (i, j + 1) are contiguous, as well as (i + 1, j) and
+  // (i + 1, j + 1)
+  const size_t lower = (i * ny_ + j) * num_values_;
+  return Cell{.lower = lower,
+              .upper = lower + ny_ * num_values_,
+              .w00 = (1.0 - tx) * (1.0 - ty),
+              .w01 = (1.0 - tx) * ty,
+              .w10 = tx * (1.0 - ty),
+              .w11 = tx * ty};
+}
+
+void UniformGrid2d::accumulate(const Cell &cell, double *values) const {
+  if (precision_ != TablePrecision::kDouble) {
+    for (size_t v = 0; v < num_values_; ++v) {
+      values[v] = blend(cell, v);
+    }
+    return;
+  }
+  const double *lower = nodes_ + cell.lower;
+  const double *upper = nodes_ + cell.upper;
+  for (size_t v = 0; v < num_values_; ++v) {
+    const size_t next = num_values_ + v;
+    values[v] = cell.w00 * lower[v] + cell.w01 * lower[next] +
+                cell.w10 * upper[v] + cell.w11 * upper[next];
+  }
+}
+
+double UniformGrid2d::blend(const Cell &cell, size_t value) const {
+  const size_t next = num_values_ + value;
+  switch (precision_) {
+    case TablePrecision::kFloat32: {
+      const float *lower = float_nodes_.data() + cell.lower;
+      const float *upper = float_nodes_.data() + cell.upper;
+      return cell.w00 * lower[value] + cell.w01 * lower[next] +
+             cell.w10 * upper[value] + cell.w11 * upper[next];
+    }
+    case TablePrecision::kLogUint16: {
+      // Decode corners before blending, so that interpolation stays linear
+      const uint16_t *lower = code_nodes_.data() + cell.lower;
+      const uint16_t *upper = code_nodes_.data() + cell.upper;
+      const Quantizer &quantizer = quantizers_[value];
+      return cell.w00 * quantizer.decode(lower[value]) +
+             cell.w01 * quantizer.decode(lower[next]) +
+             cell.w10 * quantizer.decode(upper[value]) +
+             cell.w11 * quantizer.decode(upper[next]);
+    }
+    default: {
+      const double *lower = nodes_ + cell.lower;
+      const double *upper = nodes_ + cell.upper;
+      return cell.w00 * lower[value] + cell.w01 * lower[next] +
+             cell.w10 * upper[value] + cell.w11 * upper[next];
+    }
+  }
+}
+
+void UniformGrid2d::interpolate(double x, double y, double *values) const {
+  accumulate(locate(x, y), values);
+}
+
+void UniformGrid2d::interpolate_points(const double *points, size_t num_points,
+                                       double *values) const {
+  // Locate a few cells ahead of reading them
+  constexpr size_t kChunkSize = 4;
+  Cell cells[kChunkSize];
+  for (size_t start = 0; start < num_points; start += kChunkSize) {
+    const size_t chunk_size = std::min(kChunkSize, num_points - start);
+    for (size_t k = 0; k < chunk_size; ++k) {
+      const double *point = points + 2 * (start + k);
+      cells[k] = locate(point[0], point[1]);
+    }
+    for (size_t k = 0; k < chunk_size; ++k) {
+      accumulate(cells[k], values + (start + k) * num_values_);
+    }
+  }
+}
+
+void UniformGrid2d::interpolate_range(const double *xs, const double *ys,
+                                      size_t begin, size_t end,
+                                      double *const *values) const {
+  for (size_t k = begin; k < end; ++k) {
+    const Cell cell = locate(xs[k], ys[k]);
+    for (size_t v = 0; v < num_values_; ++v) {
+      values[v][k] = blend(cell, v);
+    }
+  }
+}
+
+#if defined(__AVX2__)
+
+void UniformGrid2d::interpolate_batch(const double *xs, const double *ys,
+                                      size_t num_points,
+                                      double *const *values) const {
+  // Gathers take 32-bit offsets, and only read doubles
+  constexpr int32_t kMaxOffset = std::numeric_limits<int32_t>::max();
+  if (nx_ * ny_ * num_values_ > static_cast<size_t>(kMaxOffset) ||
+      precision_ != TablePrecision::kDouble) {
+    interpolate_range(xs, ys, 0, num_points, values);
+    return;
+  }
+
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d x0 = _mm256_set1_pd(x0_);
+  const __m256d y0 = _mm256_set1_pd(y0_);
+  const __m256d x1 = _mm256_set1_pd(x1_);
+  const __m256d y1 = _mm256_set1_pd(y1_);
+  const __m256d inv_dx = _mm256_set1_pd(inv_dx_);
+  const __m256d inv_dy = _mm256_set1_pd(inv_dy_);
+  const __m128i max_i = _mm_set1_epi32(static_cast<int32_t>(nx_ - 2));
+  const __m128i max_j = _mm_set1_epi32(static_cast<int32_t>(ny_ - 2));
+  const __m128i row_stride =
+      _mm_set1_epi32(static_cast<int32_t>(ny_ * num_values_));
+  const __m128i node_stride = _mm_set1_epi32(static_cast<int32_t>(num_values_));
+
+  size_t k = 0;
+  for (; k + 4 <= num_points; k += 4) {
+    // Same operations as locate(), four points at a time
+    const __m256d x =
+        _mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(xs + k), x0), x1);
+    const __m256d y =
+        _mm256_min_pd(_mm256_max_pd(_mm256_loadu_pd(ys + k), y0), y1);
+    const __m256d u = _mm256_mul_pd(_mm256_sub_pd(x, x0), inv_dx);
+    const __m256d w = _mm256_mul_pd(_mm256_sub_pd(y, y0), inv_dy);
+    const __m128i i = _mm_min_epi32(_mm256_cvttpd_epi32(u), max_i);
+    const __m128i j = _mm_min_epi32(_mm256_cvttpd_epi32(w), max_j);
+    const __m256d tx = _mm256_sub_pd(u, _mm256_cvtepi32_pd(i));
+    const __m256d ty = _mm256_sub_pd(w, _mm256_cvtepi32_pd(j));
+    const __m256d sx = _mm256_sub_pd(one, tx);
+    const __m256d sy = _mm256_sub_pd(one, ty);
+    const __m256d w00 = _mm256_mul_pd(sx, sy);
+    const __m256d w01 = _mm256_mul_pd(sx, ty);
+    const __m256d w10 = _mm256_mul_pd(tx, sy);
+    const __m256d w11 = _mm256_mul_pd(tx, ty);
+
+    // Offsets of nodes (i, j) and (i + 1, j) in the interleaved tables
+    const __m128i lower = _mm_add_epi32(_mm_mullo_epi32(i, row_stride),
+                                        _mm_mullo_epi32(j, node_stride));
+    const __m128i upper = _mm_add_epi32(lower, row_stride);
+    for (size_t v = 0; v < num_values_; ++v) {
+      const double *value = nodes_ + v;
+      const double *next = value + num_values_;
+      const __m256d sum = _mm256_add_pd(
+          _mm256_add_pd(
+              _mm256_add_pd(
+                  _mm256_mul_pd(w00, _mm256_i32gather_pd(value, lower, 8)),
+                  _mm256_mul_pd(w01, _mm256_i32gather_pd(next, lower, 8))),
+              _mm256_mul_pd(w10, _mm256_i32gather_pd(value, upper, 8))),
+          _mm256_mul_pd(w11, _mm256_i32gather_pd(next, upper, 8)));
+      _mm256_storeu_pd(values[v] + k, sum);
+    }
+  }
+  interpolate_range(xs, ys, k, num_points, values);
+}
+
+#elif defined(__ARM_NEON)
+
+void UniformGrid2d::interpolate_batch(const double *xs, const double *ys,
+                                      size_t num_points,
+                                      double *const *values) const {
+  if (precision_ != TablePrecision::kDouble) {
+    interpolate_range(xs, ys, 0, num_points, values);
+    return;
+  }
+
+  const float64x2_t one = vdupq_n_f64(1.0);
+  const float64x2_t x0 = vdupq_n_f64(x0_);
+  const float64x2_t y0 = vdupq_n_f64(y0_);
+  const float64x2_t x1 = vdupq_n_f64(x1_);
+  const float64x2_t y1 = vdupq_n_f64(y1_);
+  const float64x2_t inv_dx = vdupq_n_f64(inv_dx_);
+  const float64x2_t inv_dy = vdupq_n_f64(inv_dy_);
+  const uint64x2_t max_i = vdupq_n_u64(nx_ - 2);
+  const uint64x2_t max_j = vdupq_n_u64(ny_ - 2);
+
+  size_t k = 0;
+  for (; k + 2 <= num_points; k += 2) {
+    // Same operations as locate(), two points at a time
+    const float64x2_t x = vminq_f64(vmaxq_f64(vld1q_f64(xs + k), x0), x1);
+    const float64x2_t y = vminq_f64(vmaxq_f64(vld1q_f64(ys + k), y0), y1);
+    const float64x2_t u = vmulq_f64(vsubq_f64(x, x0), inv_dx);
+    const float64x2_t w = vmulq_f64(vsubq_f64(y, y0), inv_dy);
+    uint64x2_t i = vcvtq_u64_f64(u);
+    uint64x2_t j = vcvtq_u64_f64(w);
+    i = vbslq_u64(vcgtq_u64(i, max_i), max_i, i);
+    j = vbslq_u64(vcgtq_u64(j, max_j), max_j, j);
+    const float64x2_t tx = vsubq_f64(u, vcvtq_f64_u64(i));
+    const float64x2_t ty = vsubq_f64(w, vcvtq_f64_u64(j));
+    const float64x2_t sx = vsubq_f64(one, tx);
+    const float64x2_t sy = vsubq_f64(one, ty);
+    const float64x2_t w00 = vmulq_f64(sx, sy);
+    const float64x2_t w01 = vmulq_f64(sx, ty);
+    const float64x2_t w10 = vmulq_f64(tx, sy);
+    const float64x2_t w11 = vmulq_f64(tx, ty);
+
+    // NEON has no gather: load the corners of both cells lane by lane
+    const double *lower[2] = {
+        nodes_ +
+            (vgetq_lane_u64(i, 0) * ny_ + vgetq_lane_u64(j, 0)) * num_values_,
+        nodes_ +
+            (vgetq_lane_u64(i, 1) * ny_ + vgetq_lane_u64(j, 1)) * num_values_};
+    const double *upper[2] = {lower[0] + ny_ * num_values_,
+                              lower[1] + ny_ * num_values_};
+    for (size_t v = 0; v < num_values_; ++v) {
+      const size_t next = num_values_ + v;
+      const float64x2_t a = {lower[0][v], lower[1][v]};
+      const float64x2_t b = {lower[0][next], lower[1][next]};
+      const float64x2_t c = {upper[0][v], upper[1][v]};
+      const float64x2_t d = {upper[0][next], upper[1][next]};
+      const float64x2_t sum = vaddq_f64(
+          vaddq_f64(vaddq_f64(vmulq_f64(w00, a), vmulq_f64(w01, b)),
+                    vmulq_f64(w10, c)),
+          vmulq_f64(w11, d));
+      vst1q_f64(values[v] + k, sum);
+    }
+  }
+  interpolate_range(xs, ys, k, num_points, values);
+}
+
+#elif defined(__SSE2__)
+
+void UniformGrid2d::interpolate_batch(const double *xs, const double *ys,
+                                      size_t num_points,
+                                      double *const *values) const {
+  // Cell indices are converted to 32-bit integers
+  constexpr size_t kMaxIndex = std::numeric_limits<int32_t>::max();
+  if (nx_ > kMaxIndex || ny_ > kMaxIndex ||
+      precision_ != TablePrecision::kDouble) {
+    interpolate_range(xs, ys, 0, num_points, values);
+    return;
+  }
+
+  const __m128d one = _mm_set1_pd(1.0);
+  const __m128d x0 = _mm_set1_pd(x0_);
+  const __m128d y0 = _mm_set1_pd(y0_);
+  const __m128d x1 = _mm_set1_pd(x1_);
+  const __m128d y1 = _mm_set1_pd(y1_);
+  const __m128d inv_dx = _mm_set1_pd(inv_dx_);
+  const __m128d inv_dy = _mm_set1_pd(inv_dy_);
+  const __m128d max_u = _mm_set1_pd(static_cast<double>(nx_ - 2));
+  const __m128d max_w = _mm_set1_pd(static_cast<double>(ny_ - 2));
+
+  size_t k = 0;
+  for (; k + 2 <= num_points; k += 2) {
+    // Same operations as locate(), two points at a time. SSE2 has no integer
+    // minimum, but clamping before truncation gives the same indices
+    const __m128d x = _mm_min_pd(_mm_max_pd(_mm_loadu_pd(xs + k), x0), x1);
+    const __m128d y = _mm_min_pd(_mm_max_pd(_mm_loadu_pd(ys + k), y0), y1);
+    const __m128d u = _mm_mul_pd(_mm_sub_pd(x, x0), inv_dx);
+    const __m128d w = _mm_mul_pd(_mm_sub_pd(y, y0), inv_dy);
+    const __m128i i = _mm_cvttpd_epi32(_mm_min_pd(u, max_u));
+    const __m128i j = _mm_cvttpd_epi32(_mm_min_pd(w, max_w));
+    const __m128d tx = _mm_sub_pd(u, _mm_cvtepi32_pd(i));
+    const __m128d ty = _mm_sub_pd(w, _mm_cvtepi32_pd(j));
+    const __m128d sx = _mm_sub_pd(one, tx);
+    const __m128d sy = _mm_sub_pd(one, ty);
+    const __m128d w00 = _mm_mul_pd(sx, sy);
+    const __m128d w01 = _mm_mul_pd(sx, ty);
+    const __m128d w10 = _mm_mul_pd(tx, sy);
+    const __m128d w11 = _mm_mul_pd(tx, ty);
+
+    // SSE2 has no gather: load the corners of both cells lane by lane
+    alignas(16) int32_t cell_i[4], cell_j[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(cell_i), i);
+    _mm_store_si128(reinterpret_cast<__m128i *>(cell_j), j);
+    const double *lower[2];
+    const double *upper[2];
+    for (int lane = 0; lane < 2; ++lane) {
+      const size_t node =
+          static_cast<size_t>(cell_i[lane]) * ny_ + cell_j[lane];
+      lower[lane] = nodes_ + node * num_values_;
+      upper[lane] = lower[lane] + ny_ * num_values_;
+    }
+    for (size_t v = 0; v < num_values_; ++v) {
+      const size_t next = num_values_ + v;
+      const __m128d a = _mm_setr_pd(lower[0][v], lower[1][v]);
+      const __m128d b = _mm_setr_pd(lower[0][next], lower[1][next]);
+      const __m128d c = _mm_setr_pd(upper[0][v], upper[1][v]);
+      const __m128d d = _mm_setr_pd(upper[0][next], upper[1][next]);
+      const __m128d sum = _mm_add_pd(
+          _mm_add_pd(_mm_add_pd(_mm_mul_pd(w00, a), _mm_mul_pd(w01, b)),
+                     _mm_mul_pd(w10, c)),
+          _mm_mul_pd(w11, d));
+      _mm_storeu_pd(values[v] + k, sum);
+    }
+  }
+  interpolate_range(xs, ys, k, num_points, values);
+}
+
+#else
+
+void UniformGrid2d::interpolate_batch(const double *xs, const double *ys,
+                                      size_t num_points,
+                                      double *const *values) const {
+  interpolate_range(xs, ys, 0, num_points, values);
+}
+
+#endif
@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! Storage precision of interpolation tables
+enum class TablePrecision {
+  //! Double precision, as loaded
+  kDouble,
+
+  //! Single precision, half the footprint of doubles
+  kFloat32,
+
+  /*! 16-bit codes with a scale and offset per table, a quarter of the
+   * footprint of doubles. Codes are uniform in log scale for nonnegative
+   * tables such as likelihoods, so that their relative error is bounded, and
+   * uniform in linear scale for other tables such as log-likelihood ratios.
+   */
+  kLogUint16
+};
+
+//! Values of a nonnegative table below this fraction of its maximum are
+//! quantized to zero in log scale
+inline constexpr double kLogQuantizationFloor = 1e-12;
+
+/*! Check whether grid points are evenly spaced.
+ *
+ * \param[in] axis Grid points, in increasing order.
+ * \param[in] tolerance Maximum deviation from an evenly spaced grid, relative
+ * to the range of the axis.
+ * \return True if the axis has at least two points, is increasing, and all
+ * its points lie within tolerance of an evenly spaced grid.
+ */
+bool is_uniform_axis(const std::vector<double> &axis,
+                     double tolerance = 1e-9);
+
+/*! Bilinear interpolator on a uniform 2-D grid.
+ *
+ * Cells are found in O(1) from the grid origin and spacing, rather than by
+ * searching the axes. Values of all tables are interleaved per grid node, so
+ * that the two nodes of a cell along the y axis are contiguous in memory and
+ * one query touches two short runs of doubles. Points outside the grid are
+ * clamped to it, i.e. extrapolation is constant.
+ */
+class UniformGrid2d {
+ public:
+  /*! Interleave tables defined on a uniform grid.
+   *
+   * \param[in] x_axis Grid points along the first axis.
+   * \param[in] y_axis Grid points along the second axis.
+   * \param[in] tables Values at grid points, in row-major order (the y axis
+   * being contiguous), one table per value.
+   * \throw std::invalid_argument If an axis is not uniform, or if a table
+   * does not have one value per grid point.
+   */
+  UniformGrid2d(const std::vector<double> &x_axis,
+                const std::vector<double> &y_axis,
+                const std::vector<std::vector<double>> &tables);
+
+  /*! Interpolate values already interleaved per grid node.
+   *
+   * Double values are viewed without copying them. Other precisions quantize
+   * them once into storage of the interpolator, and queries then read the
+   * quantized values only, while double values are kept as reference for
+   * quantization_errors().
+   *
+   * \param[in] x_axis Grid points along the first axis.
+   * \param[in] y_axis Grid points along the second axis.
+   * \param[in] num_values Number of values per grid node.
+   * \param[in] nodes Values interleaved per grid node, in row-major order of
+   * the nodes. They should outlive the interpolator.
+   * \param[in] precision Precision of the values read by queries.
+   * \throw std::invalid_argument If an axis is not uniform.
+   */
+  UniformGrid2d(const std::vector<double> &x_axis,
+                const std::vector<double> &y_axis, size_t num_values,
+                const double *nodes,
+                TablePrecision precision = TablePrecision::kDouble);
+
+  // Nodes may point to our own storage
+  UniformGrid2d(const UniformGrid2d &) = delete;
+  UniformGrid2d &operator=(const UniformGrid2d &) = delete;
+
+  //! Number of values per grid node
+  size_t num_values() const { return num_values_; }
+
+  //! Precision of the values read by queries
+  TablePrecision precision() const { return precision_; }
+
+  //! Beginning of the values read by queries
+  const void *table_data() const;
+
+  //! Size in bytes of the values read by queries
+  size_t table_bytes() const;
+
+  /*! Maximum interpolation error of each value with respect to the double
+   * values, over all grid nodes and cell centers.
+   *
+   * \return Errors, all zero if values are stored as doubles.
+   */
+  std::vector<double> quantization_errors() const;
+
+  /*! Interpolate all values at a point.
+   *
+   * \param[in] x First coordinate.
+   * \param[in] y Second coordinate.
+   * \param[out] values Interpolated values, `num_values()` of them.
+   */
+  void interpolate(double x, double y, double *values) const;
+
+  /*! Interpolate all values at several points.
+   *
+   * Cells of consecutive points are located before any of them is read, so
+   * that their memory accesses overlap.
+   *
+   * \param[in] points Coordinates of the points, as consecutive (x, y) pairs.
+   * \param[in] num_points Number of points.
+   * \param[out] values Interpolated values, `num_values()` per point, in the
+   * order of the points.
+   */
+  void interpolate_points(const double *points, size_t num_points,
+                          double *values) const;
+
+  /*! Interpolate all values at a batch of points, vectorized when possible.
+   *
+   * Coordinates and values are laid out as structures of arrays, so that
+   * whole logs can be evaluated in one call. Uses AVX2, NEON or SSE2
+   * intrinsics depending on the target, and the scalar path for the
+   * remaining points.
+   *
+   * \param[in] xs First coordinate of each point.
+   * \param[in] ys Second coordinate of each point.
+   * \param[in] num_points Number of points.
+   * \param[out] values One array per value, `num_values()` of them, each
+   * receiving `num_points` interpolated values.
+   */
+  void interpolate_batch(const double *xs, const double *ys, size_t num_points,
+                         double *const *values) const;
+
+ private:
+  //! Grid cell containing a point, with bilinear weights of its corners
+  struct Cell {
+    //! Offset of the values at node (i, j), followed by those at node
+    //! (i, j + 1)
+    size_t lower;
+
+    //! Offset of the values at node (i + 1, j), followed by those at node
+    //! (i + 1, j + 1)
+    size_t upper;
+
+    //! Weights of nodes (i, j), (i, j + 1), (i + 1, j) and (i + 1, j + 1)
+    double w00, w01, w10, w11;
+  };
+
+  /*! Locate the cell containing a point, clamped to the grid.
+   *
+   * \param[in] x First coordinate.
+   * \param[in] y Second coordinate.
+   */
+  Cell locate(double x, double y) const;
+
+  /*! Weighted sum of the values at the corners of a cell.
+   *
+   * \param[in] cell Grid cell.
+   * \param[out] values Interpolated values, `num_values()` of them.
+   */
+  void accumulate(const Cell &cell, double *values) const;
+
+  /*! Interpolate one value from the corners of a cell, at the precision of
+   * the grid.
+   *
+   * \param[in] cell Grid cell.
+   * \param[in] value Index of the value.
+   */
+  double blend(const Cell &cell, size_t value) const;
+
+  //! Affine map between 16-bit codes and values, or their logarithms
+  struct Quantizer {
+    //! Step between consecutive codes
+    double scale;
+
+    //! Value, or logarithm, of the first code
+    double offset;
+
+    //! Codes are uniform in log scale, code zero being value zero
+    bool log_scale;
+
+    /*! Quantize a value.
+     *
+     * \param[in] value Value to quantize.
+     */
+    uint16_t encode(double value) const;
+
+    /*! Value of a code.
+     *
+     * \param[in] code Quantized value.
+     */
+    double decode(uint16_t code) const;
+  };
+
+  /*! Set up the quantizer of a value from its range over the grid.
+   *
+   * \param[in] value Index of the value.
+   */
+  Quantizer make_quantizer(size_t value) const;
+
+  /*! Scalar batch interpolation over a range of points.
+   *
+   * \param[in] xs First coordinate of each point.
+   * \param[in] ys Second coordinate of each point.
+   * \param[in] begin Index of the first point of the range.
+   * \param[in] end Index past the last point of the range.
+   * \param[out] values One array per value, written over the range.
+   */
+  void interpolate_range(const double *xs, const double *ys, size_t begin,
+                         size_t end, double *const *values) const;
+
+  //! Number of values per grid node
+  const size_t num_values_;
+
+  //! Number of grid points along each axis
+  const size_t nx_;
+  const size_t ny_;
+
+  //! First grid point along each axis
+  const double x0_;
+  const double y0_;
+
+  //! Last grid point along each axis
+  const double x1_;
+  const double y1_;
+
+  //! Inverse of the grid spacing along each axis
+  const double inv_dx_;
+  const double inv_dy_;
+
+  //! Interleaved values, if the interpolator owns them
+  std::vector<double> storage_;
+
+  //! Values of all tables, interleaved per grid node
+  const double *nodes_;
+
+  //! Precision of the values read by queries
+  const TablePrecision precision_;
+
+  //! Values in single precision, if the precision is kFloat32
+  std::vector<float> float_nodes_;
+
+  //! Quantized values, if the precision is kLogUint16
+  std::vector<uint16_t> code_nodes_;
+
+  //! Quantizer of each value, if the precision is kLogUint16
+  std::vector<Quantizer> quantizers_;
+};
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/UniformGridNd.h"
+
+template class UniformGridNd<3>;
+template class UniformGridNd<4>;
+template class UniformGridNd<5>;
+
+namespace {
+
+//! Build the uniform grid interpolator with N axes or more, up to
+//! kMaxUniformGridAxes, matching the number of axes of a grid
+template <size_t N>
+std::unique_ptr<MultilinearGrid> make_grid(
+    const std::vector<std::vector<double>> &axes, size_t num_values,
+    const double *nodes) {
+  if (axes.size() == N) {
+    return std::make_unique<UniformGridNd<N>>(axes, num_values, nodes);
+  }
+  if constexpr (N < kMaxUniformGridAxes) {
+    return make_grid<N + 1>(axes, num_values, nodes);
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+std::unique_ptr<MultilinearGrid> make_uniform_grid_nd(
+    const std::vector<std::vector<double>> &axes, size_t num_values,
+    const double *nodes) {
+  if (axes.size() < kMinUniformGridAxes || axes.size() > kMaxUniformGridAxes) {
+    return nullptr;
+  }
+  for (const auto &axis : axes) {
+    if (!is_uniform_axis(axis)) {
+      return nullptr;
+    }
+  }
+  return make_grid<kMinUniformGridAxes>(axes, num_values, nodes);
+}
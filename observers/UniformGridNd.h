@@ -0,0 +1,247 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "observers/UniformGrid2d.h"
+
+//! Numbers of axes of the uniform grids built by make_uniform_grid_nd
+inline constexpr size_t kMinUniformGridAxes = 3;
+inline constexpr size_t kMaxUniformGridAxes = 5;
+
+//! Multilinear interpolator on a grid whose number of axes is only known at
+//! run time, e.g. when loading a model
+class MultilinearGrid {
+ public:
+  virtual ~MultilinearGrid() = default;
+
+  //! Number of axes of the grid
+  virtual size_t num_axes() const = 0;
+
+  //! Number of values per grid node
+  virtual size_t num_values() const = 0;
+
+  /*! Interpolate all values at a point.
+   *
+   * \param[in] point Coordinates of the point, one per axis.
+   * \param[out] values Interpolated values, `num_values()` of them.
+   */
+  virtual void interpolate(const double *point, double *values) const = 0;
+
+  /*! Interpolate all values at several points.
+   *
+   * \param[in] points Coordinates of the points, concatenated.
+   * \param[in] num_points Number of points.
+   * \param[out] values Interpolated values, `num_values()` per point, in the
+   * order of the points.
+   */
+  virtual void interpolate_points(const double *points, size_t num_points,
+                                  double *values) const = 0;
+};
+
+/*! Multilinear interpolator on a uniform grid with N axes, N being known at
+ * compile time.
+ *
+ * Extends UniformGrid2d to models with more inputs than wheel and knee
+ * torques, e.g. a hip torque or a wheel velocity. Coordinates, strides and
+ * weights are held in fixed-size arrays, so that the loops over axes and over
+ * the 2^N corners of a cell are unrolled. Offsets of the corners from the
+ * lower corner of a cell are the same for all cells, hence computed once at
+ * construction. Values of all tables are interleaved per grid node, and
+ * points outside the grid are clamped to it as in UniformGrid2d.
+ */
+template <size_t N>
+class UniformGridNd final : public MultilinearGrid {
+  static_assert(N >= kMinUniformGridAxes && N <= kMaxUniformGridAxes,
+                "Uniform grids have kMinUniformGridAxes to kMaxUniformGridAxes "
+                "axes");
+
+ public:
+  //! Number of corners of a grid cell
+  static constexpr size_t kNumCorners = size_t{1} << N;
+
+  /*! Interpolate values already interleaved per grid node.
+   *
+   * \param[in] axes Grid points along each axis.
+   * \param[in] num_values Number of values per grid node.
+   * \param[in] nodes Values interleaved per grid node, in row-major order of
+   * the nodes. They should outlive the interpolator.
+   * \throw std::invalid_argument If the grid does not have N axes, or if an
+   * axis is not uniform.
+   */
+  UniformGridNd(const std::vector<std::vector<double>> &axes,
+                size_t num_values, const double *nodes);
+
+  size_t num_axes() const override { return N; }
+
+  size_t num_values() const override { return num_values_; }
+
+  void interpolate(const double *point, double *values) const override {
+    accumulate(locate(point), values, std::make_index_sequence<kNumCorners>{});
+  }
+
+  void interpolate_points(const double *points, size_t num_points,
+                          double *values) const override;
+
+ private:
+  //! Grid cell containing a point, with multilinear weights of its corners
+  struct Cell {
+    //! Offset of the values at the lower corner of the cell
+    size_t lower;
+
+    //! Weight of each corner, bit N - 1 - d of the corner index selecting
+    //! the upper node along axis d
+    std::array<double, kNumCorners> weights;
+  };
+
+  /*! Locate the cell containing a point, clamped to the grid.
+   *
+   * \param[in] point Coordinates of the point, one per axis.
+   */
+  Cell locate(const double *point) const;
+
+  /*! Weighted sum of the values at the corners of a cell.
+   *
+   * \param[in] cell Grid cell.
+   * \param[out] values Interpolated values, `num_values()` of them.
+   */
+  template <size_t... Corners>
+  void accumulate(const Cell &cell, double *values,
+                  std::index_sequence<Corners...>) const {
+    const double *lower = nodes_ + cell.lower;
+    for (size_t v = 0; v < num_values_; ++v) {
+      values[v] =
+          (... + (cell.weights[Corners] * lower[corner_offsets_[Corners] + v]));
+    }
+  }
+
+  //! Number of values per grid node
+  const size_t num_values_;
+
+  //! Values of all tables, interleaved per grid node
+  const double *const nodes_;
+
+  //! First grid point along each axis
+  std::array<double, N> lower_;
+
+  //! Last grid point along each axis
+  std::array<double, N> upper_;
+
+  //! Inverse of the grid spacing along each axis
+  std::array<double, N> inv_spacing_;
+
+  //! Index of the last cell along each axis
+  std::array<size_t, N> last_cell_;
+
+  //! Offset between consecutive grid points along each axis, in doubles
+  std::array<size_t, N> strides_;
+
+  //! Offset of each corner of a cell from its lower corner, in doubles
+  std::array<size_t, kNumCorners> corner_offsets_;
+};
+
+template <size_t N>
+UniformGridNd<N>::UniformGridNd(const std::vector<std::vector<double>> &axes,
+                                size_t num_values, const double *nodes)
+    : num_values_(num_values), nodes_(nodes) {
+  if (axes.size() != N) {
+    throw std::invalid_argument("Grid should have " + std::to_string(N) +
+                                " axes, not " + std::to_string(axes.size()));
+  }
+
+  // Row-major strides, the last axis being contiguous
+  size_t stride = num_values;
+  for (size_t d = N; d-- > 0;) {
+    const std::vector<double> &axis = axes[d];
+    if (!is_uniform_axis(axis)) {
+      throw std::invalid_argument("Axis " + std::to_string(d) +
+                                  " is not uniform");
+    }
+    lower_[d] = axis.front();
+    upper_[d] = axis.back();
+    inv_spacing_[d] = (axis.size() - 1) / (axis.back() - axis.front());
+    last_cell_[d] = axis.size() - 2;
+    strides_[d] = stride;
+    stride *= axis.size();
+  }
+
+  for (size_t corner = 0; corner < kNumCorners; ++corner) {
+    corner_offsets_[corner] = 0;
+    for (size_t d = 0; d < N; ++d) {
+      corner_offsets_[corner] += ((corner >> (N - 1 - d)) & 1) * strides_[d];
+    }
+  }
+}
+
+template <size_t N>
+typename UniformGridNd<N>::Cell UniformGridNd<N>::locate(
+    const double *point) const {
+  Cell cell;
+  cell.lower = 0;
+  cell.weights[0] = 1.0;
+  for (size_t d = 0; d < N; ++d) {
+    // Cell coordinate, clamped for constant extrapolation
+    const double u =
+        (std::clamp(point[d], lower_[d], upper_[d]) - lower_[d]) *
+        inv_spacing_[d];
+    const size_t i = std::min(static_cast<size_t>(u), last_cell_[d]);
+    const double t = u - i;
+    cell.lower += i * strides_[d];
+
+    // Split the weights of the corners over the previous axes between the
+    // lower and upper nodes along this one, from the last corner down so
+    // that no weight is overwritten before it is read
+    for (size_t corner = size_t{1} << d; corner-- > 0;) {
+      const double weight = cell.weights[corner];
+      cell.weights[2 * corner + 1] = weight * t;
+      cell.weights[2 * corner] = weight * (1.0 - t);
+    }
+  }
+  return cell;
+}
+
+template <size_t N>
+void UniformGridNd<N>::interpolate_points(const double *points,
+                                          size_t num_points,
+                                          double *values) const {
+  // Locate a few cells ahead of reading them
+  constexpr size_t kChunkSize = 4;
+  Cell cells[kChunkSize];
+  for (size_t start = 0; start < num_points; start += kChunkSize) {
+    const size_t chunk_size = std::min(kChunkSize, num_points - start);
+    for (size_t k = 0; k < chunk_size; ++k) {
+      cells[k] = locate(points + N * (start + k));
+    }
+    for (size_t k = 0; k < chunk_size; ++k) {
+      accumulate(cells[k], values + (start + k) * num_values_,
+                 std::make_index_sequence<kNumCorners>{});
+    }
+  }
+}
+
+extern template class UniformGridNd<3>;
+extern template class UniformGridNd<4>;
+extern template class UniformGridNd<5>;
+
+/*! Build the uniform grid interpolator matching the number of axes of a grid.
+ *
+ * \param[in] axes Grid points along each axis.
+ * \param[in] num_values Number of values per grid node.
+ * \param[in] nodes Values interleaved per grid node, in row-major order of
+ * the nodes. They should outlive the interpolator.
+ * \return Interpolator, or null if the grid has fewer than
+ * kMinUniformGridAxes or more than kMaxUniformGridAxes axes, or if one of
+ * its axes is not uniform.
+ */
+std::unique_ptr<MultilinearGrid> make_uniform_grid_nd(
+    const std::vector<std::vector<double>> &axes, size_t num_values,
+    const double *nodes);
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/WarpedGrid2d.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+WarpedAxis::WarpedAxis(const std::vector<double> &points)
+    : points_(points), front_(0.0), back_(0.0), inv_bin_width_(0.0) {
+  if (points_.size() < 2 ||
+      points_.size() > std::numeric_limits<uint32_t>::max()) {
+    throw std::invalid_argument("Warped axis should have at least two points");
+  }
+  double min_spacing = std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i + 1 < points_.size(); ++i) {
+    const double spacing = points_[i + 1] - points_[i];
+    if (!(spacing > 0.0)) {
+      throw std::invalid_argument("Warped axis is not strictly increasing");
+    }
+    inv_spacings_.push_back(1.0 / spacing);
+    min_spacing = std::min(min_spacing, spacing);
+  }
+  front_ = points_.front();
+  back_ = points_.back();
+
+  // Bins no wider than the narrowest cell
+  const double range = back_ - front_;
+  const size_t num_bins =
+      std::min(static_cast<size_t>(std::ceil(range / min_spacing)) + 1,
+               kMaxWarpedAxisBins);
+  inv_bin_width_ = num_bins / range;
+  bins_.resize(num_bins);
+  size_t i = 0;
+  for (size_t bin = 0; bin < num_bins; ++bin) {
+    const double start = front_ + bin / inv_bin_width_;
+    while (i + 2 < points_.size() && points_[i + 1] <= start) {
+      ++i;
+    }
+    bins_[bin] = static_cast<uint32_t>(i);
+  }
+}
+
+WarpedGrid2d::WarpedGrid2d(const std::vector<double> &x_axis,
+                           const std::vector<double> &y_axis,
+                           size_t num_values, const double *nodes)
+    : x_axis_(x_axis),
+      y_axis_(y_axis),
+      num_values_(num_values),
+      nodes_(nodes) {}
+
+void WarpedGrid2d::interpolate(double x, double y, double *values) const {
+  double tx, ty;
+  const size_t i = x_axis_.locate(x, &tx);
+  const size_t j = y_axis_.locate(y, &ty);
+
+  // Nodes (i, j) and (i, j + 1) are contiguous, as well as (i + 1, j) and
+  // (i + 1, j + 1)
+  const double *lower = nodes_ + (i * y_axis_.size() + j) * num_values_;
+  const double *upper = lower + y_axis_.size() * num_values_;
+  const double w00 = (1.0 - tx) * (1.0 - ty);
+  const double w01 = (1.0 - tx) * ty;
+  const double w10 = tx * (1.0 - ty);
+  const double w11 = tx * ty;
+  for (size_t v = 0; v < num_values_; ++v) {
+    const size_t next = num_values_ + v;
+    values[v] = w00 * lower[v] + w01 * lower[next] + w10 * upper[v] +
+                w11 * upper[next];
+  }
+}
+
+void WarpedGrid2d::interpolate_points(const double *points, size_t num_points,
+                                      double *values) const {
+  for (size_t k = 0; k < num_points; ++k) {
+    interpolate(points[2 * k], points[2 * k + 1], values + k * num_values_);
+  }
+}
+
+void WarpedGrid2d::interpolate_batch(const double *xs, const double *ys,
+                                     size_t num_points,
+                                     double *const *values) const {
+  std::vector<double> point_values(num_values_);
+  for (size_t k = 0; k < num_points; ++k) {
+    interpolate(xs[k], ys[k], point_values.data());
+    for (size_t v = 0; v < num_values_; ++v) {
+      values[v][k] = point_values[v];
+    }
+  }
+}
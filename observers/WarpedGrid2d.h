@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! Maximum number of bins of a WarpedAxis, beyond which lookups may walk
+//! further than one cell
+inline constexpr size_t kMaxWarpedAxisBins = 1 << 16;
+
+/*! Grid axis with arbitrary breakpoints, searched in O(1).
+ *
+ * The range of the axis is divided into uniform bins, each holding the index
+ * of the cell where it starts. Bins are no wider than the narrowest cell, so
+ * that a point is at most one cell past the one of its bin.
+ */
+class WarpedAxis {
+ public:
+  /*! Index the cells of an axis.
+   *
+   * \param[in] points Breakpoints, in increasing order.
+   * \throw std::invalid_argument If the axis has fewer than two points or is
+   * not strictly increasing.
+   */
+  explicit WarpedAxis(const std::vector<double> &points);
+
+  //! Number of breakpoints
+  size_t size() const { return points_.size(); }
+
+  /*! Locate the cell containing a coordinate, clamped to the axis.
+   *
+   * \param[in] x Coordinate.
+   * \param[out] t Position of the coordinate in its cell, in [0, 1].
+   * \return Index of the lower breakpoint of the cell.
+   */
+  size_t locate(double x, double *t) const {
+    x = (x < front_) ? front_ : ((x > back_) ? back_ : x);
+    size_t bin = static_cast<size_t>((x - front_) * inv_bin_width_);
+    bin = (bin < bins_.size()) ? bin : bins_.size() - 1;
+    size_t i = bins_[bin];
+    while (i + 2 < points_.size() && x >= points_[i + 1]) {
+      ++i;  // at most once, unless bins were capped at kMaxWarpedAxisBins
+    }
+    *t = (x - points_[i]) * inv_spacings_[i];
+    return i;
+  }
+
+ private:
+  //! Breakpoints
+  std::vector<double> points_;
+
+  //! Inverse of the width of each cell
+  std::vector<double> inv_spacings_;
+
+  //! Index of the cell containing the start of each bin
+  std::vector<uint32_t> bins_;
+
+  //! First breakpoint
+  double front_;
+
+  //! Last breakpoint
+  double back_;
+
+  //! Number of bins per unit of the axis
+  double inv_bin_width_;
+};
+
+/*! Bilinear interpolator on a 2-D grid with non-uniform axes.
+ *
+ * Adaptive grids keep more breakpoints where tables are steep, e.g. at the
+ * contact boundary near zero torque, and fewer in their flat tails. Cells are
+ * found in O(1) by WarpedAxis, and values of all tables are interleaved per
+ * grid node as in UniformGrid2d. Points outside the grid are clamped to it.
+ */
+class WarpedGrid2d {
+ public:
+  /*! Interpolate values already interleaved per grid node.
+   *
+   * \param[in] x_axis Breakpoints along the first axis.
+   * \param[in] y_axis Breakpoints along the second axis.
+   * \param[in] num_values Number of values per grid node.
+   * \param[in] nodes Values interleaved per grid node, in row-major order of
+   * the nodes. They are viewed without copying and should outlive the
+   * interpolator.
+   * \throw std::invalid_argument If an axis is not strictly increasing.
+   */
+  WarpedGrid2d(const std::vector<double> &x_axis,
+               const std::vector<double> &y_axis, size_t num_values,
+               const double *nodes);
+
+  //! Number of values per grid node
+  size_t num_values() const { return num_values_; }
+
+  /*! Interpolate all values at a point.
+   *
+   * \param[in] x First coordinate.
+   * \param[in] y Second coordinate.
+   * \param[out] values Interpolated values, `num_values()` of them.
+   */
+  void interpolate(double x, double y, double *values) const;
+
+  /*! Interpolate all values at several points.
+   *
+   * \param[in] points Coordinates of the points, as consecutive (x, y) pairs.
+   * \param[in] num_points Number of points.
+   * \param[out] values Interpolated values, `num_values()` per point, in the
+   * order of the points.
+   */
+  void interpolate_points(const double *points, size_t num_points,
+                          double *values) const;
+
+  /*! Interpolate all values at a batch of points, in structure-of-arrays
+   * layout.
+   *
+   * \param[in] xs First coordinate of each point.
+   * \param[in] ys Second coordinate of each point.
+   * \param[in] num_points Number of points.
+   * \param[out] values One array per value, `num_values()` of them, each
+   * receiving `num_points` interpolated values.
+   */
+  void interpolate_batch(const double *xs, const double *ys, size_t num_points,
+                         double *const *values) const;
+
+ private:
+  //! Breakpoints along the first axis
+  const WarpedAxis x_axis_;
+
+  //! Breakpoints along the second axis
+  const WarpedAxis y_axis_;
+
+  //! Number of values per grid node
+  const size_t num_values_;
+
+  //! Values of all tables, interleaved per grid node
+  const double *nodes_;
+};
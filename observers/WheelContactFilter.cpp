@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include "observers/WheelContactFilter.h"
+
+#include <cmath>
+#include <stdexcept>
+
+#include "spdlog/spdlog.h"
+
+namespace {
+
+//! Floor of state probabilities, the counterpart of the bound on the contact
+//! log-odds of ContactFilter
+const double kMinStateProbability = 1.0 / (1.0 + std::exp(kMaxContactLogOdds));
+
+}  // namespace
+
+WheelContactFilter::WheelContactFilter(const Parameters &params)
+    : params_(params),
+      filter_(Filter::Vector::Constant(1.0 / kNumStates),
+              kMinStateProbability) {
+  if (params.leg_names.size() != kNumLegs) {
+    throw std::invalid_argument("Wheel contact filters have two legs");
+  }
+  if (params.coupling < 0.0 || params.coupling > 1.0) {
+    throw std::invalid_argument("Coupling should be between zero and one");
+  }
+
+  // Legs are independent in the initial belief
+  Filter::Vector belief;
+  for (int state = 0; state < kNumStates; ++state) {
+    belief(state) = 1.0;
+    for (int leg = 0; leg < kNumLegs; ++leg) {
+      belief(state) *= ((state >> leg) & 1) ? params.p_contact
+                                            : 1.0 - params.p_contact;
+    }
+  }
+  filter_.reset(belief);
+  for (int leg = 0; leg < kNumLegs; ++leg) {
+    p_contact[leg] = params.p_contact;
+  }
+
+  for (const auto &leg_name : params.leg_names) {
+    legs_.push_back(LegPaths{
+        .log_likelihood_ratio =
+            InputPath{"measurement_model", leg_name, "log_likelihood_ratio"},
+        .p_contact = OutputPath{"contact_filter", leg_name, "p_contact"}});
+  }
+}
+
+void WheelContactFilter::reset(const Dictionary &config) {
+  p_switch_input.unbind();
+  p_landing_input.unbind();
+  for (auto &leg : legs_) {
+    leg.log_likelihood_ratio.unbind();
+    leg.p_contact.unbind();
+  }
+  p_contact_output.unbind();
+}
+
+WheelContactFilter::Filter::Matrix WheelContactFilter::transition(
+    double p_switch, double p_landing, double coupling) {
+  // Transitions of a single leg, as in ContactFilter, state 1 being contact
+  Eigen::Matrix2d leg_transition;
+  leg_transition << 1.0 - p_switch, p_switch * (1.0 - p_landing),
+      p_switch * p_landing, 1.0 - p_switch;
+
+  // Independent legs: product of the transitions of each leg
+  Filter::Matrix independent;
+  for (int to = 0; to < kNumStates; ++to) {
+    for (int from = 0; from < kNumStates; ++from) {
+      independent(to, from) = leg_transition(to & 1, from & 1) *
+                              leg_transition(to >> 1, from >> 1);
+    }
+  }
+
+  // Coupled legs: a switch lands both legs or lifts both off
+  constexpr int kAllContact = kNumStates - 1;
+  Filter::Matrix coupled = (1.0 - p_switch) * Filter::Matrix::Identity();
+  for (int from = 0; from < kNumStates; ++from) {
+    if (from != kAllContact) {
+      coupled(kAllContact, from) += p_switch * p_landing;
+    }
+    if (from != 0) {
+      coupled(0, from) += p_switch * (1.0 - p_landing);
+    }
+  }
+  return coupling * coupled + (1.0 - coupling) * independent;
+}
+
+WheelContactFilter::Filter::Vector WheelContactFilter::likelihoods(
+    const double *log_likelihood_ratios) {
+  // Likelihoods of each leg scaled to sum to one, so that they stay finite
+  // and never both vanish
+  Filter::Vector likelihoods = Filter::Vector::Ones();
+  for (int leg = 0; leg < kNumLegs; ++leg) {
+    const double p_contact =
+        1.0 / (1.0 + std::exp(-log_likelihood_ratios[leg]));
+    for (int state = 0; state < kNumStates; ++state) {
+      likelihoods(state) *=
+          ((state >> leg) & 1) ? p_contact : 1.0 - p_contact;
+    }
+  }
+  return likelihoods;
+}
+
+void WheelContactFilter::read(const Dictionary &observation) {
+  const double p_switch = p_switch_input(observation).as<double>();
+  const double p_landing = p_landing_input(observation).as<double>();
+  double log_likelihood_ratios[kNumLegs];
+  for (int leg = 0; leg < kNumLegs; ++leg) {
+    log_likelihood_ratios[leg] =
+        legs_[leg].log_likelihood_ratio(observation).as<double>();
+  }
+
+  filter_.predict(transition(p_switch, p_landing, params_.coupling));
+  if (!filter_.update(likelihoods(log_likelihood_ratios))) {
+    spdlog::warn("Invalid contact likelihoods, only predicting contacts");
+  }
+
+  // Marginal contact probability of each leg
+  const Filter::Vector &belief = filter_.belief();
+  for (int leg = 0; leg < kNumLegs; ++leg) {
+    p_contact[leg] = 0.0;
+    for (int state = 0; state < kNumStates; ++state) {
+      if ((state >> leg) & 1) {
+        p_contact[leg] += belief(state);
+      }
+    }
+  }
+}
+
+void WheelContactFilter::write(Dictionary &observation) {
+  for (int leg = 0; leg < kNumLegs; ++leg) {
+    legs_[leg].p_contact(observation) = p_contact[leg];
+  }
+  p_contact_output(observation) = p_contact[0];
+}
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "observers/ContactFilter.h"
+#include "observers/DictionaryBinding.h"
+#include "observers/HmmFilter.h"
+#include "palimpsest/Dictionary.h"
+#include "upkie/cpp/observers/Observer.h"
+
+using palimpsest::Dictionary;
+using upkie::cpp::observers::Observer;
+
+/*! Estimate the contacts of both wheels jointly.
+ *
+ * The four states of the hidden Markov model are the contacts of the two
+ * legs, leg l being in contact in states whose bit l is set. Both legs are
+ * updated at once: the transition matrix is built from the transition model,
+ * and the likelihood of each state is the product of the likelihoods of the
+ * measurement model for each leg.
+ *
+ * Transitions mix two models. In the independent one, each leg switches as
+ * in ContactFilter, so that the marginal of each leg matches a ContactFilter
+ * in log-odds mode. In the coupled one, a switch of the transition model,
+ * e.g. a jump or a landing, affects both legs at once.
+ *
+ * Replaces ContactFilter when the measurement model has two legs. Outputs
+ * follow the measurement model: `contact_filter/<leg>/p_contact` for each
+ * leg, and `contact_filter/p_contact` for the first one.
+ */
+class WheelContactFilter : public Observer {
+ public:
+  //! Number of legs
+  static constexpr int kNumLegs = 2;
+
+  //! Number of contact states
+  static constexpr int kNumStates = 1 << kNumLegs;
+
+  //! Contact filter of both legs
+  using Filter = HmmFilter<kNumStates>;
+
+  //! Parameters of the filter
+  struct Parameters {
+    //! Names of the legs, as in MeasurementModel::Parameters::leg_names
+    std::vector<std::string> leg_names = {"left", "right"};
+
+    //! Initial contact belief of each leg
+    double p_contact = 0.5;
+
+    //! Weight of the coupled transition model, between zero for legs that
+    //! switch independently and one for legs that always switch together
+    double coupling = 0.0;
+  };
+
+  /*! Initialize observer.
+   *
+   * \param[in] params Parameters of the filter.
+   * \throw std::invalid_argument If there are not two legs, or if the
+   * coupling is not between zero and one.
+   */
+  explicit WheelContactFilter(const Parameters &params);
+
+  //! Prefix of outputs in the observation dictionary.
+  inline std::string prefix() const noexcept final { return "contact_filter"; }
+
+  /*! Unbind dictionary paths, which are bound again at the next tick.
+   *
+   * \param[in] config Configuration dictionary.
+   */
+  void reset(const Dictionary &config) override;
+
+  /*! Read inputs from other observations.
+   *
+   * \param[in] observation Dictionary to read other observations from.
+   */
+  void read(const Dictionary &observation) override;
+
+  /*! Write outputs, called if reading was successful.
+   *
+   * \param[out] observation Dictionary to write observations to.
+   */
+  void write(Dictionary &observation) override;
+
+  /*! Transition matrix of both legs.
+   *
+   * \param[in] p_switch Probability of a contact switch.
+   * \param[in] p_landing Probability of landing, conditioned on a switch.
+   * \param[in] coupling Weight of the coupled transition model.
+   */
+  static Filter::Matrix transition(double p_switch, double p_landing,
+                                   double coupling);
+
+  /*! Likelihood of each state.
+   *
+   * \param[in] log_likelihood_ratios Log-likelihood ratio of contact to no
+   * contact of each leg.
+   */
+  static Filter::Vector likelihoods(const double *log_likelihood_ratios);
+
+  //! Joint distribution of the contacts of both legs
+  const Filter::Vector &belief() const { return filter_.belief(); }
+
+  //! Contact probability of each leg
+  double p_contact[kNumLegs]{};
+
+ private:
+  //! Paths to the inputs and outputs of a leg
+  struct LegPaths {
+    InputPath log_likelihood_ratio;
+    OutputPath p_contact;
+  };
+
+  //! Parameters of the filter
+  const Parameters params_;
+
+  //! Forward filter of the joint contact states
+  Filter filter_;
+
+  //! Inputs from the transition model, bound at the first tick
+  InputPath p_switch_input{"transition_model", "p_switch"};
+  InputPath p_landing_input{"transition_model", "p_landing"};
+
+  //! Inputs and outputs of each leg, bound at the first tick
+  std::vector<LegPaths> legs_;
+
+  //! Contact probability of the first leg at the top level
+  OutputPath p_contact_output{"contact_filter", "p_contact"};
+};
@@ -0,0 +1,40 @@
+# -*- python -*-
+#
+# SPDX-License-Identifier: Apache-2.0
+# Copyright 2024 Inria
+
+"""Bazel macro embedding a compiled measurement model in a binary."""
+
+def embedded_model(name, src, visibility = None):
+    """
+    Compile a .npz measurement model into a C++ library holding it.
+
+    The library provides a header `<name>.h` declaring `<name>()`, which
+    returns the EmbeddedModel to pass to ModelFile::embedded. Its tables are
+    part of the binary, so that loading them needs no filesystem access.
+
+    Args:
+        name: Name of the library, of its header and of its function.
+        src: Label of the .npz measurement model.
+        visibility: Visibility of the library.
+    """
+    native.genrule(
+        name = name + "_sources",
+        srcs = [src],
+        outs = [name + ".h", name + ".cpp"],
+        cmd = " ".join([
+            "$(location //observers:compile_model)",
+            "$(location {})".format(src),
+            "$(location {}.cpp)".format(name),
+            "--embed",
+            name,
+        ]),
+        tools = ["//observers:compile_model"],
+    )
+    native.cc_library(
+        name = name,
+        srcs = [name + ".cpp"],
+        hdrs = [name + ".h"],
+        deps = ["//observers:model_file"],
+        visibility = visibility,
+    )
@@ -0,0 +1,299 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "observers/ContactFilter.h"
+#include "observers/MeasurementModel.h"
+#include "observers/TransitionModel.h"
+#include "observers/WheelContactFilter.h"
+#include "observers/utils.h"
+#include "palimpsest/Dictionary.h"
+
+namespace {
+
+//! Path to the test binary, to find model files in its runfiles
+constexpr char kArgv0[] = "observers/tests/AllocationTest";
+
+//! Count allocations of the calling thread when set
+thread_local bool count_allocations = false;
+
+//! Number of allocations counted so far
+thread_local size_t num_allocations = 0;
+
+void *counted_malloc(size_t size) {
+  if (count_allocations) {
+    ++num_allocations;
+  }
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *counted_aligned_alloc(size_t size, std::align_val_t alignment) {
+  if (count_allocations) {
+    ++num_allocations;
+  }
+  const size_t align = static_cast<size_t>(alignment);
+  void *ptr = std::aligned_alloc(align, (size + align - 1) / align * align);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+}  // namespace
+
+// Replace the global allocation functions by counting ones
+void *operator new(size_t size) { return counted_malloc(size); }
+void *operator new[](size_t size) { return counted_malloc(size); }
+void *operator new(size_t size, std::align_val_t alignment) {
+  return counted_aligned_alloc(size, alignment);
+}
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return counted_aligned_alloc(size, alignment);
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+
+//! Ticks run before counting, so that all output keys exist
+constexpr int kWarmupTicks = 2 * kWindowSize;
+
+//! Steady-state ticks over which allocations are counted
+constexpr int kCountedTicks = 4 * kWindowSize;
+
+//! Count allocations of the calling thread within a scope
+class AllocationCounter {
+ public:
+  AllocationCounter() {
+    num_allocations = 0;
+    count_allocations = true;
+  }
+
+  ~AllocationCounter() { count_allocations = false; }
+
+  //! Number of allocations since construction
+  size_t count() const { return num_allocations; }
+};
+
+/*! Write inputs of all observers, as the spine would.
+ *
+ * \param[in] tick Tick index, used to vary the inputs.
+ * \param[out] observation Observation dictionary.
+ */
+void write_inputs(int tick, Dictionary &observation) {
+  const double t = 1e-3 * tick;
+  const double bump = (tick % 50 == 0) ? 20.0 : 0.0;
+  observation("imu")("linear_acceleration") = Eigen::Vector3d(
+      0.1 * std::sin(30.0 * t), 0.2 * std::cos(20.0 * t), 9.81 + bump);
+  observation("imu")("angular_velocity") =
+      Eigen::Vector3d(0.01 * std::sin(5.0 * t), 0.0, 0.02);
+  observation("base_orientation")("pitch") = 0.1 * std::sin(t);
+  observation("servo")("left_wheel")("torque") = 0.05 * std::sin(3.0 * t);
+  observation("servo")("left_knee")("torque") = 0.05 * std::cos(2.0 * t);
+  observation("servo")("right_wheel")("torque") = -0.05 * std::sin(3.0 * t);
+  observation("servo")("right_knee")("torque") = 0.05 * std::sin(2.0 * t);
+}
+
+/*! Run observers in order and count allocations in their read and write.
+ *
+ * \param[in] observers Observers, in the order of the spine pipeline.
+ * \return Number of allocations over kCountedTicks steady-state ticks.
+ */
+size_t count_steady_state_allocations(
+    const std::vector<Observer *> &observers) {
+  // Observers may have bound paths in a previous dictionary, reset them as
+  // the spine does before a new episode
+  Dictionary observation;
+  for (Observer *observer : observers) {
+    observer->reset(observation);
+  }
+  for (int tick = 0; tick < kWarmupTicks; ++tick) {
+    write_inputs(tick, observation);
+    for (Observer *observer : observers) {
+      observer->read(observation);
+      observer->write(observation);
+    }
+  }
+
+  size_t count = 0;
+  for (int tick = kWarmupTicks; tick < kWarmupTicks + kCountedTicks; ++tick) {
+    write_inputs(tick, observation);
+    AllocationCounter counter;
+    for (Observer *observer : observers) {
+      observer->read(observation);
+      observer->write(observation);
+    }
+    count += counter.count();
+  }
+  return count;
+}
+
+TEST(AllocationTest, CounterCountsAllocations) {
+  AllocationCounter counter;
+  auto vec = std::make_unique<std::vector<double>>(100);
+  ASSERT_EQ(counter.count(), 2);
+}
+
+TEST(AllocationTest, TransitionModelEngines) {
+  for (SpectralEngine engine :
+       {SpectralEngine::kKissFft, SpectralEngine::kSlidingDft,
+        SpectralEngine::kRealFft, SpectralEngine::kGoertzel,
+        SpectralEngine::kWavelet}) {
+    TransitionModel::Parameters params;
+    params.spectral_engine = engine;
+    TransitionModel transition_model(params);
+    ASSERT_EQ(count_steady_state_allocations({&transition_model}), 0)
+        << "engine = " << static_cast<int>(engine);
+  }
+}
+
+TEST(AllocationTest, TransitionModelMultiAxis) {
+  TransitionModel::Parameters params;
+  params.multi_axis = true;
+  TransitionModel transition_model(params);
+  ASSERT_EQ(count_steady_state_allocations({&transition_model}), 0);
+}
+
+TEST(AllocationTest, TransitionModelHop) {
+  TransitionModel::Parameters params;
+  params.hop = 4;
+  params.extrapolate_features = true;
+  TransitionModel transition_model(params);
+  ASSERT_EQ(count_steady_state_allocations({&transition_model}), 0);
+}
+
+TEST(AllocationTest, MeasurementModel) {
+  MeasurementModel::Parameters params;
+  params.resolve_model_path = runfiles_resolver(kArgv0);
+  params.model_path = "contact_agent/observers/data/measurement_model.npz";
+  MeasurementModel measurement_model(params);
+  ASSERT_EQ(count_steady_state_allocations({&measurement_model}), 0);
+
+  params.leg_names = {"left", "right"};
+  MeasurementModel dual_leg_model(params);
+  ASSERT_EQ(count_steady_state_allocations({&dual_leg_model}), 0);
+}
+
+TEST(AllocationTest, MeasurementModelOnlineAdaptation) {
+  MeasurementModel::Parameters params;
+  params.resolve_model_path = runfiles_resolver(kArgv0);
+  params.model_path = "contact_agent/observers/data/measurement_model.npz";
+  params.online_adaptation = true;
+  params.online_kde.update_period = 0.0;
+  MeasurementModel measurement_model(params);
+  TransitionModel transition_model(TransitionModel::Parameters{});
+  ContactFilter contact_filter(0.5, true);
+  measurement_model.online_kde()->update();
+
+  // Samples go to histograms, and ticks read the re-estimated tables
+  ASSERT_EQ(count_steady_state_allocations(
+                {&measurement_model, &transition_model, &contact_filter}),
+            0);
+}
+
+TEST(AllocationTest, Pipeline) {
+  MeasurementModel::Parameters measurement_params;
+  measurement_params.resolve_model_path = runfiles_resolver(kArgv0);
+  measurement_params.model_path =
+      "contact_agent/observers/data/measurement_model.npz";
+  MeasurementModel measurement_model(measurement_params);
+  TransitionModel transition_model(TransitionModel::Parameters{});
+  for (bool log_odds : {false, true}) {
+    ContactFilter contact_filter(0.5, log_odds);
+    ASSERT_EQ(count_steady_state_allocations(
+                  {&measurement_model, &transition_model, &contact_filter}),
+              0)
+        << "log_odds = " << log_odds;
+  }
+}
+
+TEST(AllocationTest, ContactFilterSmoother) {
+  MeasurementModel::Parameters measurement_params;
+  measurement_params.resolve_model_path = runfiles_resolver(kArgv0);
+  measurement_params.model_path =
+      "contact_agent/observers/data/measurement_model.npz";
+  MeasurementModel measurement_model(measurement_params);
+  TransitionModel transition_model(TransitionModel::Parameters{});
+  ContactFilter contact_filter(0.5, /* log_odds = */ true,
+                               /* smoother_lag = */ 50);
+  ASSERT_EQ(count_steady_state_allocations(
+                {&measurement_model, &transition_model, &contact_filter}),
+            0);
+}
+
+TEST(AllocationTest, WheelContactFilter) {
+  MeasurementModel::Parameters measurement_params;
+  measurement_params.resolve_model_path = runfiles_resolver(kArgv0);
+  measurement_params.model_path =
+      "contact_agent/observers/data/measurement_model.npz";
+  measurement_params.leg_names = {"left", "right"};
+  MeasurementModel measurement_model(measurement_params);
+  TransitionModel transition_model(TransitionModel::Parameters{});
+  WheelContactFilter::Parameters filter_params;
+  filter_params.coupling = 0.5;
+  WheelContactFilter wheel_contact_filter(filter_params);
+  ASSERT_EQ(count_steady_state_allocations({&measurement_model,
+                                            &transition_model,
+                                            &wheel_contact_filter}),
+            0);
+}
+
+TEST(AllocationTest, MeasurementModelHotReload) {
+  MeasurementModel::Parameters params;
+  params.resolve_model_path = runfiles_resolver(kArgv0);
+  params.model_path = "contact_agent/observers/data/measurement_model.npz";
+  params.hot_reload = true;
+  params.reload_period = 0.0;
+  MeasurementModel measurement_model(params);
+  ASSERT_EQ(count_steady_state_allocations({&measurement_model}), 0);
+  Dictionary observation;
+  write_inputs(0, observation);
+  measurement_model.read(observation);
+  measurement_model.write(observation);
+
+  // Reload the model on request, as the agent would at the start of an
+  // episode, and wait for the loader thread
+  Dictionary config;
+  config("measurement_model")("model_path") = params.model_path;
+  measurement_model.reset(config);
+  ModelReloader *reloader = measurement_model.reloader();
+  for (int k = 0; k < 5000 && reloader->num_loads() < 1; ++k) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(reloader->num_loads(), 1);
+
+  // The tick swapping the reloaded tables in does not allocate
+  write_inputs(1, observation);
+  AllocationCounter counter;
+  measurement_model.read(observation);
+  measurement_model.write(observation);
+  ASSERT_EQ(counter.count(), 0);
+  ASSERT_EQ(reloader->num_swaps(), 1);
+}
+
+}  // namespace
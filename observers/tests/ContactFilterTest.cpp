@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "observers/ContactFilter.h"
+#include "observers/NpzInterpolator.h"
+#include "palimpsest/Dictionary.h"
+
+constexpr double kNearTolerance = 1e-9;
+
+namespace {
+
+/*! Write the inputs of the contact filter.
+ *
+ * \param[in] contact_likelihood Likelihood of contact.
+ * \param[in] no_contact_likelihood Likelihood of no contact.
+ * \param[in] p_switch Probability of a contact switch.
+ * \param[in] p_landing Probability of landing, conditioned on a switch.
+ * \param[out] observation Observation dictionary.
+ */
+void write_inputs(double contact_likelihood, double no_contact_likelihood,
+                  double p_switch, double p_landing, Dictionary &observation) {
+  observation("measurement_model")("contact_likelihood") = contact_likelihood;
+  observation("measurement_model")("no_contact_likelihood") =
+      no_contact_likelihood;
+  observation("measurement_model")("log_likelihood_ratio") =
+      std::log(std::max(contact_likelihood, kMinLikelihood)) -
+      std::log(std::max(no_contact_likelihood, kMinLikelihood));
+  observation("transition_model")("p_switch") = p_switch;
+  observation("transition_model")("p_landing") = p_landing;
+  observation("transition_model")("power") = 0.0;
+}
+
+TEST(ContactFilterTest, InitialBelief) {
+  ContactFilter contact_filter(0.2, /* log_odds = */ true);
+  ASSERT_NEAR(contact_filter.contact_log_odds, std::log(0.25), kNearTolerance);
+
+  // Certain beliefs are bounded in log-odds
+  ASSERT_EQ(ContactFilter(1.0, true).contact_log_odds, kMaxContactLogOdds);
+  ASSERT_EQ(ContactFilter(0.0, true).contact_log_odds, -kMaxContactLogOdds);
+}
+
+TEST(ContactFilterTest, LogOddsMatchesBelief) {
+  ContactFilter contact_filter(0.5);
+  ContactFilter log_odds_filter(0.5, /* log_odds = */ true);
+  Dictionary observation;
+  unsigned int seed = 42;
+  for (int i = 0; i < 1000; ++i) {
+    const double contact_likelihood =
+        0.1 + 10.0 * static_cast<double>(rand_r(&seed)) / RAND_MAX;
+    const double no_contact_likelihood =
+        0.1 + 10.0 * static_cast<double>(rand_r(&seed)) / RAND_MAX;
+    const double p_switch = static_cast<double>(rand_r(&seed)) / RAND_MAX;
+    const double p_landing = static_cast<double>(rand_r(&seed)) / RAND_MAX;
+    write_inputs(contact_likelihood, no_contact_likelihood, 0.1 * p_switch,
+                 p_landing, observation);
+    contact_filter.read(observation);
+    log_odds_filter.read(observation);
+    ASSERT_NEAR(log_odds_filter.p_contact, contact_filter.p_contact,
+                kNearTolerance);
+    ASSERT_NEAR(log_odds_filter.p_contact_smooth,
+                contact_filter.p_contact_smooth, kNearTolerance);
+  }
+
+  log_odds_filter.write(observation);
+  ASSERT_EQ(observation("contact_filter")("p_contact").as<double>(),
+            log_odds_filter.p_contact);
+}
+
+TEST(ContactFilterTest, LogOddsOutsideSupport) {
+  ContactFilter log_odds_filter(0.5, /* log_odds = */ true);
+  Dictionary observation;
+
+  // Torques outside of the support of the no-contact model
+  write_inputs(0.2, 0.0, 1e-10, 0.5, observation);
+  for (int i = 0; i < 10; ++i) {
+    log_odds_filter.read(observation);
+  }
+  ASSERT_TRUE(std::isfinite(log_odds_filter.contact_log_odds));
+  ASSERT_NEAR(log_odds_filter.p_contact, 1.0, kNearTolerance);
+
+  // Torques outside of the support of both models: no information
+  write_inputs(0.0, 0.0, 1e-10, 0.5, observation);
+  const double p_contact = log_odds_filter.p_contact;
+  log_odds_filter.read(observation);
+  ASSERT_FALSE(std::isnan(log_odds_filter.p_contact));
+  ASSERT_NEAR(log_odds_filter.p_contact, p_contact, kNearTolerance);
+
+  // The belief recovers when the contact model becomes unlikely
+  write_inputs(1e-3, 10.0, 1e-10, 0.5, observation);
+  for (int i = 0; i < 20; ++i) {
+    log_odds_filter.read(observation);
+  }
+  ASSERT_LT(log_odds_filter.p_contact, 0.01);
+}
+
+}  // namespace
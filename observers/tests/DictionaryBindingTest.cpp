@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "observers/ContactFilter.h"
+#include "observers/DictionaryBinding.h"
+#include "observers/MeasurementModel.h"
+#include "observers/TransitionModel.h"
+#include "observers/utils.h"
+#include "palimpsest/Dictionary.h"
+
+namespace {
+
+//! Path to the test binary, to find model files in its runfiles
+constexpr char kArgv0[] = "observers/tests/DictionaryBindingTest";
+
+/*! Write inputs of all observers, as the spine would.
+ *
+ * \param[in] tick Tick index, used to vary the inputs.
+ * \param[out] observation Observation dictionary.
+ */
+void write_inputs(int tick, Dictionary &observation) {
+  const double t = 1e-3 * tick;
+  observation("imu")("linear_acceleration") =
+      Eigen::Vector3d(0.1 * std::sin(30.0 * t), 0.0, 9.81);
+  observation("imu")("angular_velocity") = Eigen::Vector3d(0.0, 0.0, 0.02);
+  observation("base_orientation")("pitch") = 0.1 * std::sin(t);
+  observation("servo")("left_wheel")("torque") = 0.05 * std::sin(3.0 * t);
+  observation("servo")("left_knee")("torque") = 0.05 * std::cos(2.0 * t);
+}
+
+//! Paths read and written by the measurement model, transition model and
+//! contact filter at every tick
+const std::vector<std::vector<std::string>> kInputPaths = {
+    {"servo", "left_wheel", "torque"},
+    {"servo", "left_knee", "torque"},
+    {"base_orientation", "pitch"},
+    {"measurement_model", "contact_likelihood"},
+    {"measurement_model", "no_contact_likelihood"},
+    {"transition_model", "p_switch"},
+    {"transition_model", "p_landing"},
+    {"transition_model", "power"}};
+const std::vector<std::vector<std::string>> kOutputPaths = {
+    {"measurement_model", "contact_likelihood"},
+    {"measurement_model", "no_contact_likelihood"},
+    {"measurement_model", "log_likelihood_ratio"},
+    {"measurement_model", "p_contact"},
+    {"measurement_model", "left_wheel", "torque"},
+    {"measurement_model", "left_knee", "torque"},
+    {"transition_model", "mean_frequency"},
+    {"transition_model", "median_frequency"},
+    {"transition_model", "power"},
+    {"transition_model", "acc_buf"},
+    {"transition_model", "power_freq"},
+    {"transition_model", "filtered_median_freq"},
+    {"transition_model", "filtered_mean_freq"},
+    {"transition_model", "p_switch"},
+    {"transition_model", "p_landing"},
+    {"transition_model", "p_landing_p_switch"},
+    {"transition_model", "p_takeoff_p_switch"},
+    {"contact_filter", "p_contact"},
+    {"contact_filter", "p_contact_smooth"}};
+
+TEST(DictionaryBindingTest, InputPath) {
+  Dictionary observation;
+  observation("servo")("left_wheel")("torque") = 1.0;
+  const Dictionary &input = observation;
+  InputPath torque{"servo", "left_wheel", "torque"};
+  ASSERT_EQ(torque(input).as<double>(), 1.0);
+
+  // Values updated in place are read through the bound node
+  observation("servo")("left_wheel")("torque") = 2.0;
+  ASSERT_EQ(&torque(input), &input("servo")("left_wheel")("torque"));
+  ASSERT_EQ(torque(input).as<double>(), 2.0);
+
+  // Another dictionary binds the path again
+  Dictionary other;
+  other("servo")("left_wheel")("torque") = 3.0;
+  ASSERT_EQ(torque(other).as<double>(), 3.0);
+  ASSERT_EQ(torque(input).as<double>(), 2.0);
+
+  // Inputs are not inserted
+  InputPath missing{"servo", "right_wheel", "torque"};
+  ASSERT_THROW(missing(input), std::out_of_range);
+  ASSERT_EQ(missing.find(input), nullptr);
+  ASSERT_FALSE(observation("servo").has("right_wheel"));
+}
+
+TEST(DictionaryBindingTest, OptionalInput) {
+  Dictionary observation;
+  const Dictionary &input = observation;
+  InputPath pitch{"base_orientation", "pitch"};
+  ASSERT_EQ(pitch.find(input), nullptr);
+
+  // Missing paths are looked up again until they are found
+  observation("base_orientation")("pitch") = 0.5;
+  const Dictionary *node = pitch.find(input);
+  ASSERT_NE(node, nullptr);
+  ASSERT_EQ(node->as<double>(), 0.5);
+  ASSERT_EQ(pitch.find(input), node);
+}
+
+TEST(DictionaryBindingTest, OutputPath) {
+  Dictionary observation;
+  OutputPath p_contact{"contact_filter", "p_contact"};
+  p_contact(observation) = 0.25;
+  ASSERT_EQ(observation("contact_filter")("p_contact").as<double>(), 0.25);
+  p_contact(observation) = 0.75;
+  ASSERT_EQ(observation("contact_filter")("p_contact").as<double>(), 0.75);
+  ASSERT_EQ(p_contact.keys().size(), 2);
+
+  // Restructured dictionaries need the path to be bound again
+  observation.remove("contact_filter");
+  p_contact.unbind();
+  p_contact(observation) = 0.5;
+  ASSERT_EQ(observation("contact_filter")("p_contact").as<double>(), 0.5);
+}
+
+TEST(DictionaryBindingTest, ObserversRebindOnReset) {
+  MeasurementModel::Parameters params;
+  params.resolve_model_path = runfiles_resolver(kArgv0);
+  params.model_path = "contact_agent/observers/data/measurement_model.npz";
+  MeasurementModel measurement_model(params);
+  TransitionModel transition_model(TransitionModel::Parameters{});
+  ContactFilter contact_filter(0.5, true);
+  const std::vector<Observer *> observers = {
+      &measurement_model, &transition_model, &contact_filter};
+
+  auto run_tick = [&observers](int tick, Dictionary &observation) {
+    write_inputs(tick, observation);
+    for (Observer *observer : observers) {
+      observer->read(observation);
+      observer->write(observation);
+    }
+  };
+  auto episode = std::make_unique<Dictionary>();
+  run_tick(0, *episode);
+  run_tick(1, *episode);
+
+  // The spine resets observers when it restructures the observation
+  episode->clear();
+  for (Observer *observer : observers) {
+    observer->reset(Dictionary{});
+  }
+  run_tick(2, *episode);
+  for (const auto &path : kOutputPaths) {
+    const Dictionary *node = episode.get();
+    for (const auto &key : path) {
+      ASSERT_TRUE(node->has(key)) << key;
+      node = &(*node)(key);
+    }
+  }
+  ASSERT_EQ((*episode)("contact_filter")("p_contact").as<double>(),
+            contact_filter.p_contact);
+}
+
+TEST(DictionaryBindingTest, TickBenchmark) {
+  Dictionary observation;
+  MeasurementModel::Parameters params;
+  params.resolve_model_path = runfiles_resolver(kArgv0);
+  params.model_path = "contact_agent/observers/data/measurement_model.npz";
+  MeasurementModel measurement_model(params);
+  TransitionModel transition_model(TransitionModel::Parameters{});
+  ContactFilter contact_filter(0.5, true);
+  write_inputs(0, observation);
+  for (Observer *observer : std::vector<Observer *>{
+           &measurement_model, &transition_model, &contact_filter}) {
+    observer->read(observation);
+    observer->write(observation);
+  }
+
+  // Dictionary accesses of the three observers at each tick, by key as
+  // before and through bound paths
+  std::vector<InputPath> inputs;
+  for (const auto &path : kInputPaths) {
+    inputs.emplace_back(path);
+  }
+  std::vector<OutputPath> outputs;
+  for (const auto &path : kOutputPaths) {
+    outputs.emplace_back(path);
+  }
+  const Dictionary &input = observation;
+  constexpr int kNumTicks = 100000;
+  for (auto &path : outputs) {
+    path(observation) = 0.5;
+  }
+
+  // Accumulate results so that lookups are not optimized away
+  double key_sum{}, bound_sum{};
+  auto start_time = std::chrono::high_resolution_clock::now();
+  for (int tick = 0; tick < kNumTicks; ++tick) {
+    for (const auto &path : kInputPaths) {
+      const Dictionary *node = &input;
+      for (const auto &key : path) {
+        node = &(*node)(key);
+      }
+      key_sum += node->as<double>();
+    }
+    for (const auto &path : kOutputPaths) {
+      Dictionary *node = &observation;
+      for (const auto &key : path) {
+        node = &(*node)(key);
+      }
+      *node = 0.5;
+    }
+  }
+  const auto key_time = std::chrono::high_resolution_clock::now() - start_time;
+
+  start_time = std::chrono::high_resolution_clock::now();
+  for (int tick = 0; tick < kNumTicks; ++tick) {
+    for (auto &path : inputs) {
+      bound_sum += path(input).as<double>();
+    }
+    for (auto &path : outputs) {
+      path(observation) = 0.5;
+    }
+  }
+  const auto bound_time =
+      std::chrono::high_resolution_clock::now() - start_time;
+
+  const double key_ns =
+      std::chrono::duration<double, std::nano>(key_time).count() / kNumTicks;
+  const double bound_ns =
+      std::chrono::duration<double, std::nano>(bound_time).count() /
+      kNumTicks;
+  std::cout << "Lookups by key per tick ns: " << key_ns << std::endl;
+  std::cout << "Bound paths per tick ns: " << bound_ns << std::endl;
+  std::cout << "Speedup: " << key_ns / bound_ns << std::endl;
+  ASSERT_EQ(bound_sum, key_sum);
+}
+
+}  // namespace
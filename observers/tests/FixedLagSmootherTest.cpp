@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#include <stdlib.h>
+
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+#include "observers/ContactFilter.h"
+#include "observers/FixedLagSmoother.h"
+#include "observers/HmmFilter.h"
+#include "palimpsest/Dictionary.h"
+
+namespace {
+
+using Smoother = FixedLagSmoother<2>;
+
+//! Uniform random number between zero and one
+double uniform(unsigned int *seed) {
+  return static_cast<double>(rand_r(seed)) / RAND_MAX;
+}
+
+//! Ticks of a forward filter, with the contact state that generated them
+struct Sequence {
+  Smoother::MatrixSequence transitions;
+  Smoother::VectorSequence likelihoods;
+  Smoother::VectorSequence beliefs;
+  std::vector<int> states;
+};
+
+/*! Simulate a contact state that switches at random, observed through noisy
+ * Gaussian measurements, and filter it.
+ *
+ * \param[in] num_ticks Number of ticks.
+ * \param[in] noise Standard deviation of measurements, whose mean is the
+ * state.
+ * \param[in] seed Random seed.
+ */
+Sequence simulate(size_t num_ticks, double noise, unsigned int seed) {
+  constexpr double kSwitch = 0.02;
+  Smoother::Matrix transition;
+  transition << 1.0 - kSwitch, kSwitch, kSwitch, 1.0 - kSwitch;
+  HmmFilter<2> filter(HmmFilter<2>::Vector(0.5, 0.5));
+  Sequence sequence;
+  int state = 0;
+  for (size_t t = 0; t < num_ticks; ++t) {
+    if (uniform(&seed) < kSwitch) {
+      state = 1 - state;
+    }
+
+    // Box-Muller transform
+    const double gaussian = std::sqrt(-2.0 * std::log(uniform(&seed) + 1e-12)) *
+                            std::cos(2.0 * M_PI * uniform(&seed));
+    const double measurement = state + noise * gaussian;
+    const Smoother::Vector likelihoods(
+        std::exp(-0.5 * std::pow(measurement / noise, 2)),
+        std::exp(-0.5 * std::pow((measurement - 1.0) / noise, 2)));
+    filter.predict(transition);
+    filter.update(likelihoods);
+    sequence.transitions.push_back(transition);
+    sequence.likelihoods.push_back(likelihoods);
+    sequence.beliefs.push_back(filter.belief());
+    sequence.states.push_back(state);
+  }
+  return sequence;
+}
+
+TEST(FixedLagSmootherTest, MatchesSmoothingOfPastTicks) {
+  const Sequence sequence = simulate(200, 0.8, 42);
+  constexpr size_t kLag = 8;
+  Smoother smoother(kLag);
+  for (size_t t = 0; t < sequence.beliefs.size(); ++t) {
+    smoother.update(sequence.transitions[t], sequence.likelihoods[t],
+                    sequence.beliefs[t]);
+    ASSERT_EQ(smoother.delay(), std::min(t, kLag));
+
+    // Forward-backward smoothing of the ticks so far
+    const size_t end = t + 1;
+    const auto smoothed = Smoother::smooth(
+        {sequence.transitions.begin(), sequence.transitions.begin() + end},
+        {sequence.likelihoods.begin(), sequence.likelihoods.begin() + end},
+        {sequence.beliefs.begin(), sequence.beliefs.begin() + end});
+    const auto &expected = smoothed[t - smoother.delay()];
+    ASSERT_NEAR(smoother.smoothed()(1), expected(1), 1e-12) << "t = " << t;
+  }
+}
+
+TEST(FixedLagSmootherTest, ZeroLagIsFiltering) {
+  const Sequence sequence = simulate(100, 0.8, 7);
+  Smoother smoother(0);
+  for (size_t t = 0; t < sequence.beliefs.size(); ++t) {
+    smoother.update(sequence.transitions[t], sequence.likelihoods[t],
+                    sequence.beliefs[t]);
+    ASSERT_EQ(smoother.smoothed(), sequence.beliefs[t]);
+  }
+
+  // The last tick of a whole sequence is not smoothed either
+  const auto smoothed = Smoother::smooth(
+      sequence.transitions, sequence.likelihoods, sequence.beliefs);
+  ASSERT_NEAR(smoothed.back()(1), sequence.beliefs.back()(1), 1e-15);
+}
+
+TEST(FixedLagSmootherTest, SmoothingReducesErrors) {
+  const Sequence sequence = simulate(20000, 1.0, 1234);
+  const auto smoothed = Smoother::smooth(
+      sequence.transitions, sequence.likelihoods, sequence.beliefs);
+  Smoother smoother(25);
+  size_t filtered_errors = 0, lag_errors = 0, smoothed_errors = 0;
+  for (size_t t = 0; t < sequence.beliefs.size(); ++t) {
+    smoother.update(sequence.transitions[t], sequence.likelihoods[t],
+                    sequence.beliefs[t]);
+    const int state = sequence.states[t];
+    filtered_errors += (sequence.beliefs[t](1) > 0.5) != state;
+    smoothed_errors += (smoothed[t](1) > 0.5) != state;
+    const int delayed_state = sequence.states[t - smoother.delay()];
+    lag_errors += (smoother.smoothed()(1) > 0.5) != delayed_state;
+  }
+  std::cout << "Contact state errors: filtered " << filtered_errors
+            << ", lag 25 " << lag_errors << ", whole sequence "
+            << smoothed_errors << " out of " << sequence.states.size()
+            << " ticks" << std::endl;
+  ASSERT_LT(lag_errors, filtered_errors * 3 / 4);
+  ASSERT_LE(smoothed_errors, lag_errors * 11 / 10);
+}
+
+TEST(FixedLagSmootherTest, InvalidSequences) {
+  Smoother::MatrixSequence transitions(3, Smoother::Matrix::Identity());
+  Smoother::VectorSequence likelihoods(2, Smoother::Vector::Ones());
+  Smoother::VectorSequence beliefs(3, Smoother::Vector(0.5, 0.5));
+  ASSERT_THROW(Smoother::smooth(transitions, likelihoods, beliefs),
+               std::invalid_argument);
+}
+
+TEST(FixedLagSmootherTest, ContactFilter) {
+  ContactFilter contact_filter(0.5, /* log_odds = */ true,
+                               /* smoother_lag = */ 10);
+  ASSERT_EQ(contact_filter.smoother()->lag(), 10);
+  Dictionary observation;
+  observation("transition_model")("p_switch") = 0.01;
+  observation("transition_model")("p_landing") = 0.5;
+  observation("transition_model")("power") = 0.0;
+  double p_lift_off{};
+  for (int t = 0; t <= 30; ++t) {
+    observation("measurement_model")("log_likelihood_ratio") =
+        (t < 20) ? 1.0 : -3.0;
+    contact_filter.read(observation);
+    contact_filter.write(observation);
+    if (t == 20) {
+      p_lift_off = contact_filter.p_contact;
+    }
+  }
+
+  // The filtered belief at lift-off still favors contact, while the belief
+  // smoothed over the next ticks knows better
+  const double p_smoothed_lag =
+      observation("contact_filter")("p_contact_smoothed_lag").as<double>();
+  ASSERT_EQ(p_smoothed_lag, contact_filter.p_contact_smoothed_lag);
+  ASSERT_GT(p_lift_off, 0.5);
+  ASSERT_LT(p_smoothed_lag, 0.5);
+
+  // Filters without a smoother do not write it
+  ContactFilter causal_filter(0.5, true);
+  Dictionary causal_observation = Dictionary{};
+  causal_observation("transition_model")("p_switch") = 0.01;
+  causal_observation("transition_model")("p_landing") = 0.5;
+  causal_observation("measurement_model")("log_likelihood_ratio") = 1.0;
+  causal_filter.read(causal_observation);
+  causal_filter.write(causal_observation);
+  ASSERT_FALSE(causal_observation("contact_filter")
+                   .has("p_contact_smoothed_lag"));
+
+  // Reset forgets past ticks
+  contact_filter.reset(Dictionary{});
+  ASSERT_EQ(contact_filter.smoother()->delay(), 0);
+}
+
+}  // namespace
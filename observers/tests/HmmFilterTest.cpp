@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#include <stdlib.h>
+
+#include <limits>
+
+#include "gtest/gtest.h"
+#include "observers/ContactFilter.h"
+#include "observers/HmmFilter.h"
+#include "palimpsest/Dictionary.h"
+
+namespace {
+
+//! Uniform random number between zero and one
+double uniform(unsigned int *seed) {
+  return static_cast<double>(rand_r(seed)) / RAND_MAX;
+}
+
+TEST(HmmFilterTest, MatchesContactFilter) {
+  ContactFilter contact_filter(0.5);
+  HmmFilter<2> filter(HmmFilter<2>::Vector(0.5, 0.5));
+  Dictionary observation;
+  unsigned int seed = 42;
+  for (int i = 0; i < 1000; ++i) {
+    const double contact_likelihood = 0.1 + 10.0 * uniform(&seed);
+    const double no_contact_likelihood = 0.1 + 10.0 * uniform(&seed);
+    const double p_switch = 0.1 * uniform(&seed);
+    const double p_landing = uniform(&seed);
+    observation("measurement_model")("contact_likelihood") =
+        contact_likelihood;
+    observation("measurement_model")("no_contact_likelihood") =
+        no_contact_likelihood;
+    observation("measurement_model")("log_likelihood_ratio") = 0.0;
+    observation("transition_model")("p_switch") = p_switch;
+    observation("transition_model")("p_landing") = p_landing;
+    observation("transition_model")("power") = 0.0;
+    contact_filter.read(observation);
+
+    // States are no contact then contact
+    HmmFilter<2>::Matrix transition;
+    transition << 1.0 - p_switch, p_switch * (1.0 - p_landing),
+        p_switch * p_landing, 1.0 - p_switch;
+    filter.predict(transition);
+    ASSERT_TRUE(filter.update(HmmFilter<2>::Vector(
+        no_contact_likelihood, contact_likelihood + 1e-20)));
+    ASSERT_NEAR(filter.belief()(1), contact_filter.p_contact, 1e-12);
+  }
+}
+
+TEST(HmmFilterTest, InvalidLikelihoods) {
+  HmmFilter<4> filter(HmmFilter<4>::Vector::Constant(0.25));
+  HmmFilter<4>::Vector likelihoods = HmmFilter<4>::Vector::Zero();
+  ASSERT_FALSE(filter.update(likelihoods));
+  likelihoods(2) = std::numeric_limits<double>::quiet_NaN();
+  ASSERT_FALSE(filter.update(likelihoods));
+  ASSERT_EQ(filter.belief(), HmmFilter<4>::Vector::Constant(0.25));
+
+  // The floor keeps unlikely states recoverable
+  HmmFilter<4> floored(HmmFilter<4>::Vector::Constant(0.25), 1e-6);
+  ASSERT_TRUE(floored.update(HmmFilter<4>::Vector(1.0, 0.0, 0.0, 0.0)));
+  ASSERT_GT(floored.belief()(3), 0.0);
+  ASSERT_NEAR(floored.belief().sum(), 1.0, 1e-15);
+}
+
+}  // namespace
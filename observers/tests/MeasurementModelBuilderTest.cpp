@@ -0,0 +1,296 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#include <stdlib.h>
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "observers/MeasurementModelBuilder.h"
+#include "observers/NpzInterpolator.h"
+#include "palimpsest/Dictionary.h"
+#include "upkie/cpp/utils/low_pass_filter.h"
+
+using palimpsest::Dictionary;
+using upkie::cpp::utils::low_pass_filter;
+
+constexpr double kNearTolerance = 1e-8;
+
+namespace {
+
+//! Standard deviation of the synthetic torque distributions
+constexpr double kSigma = 0.05;
+
+//! Gaussian sample from a uniform generator, by the Box-Muller transform
+double gaussian(double mean, unsigned int *seed) {
+  const double u = (rand_r(seed) + 1.0) / (RAND_MAX + 2.0);
+  const double v = static_cast<double>(rand_r(seed)) / RAND_MAX;
+  return mean + kSigma * std::sqrt(-2.0 * std::log(u)) * std::cos(2 * M_PI * v);
+}
+
+//! Contact samples around (0.3, 0.3), no contact samples around (0.7, 0.7)
+std::vector<TorqueSample> make_samples(size_t num_samples, unsigned int seed) {
+  std::vector<TorqueSample> samples;
+  for (size_t k = 0; k < num_samples; ++k) {
+    const bool contact = (k % 2 == 0);
+    const double mean = contact ? 0.3 : 0.7;
+    samples.push_back(
+        TorqueSample{gaussian(mean, &seed), gaussian(mean, &seed), contact});
+  }
+  return samples;
+}
+
+//! Builder on the unit square
+MeasurementModelBuilder::Parameters unit_square_params() {
+  MeasurementModelBuilder::Parameters params;
+  params.grid_size = {64, 48};
+  params.lower_bounds = {0.0, 0.0};
+  params.upper_bounds = {1.0, 1.0};
+  params.num_threads = 4;
+  return params;
+}
+
+//! Set servo torques and ground truth contacts of an observation
+void set_observation(Dictionary &observation, double left_wheel,
+                     double left_knee, int left_points, int right_points) {
+  observation("servo")("left_wheel")("torque") = left_wheel;
+  observation("servo")("left_knee")("torque") = left_knee;
+  observation("servo")("right_wheel")("torque") = -left_wheel;
+  observation("servo")("right_knee")("torque") = -left_knee;
+  Dictionary &contacts = observation("sim")("contact");
+  contacts("left_wheel_tire")("num_contact_points") =
+      static_cast<uint64_t>(left_points);
+  contacts("right_wheel_tire")("num_contact_points") =
+      static_cast<uint64_t>(right_points);
+}
+
+//! Observation with servo torques and ground truth contacts
+Dictionary make_observation(double left_wheel, double left_knee,
+                            int left_points, int right_points) {
+  Dictionary observation;
+  set_observation(observation, left_wheel, left_knee, left_points,
+                  right_points);
+  return observation;
+}
+
+TEST(MeasurementModelBuilderTest, SampleReader) {
+  MeasurementModelBuilder::Parameters params;
+  params.leg_names = {"left", "right"};
+  MeasurementModelBuilder::SampleReader reader(params);
+  std::vector<TorqueSample> samples;
+  reader.read(make_observation(1.0, 2.0, 3, 0), samples);
+  reader.read(make_observation(1.5, 0.5, 0, 1), samples);
+  ASSERT_EQ(samples.size(), 4);
+
+  // Same filters as MeasurementModel::read
+  double wheel = 0.0, knee = 0.0;
+  for (const auto &torques : {std::pair{1.0, 2.0}, std::pair{1.5, 0.5}}) {
+    wheel = low_pass_filter(wheel, 0.025, torques.first, 0.001);
+    knee = low_pass_filter(knee, 0.025, torques.second, 0.001);
+  }
+  ASSERT_NEAR(samples[2].x, wheel, kNearTolerance);
+  ASSERT_NEAR(samples[2].y, knee, kNearTolerance);
+  ASSERT_NEAR(samples[3].x, -wheel, kNearTolerance);
+  ASSERT_NEAR(samples[3].y, -knee, kNearTolerance);
+
+  // Labels of the bodies of each leg
+  ASSERT_TRUE(samples[0].contact);
+  ASSERT_FALSE(samples[1].contact);
+  ASSERT_FALSE(samples[2].contact);
+  ASSERT_TRUE(samples[3].contact);
+
+  // Filters still run without ground truth, but nothing is labeled
+  Dictionary unlabeled = make_observation(0.0, 0.0, 0, 0);
+  unlabeled.remove("sim");
+  reader.read(unlabeled, samples);
+  ASSERT_EQ(samples.size(), 4);
+}
+
+TEST(MeasurementModelBuilderTest, SmoothMatchesDirectConvolution) {
+  constexpr size_t nx = 9, ny = 7;
+  std::vector<double> histogram(nx * ny, 0.0);
+  histogram[4 * ny + 3] = 1.0;
+  histogram[0 * ny + 6] = 2.0;
+  std::vector<double> smoothed = histogram;
+  MeasurementModelBuilder::smooth(smoothed, nx, ny, 1.5, 0.8);
+
+  // Direct convolution with the same truncated kernels
+  auto weight = [](int k, double bandwidth) {
+    const int radius = static_cast<int>(std::ceil(4.0 * bandwidth));
+    double sum = 0.0;
+    for (int l = -radius; l <= radius; ++l) {
+      sum += std::exp(-0.5 * (l / bandwidth) * (l / bandwidth));
+    }
+    return (std::abs(k) <= radius)
+               ? std::exp(-0.5 * (k / bandwidth) * (k / bandwidth)) / sum
+               : 0.0;
+  };
+  for (int i = 0; i < static_cast<int>(nx); ++i) {
+    for (int j = 0; j < static_cast<int>(ny); ++j) {
+      double expected = 0.0;
+      for (int p = 0; p < static_cast<int>(nx); ++p) {
+        for (int q = 0; q < static_cast<int>(ny); ++q) {
+          expected += histogram[p * ny + q] * weight(i - p, 1.5) *
+                      weight(j - q, 0.8);
+        }
+      }
+      ASSERT_NEAR(smoothed[i * ny + j], expected, 1e-12);
+    }
+  }
+}
+
+TEST(MeasurementModelBuilderTest, BuildFromSamples) {
+  MeasurementModelBuilder builder(unit_square_params());
+  ASSERT_THROW(builder.build(), std::runtime_error);
+  builder.add_samples(make_samples(20000, 42));
+  builder.build();
+
+  // Likelihoods are densities close to the generating ones
+  std::unique_ptr<NpzInterpolator> model = builder.interpolator();
+  const double peak = 1.0 / (2.0 * M_PI * kSigma * kSigma);
+  const std::vector<double> contact = model->interpolate({0.3, 0.3});
+  const std::vector<double> no_contact = model->interpolate({0.7, 0.7});
+  ASSERT_NEAR(contact[0], peak, 0.15 * peak);
+  ASSERT_NEAR(no_contact[1], peak, 0.15 * peak);
+  ASSERT_GT(contact[2], 0.99);
+  ASSERT_LT(no_contact[2], 0.01);
+
+  const auto &axes = builder.axis_values();
+  const double cell_area =
+      (axes[0][1] - axes[0][0]) * (axes[1][1] - axes[1][0]);
+  for (size_t v = 0; v < 2; ++v) {
+    double integral = 0.0;
+    for (double likelihood : model->table(v)) {
+      integral += likelihood * cell_area;
+    }
+    ASSERT_NEAR(integral, 1.0, 0.02);
+  }
+}
+
+TEST(MeasurementModelBuilderTest, BandwidthShrinksWithSamples) {
+  std::vector<double> bandwidths;
+  for (size_t num_samples : {400, 40000}) {
+    MeasurementModelBuilder builder(unit_square_params());
+    builder.add_samples(make_samples(num_samples, 7));
+    builder.build();
+    bandwidths.push_back(builder.bandwidths()[0][0]);
+  }
+  ASSERT_GT(bandwidths[0], bandwidths[1]);
+}
+
+TEST(MeasurementModelBuilderTest, FittedGrid) {
+  MeasurementModelBuilder::Parameters params = unit_square_params();
+  params.lower_bounds.clear();
+  params.upper_bounds.clear();
+  MeasurementModelBuilder builder(params);
+  std::vector<TorqueSample> samples = make_samples(2000, 3);
+  samples.push_back(TorqueSample{100.0, -100.0, true});
+  builder.add_samples(samples);
+  builder.build();
+
+  // Quantiles, not the outlier, bound the grid
+  const auto &axes = builder.axis_values();
+  ASSERT_EQ(axes[0].size(), 64);
+  ASSERT_EQ(axes[1].size(), 48);
+  for (const auto &axis : axes) {
+    ASSERT_GT(axis.front(), 0.0);
+    ASSERT_LT(axis.back(), 1.0);
+  }
+}
+
+TEST(MeasurementModelBuilderTest, SaveAndLoad) {
+  MeasurementModelBuilder builder(unit_square_params());
+  builder.add_samples(make_samples(2000, 5));
+  builder.build();
+  const std::string npz_path = testing::TempDir() + "built_model.npz";
+  builder.save(npz_path);
+
+  NpzInterpolator loaded(npz_path, {"wheel_torque", "knee_torque"},
+                         {"contact_likelihood", "no_contact_likelihood",
+                          "P_contact"});
+  ASSERT_TRUE(loaded.has_uniform_grid());
+  std::unique_ptr<NpzInterpolator> built = builder.interpolator();
+  for (double x : {0.1, 0.3, 0.55, 0.9}) {
+    for (double y : {0.2, 0.3, 0.75}) {
+      const std::vector<double> expected = built->interpolate({x, y});
+      const std::vector<double> values = loaded.interpolate({x, y});
+      for (size_t v = 0; v < 3; ++v) {
+        ASSERT_EQ(values[v], expected[v]);
+      }
+    }
+  }
+}
+
+TEST(MeasurementModelBuilderTest, Validation) {
+  MeasurementModelBuilder::Parameters params;
+  params.joint_names = {"wheel"};
+  ASSERT_THROW(MeasurementModelBuilder{params}, std::invalid_argument);
+
+  params = MeasurementModelBuilder::Parameters{};
+  params.lower_bounds = {0.0, 1.0};
+  params.upper_bounds = {1.0, 1.0};
+  ASSERT_THROW(MeasurementModelBuilder{params}, std::invalid_argument);
+
+  params = MeasurementModelBuilder::Parameters{};
+  params.bandwidth_factors = {1.0, 0.0};
+  ASSERT_THROW(MeasurementModelBuilder{params}, std::invalid_argument);
+
+  // Both classes are needed
+  MeasurementModelBuilder builder(unit_square_params());
+  builder.add_samples({TorqueSample{0.5, 0.5, true},
+                       TorqueSample{0.4, 0.5, true},
+                       TorqueSample{0.5, 0.4, true}});
+  ASSERT_THROW(builder.build(), std::runtime_error);
+}
+
+TEST(MeasurementModelBuilderTest, ReadLog) {
+  MeasurementModelBuilder::Parameters params;
+  params.leg_names = {"left", "right"};
+  ASSERT_THROW(MeasurementModelBuilder::read_log(testing::TempDir(), params),
+               std::runtime_error);
+
+  // An empty log has no samples
+  const std::string log_path = testing::TempDir() + "empty_log.mpack";
+  std::ofstream(log_path, std::ios::binary).close();
+  ASSERT_TRUE(MeasurementModelBuilder::read_log(log_path, params).empty());
+
+  // 0xc1 is never used by MessagePack
+  std::ofstream(log_path, std::ios::binary) << '\xc1';
+  ASSERT_THROW(MeasurementModelBuilder::read_log(log_path, params),
+               std::runtime_error);
+
+  // Samples of each logged observation, labeled as by the SampleReader
+  std::ofstream log(log_path, std::ios::binary);
+  Dictionary message;
+  std::vector<char> buffer;
+  set_observation(message("observation"), 1.0, 2.0, 3, 0);
+  size_t size = message.serialize(buffer);
+  log.write(buffer.data(), size);
+  set_observation(message("observation"), 1.5, 0.5, 0, 1);
+  size = message.serialize(buffer);
+  log.write(buffer.data(), size);
+  log.close();
+  const std::vector<TorqueSample> samples =
+      MeasurementModelBuilder::read_log(log_path, params);
+  MeasurementModelBuilder::SampleReader reader(params);
+  std::vector<TorqueSample> expected;
+  reader.read(make_observation(1.0, 2.0, 3, 0), expected);
+  reader.read(make_observation(1.5, 0.5, 0, 1), expected);
+  ASSERT_EQ(samples.size(), 4);
+  for (size_t k = 0; k < samples.size(); ++k) {
+    ASSERT_EQ(samples[k].x, expected[k].x);
+    ASSERT_EQ(samples[k].y, expected[k].y);
+    ASSERT_EQ(samples[k].contact, expected[k].contact);
+  }
+  ASSERT_TRUE(samples[0].contact);
+  ASSERT_FALSE(samples[1].contact);
+  ASSERT_FALSE(samples[2].contact);
+  ASSERT_TRUE(samples[3].contact);
+}
+
+}  // namespace
@@ -1,7 +1,16 @@
 // SPDX-License-Identifier: Apache-2.0
 // Copyright 2024 Inria
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
 #include "gtest/gtest.h"
 #include "observers/MeasurementModel.h"
+#include "observers/data/embedded_measurement_model.h"
 #include "observers/utils.h"
 #include "spdlog/spdlog.h"
 #include "tools/cpp/runfiles/runfiles.h"
@@ -10,6 +19,9 @@ using bazel::tools::cpp::runfiles::Runfiles;
 
 constexpr double kNearTolerance = 1e-8;
 
+//! Path to the test binary, to find model files in its runfiles
+constexpr char kArgv0[] = "observers/tests/MeasurementModelTest";
+
 namespace {
 class MeasurementModelTest : public testing::Test {
  protected:
@@ -17,7 +29,7 @@ class MeasurementModelTest : public testing::Test {
 
   MeasurementModelTest() {
     MeasurementModel::Parameters params;
-    params.argv0 = "observers/tests/MeasurementModelTest";
+    params.resolve_model_path = runfiles_resolver(kArgv0);
     params.model_path = "contact_agent/observers/data/measurement_model.npz";
     measurement_model = std::make_unique<MeasurementModel>(params);
   }
@@ -45,4 +57,290 @@ TEST_F(MeasurementModelTest, TestLikelihoods) {
   ASSERT_NEAR(likelihoods.contact, 0.20144421, kNearTolerance);
   ASSERT_NEAR(likelihoods.no_contact, 0., kNearTolerance);
 }
+
+TEST_F(MeasurementModelTest, TestLogLikelihoodRatio) {
+  // Grid points are interpolated exactly, in linear or log domain
+  auto likelihoods = measurement_model->query_likelihoods({-10.0, -10.0});
+  ASSERT_NEAR(likelihoods.log_ratio,
+              std::log(std::max(likelihoods.contact, kMinLikelihood)) -
+                  std::log(std::max(likelihoods.no_contact, kMinLikelihood)),
+              kNearTolerance);
+
+  // The no-contact likelihood vanishes, but the log-ratio stays finite
+  likelihoods = measurement_model->query_likelihoods({0.3, 0.2});
+  ASSERT_TRUE(std::isfinite(likelihoods.log_ratio));
+  ASSERT_GT(likelihoods.log_ratio, 0.0);
+
+  Dictionary observation;
+  observation("servo")("left_wheel")("torque") = 0.0;
+  observation("servo")("left_knee")("torque") = 0.0;
+  measurement_model->read(observation);
+  measurement_model->write(observation);
+  ASSERT_TRUE(observation("measurement_model").has("log_likelihood_ratio"));
+}
+
+TEST_F(MeasurementModelTest, TestCompiledModel) {
+  // Compiled by //observers/data:compiled_contact_models, with a precomputed
+  // log-likelihood ratio
+  MeasurementModel::Parameters params;
+  params.resolve_model_path = runfiles_resolver(kArgv0);
+  params.model_path = "contact_agent/observers/data/measurement_model.cmodel";
+  MeasurementModel compiled_model(params);
+  for (const std::vector<double> &point : std::vector<std::vector<double>>{
+           {0.0, 0.0}, {0.025, 0.0}, {0.3, 0.2}, {-10.0, 10.0}}) {
+    const auto expected = measurement_model->query_likelihoods(point);
+    const auto likelihoods = compiled_model.query_likelihoods(point);
+    ASSERT_EQ(likelihoods.contact, expected.contact);
+    ASSERT_EQ(likelihoods.no_contact, expected.no_contact);
+    ASSERT_EQ(likelihoods.log_ratio, expected.log_ratio);
+  }
+}
+
+TEST_F(MeasurementModelTest, TestEmbeddedModel) {
+  // Embedded by //observers/data:embedded_measurement_model, the path is
+  // never looked up
+  MeasurementModel::Parameters params;
+  params.model_path = "missing.npz";
+  params.model_file = ModelFile::embedded(embedded_measurement_model());
+  MeasurementModel embedded_model(params);
+  for (const std::vector<double> &point : std::vector<std::vector<double>>{
+           {0.0, 0.0}, {0.025, 0.0}, {0.3, 0.2}, {-10.0, 10.0}}) {
+    const auto expected = measurement_model->query_likelihoods(point);
+    const auto likelihoods = embedded_model.query_likelihoods(point);
+    ASSERT_EQ(likelihoods.contact, expected.contact);
+    ASSERT_EQ(likelihoods.no_contact, expected.no_contact);
+    ASSERT_EQ(likelihoods.log_ratio, expected.log_ratio);
+  }
+
+  // Other models are loaded from a path, which needs to be resolved
+  params.model_file = nullptr;
+  ASSERT_THROW(MeasurementModel{params}, std::invalid_argument);
+}
+
+TEST_F(MeasurementModelTest, TestOnlineAdaptation) {
+  MeasurementModel::Parameters params;
+  params.resolve_model_path = runfiles_resolver(kArgv0);
+  params.model_path = "contact_agent/observers/data/measurement_model.npz";
+  params.online_adaptation = true;
+  params.online_kde.update_period = 0.0;
+  MeasurementModel adaptive_model(params);
+  ASSERT_NE(adaptive_model.online_kde(), nullptr);
+
+  // Torques seen in contact raise the contact likelihood
+  const std::vector<double> point = {0.1, 0.3};
+  const auto prior = adaptive_model.query_likelihoods(point);
+  Dictionary observation;
+  observation("servo")("left_wheel")("torque") = point[0];
+  observation("servo")("left_knee")("torque") = point[1];
+  observation("contact_filter")("p_contact") = 1.0;
+  for (int tick = 0; tick < 10000; ++tick) {
+    adaptive_model.read(observation);
+    adaptive_model.write(observation);
+  }
+  adaptive_model.online_kde()->update();
+  const auto adapted = adaptive_model.query_likelihoods(point);
+  ASSERT_GT(adapted.contact, prior.contact);
+  ASSERT_GT(adapted.log_ratio, prior.log_ratio);
+
+  // Ticks read the new tables, at filtered torques close to the point
+  adaptive_model.read(observation);
+  ASSERT_NEAR(adaptive_model.leg_likelihoods(0).contact, adapted.contact,
+              1e-6 * adapted.contact);
+}
+
+TEST_F(MeasurementModelTest, TestQueryThread) {
+  // Queries before the first tick may come from any thread
+  bool other_thread_throws = false;
+  auto query_from_other_thread = [&]() {
+    std::thread thread([&]() {
+      try {
+        measurement_model->query_likelihoods({0.0, 0.0});
+        other_thread_throws = false;
+      } catch (const std::logic_error &) {
+        other_thread_throws = true;
+      }
+    });
+    thread.join();
+  };
+  query_from_other_thread();
+  ASSERT_FALSE(other_thread_throws);
+
+  // Afterwards, queries share the tables of the thread that runs ticks
+  Dictionary observation;
+  observation("servo")("left_wheel")("torque") = 0.0;
+  observation("servo")("left_knee")("torque") = 0.0;
+  measurement_model->read(observation);
+  ASSERT_NO_THROW(measurement_model->query_likelihoods({0.0, 0.0}));
+  query_from_other_thread();
+  ASSERT_TRUE(other_thread_throws);
+}
+
+TEST_F(MeasurementModelTest, TestHotReload) {
+  // Watch a copy of the model
+  const std::string model_path = testing::TempDir() + "hot_reload_model.npz";
+  std::filesystem::copy_file(
+      find_model_path(kArgv0,
+                      "contact_agent/observers/data/measurement_model.npz"),
+      model_path, std::filesystem::copy_options::overwrite_existing);
+  MeasurementModel::Parameters params;
+  params.resolve_model_path = runfiles_resolver(kArgv0);
+  params.model_path = model_path;
+  params.hot_reload = true;
+  params.reload_period = 0.001;
+  MeasurementModel reloading_model(params);
+  ModelReloader *reloader = reloading_model.reloader();
+  ASSERT_NE(reloader, nullptr);
+
+  auto wait_for_loads = [reloader](size_t num_loads) {
+    for (int k = 0; k < 5000 && reloader->num_loads() < num_loads; ++k) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return reloader->num_loads();
+  };
+
+  // Replace the file as a whole, then the next tick reads the new tables
+  const std::string simulation_model_path =
+      "contact_agent/observers/data/simulation_measurement_model.npz";
+  const std::string temporary_path = model_path + ".tmp";
+  std::filesystem::copy_file(
+      find_model_path(kArgv0, simulation_model_path), temporary_path,
+      std::filesystem::copy_options::overwrite_existing);
+  std::filesystem::rename(temporary_path, model_path);
+  ASSERT_EQ(wait_for_loads(1), 1);
+  const std::vector<double> point = {0.3, 0.2};
+  ASSERT_NEAR(reloading_model.query_likelihoods(point).contact,
+              measurement_model->query_likelihoods(point).contact,
+              kNearTolerance);
+  Dictionary observation;
+  observation("servo")("left_wheel")("torque") = 0.0;
+  observation("servo")("left_knee")("torque") = 0.0;
+  reloading_model.read(observation);
+  ASSERT_EQ(reloader->num_swaps(), 1);
+
+  params.model_path = simulation_model_path;
+  params.hot_reload = false;
+  MeasurementModel simulation_model(params);
+  const auto expected = simulation_model.query_likelihoods(point);
+  const auto reloaded = reloading_model.query_likelihoods(point);
+  ASSERT_EQ(reloaded.contact, expected.contact);
+  ASSERT_EQ(reloaded.no_contact, expected.no_contact);
+  ASSERT_EQ(reloaded.log_ratio, expected.log_ratio);
+
+  // Reload another model on request, as sent by the agent
+  Dictionary config;
+  config("measurement_model")("model_path") =
+      std::string("contact_agent/observers/data/measurement_model.npz");
+  reloading_model.reset(config);
+  ASSERT_EQ(wait_for_loads(2), 2);
+  reloading_model.read(observation);
+  ASSERT_EQ(reloader->num_swaps(), 2);
+  ASSERT_EQ(reloading_model.query_likelihoods(point).contact,
+            measurement_model->query_likelihoods(point).contact);
+
+  // Reloaded tables would be adapted from stale priors
+  params.hot_reload = true;
+  params.online_adaptation = true;
+  ASSERT_THROW(MeasurementModel{params}, std::invalid_argument);
+}
+
+TEST_F(MeasurementModelTest, TestUnresolvedReload) {
+  const auto resolver = runfiles_resolver(kArgv0);
+  MeasurementModel::Parameters params;
+  params.resolve_model_path = [resolver](const std::string &path) {
+    if (path.empty()) {
+      throw std::runtime_error("Empty model path");
+    }
+    return resolver(path);
+  };
+  params.model_path = "contact_agent/observers/data/measurement_model.npz";
+  params.hot_reload = true;
+  params.reload_period = 0.0;
+  MeasurementModel reloading_model(params);
+
+  // Paths that cannot be resolved are logged, and the current model kept
+  Dictionary config;
+  config("measurement_model")("model_path") = std::string("");
+  ASSERT_NO_THROW(reloading_model.reset(config));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_EQ(reloading_model.reloader()->num_loads(), 0);
+}
+
+TEST_F(MeasurementModelTest, TestQuantizedTables) {
+  MeasurementModel::Parameters params;
+  params.resolve_model_path = runfiles_resolver(kArgv0);
+  params.model_path = "contact_agent/observers/data/measurement_model.npz";
+  params.table_precision = TablePrecision::kLogUint16;
+  MeasurementModel quantized_model(params);
+
+  // Log-quantized likelihoods keep a small relative error
+  for (const std::vector<double> &point : std::vector<std::vector<double>>{
+           {0.0, 0.0}, {0.025, 0.0}, {0.0, 0.025}, {0.3, 0.2}}) {
+    const auto expected = measurement_model->query_likelihoods(point);
+    const auto likelihoods = quantized_model.query_likelihoods(point);
+    ASSERT_NEAR(likelihoods.contact, expected.contact,
+                1e-3 * expected.contact + 1e-10);
+    ASSERT_NEAR(likelihoods.no_contact, expected.no_contact,
+                1e-3 * expected.no_contact + 1e-10);
+    ASSERT_NEAR(likelihoods.log_ratio, expected.log_ratio, 1e-2);
+  }
+}
+
+TEST_F(MeasurementModelTest, TestDualLeg) {
+  MeasurementModel::Parameters params;
+  params.resolve_model_path = runfiles_resolver(kArgv0);
+  params.model_path = "contact_agent/observers/data/measurement_model.npz";
+  params.leg_names = {"left", "right"};
+  MeasurementModel dual_leg_model(params);
+  ASSERT_EQ(dual_leg_model.num_legs(), 2);
+  ASSERT_EQ(measurement_model->num_legs(), 1);
+
+  Dictionary observation;
+  Dictionary dual_leg_observation;
+  for (int i = 0; i < 200; ++i) {
+    const double t = 1e-3 * i;
+    const double left_wheel = 0.1 * std::sin(10.0 * t);
+    const double left_knee = 0.05 * std::cos(7.0 * t);
+    observation("servo")("left_wheel")("torque") = left_wheel;
+    observation("servo")("left_knee")("torque") = left_knee;
+    dual_leg_observation("servo")("left_wheel")("torque") = left_wheel;
+    dual_leg_observation("servo")("left_knee")("torque") = left_knee;
+    dual_leg_observation("servo")("right_wheel")("torque") = -left_wheel;
+    dual_leg_observation("servo")("right_knee")("torque") = 0.3;
+
+    measurement_model->read(observation);
+    measurement_model->write(observation);
+    dual_leg_model.read(dual_leg_observation);
+    dual_leg_model.write(dual_leg_observation);
+
+    // The first leg matches the single-leg model, and is also written at the
+    // top level
+    const auto &left = dual_leg_model.leg_likelihoods(0);
+    const auto &expected = measurement_model->leg_likelihoods(0);
+    ASSERT_NEAR(left.contact, expected.contact, kNearTolerance);
+    ASSERT_NEAR(left.no_contact, expected.no_contact, kNearTolerance);
+    ASSERT_NEAR(left.log_ratio, expected.log_ratio, kNearTolerance);
+    ASSERT_EQ(dual_leg_observation("measurement_model")("contact_likelihood")
+                  .as<double>(),
+              left.contact);
+    ASSERT_EQ(dual_leg_observation("measurement_model")("left")(
+                  "contact_likelihood")
+                  .as<double>(),
+              left.contact);
+  }
+
+  // The second leg is interpolated at its own filtered torques
+  const auto &right = dual_leg_model.leg_likelihoods(1);
+  const double right_wheel =
+      dual_leg_observation("measurement_model")("right_wheel")("torque");
+  const double right_knee =
+      dual_leg_observation("measurement_model")("right_knee")("torque");
+  const auto expected =
+      dual_leg_model.query_likelihoods({right_wheel, right_knee});
+  ASSERT_NEAR(right.contact, expected.contact, kNearTolerance);
+  ASSERT_NEAR(right.no_contact, expected.no_contact, kNearTolerance);
+  ASSERT_EQ(dual_leg_observation("measurement_model")("right")(
+                "no_contact_likelihood")
+                .as<double>(),
+            right.no_contact);
+}
 }  // namespace
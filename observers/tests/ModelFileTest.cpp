@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "observers/ModelFile.h"
+#include "observers/NpzInterpolator.h"
+#include "observers/utils.h"
+
+constexpr double kNearTolerance = 1e-8;
+
+namespace {
+
+class ModelFileTest : public testing::Test {
+ protected:
+  std::unique_ptr<NpzInterpolator> interpolator;
+  std::string model_path;
+
+  ModelFileTest()
+      : model_path(testing::TempDir() + "coordinate_grid" +
+                   kModelFileExtension) {
+    std::string npz_path = find_model_path(
+        "observers/tests/ModelFileTest",
+        "contact_agent/observers/tests/data/coordinate_grid.npz");
+    interpolator = std::make_unique<NpzInterpolator>(
+        npz_path, std::vector<std::string>{"x_axis", "y_axis"},
+        std::vector<std::string>{"X", "Y"});
+  }
+
+  //! Read the compiled model into memory aligned for doubles
+  std::vector<double> read_model(size_t *size) const {
+    std::ifstream file(model_path, std::ios::binary);
+    const std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+    std::vector<double> buffer((bytes.size() + 7) / 8);
+    std::memcpy(buffer.data(), bytes.data(), bytes.size());
+    *size = bytes.size();
+    return buffer;
+  }
+};
+
+TEST_F(ModelFileTest, RoundTrip) {
+  interpolator->save(model_path);
+  auto model_file = ModelFile::map(model_path);
+  ASSERT_EQ(model_file->num_axes(), 2);
+  ASSERT_EQ(model_file->num_values(), 2);
+  ASSERT_EQ(model_file->num_nodes(), 200 * 200);
+  ASSERT_EQ(model_file->axis_key(1), "y_axis");
+  ASSERT_EQ(model_file->value_key(0), "X");
+  ASSERT_EQ(model_file->axis(0)[199], 199.0);
+
+  // Arrays are read in place and aligned
+  const uintptr_t nodes = reinterpret_cast<uintptr_t>(model_file->nodes());
+  ASSERT_EQ(nodes % kModelFileAlignment, 0);
+
+  NpzInterpolator compiled(model_file, {"x_axis", "y_axis"}, {"X", "Y"});
+  ASSERT_TRUE(compiled.has_uniform_grid());
+  ASSERT_EQ(compiled.value_keys, interpolator->value_keys);
+  double values[2], expected_values[2];
+  for (const std::vector<double> &point :
+       std::vector<std::vector<double>>{{1, 190.7}, {-5, 300}, {12.3, 45.6}}) {
+    compiled.interpolate(point, values);
+    interpolator->interpolate(point, expected_values);
+    ASSERT_EQ(values[0], expected_values[0]);
+    ASSERT_EQ(values[1], expected_values[1]);
+  }
+
+  // Btwxt is only built on first use
+  ASSERT_TRUE(compiled.datasets.empty());
+  const std::vector<double> interpolated_values = compiled({1, 190.7});
+  ASSERT_EQ(compiled.datasets.size(), 2);
+  ASSERT_NEAR(interpolated_values[1], 290.7, kNearTolerance);
+}
+
+TEST_F(ModelFileTest, PathWithExtension) {
+  interpolator->add_log_ratio_table("log_X_Y", 0, 1);
+  interpolator->save(model_path);
+
+  // Further values of the model are appended to the requested ones
+  NpzInterpolator compiled(model_path, {"x_axis", "y_axis"}, {"X"});
+  ASSERT_EQ(compiled.value_keys,
+            (std::vector<std::string>{"X", "Y", "log_X_Y"}));
+  double values[3];
+  compiled.interpolate({12, 34}, values);
+  ASSERT_NEAR(values[2], std::log(12.0 / 134.0), kNearTolerance);
+
+  // Keys should match those of the model
+  ASSERT_THROW(NpzInterpolator(model_path, {"y_axis", "x_axis"}, {"X"}),
+               std::runtime_error);
+  ASSERT_THROW(NpzInterpolator(model_path, {"x_axis", "y_axis"}, {"Y"}),
+               std::runtime_error);
+  ASSERT_THROW(NpzInterpolator(model_path, {"x_axis"}, {"X"}),
+               std::runtime_error);
+}
+
+TEST_F(ModelFileTest, Validation) {
+  interpolator->save(model_path);
+  size_t size = 0;
+  std::vector<double> buffer = read_model(&size);
+  ASSERT_NO_THROW(ModelFile(buffer.data(), size));
+
+  // Truncated model
+  ASSERT_THROW(ModelFile(buffer.data(), size - sizeof(double)),
+               std::runtime_error);
+
+  // Corrupted table, only detected by the checksum
+  std::vector<double> corrupted = buffer;
+  corrupted.back() += 1.0;
+  ASSERT_THROW(ModelFile(corrupted.data(), size), std::runtime_error);
+  ASSERT_NO_THROW(ModelFile(corrupted.data(), size, false));
+
+  // Other version
+  std::vector<double> other_version = buffer;
+  reinterpret_cast<ModelFileHeader *>(other_version.data())->version += 1;
+  ASSERT_THROW(ModelFile(other_version.data(), size, false),
+               std::runtime_error);
+
+  // Not a compiled model
+  ASSERT_THROW(ModelFile::map(model_path + ".missing"), std::runtime_error);
+}
+
+TEST_F(ModelFileTest, NodeCountOverflow) {
+  // 64 axes of two points, all sharing the same array, have 2^64 nodes,
+  // which would wrap around to an empty node array at the end of the model
+  constexpr size_t kNumAxes = 64;
+  const size_t axes_offset =
+      sizeof(ModelFileHeader) + (kNumAxes + 1) * sizeof(ModelFileArray);
+  const size_t size = axes_offset + kModelFileAlignment;
+  std::vector<double> buffer(size / sizeof(double), 0.0);
+  auto *header = reinterpret_cast<ModelFileHeader *>(buffer.data());
+  std::memcpy(header->magic, kModelFileMagic, sizeof(kModelFileMagic));
+  header->version = kModelFileVersion;
+  header->byte_order = kModelFileByteOrder;
+  header->num_axes = kNumAxes;
+  header->num_values = 1;
+  header->file_size = size;
+  header->nodes_offset = size;
+  auto *arrays = reinterpret_cast<ModelFileArray *>(header + 1);
+  for (size_t axis = 0; axis < kNumAxes; ++axis) {
+    arrays[axis].offset = axes_offset;
+    arrays[axis].size = 2;
+  }
+  arrays[kNumAxes].offset = size;
+  arrays[kNumAxes].size = 0;
+  ASSERT_THROW(ModelFile(buffer.data(), size, false), std::runtime_error);
+}
+
+TEST_F(ModelFileTest, LongKeys) {
+  interpolator->add_log_table(std::string(kMaxModelKeyLength + 1, 'k'), 1);
+  ASSERT_THROW(interpolator->save(model_path), std::invalid_argument);
+}
+
+}  // namespace
@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: Apache-2.0
 // Copyright 2024 Inria
 
+#include <cmath>
+
 #include "observers/NpzInterpolator.h"
 #include "observers/utils.h"
 #include "spdlog/spdlog.h"
@@ -135,4 +137,47 @@ TEST_F(NpzInterpolatorTest, TestInterpolationOutsideGrid) {
   ASSERT_NEAR(interpolated_values[0], 199, kNearTolerance);
   ASSERT_NEAR(interpolated_values[1], 299, kNearTolerance);
 }
+
+TEST_F(NpzInterpolatorTest, TestInterpolationIntoBuffer) {
+  // The allocation-free interpolation should match Btwxt, inside and outside
+  // the grid
+  std::vector<std::vector<double>> points = {
+      {1, 190.7}, {0, 0}, {199, 199}, {37.25, 0.5}, {-100, 42.1}, {250, 400}};
+  double values[2];
+  for (const auto &point : points) {
+    std::vector<double> expected_values = (*interpolator)(point);
+    interpolator->interpolate(point, values);
+    ASSERT_NEAR(values[0], expected_values[0], kNearTolerance);
+    ASSERT_NEAR(values[1], expected_values[1], kNearTolerance);
+  }
+
+  // Points should have one coordinate per axis
+  ASSERT_THROW(interpolator->interpolate({1.0}, values), std::invalid_argument);
+}
+
+TEST_F(NpzInterpolatorTest, TestLogTables) {
+  // Values are X = x and Y = 100 + y, X vanishes on the first row
+  const size_t log_index = interpolator->add_log_table("log_Y", 1);
+  const size_t ratio_index = interpolator->add_log_ratio_table("log_X_Y", 0, 1);
+  ASSERT_EQ(log_index, 2);
+  ASSERT_EQ(ratio_index, 3);
+  ASSERT_EQ(interpolator->num_values(), 4);
+  ASSERT_EQ(interpolator->value_keys.back(), "log_X_Y");
+
+  double values[4];
+  interpolator->interpolate({12, 34}, values);
+  ASSERT_NEAR(values[log_index], std::log(134.0), kNearTolerance);
+  ASSERT_NEAR(values[ratio_index], std::log(12.0 / 134.0), kNearTolerance);
+
+  // Zero likelihoods are floored
+  interpolator->interpolate({0, 34}, values);
+  ASSERT_NEAR(values[ratio_index], std::log(kMinLikelihood / 134.0),
+              kNearTolerance);
+
+  // The vector-returning interpolation also includes the new tables
+  std::vector<double> interpolated_values = (*interpolator)({12, 34});
+  ASSERT_EQ(interpolated_values.size(), 4);
+  ASSERT_NEAR(interpolated_values[ratio_index], std::log(12.0 / 134.0),
+              kNearTolerance);
+}
 } // namespace
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "observers/NpzInterpolator.h"
+#include "observers/OnlineKde.h"
+
+constexpr double kNearTolerance = 1e-8;
+
+namespace {
+
+class OnlineKdeTest : public testing::Test {
+ protected:
+  std::unique_ptr<NpzInterpolator> prior;
+  size_t log_ratio_index;
+
+  //! Uniform likelihoods on the unit square, with a log-likelihood ratio
+  OnlineKdeTest() {
+    std::vector<double> axis;
+    for (int k = 0; k <= 20; ++k) {
+      axis.push_back(0.05 * k);
+    }
+    const std::vector<double> uniform(axis.size() * axis.size(), 1.0);
+    prior = std::make_unique<NpzInterpolator>(
+        std::vector<std::string>{"wheel_torque", "knee_torque"},
+        std::vector<std::vector<double>>{axis, axis},
+        std::vector<std::string>{"contact_likelihood", "no_contact_likelihood"},
+        std::vector<std::vector<double>>{uniform, uniform});
+    log_ratio_index = prior->add_log_ratio_table("log_likelihood_ratio", 0, 1);
+  }
+
+  //! Likelihoods of the latest tables at a point
+  static std::vector<double> query(OnlineKde &online_kde, double x, double y) {
+    std::vector<double> values(3);
+    online_kde.acquire()->interpolate({x, y}, values.data());
+    return values;
+  }
+};
+
+TEST_F(OnlineKdeTest, AdaptsToSamples) {
+  OnlineKde::Parameters params;
+  params.update_period = 0.0;
+  params.prior_weight = 100.0;
+  OnlineKde online_kde(*prior, log_ratio_index, params);
+  ASSERT_EQ(online_kde.acquire(), nullptr);
+
+  // Contact around one point, no contact around another one
+  const auto add_samples = [](OnlineKde &kde) {
+    for (int k = 0; k < 1000; ++k) {
+      kde.add_sample(0.25, 0.25, 1.0);
+      kde.add_sample(0.75, 0.75, 0.0);
+    }
+  };
+  add_samples(online_kde);
+  online_kde.update();
+  ASSERT_EQ(online_kde.num_updates(), 1);
+
+  const std::vector<double> contact_point = query(online_kde, 0.25, 0.25);
+  const std::vector<double> no_contact_point = query(online_kde, 0.75, 0.75);
+  ASSERT_GT(contact_point[0], 1.0);
+  ASSERT_LT(contact_point[1], 1.0);
+  ASSERT_LT(no_contact_point[0], 1.0);
+  ASSERT_GT(no_contact_point[1], 1.0);
+  for (const auto &values : {contact_point, no_contact_point}) {
+    ASSERT_NEAR(values[2], std::log(values[0] / values[1]), kNearTolerance);
+  }
+  ASSERT_GT(contact_point[2], 0.0);
+  ASSERT_LT(no_contact_point[2], 0.0);
+
+  // Samples outside of the grid are ignored
+  OnlineKde outside_kde(*prior, log_ratio_index, params);
+  add_samples(outside_kde);
+  outside_kde.add_sample(-1.0, 0.5, 1.0);
+  outside_kde.add_sample(0.5, 2.0, 1.0);
+  outside_kde.add_sample(1.5, -0.5, 0.0);
+  outside_kde.update();
+  for (const double x : {0.0, 0.25, 0.5, 0.75, 1.0}) {
+    for (const double y : {0.0, 0.25, 0.5, 0.75, 1.0}) {
+      ASSERT_EQ(query(outside_kde, x, y), query(online_kde, x, y));
+    }
+  }
+}
+
+TEST_F(OnlineKdeTest, ForgetsOldSamples) {
+  OnlineKde::Parameters params;
+  params.update_period = 0.0;
+  params.half_life = 1.0;
+  params.prior_weight = 100.0;
+  OnlineKde online_kde(*prior, log_ratio_index, params);
+  for (int k = 0; k < 1000; ++k) {
+    online_kde.add_sample(0.25, 0.25, 1.0);
+  }
+  online_kde.update();
+  const double adapted = query(online_kde, 0.25, 0.25)[0];
+
+  // Weights halve at each update, tables go back to the prior
+  for (int k = 0; k < 30; ++k) {
+    online_kde.update();
+  }
+  const double forgotten = query(online_kde, 0.25, 0.25)[0];
+  ASSERT_LT(forgotten, adapted);
+  ASSERT_NEAR(forgotten, 1.0, 1e-3);
+}
+
+TEST_F(OnlineKdeTest, BackgroundThread) {
+  OnlineKde::Parameters params;
+  params.update_period = 0.001;
+  OnlineKde online_kde(*prior, log_ratio_index, params);
+  for (int k = 0; k < 1000 && online_kde.num_updates() < 3; ++k) {
+    online_kde.add_sample(0.5, 0.5, 0.9);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (online_kde.acquire() != nullptr) {
+      ASSERT_GT(query(online_kde, 0.5, 0.5)[0], 0.0);
+    }
+  }
+  ASSERT_GE(online_kde.num_updates(), 3);
+}
+
+TEST_F(OnlineKdeTest, PublishedPrecision) {
+  OnlineKde::Parameters params;
+  params.update_period = 0.0;
+  params.prior_weight = 100.0;
+  OnlineKde online_kde(*prior, log_ratio_index, params);
+  params.table_precision = TablePrecision::kFloat32;
+  OnlineKde quantized_kde(*prior, log_ratio_index, params);
+  for (int k = 0; k < 1000; ++k) {
+    online_kde.add_sample(0.25, 0.25, 1.0);
+    quantized_kde.add_sample(0.25, 0.25, 1.0);
+  }
+  online_kde.update();
+  quantized_kde.update();
+
+  // Published tables are quantized, as loaded ones would be
+  const auto &errors = online_kde.acquire()->quantization_errors;
+  const auto &quantized_errors = quantized_kde.acquire()->quantization_errors;
+  ASSERT_EQ(*std::max_element(errors.begin(), errors.end()), 0.0);
+  ASSERT_GT(
+      *std::max_element(quantized_errors.begin(), quantized_errors.end()),
+      0.0);
+  const std::vector<double> expected = query(online_kde, 0.3, 0.2);
+  const std::vector<double> values = query(quantized_kde, 0.3, 0.2);
+  for (size_t v = 0; v < values.size(); ++v) {
+    ASSERT_NEAR(values[v], expected[v], 1e-6 * std::abs(expected[v]) + 1e-6);
+  }
+}
+
+TEST_F(OnlineKdeTest, Validation) {
+  OnlineKde::Parameters params;
+  params.prior_weight = 0.0;
+  ASSERT_THROW(OnlineKde(*prior, log_ratio_index, params),
+               std::invalid_argument);
+
+  // KDE grids are uniform
+  NpzInterpolator warped({"wheel_torque", "knee_torque"},
+                         {{0.0, 0.1, 1.0}, {0.0, 1.0}},
+                         {"contact_likelihood", "no_contact_likelihood"},
+                         {std::vector<double>(6, 1.0),
+                          std::vector<double>(6, 1.0)});
+  ASSERT_THROW(OnlineKde(warped, 0, OnlineKde::Parameters{}),
+               std::invalid_argument);
+}
+
+}  // namespace
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#pragma once
+
+#include <stdlib.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "observers/NpzInterpolator.h"
+
+//! Random point covering the grid of some axes and some margin around it
+inline std::vector<double> random_point(
+    const std::vector<std::vector<double>> &axes, unsigned int *seed) {
+  std::vector<double> point(axes.size());
+  for (size_t d = 0; d < axes.size(); ++d) {
+    const double lower = axes[d].front();
+    const double upper = axes[d].back();
+    const double margin = 0.1 * (upper - lower);
+    const double r = static_cast<double>(rand_r(seed)) / RAND_MAX;
+    point[d] = lower - margin + r * (upper - lower + 2 * margin);
+  }
+  return point;
+}
+
+/*! Time random queries through Btwxt and through the grid of an
+ * interpolator, and check that both return the same first values.
+ *
+ * \param[in] interpolator Interpolator to benchmark.
+ * \param[in] grid_name Name of the grid in the printed times, e.g. "4-D".
+ */
+inline void benchmark_queries(NpzInterpolator &interpolator,
+                              const std::string &grid_name) {
+  unsigned int seed = 42;
+  std::vector<std::vector<double>> points;
+  for (int trial = 0; trial < 100000; ++trial) {
+    points.push_back(random_point(interpolator.axis_values, &seed));
+  }
+
+  // Accumulate results so that queries are not optimized away
+  double btwxt_sum{}, uniform_sum{};
+  auto start_time = std::chrono::high_resolution_clock::now();
+  for (const auto &point : points) {
+    btwxt_sum += interpolator(point)[0];
+  }
+  const auto btwxt_time =
+      std::chrono::high_resolution_clock::now() - start_time;
+
+  std::vector<double> values(interpolator.num_values());
+  start_time = std::chrono::high_resolution_clock::now();
+  for (const auto &point : points) {
+    interpolator.interpolate(point, values.data());
+    uniform_sum += values[0];
+  }
+  const auto uniform_time =
+      std::chrono::high_resolution_clock::now() - start_time;
+
+  const double btwxt_ns =
+      std::chrono::duration<double, std::nano>(btwxt_time).count() /
+      points.size();
+  const double uniform_ns =
+      std::chrono::duration<double, std::nano>(uniform_time).count() /
+      points.size();
+  std::cout << "Btwxt " << grid_name << " query time ns: " << btwxt_ns
+            << std::endl;
+  std::cout << "Uniform " << grid_name << " grid query time ns: " << uniform_ns
+            << std::endl;
+  std::cout << "Speedup: " << btwxt_ns / uniform_ns << std::endl;
+  ASSERT_NEAR(uniform_sum, btwxt_sum, 1e-6 * std::abs(btwxt_sum));
+}
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#include <stdlib.h>
+
+#include "gtest/gtest.h"
+#include "observers/RingWindow.h"
+
+constexpr double kNearTolerance = 1e-10;
+
+namespace {
+
+TEST(RingWindowTest, InitiallyZero) {
+  RingWindow window(8);
+  ASSERT_EQ(window.size(), 8);
+  for (size_t i = 0; i < window.size(); ++i) {
+    ASSERT_EQ(window[i], 0.0);
+  }
+  ASSERT_EQ(window.sum(), 0.0);
+  ASSERT_EQ(window.power(), 0.0);
+}
+
+TEST(RingWindowTest, ContiguousOrder) {
+  RingWindow window(4);
+  for (int i = 1; i <= 6; ++i) {
+    window.push(i);
+  }
+
+  // The window holds the last four samples, oldest first
+  const double *samples = window.data();
+  for (size_t i = 0; i < window.size(); ++i) {
+    ASSERT_EQ(samples[i], 3.0 + i);
+  }
+  ASSERT_EQ(window.oldest(), 3.0);
+  ASSERT_EQ(window.newest(), 6.0);
+  ASSERT_NEAR(window.mean(), 4.5, kNearTolerance);
+  ASSERT_NEAR(window.power(), (9.0 + 16.0 + 25.0 + 36.0) / 4, kNearTolerance);
+}
+
+TEST(RingWindowTest, NoDriftOverLongRuns) {
+  // One hour of samples at 1 kHz, with a large offset so that naive running
+  // sums would lose low-order bits at every subtraction
+  constexpr size_t kWindowSize = 128;
+  constexpr size_t kNumSamples = 3600 * 1000;
+  RingWindow window(kWindowSize);
+  unsigned int seed = 42;
+  for (size_t i = 0; i < kNumSamples; ++i) {
+    window.push(1e3 + (static_cast<double>(rand_r(&seed)) / RAND_MAX) * 20.0);
+  }
+
+  double sum = 0.0, sum_of_squares = 0.0;
+  for (size_t i = 0; i < kWindowSize; ++i) {
+    sum += window[i];
+    sum_of_squares += window[i] * window[i];
+  }
+  ASSERT_NEAR(window.sum(), sum, 1e-12 * sum);
+  ASSERT_NEAR(window.sum_of_squares(), sum_of_squares, 1e-12 * sum_of_squares);
+}
+
+}  // namespace
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#include <stdlib.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "observers/SpectralStatistics.h"
+#include "observers/TransitionModel.h"
+
+constexpr double kNearTolerance = 1e-12;
+
+namespace {
+
+std::vector<kiss_fft_cpx> random_bins(size_t num_bins, unsigned int *seed) {
+  std::vector<kiss_fft_cpx> bins(num_bins);
+  for (auto &bin : bins) {
+    bin.r = (static_cast<double>(rand_r(seed)) / RAND_MAX) * 200.0 - 100.0;
+    bin.i = (static_cast<double>(rand_r(seed)) / RAND_MAX) * 200.0 - 100.0;
+  }
+  return bins;
+}
+
+TEST(SpectralStatisticsTest, FusedPassMatchesScalar) {
+  unsigned int seed = 42;
+  const size_t num_bins = 64;
+  const auto bins = random_bins(num_bins, &seed);
+  const std::vector<double> freqs = output_frequencies(0.001, 2 * num_bins);
+
+  std::vector<double> re(num_bins), im(num_bins);
+  for (size_t i = 0; i < num_bins; ++i) {
+    re[i] = bins[i].r;
+    im[i] = bins[i].i;
+  }
+
+  std::vector<double> mags(num_bins), cumulative_mags(num_bins);
+  std::vector<double> scalar_mags(num_bins), scalar_cumulative_mags(num_bins);
+  const double weighted_sum =
+      fused_spectral_pass(re.data(), im.data(), freqs.data(), num_bins,
+                          mags.data(), cumulative_mags.data());
+  const double scalar_weighted_sum = fused_spectral_pass_scalar(
+      re.data(), im.data(), freqs.data(), num_bins, scalar_mags.data(),
+      scalar_cumulative_mags.data());
+
+  // Sums are accumulated in a different order, hence the relative tolerance
+  ASSERT_NEAR(weighted_sum, scalar_weighted_sum,
+              kNearTolerance * scalar_weighted_sum);
+  for (size_t i = 0; i < num_bins; ++i) {
+    ASSERT_NEAR(mags[i], scalar_mags[i], kNearTolerance * scalar_mags[i]);
+    ASSERT_NEAR(cumulative_mags[i], scalar_cumulative_mags[i],
+                kNearTolerance * scalar_cumulative_mags[i]);
+  }
+}
+
+TEST(SpectralStatisticsTest, MatchesReferenceFunctions) {
+  unsigned int seed = 42;
+
+  // Sizes that are not multiples of the number of lanes exercise the padding
+  for (size_t num_bins : {1, 5, 63, 64, 512}) {
+    const std::vector<double> freqs = output_frequencies(0.001, 2 * num_bins);
+    SpectralStatistics statistics(freqs);
+    ASSERT_EQ(statistics.num_bins(), num_bins);
+
+    for (int trial = 0; trial < 16; ++trial) {
+      const auto bins = random_bins(num_bins, &seed);
+      statistics.compute(bins.data());
+      ASSERT_NEAR(statistics.mean_frequency(),
+                  mean_frequency(bins.data(), freqs), kNearTolerance * 1e3)
+          << "num_bins = " << num_bins;
+      ASSERT_NEAR(statistics.median_frequency(),
+                  median_frequency(bins.data(), freqs), kNearTolerance * 1e3)
+          << "num_bins = " << num_bins;
+    }
+  }
+}
+
+TEST(SpectralStatisticsTest, SingleBin) {
+  const std::vector<double> freqs = output_frequencies(0.001, 128);
+  SpectralStatistics statistics(freqs);
+  std::vector<kiss_fft_cpx> bins(freqs.size(), kiss_fft_cpx{0.0, 0.0});
+
+  // Same expectations as TransitionModelTest.TestFrequencySanity
+  bins[10] = kiss_fft_cpx{.r = 0.0, .i = 1.0};
+  statistics.compute(bins.data());
+  ASSERT_NEAR(statistics.magnitude_sum(), 1.0, kNearTolerance);
+  ASSERT_NEAR(statistics.mean_frequency(), freqs[10], kNearTolerance);
+  ASSERT_NEAR(statistics.median_frequency(), 0.5 * (freqs[9] + freqs[10]),
+              kNearTolerance);
+
+  // Empty spectrum
+  bins[10] = kiss_fft_cpx{.r = 0.0, .i = 0.0};
+  statistics.compute(bins.data());
+  ASSERT_EQ(statistics.median_frequency(),
+            median_frequency(bins.data(), freqs));
+}
+
+}  // namespace
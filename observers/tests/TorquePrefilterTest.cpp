@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "observers/TorquePrefilter.h"
+#include "upkie/cpp/utils/low_pass_filter.h"
+
+using upkie::cpp::utils::low_pass_filter;
+
+namespace {
+
+constexpr double kDt = 1e-3;
+constexpr double kCutoffPeriod = 0.025;
+
+/*! Amplitude of the steady-state response to a sinusoid.
+ *
+ * \param[in] params Parameters of the prefilter.
+ * \param[in] frequency Frequency of the sinusoid, in Hz.
+ */
+double sine_gain(const TorquePrefilter::Parameters &params, double frequency) {
+  TorquePrefilter prefilter(params, kDt, {kCutoffPeriod});
+  const int num_samples = 4000;
+  double amplitude = 0.0;
+  for (int n = 0; n < num_samples; ++n) {
+    const double input = std::sin(2.0 * M_PI * frequency * n * kDt);
+    double output;
+    prefilter.filter(&input, &output);
+    if (n >= num_samples / 2) {
+      amplitude = std::max(amplitude, std::abs(output));
+    }
+  }
+  return amplitude;
+}
+
+/*! Number of samples until the response to a unit step reaches 90%.
+ *
+ * \param[in] params Parameters of the prefilter.
+ */
+int rise_time(const TorquePrefilter::Parameters &params) {
+  TorquePrefilter prefilter(params, kDt, {kCutoffPeriod});
+  const double input = 1.0;
+  double output = 0.0;
+  int n = 0;
+  while (output < 0.9) {
+    prefilter.filter(&input, &output);
+    ++n;
+  }
+  return n;
+}
+
+TEST(TorquePrefilterTest, FirstOrderMatchesLowPassFilter) {
+  TorquePrefilter prefilter(TorquePrefilter::Parameters{}, kDt,
+                            {kCutoffPeriod, 0.05});
+  double expected[2] = {0.0, 0.0};
+  for (int n = 0; n < 1000; ++n) {
+    const double inputs[2] = {std::sin(0.01 * n), std::cos(0.03 * n)};
+    double outputs[2];
+    prefilter.filter(inputs, outputs);
+    expected[0] = low_pass_filter(expected[0], kCutoffPeriod, inputs[0], kDt);
+    expected[1] = low_pass_filter(expected[1], 0.05, inputs[1], kDt);
+    ASSERT_EQ(outputs[0], expected[0]);
+    ASSERT_EQ(outputs[1], expected[1]);
+  }
+}
+
+TEST(TorquePrefilterTest, ButterworthGains) {
+  TorquePrefilter::Parameters params;
+  params.type = PrefilterType::kButterworth;
+  const double cutoff_frequency = 1.0 / (2.0 * M_PI * kCutoffPeriod);
+  for (size_t num_sections : {1, 2, 3}) {
+    params.num_sections = num_sections;
+    ASSERT_NEAR(sine_gain(params, 0.1), 1.0, 1e-3);
+    ASSERT_NEAR(sine_gain(params, cutoff_frequency), std::sqrt(0.5), 1e-2);
+
+    // Each section doubles the attenuation slope, in dB per decade
+    const double high_gain = sine_gain(params, 10.0 * cutoff_frequency);
+    ASSERT_LT(20.0 * std::log10(high_gain), -38.0 * num_sections);
+  }
+}
+
+TEST(TorquePrefilterTest, FirDelay) {
+  TorquePrefilter::Parameters params;
+  params.type = PrefilterType::kLinearPhaseFir;
+  params.num_taps = 201;
+  TorquePrefilter prefilter(params, kDt, {kCutoffPeriod, kCutoffPeriod});
+  ASSERT_EQ(prefilter.num_taps(), 201);
+  ASSERT_NEAR(prefilter.response(1).group_delay, 100 * kDt, 1e-12);
+
+  // Unit gain at DC, and the ramp is delayed by half the window
+  double outputs[2];
+  for (int n = 0; n < 400; ++n) {
+    const double inputs[2] = {1.0, static_cast<double>(n)};
+    prefilter.filter(inputs, outputs);
+  }
+  ASSERT_NEAR(outputs[0], 1.0, 1e-12);
+  ASSERT_NEAR(outputs[1], 399.0 - 100.0, 1e-9);
+}
+
+TEST(TorquePrefilterTest, FirCutoff) {
+  // The default window spans one period of the cutoff frequency
+  TorquePrefilter::Parameters params;
+  params.type = PrefilterType::kLinearPhaseFir;
+  TorquePrefilter prefilter(params, kDt, {kCutoffPeriod, 0.5 * kCutoffPeriod});
+  ASSERT_EQ(prefilter.num_taps(), 159);
+
+  // Its -3 dB point is close below the cutoff frequency, and higher
+  // frequencies are rejected
+  const double cutoff_frequency = 1.0 / (2.0 * M_PI * kCutoffPeriod);
+  ASSERT_NEAR(sine_gain(params, 0.1), 1.0, 1e-3);
+  ASSERT_GT(sine_gain(params, cutoff_frequency), 0.5);
+  ASSERT_LT(sine_gain(params, cutoff_frequency), std::sqrt(0.5));
+  ASSERT_LT(sine_gain(params, 2.0 * cutoff_frequency), 0.1);
+  ASSERT_LT(sine_gain(params, 10.0 * cutoff_frequency), 1e-3);
+
+  // Shorter windows would cut off well above the cutoff frequency
+  params.num_taps = 31;
+  ASSERT_THROW(TorquePrefilter(params, kDt, {kCutoffPeriod}),
+               std::invalid_argument);
+}
+
+TEST(TorquePrefilterTest, OneEuro) {
+  TorquePrefilter::Parameters params;
+  params.type = PrefilterType::kOneEuro;
+  params.speed_coefficient = 0.0;
+  TorquePrefilter one_euro(params, kDt, {kCutoffPeriod});
+  TorquePrefilter first_order(TorquePrefilter::Parameters{}, kDt,
+                              {kCutoffPeriod});
+  for (int n = 0; n < 1000; ++n) {
+    const double input = std::sin(0.01 * n);
+    double expected, output;
+    first_order.filter(&input, &expected);
+    one_euro.filter(&input, &output);
+    ASSERT_DOUBLE_EQ(output, expected);
+  }
+
+  // At rest, the noise gain on white noise matches the impulse response
+  const double linear_gain = first_order.response(0).noise_gain;
+  ASSERT_NEAR(one_euro.response(0).noise_gain, linear_gain, 0.05 * linear_gain);
+
+  // Fast torque changes raise the cutoff frequency, hence let more noise
+  // through
+  params.speed_coefficient = 0.5;
+  ASSERT_LT(2 * rise_time(params), rise_time(TorquePrefilter::Parameters{}));
+  TorquePrefilter fast_one_euro(params, kDt, {kCutoffPeriod});
+  const TorquePrefilter::Response response = fast_one_euro.response(0);
+  ASSERT_GT(response.noise_gain, 2.0 * linear_gain);
+  ASSERT_EQ(response.group_delay, first_order.response(0).group_delay);
+}
+
+TEST(TorquePrefilterTest, IndependentChannels) {
+  for (PrefilterType type :
+       {PrefilterType::kFirstOrder, PrefilterType::kButterworth,
+        PrefilterType::kLinearPhaseFir, PrefilterType::kOneEuro}) {
+    TorquePrefilter::Parameters params;
+    params.type = type;
+    params.num_sections = 2;
+    TorquePrefilter pair(params, kDt, {kCutoffPeriod, 0.05});
+    TorquePrefilter single(params, kDt, {0.05});
+    for (int n = 0; n < 500; ++n) {
+      const double inputs[2] = {std::sin(0.02 * n), std::cos(0.05 * n)};
+      double outputs[2], output;
+      pair.filter(inputs, outputs);
+      single.filter(inputs + 1, &output);
+      ASSERT_EQ(outputs[1], output) << TorquePrefilter::type_name(type);
+    }
+  }
+}
+
+TEST(TorquePrefilterTest, InvalidParameters) {
+  TorquePrefilter::Parameters params;
+  ASSERT_THROW(TorquePrefilter(params, kDt, {2 * kDt}), std::invalid_argument);
+  ASSERT_THROW(TorquePrefilter(params, 0.0, {kCutoffPeriod}),
+               std::invalid_argument);
+  params.type = PrefilterType::kButterworth;
+  params.num_sections = 0;
+  ASSERT_THROW(TorquePrefilter(params, kDt, {kCutoffPeriod}),
+               std::invalid_argument);
+  params.type = PrefilterType::kLinearPhaseFir;
+  params.num_taps = 20;
+  ASSERT_THROW(TorquePrefilter(params, kDt, {kCutoffPeriod}),
+               std::invalid_argument);
+  params.type = PrefilterType::kOneEuro;
+  params.speed_coefficient = -1.0;
+  ASSERT_THROW(TorquePrefilter(params, kDt, {kCutoffPeriod}),
+               std::invalid_argument);
+  ASSERT_EQ(TorquePrefilter::parse_type("butterworth"),
+            PrefilterType::kButterworth);
+  ASSERT_THROW(TorquePrefilter::parse_type("kalman"), std::invalid_argument);
+}
+
+TEST(TorquePrefilterTest, ResponseTable) {
+  // Filters at the default cutoff period of the measurement model
+  std::vector<TorquePrefilter::Parameters> candidates(5);
+  candidates[1].type = PrefilterType::kButterworth;
+  candidates[2].type = PrefilterType::kButterworth;
+  candidates[2].num_sections = 2;
+  candidates[3].type = PrefilterType::kLinearPhaseFir;
+  candidates[4].type = PrefilterType::kOneEuro;
+  std::cout << std::fixed << std::setprecision(1);
+  for (const auto &params : candidates) {
+    TorquePrefilter prefilter(params, kDt, {kCutoffPeriod});
+    const TorquePrefilter::Response response = prefilter.response(0);
+    std::cout << TorquePrefilter::type_name(params.type) << " x"
+              << params.num_sections << ": group delay "
+              << 1e3 * response.group_delay
+              << " ms, noise rejection " << response.noise_rejection_db()
+              << " dB, 90% rise " << rise_time(params) << " ms" << std::endl;
+    ASSERT_GT(response.group_delay, 0.0);
+    ASSERT_GT(response.noise_rejection_db(), 0.0);
+  }
+
+  // The first-order filter delays by about one cutoff period
+  TorquePrefilter first_order(candidates[0], kDt, {kCutoffPeriod});
+  ASSERT_NEAR(first_order.response(0).group_delay, kCutoffPeriod, 2 * kDt);
+}
+
+}  // namespace
@@ -2,7 +2,9 @@
 // Copyright 2024 Inria
 #include <stdlib.h>
 
+#include <memory>
 #include <numeric>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "observers/TransitionModel.h"
@@ -232,4 +234,633 @@ TEST_F(TransitionModelTest, ReadWriteTest) {
   ASSERT_NEAR(observation("transition_model")("power").as<double>(),
               expected_power, kNearTolerance);
 }
+
+TEST_F(TransitionModelTest, SlidingDftMatchesKissFft) {
+  TransitionModel::Parameters sliding_params = params;
+  sliding_params.spectral_engine = SpectralEngine::kSlidingDft;
+  TransitionModel sliding_model(sliding_params);
+
+  palimpsest::Dictionary observation;
+  palimpsest::Dictionary sliding_observation;
+  unsigned int seed = 42;
+
+  // Run for several windows so that every bin is resynchronized
+  std::chrono::nanoseconds kiss_time{}, sliding_time{};
+  for (size_t i = 0; i < 4 * params.window_size; ++i) {
+    const double acc_z =
+        (static_cast<double>(rand_r(&seed)) / RAND_MAX) * 20.0 - 10.0;
+    observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+    sliding_observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    transition_model.read(observation);
+    transition_model.write(observation);
+    kiss_time += std::chrono::high_resolution_clock::now() - start_time;
+
+    start_time = std::chrono::high_resolution_clock::now();
+    sliding_model.read(sliding_observation);
+    sliding_model.write(sliding_observation);
+    sliding_time += std::chrono::high_resolution_clock::now() - start_time;
+
+    for (const auto &key : {"mean_frequency", "median_frequency", "power",
+                            "p_switch", "p_landing"}) {
+      ASSERT_NEAR(sliding_observation("transition_model")(key).as<double>(),
+                  observation("transition_model")(key).as<double>(),
+                  kNearTolerance)
+          << "key = " << key << ", i = " << i;
+    }
+  }
+  std::cout << "kiss_fft read/write time microsecs: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(kiss_time)
+                   .count()
+            << std::endl;
+  std::cout << "Sliding DFT read/write time microsecs: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(
+                   sliding_time)
+                   .count()
+            << std::endl;
+}
+
+TEST_F(TransitionModelTest, SlidingDftReadWriteTest) {
+  TransitionModel::Parameters sliding_params = params;
+  sliding_params.spectral_engine = SpectralEngine::kSlidingDft;
+  TransitionModel sliding_model(sliding_params);
+  palimpsest::Dictionary observation;
+
+  // Sine wave with an integer number of periods in the window
+  const size_t kNumPeriods = 10;
+  const double target_freq = kNumPeriods / (params.dt * params.window_size);
+  const double df = 1.0 / (params.dt * params.window_size);
+
+  // Slide over more than one window to exercise the recursion
+  for (size_t i = 0; i < 3 * params.window_size; ++i) {
+    observation("imu")("linear_acceleration") = Eigen::Vector3d(
+        0.0, 0.0, sin(2 * M_PI * target_freq * i * params.dt));
+    sliding_model.read(observation);
+  }
+  sliding_model.write(observation);
+
+  ASSERT_NEAR(observation("transition_model")("mean_frequency").as<double>(),
+              target_freq, kNearTolerance);
+  ASSERT_NEAR(observation("transition_model")("median_frequency").as<double>(),
+              target_freq - df / 2, kNearTolerance);
+  ASSERT_NEAR(observation("transition_model")("power").as<double>(), 0.5,
+              kNearTolerance);
+}
+
+TEST_F(TransitionModelTest, RealFftMatchesKissFft) {
+  TransitionModel::Parameters real_params = params;
+  real_params.spectral_engine = SpectralEngine::kRealFft;
+  TransitionModel real_model(real_params);
+
+  palimpsest::Dictionary observation;
+  palimpsest::Dictionary real_observation;
+  unsigned int seed = 42;
+
+  std::chrono::nanoseconds kiss_time{}, real_time{};
+  for (size_t i = 0; i < 2 * params.window_size; ++i) {
+    const double acc_z =
+        (static_cast<double>(rand_r(&seed)) / RAND_MAX) * 20.0 - 10.0;
+    observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+    real_observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    transition_model.read(observation);
+    transition_model.write(observation);
+    kiss_time += std::chrono::high_resolution_clock::now() - start_time;
+
+    start_time = std::chrono::high_resolution_clock::now();
+    real_model.read(real_observation);
+    real_model.write(real_observation);
+    real_time += std::chrono::high_resolution_clock::now() - start_time;
+
+    for (const auto &key : {"mean_frequency", "median_frequency", "power",
+                            "p_switch", "p_landing"}) {
+      ASSERT_NEAR(real_observation("transition_model")(key).as<double>(),
+                  observation("transition_model")(key).as<double>(),
+                  kNearTolerance)
+          << "key = " << key << ", i = " << i;
+    }
+  }
+  std::cout << "kiss_fft read/write time microsecs: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(kiss_time)
+                   .count()
+            << std::endl;
+  std::cout << "Real FFT read/write time microsecs: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(real_time)
+                   .count()
+            << std::endl;
+}
+
+TEST_F(TransitionModelTest, RealFftHannWindow) {
+  TransitionModel::Parameters real_params = params;
+  real_params.spectral_engine = SpectralEngine::kRealFft;
+  real_params.apply_hann_window = true;
+  TransitionModel real_model(real_params);
+  palimpsest::Dictionary observation;
+
+  const size_t kNumPeriods = 10;
+  const double target_freq = kNumPeriods / (params.dt * params.window_size);
+  const double df = 1.0 / (params.dt * params.window_size);
+
+  for (size_t i = 0; i < params.window_size; ++i) {
+    observation("imu")("linear_acceleration") = Eigen::Vector3d(
+        0.0, 0.0, sin(2 * M_PI * target_freq * i * params.dt));
+    real_model.read(observation);
+  }
+  real_model.write(observation);
+
+  // The periodic Hann window spreads the peak over its two neighbors with
+  // half the magnitude, symmetrically, so the mean and median are unchanged.
+  ASSERT_NEAR(observation("transition_model")("mean_frequency").as<double>(),
+              target_freq, kNearTolerance);
+  ASSERT_NEAR(observation("transition_model")("median_frequency").as<double>(),
+              target_freq - df / 2, kNearTolerance);
+
+  // The power is computed on the raw window
+  ASSERT_NEAR(observation("transition_model")("power").as<double>(), 0.5,
+              kNearTolerance);
+}
+
+TEST_F(TransitionModelTest, RealFftWindowSizeDispatch) {
+  for (size_t window_size : {32, 64, 256, 512, 1024}) {
+    TransitionModel::Parameters real_params = params;
+    real_params.window_size = window_size;
+    real_params.spectral_engine = SpectralEngine::kRealFft;
+    TransitionModel real_model(real_params);
+    ASSERT_EQ(real_model.spectral_frontend->window_size(), window_size);
+    ASSERT_EQ(real_model.freqs.size(), window_size / 2);
+  }
+
+  TransitionModel::Parameters real_params = params;
+  real_params.window_size = 100;
+  real_params.spectral_engine = SpectralEngine::kRealFft;
+  ASSERT_THROW(TransitionModel{real_params}, std::invalid_argument);
+}
+
+TEST_F(TransitionModelTest, MultiAxisFeatures) {
+  TransitionModel::Parameters multi_params = params;
+  multi_params.multi_axis = true;
+  TransitionModel multi_model(multi_params);
+  palimpsest::Dictionary observation;
+
+  // One sine wave per channel, each with a distinct integer number of periods
+  // in the window and a distinct amplitude
+  const double df = 1.0 / (params.dt * params.window_size);
+  const std::array<size_t, 6> num_periods = {3, 5, 10, 7, 12, 20};
+  const std::array<double, 6> amplitudes = {1.0, 2.0, 0.5, 1.5, 3.0, 0.25};
+  auto sample = [&](size_t c, size_t i) {
+    return amplitudes[c] * sin(2 * M_PI * num_periods[c] * df * i * params.dt);
+  };
+
+  for (size_t i = 0; i < params.window_size; ++i) {
+    observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(sample(0, i), sample(1, i), sample(2, i));
+    observation("imu")("angular_velocity") =
+        Eigen::Vector3d(sample(3, i), sample(4, i), sample(5, i));
+    multi_model.read(observation);
+    transition_model.read(observation);
+  }
+  multi_model.write(observation);
+
+  for (size_t c = 0; c < MultiAxisSpectrum::kNumChannels; ++c) {
+    const auto &axis_output =
+        observation("transition_model")(MultiAxisSpectrum::kChannelNames[c]);
+    const double target_freq = num_periods[c] * df;
+    ASSERT_NEAR(axis_output("mean_frequency").as<double>(), target_freq,
+                kNearTolerance);
+    ASSERT_NEAR(axis_output("median_frequency").as<double>(),
+                target_freq - df / 2, kNearTolerance);
+    ASSERT_NEAR(axis_output("power").as<double>(),
+                0.5 * amplitudes[c] * amplitudes[c], kNearTolerance);
+  }
+
+  // Without pitch, the z-axis channel is the signal of the single-axis path
+  transition_model.update();
+  const auto &acc_z_output = observation("transition_model")("acc_z");
+  ASSERT_NEAR(acc_z_output("mean_frequency").as<double>(),
+              transition_model.mean_freq, kNearTolerance);
+  ASSERT_NEAR(acc_z_output("median_frequency").as<double>(),
+              transition_model.median_freq, kNearTolerance);
+  ASSERT_NEAR(acc_z_output("power").as<double>(), transition_model.power,
+              kNearTolerance);
+}
+
+TEST_F(TransitionModelTest, MultiAxisBatchedCost) {
+  TransitionModel::Parameters multi_params = params;
+  multi_params.multi_axis = true;
+  TransitionModel multi_model(multi_params);
+  palimpsest::Dictionary observation;
+  observation("imu")("angular_velocity") = Eigen::Vector3d(0.0, 0.0, 0.0);
+  unsigned int seed = 42;
+
+  // Per-axis reference: one single-axis model fed each channel along z
+  std::vector<std::unique_ptr<TransitionModel>> axis_models;
+  std::vector<palimpsest::Dictionary> axis_observations(
+      MultiAxisSpectrum::kNumChannels);
+  for (size_t c = 0; c < MultiAxisSpectrum::kNumChannels; ++c) {
+    axis_models.push_back(std::make_unique<TransitionModel>(params));
+  }
+
+  std::chrono::nanoseconds single_time{}, multi_time{};
+  for (size_t i = 0; i < 4 * params.window_size; ++i) {
+    Eigen::Vector3d acc, gyro;
+    for (Eigen::Index j = 0; j < 3; ++j) {
+      acc(j) = (static_cast<double>(rand_r(&seed)) / RAND_MAX) * 20.0 - 10.0;
+      gyro(j) = (static_cast<double>(rand_r(&seed)) / RAND_MAX) * 2.0 - 1.0;
+    }
+    observation("imu")("linear_acceleration") = acc;
+    observation("imu")("angular_velocity") = gyro;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    transition_model.read(observation);
+    transition_model.update();
+    single_time += std::chrono::high_resolution_clock::now() - start_time;
+
+    start_time = std::chrono::high_resolution_clock::now();
+    multi_model.read(observation);
+    multi_model.update();
+    multi_time += std::chrono::high_resolution_clock::now() - start_time;
+
+    // Batched features match those of each axis on its own
+    multi_model.write(observation);
+    for (size_t c = 0; c < MultiAxisSpectrum::kNumChannels; ++c) {
+      const double value = (c < 3) ? acc(c) : gyro(c - 3);
+      axis_observations[c]("imu")("linear_acceleration") =
+          Eigen::Vector3d(0.0, 0.0, value);
+      axis_models[c]->read(axis_observations[c]);
+      axis_models[c]->update();
+      const auto &axis_output =
+          observation("transition_model")(MultiAxisSpectrum::kChannelNames[c]);
+      ASSERT_NEAR(axis_output("mean_frequency").as<double>(),
+                  axis_models[c]->mean_freq, kNearTolerance);
+      ASSERT_NEAR(axis_output("median_frequency").as<double>(),
+                  axis_models[c]->median_freq, kNearTolerance);
+      ASSERT_NEAR(axis_output("power").as<double>(), axis_models[c]->power,
+                  kNearTolerance);
+    }
+  }
+  std::cout << "Single-axis read/update time microsecs: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(
+                   single_time)
+                   .count()
+            << std::endl;
+  std::cout << "Multi-axis read/update time microsecs: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(multi_time)
+                   .count()
+            << std::endl;
+}
+
+TEST_F(TransitionModelTest, GoertzelSingleBinBandsMatchKissFft) {
+  // With one band per DFT bin, the bank computes the same statistics as the
+  // full spectrum
+  const double df = 1.0 / (params.dt * params.window_size);
+  TransitionModel::Parameters goertzel_params = params;
+  goertzel_params.spectral_engine = SpectralEngine::kGoertzel;
+  goertzel_params.band_edges.clear();
+  for (size_t k = 0; k <= params.window_size / 2; ++k) {
+    goertzel_params.band_edges.push_back(k * df);
+  }
+  TransitionModel goertzel_model(goertzel_params);
+  ASSERT_EQ(goertzel_model.goertzel_bank->num_bands(), params.window_size / 2);
+
+  palimpsest::Dictionary observation;
+  palimpsest::Dictionary goertzel_observation;
+  unsigned int seed = 42;
+
+  // Run over as many windows as bands so that every band is resynchronized
+  const size_t num_samples = params.window_size * params.window_size / 2;
+  for (size_t i = 0; i < num_samples; ++i) {
+    const double acc_z =
+        (static_cast<double>(rand_r(&seed)) / RAND_MAX) * 20.0 - 10.0;
+    observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+    goertzel_observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+    goertzel_model.read(goertzel_observation);
+    goertzel_model.write(goertzel_observation);
+
+    // Only compare the last windows, kiss_fft is the slow one here
+    if (i + 2 * params.window_size < num_samples) {
+      continue;
+    }
+    transition_model.read(observation);
+    transition_model.write(observation);
+    if (i + params.window_size < num_samples) {
+      continue;
+    }
+    for (const auto &key : {"mean_frequency", "median_frequency", "power",
+                            "p_switch"}) {
+      ASSERT_NEAR(goertzel_observation("transition_model")(key).as<double>(),
+                  observation("transition_model")(key).as<double>(),
+                  kNearTolerance)
+          << "key = " << key << ", i = " << i;
+    }
+  }
+}
+
+TEST_F(TransitionModelTest, GoertzelReadWriteTest) {
+  TransitionModel::Parameters goertzel_params = params;
+  goertzel_params.spectral_engine = SpectralEngine::kGoertzel;
+  TransitionModel goertzel_model(goertzel_params);
+  palimpsest::Dictionary observation;
+
+  // Sine wave at the center bin of the [48, 64) Hz band, i.e. bins [6, 8)
+  const size_t kNumPeriods = 6;
+  const double df = 1.0 / (params.dt * params.window_size);
+  const double target_freq = kNumPeriods * df;
+
+  for (size_t i = 0; i < 3 * params.window_size; ++i) {
+    observation("imu")("linear_acceleration") = Eigen::Vector3d(
+        0.0, 0.0, sin(2 * M_PI * target_freq * i * params.dt));
+    goertzel_model.read(observation);
+  }
+  goertzel_model.write(observation);
+
+  // The median is interpolated over the two bins of the band
+  ASSERT_NEAR(observation("transition_model")("mean_frequency").as<double>(),
+              target_freq, kNearTolerance);
+  ASSERT_NEAR(observation("transition_model")("median_frequency").as<double>(),
+              target_freq, kNearTolerance);
+  ASSERT_NEAR(observation("transition_model")("power").as<double>(), 0.5,
+              kNearTolerance);
+
+  // All the energy is in this band: sum of |X_k|^2 over the two bins, with
+  // |X_k| = N / 2 for a unit sine wave
+  const double half_window = params.window_size / 2.0;
+  for (size_t b = 0; b < goertzel_model.goertzel_bank->num_bands(); ++b) {
+    const double expected_energy = (b == 5) ? 2 * half_window * half_window
+                                            : 0.0;
+    ASSERT_NEAR(goertzel_model.goertzel_bank->band_energy(b), expected_energy,
+                1e-6)
+        << "band = " << b;
+  }
+}
+
+TEST_F(TransitionModelTest, GoertzelBandsBenchmark) {
+  TransitionModel::Parameters goertzel_params = params;
+  goertzel_params.spectral_engine = SpectralEngine::kGoertzel;
+  TransitionModel goertzel_model(goertzel_params);
+
+  palimpsest::Dictionary observation;
+  palimpsest::Dictionary goertzel_observation;
+  unsigned int seed = 42;
+
+  // Low-frequency oscillation with noise, then a high-frequency burst
+  const double df = 1.0 / (params.dt * params.window_size);
+  std::chrono::nanoseconds kiss_time{}, goertzel_time{};
+  double max_landing_error{};
+  for (size_t i = 0; i < 8 * params.window_size; ++i) {
+    const double t = i * params.dt;
+    const double noise =
+        (static_cast<double>(rand_r(&seed)) / RAND_MAX) * 2.0 - 1.0;
+    const double freq = (i < 4 * params.window_size) ? 2 * df : 20 * df;
+    const double acc_z = 10.0 * sin(2 * M_PI * freq * t) + noise;
+    observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+    goertzel_observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    transition_model.read(observation);
+    transition_model.write(observation);
+    kiss_time += std::chrono::high_resolution_clock::now() - start_time;
+
+    start_time = std::chrono::high_resolution_clock::now();
+    goertzel_model.read(goertzel_observation);
+    goertzel_model.write(goertzel_observation);
+    goertzel_time += std::chrono::high_resolution_clock::now() - start_time;
+
+    // The switch probability only depends on the power
+    ASSERT_NEAR(goertzel_observation("transition_model")("p_switch")
+                    .as<double>(),
+                observation("transition_model")("p_switch").as<double>(),
+                kNearTolerance);
+    max_landing_error = std::max(
+        max_landing_error,
+        std::abs(
+            goertzel_observation("transition_model")("p_landing").as<double>() -
+            observation("transition_model")("p_landing").as<double>()));
+  }
+  std::cout << "kiss_fft read/write time microsecs: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(kiss_time)
+                   .count()
+            << std::endl;
+  std::cout << "Goertzel read/write time microsecs: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(
+                   goertzel_time)
+                   .count()
+            << std::endl;
+  std::cout << "Goertzel max p_landing error: " << max_landing_error
+            << std::endl;
+  ASSERT_LT(max_landing_error, 0.1);
+}
+
+TEST_F(TransitionModelTest, HopHoldsSpectralFeatures) {
+  TransitionModel::Parameters hop_params = params;
+  hop_params.hop = 4;
+  TransitionModel hop_model(hop_params);
+
+  palimpsest::Dictionary observation;
+  palimpsest::Dictionary hop_observation;
+  unsigned int seed = 42;
+
+  double held_mean_freq{}, held_median_freq{};
+  for (size_t i = 0; i < 2 * params.window_size; ++i) {
+    const double acc_z =
+        (static_cast<double>(rand_r(&seed)) / RAND_MAX) * 20.0 - 10.0;
+    observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+    hop_observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+    transition_model.read(observation);
+    transition_model.write(observation);
+    hop_model.read(hop_observation);
+    hop_model.write(hop_observation);
+
+    const auto &output = observation("transition_model");
+    const auto &hop_output = hop_observation("transition_model");
+    if (i % hop_params.hop == 0) {
+      held_mean_freq = output("mean_frequency").as<double>();
+      held_median_freq = output("median_frequency").as<double>();
+    }
+    ASSERT_NEAR(hop_output("mean_frequency").as<double>(), held_mean_freq,
+                kNearTolerance)
+        << "i = " << i;
+    ASSERT_NEAR(hop_output("median_frequency").as<double>(), held_median_freq,
+                kNearTolerance)
+        << "i = " << i;
+
+    // The power, hence the switch probability, is updated at every tick
+    ASSERT_NEAR(hop_output("power").as<double>(),
+                output("power").as<double>(), kNearTolerance);
+    ASSERT_NEAR(hop_output("p_switch").as<double>(),
+                output("p_switch").as<double>(), kNearTolerance);
+  }
+}
+
+TEST_F(TransitionModelTest, HopExtrapolatesSpectralFeatures) {
+  TransitionModel::Parameters hop_params = params;
+  hop_params.hop = 4;
+  hop_params.extrapolate_features = true;
+  TransitionModel hop_model(hop_params);
+
+  palimpsest::Dictionary observation;
+  palimpsest::Dictionary hop_observation;
+  unsigned int seed = 42;
+
+  double prev_mean_freq{}, last_mean_freq{};
+  for (size_t i = 0; i < 2 * params.window_size; ++i) {
+    const double acc_z =
+        (static_cast<double>(rand_r(&seed)) / RAND_MAX) * 20.0 - 10.0;
+    observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+    hop_observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+    transition_model.read(observation);
+    transition_model.write(observation);
+    hop_model.read(hop_observation);
+    hop_model.write(hop_observation);
+
+    const size_t ticks_since_update = i % hop_params.hop;
+    if (ticks_since_update == 0) {
+      prev_mean_freq = (i > 0) ? last_mean_freq : 0.0;
+      last_mean_freq =
+          observation("transition_model")("mean_frequency").as<double>();
+    }
+    if (i < hop_params.hop) {
+      continue;
+    }
+    const double slope = (last_mean_freq - prev_mean_freq) / hop_params.hop;
+    ASSERT_NEAR(
+        hop_observation("transition_model")("mean_frequency").as<double>(),
+        last_mean_freq + ticks_since_update * slope, kNearTolerance)
+        << "i = " << i;
+  }
+}
+
+TEST_F(TransitionModelTest, HopMustBePositive) {
+  TransitionModel::Parameters hop_params = params;
+  hop_params.hop = 0;
+  ASSERT_THROW(TransitionModel{hop_params}, std::invalid_argument);
+}
+
+TEST_F(TransitionModelTest, WaveletBands) {
+  TransitionModel::Parameters wavelet_params = params;
+  wavelet_params.spectral_engine = SpectralEngine::kWavelet;
+  TransitionModel wavelet_model(wavelet_params);
+  const LiftingWavelet &wavelet = *wavelet_model.lifting_wavelet;
+  const size_t num_bands = wavelet_params.wavelet_levels + 1;
+  ASSERT_EQ(wavelet.num_bands(), num_bands);
+
+  // A constant signal only has energy in the approximation band, which spans
+  // [0, 1000 / 2^6] Hz
+  palimpsest::Dictionary observation;
+  observation("imu")("linear_acceleration") = Eigen::Vector3d(0.0, 0.0, 2.0);
+  for (size_t i = 0; i < params.window_size; ++i) {
+    wavelet_model.read(observation);
+  }
+  wavelet_model.write(observation);
+  ASSERT_NEAR(wavelet.band_power(0), 4.0, kNearTolerance);
+  for (size_t b = 1; b < num_bands; ++b) {
+    ASSERT_NEAR(wavelet.band_power(b), 0.0, kNearTolerance);
+  }
+  ASSERT_NEAR(observation("transition_model")("power").as<double>(), 4.0,
+              kNearTolerance);
+  ASSERT_NEAR(observation("transition_model")("mean_frequency").as<double>(),
+              7.8125, kNearTolerance);
+  ASSERT_NEAR(observation("transition_model")("median_frequency").as<double>(),
+              7.8125, kNearTolerance);
+
+  // The fastest oscillation only has energy in the finest band, which spans
+  // [250, 500] Hz
+  for (size_t i = 0; i < params.window_size; ++i) {
+    observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, (i % 2 == 0) ? 1.0 : -1.0);
+    wavelet_model.read(observation);
+  }
+  wavelet_model.write(observation);
+  for (size_t b = 0; b + 1 < num_bands; ++b) {
+    ASSERT_NEAR(wavelet.band_power(b), 0.0, kNearTolerance);
+  }
+  ASSERT_NEAR(wavelet.band_power(num_bands - 1), 1.0, kNearTolerance);
+  ASSERT_NEAR(observation("transition_model")("mean_frequency").as<double>(),
+              375.0, kNearTolerance);
+  ASSERT_NEAR(observation("transition_model")("median_frequency").as<double>(),
+              375.0, kNearTolerance);
+}
+
+TEST_F(TransitionModelTest, WaveletDetectsImpactsEarlier) {
+  TransitionModel::Parameters wavelet_params = params;
+  wavelet_params.spectral_engine = SpectralEngine::kWavelet;
+  TransitionModel wavelet_model(wavelet_params);
+
+  palimpsest::Dictionary observation;
+  palimpsest::Dictionary wavelet_observation;
+  unsigned int seed = 42;
+
+  // Small noise, then a landing impact ringing at 125 Hz
+  std::chrono::nanoseconds kiss_time{}, wavelet_time{};
+  size_t fft_detection = 0, wavelet_detection = 0;
+  const size_t impact = 2 * params.window_size;
+  for (size_t i = 0; i < impact + params.window_size; ++i) {
+    double acc_z =
+        (static_cast<double>(rand_r(&seed)) / RAND_MAX) * 0.2 - 0.1;
+    if (i >= impact) {
+      acc_z += 20.0 * sin(2 * M_PI * 125.0 * (i - impact) * params.dt + 1.0);
+    }
+    observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+    wavelet_observation("imu")("linear_acceleration") =
+        Eigen::Vector3d(0.0, 0.0, acc_z);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    transition_model.read(observation);
+    transition_model.write(observation);
+    kiss_time += std::chrono::high_resolution_clock::now() - start_time;
+
+    start_time = std::chrono::high_resolution_clock::now();
+    wavelet_model.read(wavelet_observation);
+    wavelet_model.write(wavelet_observation);
+    wavelet_time += std::chrono::high_resolution_clock::now() - start_time;
+
+    if (fft_detection == 0 &&
+        observation("transition_model")("p_switch").as<double>() > 0.5) {
+      fft_detection = i;
+    }
+    if (wavelet_detection == 0 &&
+        wavelet_observation("transition_model")("p_switch").as<double>() >
+            0.5) {
+      wavelet_detection = i;
+    }
+  }
+  std::cout << "kiss_fft read/write time microsecs: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(kiss_time)
+                   .count()
+            << std::endl;
+  std::cout << "Wavelet read/write time microsecs: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(
+                   wavelet_time)
+                   .count()
+            << std::endl;
+  std::cout << "Switch detected after " << fft_detection - impact
+            << " ticks with kiss_fft, " << wavelet_detection - impact
+            << " ticks with the wavelet transform" << std::endl;
+  ASSERT_GE(fft_detection, impact);
+  ASSERT_GE(wavelet_detection, impact);
+  ASSERT_LT(wavelet_detection, fft_detection);
+}
+
+TEST_F(TransitionModelTest, WaveletLevelsDivideWindow) {
+  TransitionModel::Parameters wavelet_params = params;
+  wavelet_params.spectral_engine = SpectralEngine::kWavelet;
+  wavelet_params.wavelet_levels = 8;
+  ASSERT_THROW(TransitionModel{wavelet_params}, std::invalid_argument);
+  wavelet_params.wavelet_levels = 0;
+  ASSERT_THROW(TransitionModel{wavelet_params}, std::invalid_argument);
+}
 }  // namespace
@@ -0,0 +1,299 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#include <stdlib.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "observers/NpzInterpolator.h"
+#include "observers/UniformGrid2d.h"
+#include "observers/tests/QueryBenchmark.h"
+#include "observers/utils.h"
+
+constexpr double kNearTolerance = 1e-8;
+
+namespace {
+
+class UniformGrid2dTest : public testing::Test {
+ protected:
+  std::unique_ptr<NpzInterpolator> interpolator;
+
+  UniformGrid2dTest() {
+    std::string model_path =
+        find_model_path("observers/tests/UniformGrid2dTest",
+                        "contact_agent/observers/data/measurement_model.npz");
+    interpolator = std::make_unique<NpzInterpolator>(
+        model_path, std::vector<std::string>{"wheel_torque", "knee_torque"},
+        std::vector<std::string>{"contact_likelihood",
+                                 "no_contact_likelihood"});
+  }
+
+  //! Random point covering the grid and some margin around it
+  std::vector<double> random_point(unsigned int *seed) const {
+    return ::random_point(interpolator->axis_values, seed);
+  }
+};
+
+TEST(UniformAxisTest, DetectsUniformAxes) {
+  ASSERT_TRUE(is_uniform_axis({0.0, 1.0}));
+  ASSERT_TRUE(is_uniform_axis({-0.3, -0.1, 0.1, 0.3}));
+  ASSERT_FALSE(is_uniform_axis({0.0}));
+  ASSERT_FALSE(is_uniform_axis({1.0, 0.0}));
+  ASSERT_FALSE(is_uniform_axis({0.0, 1.0, 3.0}));
+  ASSERT_THROW(UniformGrid2d({0.0, 1.0, 3.0}, {0.0, 1.0}, {}),
+               std::invalid_argument);
+  ASSERT_THROW(UniformGrid2d({0.0, 1.0}, {0.0, 1.0}, {{0.0, 1.0, 2.0}}),
+               std::invalid_argument);
+}
+
+TEST(UniformAxisTest, BilinearInterpolation) {
+  // Values v0 = x + 10 y and v1 = x * y are reproduced exactly by bilinear
+  // interpolation
+  const std::vector<double> x_axis = {0.0, 0.5, 1.0};
+  const std::vector<double> y_axis = {-1.0, 0.0, 1.0, 2.0};
+  std::vector<std::vector<double>> tables(2);
+  for (double x : x_axis) {
+    for (double y : y_axis) {
+      tables[0].push_back(x + 10.0 * y);
+      tables[1].push_back(x * y);
+    }
+  }
+  UniformGrid2d grid(x_axis, y_axis, tables);
+  ASSERT_EQ(grid.num_values(), 2);
+
+  double values[2];
+  grid.interpolate(0.3, 1.7, values);
+  ASSERT_NEAR(values[0], 17.3, kNearTolerance);
+  ASSERT_NEAR(values[1], 0.51, kNearTolerance);
+
+  // Constant extrapolation
+  grid.interpolate(-1.0, 5.0, values);
+  ASSERT_NEAR(values[0], 20.0, kNearTolerance);
+  ASSERT_NEAR(values[1], 0.0, kNearTolerance);
+  grid.interpolate(1.0, 2.0, values);
+  ASSERT_NEAR(values[0], 21.0, kNearTolerance);
+  ASSERT_NEAR(values[1], 2.0, kNearTolerance);
+}
+
+TEST(UniformAxisTest, Quantization) {
+  // Nonnegative values are log-quantized, others linearly
+  const std::vector<double> x_axis = {0.0, 1.0, 2.0};
+  const std::vector<double> y_axis = {0.0, 1.0};
+  const std::vector<double> nodes = {0.0, -3.0, 1e-20, -1.0, 0.5,  0.0,
+                                     2.0, 1.0,  100.0, 2.0,  50.0, 3.0};
+  for (TablePrecision precision :
+       {TablePrecision::kFloat32, TablePrecision::kLogUint16}) {
+    UniformGrid2d grid(x_axis, y_axis, 2, nodes.data(), precision);
+    UniformGrid2d reference(x_axis, y_axis, 2, nodes.data());
+    ASSERT_EQ(grid.precision(), precision);
+    ASSERT_LT(grid.table_bytes(), reference.table_bytes());
+
+    double values[2], expected_values[2];
+    for (double x : {0.0, 0.3, 1.0, 1.7, 2.0}) {
+      for (double y : {0.0, 0.4, 1.0}) {
+        grid.interpolate(x, y, values);
+        reference.interpolate(x, y, expected_values);
+        ASSERT_NEAR(values[0], expected_values[0],
+                    1e-3 * std::abs(expected_values[0]) + 1e-10);
+        ASSERT_NEAR(values[1], expected_values[1], 1e-4);
+      }
+    }
+
+    // Zero is exact in log scale, values below the floor vanish
+    grid.interpolate(0.0, 0.0, values);
+    ASSERT_EQ(values[0], 0.0);
+    const std::vector<double> errors = grid.quantization_errors();
+    ASSERT_LT(errors[0], 1e-3 * 100.0);
+    ASSERT_LT(errors[1], 1e-4);
+  }
+  ASSERT_EQ(UniformGrid2d(x_axis, y_axis, 2, nodes.data())
+                .quantization_errors(),
+            std::vector<double>(2, 0.0));
+}
+
+TEST_F(UniformGrid2dTest, QuantizedModel) {
+  double values[2], expected_values[2];
+  for (TablePrecision precision :
+       {TablePrecision::kFloat32, TablePrecision::kLogUint16}) {
+    std::string model_path =
+        find_model_path("observers/tests/UniformGrid2dTest",
+                        "contact_agent/observers/data/measurement_model.npz");
+    NpzInterpolator quantized(
+        model_path, {"wheel_torque", "knee_torque"},
+        {"contact_likelihood", "no_contact_likelihood"});
+    quantized.set_precision(precision);
+    ASSERT_EQ(quantized.quantization_errors.size(), 2);
+
+    unsigned int seed = 42;
+    for (int trial = 0; trial < 1000; ++trial) {
+      const std::vector<double> point = random_point(&seed);
+      quantized.interpolate(point, values);
+      interpolator->interpolate(point, expected_values);
+      for (size_t v = 0; v < 2; ++v) {
+        ASSERT_LE(std::abs(values[v] - expected_values[v]),
+                  quantized.quantization_errors[v] + 1e-12);
+      }
+    }
+  }
+}
+
+TEST_F(UniformGrid2dTest, MatchesBtwxt) {
+  ASSERT_TRUE(interpolator->has_uniform_grid());
+
+  unsigned int seed = 42;
+  double values[2];
+  for (int trial = 0; trial < 10000; ++trial) {
+    const std::vector<double> point = random_point(&seed);
+    const std::vector<double> expected_values = (*interpolator)(point);
+    interpolator->interpolate(point, values);
+    ASSERT_NEAR(values[0], expected_values[0], kNearTolerance);
+    ASSERT_NEAR(values[1], expected_values[1], kNearTolerance);
+  }
+}
+
+TEST_F(UniformGrid2dTest, InterpolatePoints) {
+  // Chunks of cells are located ahead, check sizes around the chunk size
+  unsigned int seed = 42;
+  for (size_t num_points : {1, 2, 4, 5, 9}) {
+    std::vector<double> points;
+    for (size_t k = 0; k < num_points; ++k) {
+      const std::vector<double> point = random_point(&seed);
+      points.insert(points.end(), point.begin(), point.end());
+    }
+    std::vector<double> values(2 * num_points);
+    interpolator->interpolate_points(points, values.data());
+    for (size_t k = 0; k < num_points; ++k) {
+      double expected_values[2];
+      interpolator->interpolate({points[2 * k], points[2 * k + 1]},
+                                expected_values);
+      ASSERT_EQ(values[2 * k], expected_values[0]);
+      ASSERT_EQ(values[2 * k + 1], expected_values[1]);
+    }
+  }
+
+  // Coordinates should come in pairs
+  double values[2];
+  ASSERT_THROW(interpolator->interpolate_points({1.0, 2.0, 3.0}, values),
+               std::invalid_argument);
+}
+
+TEST_F(UniformGrid2dTest, InterpolateBatch) {
+  // Vector kernels process 2 or 4 points at once, check sizes around them
+  unsigned int seed = 42;
+  for (size_t num_points : {0, 1, 3, 4, 5, 7, 17}) {
+    std::vector<double> wheel_torques, knee_torques;
+    for (size_t k = 0; k < num_points; ++k) {
+      const std::vector<double> point = random_point(&seed);
+      wheel_torques.push_back(point[0]);
+      knee_torques.push_back(point[1]);
+    }
+    std::vector<double> contact(num_points), no_contact(num_points);
+    const double *coordinates[2] = {wheel_torques.data(),
+                                    knee_torques.data()};
+    double *values[2] = {contact.data(), no_contact.data()};
+    interpolator->interpolate_batch(coordinates, num_points, values);
+    for (size_t k = 0; k < num_points; ++k) {
+      double expected_values[2];
+      interpolator->interpolate({wheel_torques[k], knee_torques[k]},
+                                expected_values);
+      ASSERT_NEAR(contact[k], expected_values[0], kNearTolerance);
+      ASSERT_NEAR(no_contact[k], expected_values[1], kNearTolerance);
+    }
+  }
+}
+
+TEST(UniformAxisTest, BatchMatchesScalar) {
+  const std::vector<double> x_axis = {-1.0, 0.0, 1.0, 2.0};
+  const std::vector<double> y_axis = {0.0, 0.25, 0.5};
+  std::vector<std::vector<double>> tables(3);
+  for (double x : x_axis) {
+    for (double y : y_axis) {
+      tables[0].push_back(std::sin(x) + y);
+      tables[1].push_back(x * x * y);
+      tables[2].push_back(std::exp(-x - y));
+    }
+  }
+  UniformGrid2d grid(x_axis, y_axis, tables);
+
+  // Points inside, outside and exactly on the boundary of the grid
+  std::vector<double> xs = {-2.0, -1.0, 2.0, 3.0, 0.5, 1.999, -0.3};
+  std::vector<double> ys = {0.1, -1.0, 0.5, 0.7, 0.25, 0.4, 0.49};
+  unsigned int seed = 42;
+  for (int k = 0; k < 100; ++k) {
+    xs.push_back(-1.5 + 4.0 * static_cast<double>(rand_r(&seed)) / RAND_MAX);
+    ys.push_back(-0.2 + 0.9 * static_cast<double>(rand_r(&seed)) / RAND_MAX);
+  }
+  const size_t num_points = xs.size();
+  std::vector<std::vector<double>> batch(3, std::vector<double>(num_points));
+  double *batch_values[3] = {batch[0].data(), batch[1].data(),
+                             batch[2].data()};
+  grid.interpolate_batch(xs.data(), ys.data(), num_points, batch_values);
+
+  // Vectorized kernels match the scalar interpolation of each point
+  double scalar[3];
+  for (size_t k = 0; k < num_points; ++k) {
+    grid.interpolate(xs[k], ys[k], scalar);
+    for (size_t v = 0; v < 3; ++v) {
+      ASSERT_NEAR(batch[v][k], scalar[v], 1e-12)
+          << "v = " << v << ", k = " << k;
+    }
+  }
+}
+
+TEST_F(UniformGrid2dTest, QueryBenchmark) {
+  benchmark_queries(*interpolator, "2-D");
+}
+
+TEST_F(UniformGrid2dTest, BatchBenchmark) {
+  constexpr size_t kNumPoints = 1000000;
+  unsigned int seed = 42;
+  std::vector<double> wheel_torques(kNumPoints), knee_torques(kNumPoints);
+  for (size_t k = 0; k < kNumPoints; ++k) {
+    const std::vector<double> point = random_point(&seed);
+    wheel_torques[k] = point[0];
+    knee_torques[k] = point[1];
+  }
+
+  double point_sum{};
+  double point_values[2];
+  std::vector<double> point(2);
+  auto start_time = std::chrono::high_resolution_clock::now();
+  for (size_t k = 0; k < kNumPoints; ++k) {
+    point[0] = wheel_torques[k];
+    point[1] = knee_torques[k];
+    interpolator->interpolate(point, point_values);
+    point_sum += point_values[0];
+  }
+  const auto point_time =
+      std::chrono::high_resolution_clock::now() - start_time;
+
+  std::vector<double> contact(kNumPoints), no_contact(kNumPoints);
+  const double *coordinates[2] = {wheel_torques.data(), knee_torques.data()};
+  double *values[2] = {contact.data(), no_contact.data()};
+  start_time = std::chrono::high_resolution_clock::now();
+  interpolator->interpolate_batch(coordinates, kNumPoints, values);
+  const auto batch_time =
+      std::chrono::high_resolution_clock::now() - start_time;
+  double batch_sum{};
+  for (double value : contact) {
+    batch_sum += value;
+  }
+
+  const double point_ns =
+      std::chrono::duration<double, std::nano>(point_time).count() /
+      kNumPoints;
+  const double batch_ns =
+      std::chrono::duration<double, std::nano>(batch_time).count() /
+      kNumPoints;
+  std::cout << "Point-wise query time ns: " << point_ns << std::endl;
+  std::cout << "Batch query time ns: " << batch_ns << std::endl;
+  std::cout << "Speedup: " << point_ns / batch_ns << std::endl;
+  ASSERT_NEAR(batch_sum, point_sum, 1e-6 * std::abs(point_sum));
+}
+
+}  // namespace
@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "observers/NpzInterpolator.h"
+#include "observers/UniformGridNd.h"
+#include "observers/tests/QueryBenchmark.h"
+
+constexpr double kNearTolerance = 1e-8;
+
+namespace {
+
+//! Uniform axis of a given number of points over [lower, upper]
+std::vector<double> uniform_axis(double lower, double upper, size_t size) {
+  std::vector<double> axis(size);
+  for (size_t i = 0; i < size; ++i) {
+    axis[i] = lower + (upper - lower) * i / (size - 1);
+  }
+  return axis;
+}
+
+//! Grid axes with the given numbers of points, over different ranges
+std::vector<std::vector<double>> make_axes(const std::vector<size_t> &sizes) {
+  std::vector<std::vector<double>> axes;
+  for (size_t d = 0; d < sizes.size(); ++d) {
+    axes.push_back(uniform_axis(-1.0 - d, 0.5 * d + 1.0, sizes[d]));
+  }
+  return axes;
+}
+
+//! Coordinates of a grid node from its row-major index
+std::vector<double> node_point(const std::vector<std::vector<double>> &axes,
+                               size_t node) {
+  std::vector<double> point(axes.size());
+  for (size_t d = axes.size(); d-- > 0;) {
+    point[d] = axes[d][node % axes[d].size()];
+    node /= axes[d].size();
+  }
+  return point;
+}
+
+//! Multilinear function, reproduced exactly by multilinear interpolation
+double multilinear(const std::vector<double> &point) {
+  double product = 1.0, sum = 0.5;
+  for (size_t d = 0; d < point.size(); ++d) {
+    product *= point[d];
+    sum += (d + 1.0) * point[d];
+  }
+  return sum - 0.3 * product;
+}
+
+//! Interpolator of a random table and of the multilinear function
+std::unique_ptr<NpzInterpolator> make_interpolator(
+    const std::vector<std::vector<double>> &axes, unsigned int seed) {
+  size_t num_nodes = 1;
+  std::vector<std::string> axis_keys;
+  for (size_t d = 0; d < axes.size(); ++d) {
+    num_nodes *= axes[d].size();
+    axis_keys.push_back("axis_" + std::to_string(d));
+  }
+  std::vector<std::vector<double>> tables(2);
+  for (size_t node = 0; node < num_nodes; ++node) {
+    tables[0].push_back(static_cast<double>(rand_r(&seed)) / RAND_MAX);
+    tables[1].push_back(multilinear(node_point(axes, node)));
+  }
+  return std::make_unique<NpzInterpolator>(
+      axis_keys, axes, std::vector<std::string>{"random", "multilinear"},
+      tables);
+}
+
+TEST(UniformGridNdTest, ReproducesMultilinearFunctions) {
+  const std::vector<std::vector<double>> axes = make_axes({5, 4, 3});
+  std::vector<double> nodes;
+  for (size_t node = 0; node < 5 * 4 * 3; ++node) {
+    nodes.push_back(multilinear(node_point(axes, node)));
+  }
+  const UniformGridNd<3> grid(axes, 1, nodes.data());
+  ASSERT_EQ(grid.num_axes(), 3);
+  ASSERT_EQ(grid.num_values(), 1);
+
+  unsigned int seed = 42;
+  for (int trial = 0; trial < 1000; ++trial) {
+    std::vector<double> point = random_point(axes, &seed);
+    double value;
+    grid.interpolate(point.data(), &value);
+
+    // Constant extrapolation outside of the grid
+    for (size_t d = 0; d < 3; ++d) {
+      point[d] = std::clamp(point[d], axes[d].front(), axes[d].back());
+    }
+    ASSERT_NEAR(value, multilinear(point), kNearTolerance);
+  }
+}
+
+TEST(UniformGridNdTest, MatchesBtwxt) {
+  for (const std::vector<size_t> &sizes :
+       {std::vector<size_t>{12, 9, 7}, std::vector<size_t>{8, 6, 5, 4},
+        std::vector<size_t>{6, 5, 4, 4, 3}}) {
+    const std::vector<std::vector<double>> axes = make_axes(sizes);
+    std::unique_ptr<NpzInterpolator> interpolator = make_interpolator(axes, 7);
+    ASSERT_TRUE(interpolator->has_uniform_grid_nd());
+    ASSERT_FALSE(interpolator->has_uniform_grid());
+
+    unsigned int seed = 42;
+    double values[2];
+    for (int trial = 0; trial < 1000; ++trial) {
+      const std::vector<double> point = random_point(axes, &seed);
+      const std::vector<double> expected = (*interpolator)(point);
+      interpolator->interpolate(point, values);
+      ASSERT_NEAR(values[0], expected[0], kNearTolerance);
+      ASSERT_NEAR(values[1], expected[1], kNearTolerance);
+    }
+  }
+}
+
+TEST(UniformGridNdTest, InterpolatePoints) {
+  const std::vector<std::vector<double>> axes = make_axes({8, 6, 5, 4});
+  std::unique_ptr<NpzInterpolator> interpolator = make_interpolator(axes, 3);
+
+  // Several chunks of points and a partial one
+  constexpr size_t kNumPoints = 11;
+  unsigned int seed = 42;
+  std::vector<double> points;
+  std::vector<std::vector<double>> coordinates(4);
+  for (size_t k = 0; k < kNumPoints; ++k) {
+    const std::vector<double> point = random_point(axes, &seed);
+    points.insert(points.end(), point.begin(), point.end());
+    for (size_t d = 0; d < 4; ++d) {
+      coordinates[d].push_back(point[d]);
+    }
+  }
+  std::vector<double> values(2 * kNumPoints);
+  interpolator->interpolate_points(points, values.data());
+
+  std::vector<double> randoms(kNumPoints), multilinears(kNumPoints);
+  const double *coordinate_arrays[] = {coordinates[0].data(),
+                                       coordinates[1].data(),
+                                       coordinates[2].data(),
+                                       coordinates[3].data()};
+  double *value_arrays[] = {randoms.data(), multilinears.data()};
+  interpolator->interpolate_batch(coordinate_arrays, kNumPoints,
+                                  value_arrays);
+
+  double expected[2];
+  for (size_t k = 0; k < kNumPoints; ++k) {
+    const std::vector<double> point(points.begin() + 4 * k,
+                                    points.begin() + 4 * (k + 1));
+    interpolator->interpolate(point, expected);
+    ASSERT_EQ(values[2 * k], expected[0]);
+    ASSERT_EQ(values[2 * k + 1], expected[1]);
+    ASSERT_EQ(randoms[k], expected[0]);
+    ASSERT_EQ(multilinears[k], expected[1]);
+  }
+}
+
+TEST(UniformGridNdTest, Dispatch) {
+  // Two axes go through UniformGrid2d
+  ASSERT_FALSE(make_interpolator(make_axes({5, 4}), 1)->has_uniform_grid_nd());
+
+  // Non-uniform and degenerate axes through generic multilinear
+  // interpolation
+  std::vector<std::vector<double>> axes = make_axes({5, 4, 3});
+  axes[1] = {0.0, 1.0, 3.0, 4.0};
+  ASSERT_FALSE(make_interpolator(axes, 1)->has_uniform_grid_nd());
+  axes[1] = {0.0};
+  ASSERT_FALSE(make_interpolator(axes, 1)->has_uniform_grid_nd());
+  axes = make_axes({3, 3, 3, 3, 3, 3});
+  ASSERT_FALSE(make_interpolator(axes, 1)->has_uniform_grid_nd());
+}
+
+TEST(UniformGridNdTest, ConcurrentMultilinearQueries) {
+  // Six axes go through generic multilinear interpolation, which keeps its
+  // scratch on the stack so that threads can share the interpolator
+  const std::vector<std::vector<double>> axes = make_axes({3, 3, 3, 3, 3, 3});
+  const std::unique_ptr<NpzInterpolator> interpolator =
+      make_interpolator(axes, 5);
+  constexpr size_t kNumThreads = 4;
+  constexpr size_t kNumPoints = 1000;
+  unsigned int seed = 42;
+  std::vector<double> points;
+  for (size_t k = 0; k < kNumPoints; ++k) {
+    const std::vector<double> point = random_point(axes, &seed);
+    points.insert(points.end(), point.begin(), point.end());
+  }
+  std::vector<double> expected(2 * kNumPoints);
+  interpolator->interpolate_points(points, expected.data());
+
+  std::vector<std::vector<double>> values(kNumThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    values[t].resize(2 * kNumPoints);
+    threads.emplace_back([&, t]() {
+      for (size_t k = 0; k < kNumPoints; ++k) {
+        const std::vector<double> point(points.begin() + 6 * k,
+                                        points.begin() + 6 * (k + 1));
+        interpolator->interpolate(point, values[t].data() + 2 * k);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    ASSERT_EQ(values[t], expected);
+  }
+}
+
+TEST(UniformGridNdTest, Validation) {
+  const std::vector<double> nodes(5 * 4 * 3, 0.0);
+  ASSERT_THROW(UniformGridNd<4>(make_axes({5, 4, 3}), 1, nodes.data()),
+               std::invalid_argument);
+  std::vector<std::vector<double>> axes = make_axes({5, 4, 3});
+  axes[2] = {0.0, 1.0, 3.0};
+  ASSERT_THROW(UniformGridNd<3>(axes, 1, nodes.data()), std::invalid_argument);
+  ASSERT_EQ(make_uniform_grid_nd(axes, 1, nodes.data()), nullptr);
+
+  // Uniform grids only cover a range of axis counts
+  for (const size_t num_axes : {kMinUniformGridAxes - 1,
+                                kMaxUniformGridAxes + 1}) {
+    const std::vector<size_t> sizes(num_axes, 2);
+    const std::vector<double> corners(size_t{1} << num_axes, 0.0);
+    ASSERT_EQ(make_uniform_grid_nd(make_axes(sizes), 1, corners.data()),
+              nullptr);
+  }
+
+  // Multilinear interpolation has a bounded number of axes
+  const std::vector<size_t> sizes(kMaxInterpolationAxes + 1, 2);
+  ASSERT_THROW(make_interpolator(make_axes(sizes), 1), std::invalid_argument);
+}
+
+TEST(UniformGridNdTest, QueryBenchmark) {
+  std::unique_ptr<NpzInterpolator> interpolator =
+      make_interpolator(make_axes({40, 40, 20, 20}), 5);
+  benchmark_queries(*interpolator, "4-D");
+}
+
+}  // namespace
@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "observers/ModelFile.h"
+#include "observers/NpzInterpolator.h"
+#include "observers/WarpedGrid2d.h"
+#include "observers/utils.h"
+
+constexpr double kNearTolerance = 1e-8;
+
+namespace {
+
+class WarpedGrid2dTest : public testing::Test {
+ protected:
+  std::unique_ptr<NpzInterpolator> interpolator;
+  std::string model_path;
+
+  WarpedGrid2dTest() {
+    model_path =
+        find_model_path("observers/tests/WarpedGrid2dTest",
+                        "contact_agent/observers/data/measurement_model.npz");
+    interpolator = load();
+  }
+
+  //! Load the full measurement model
+  std::unique_ptr<NpzInterpolator> load() const {
+    return std::make_unique<NpzInterpolator>(
+        model_path, std::vector<std::string>{"wheel_torque", "knee_torque"},
+        std::vector<std::string>{"contact_likelihood",
+                                 "no_contact_likelihood"});
+  }
+
+  //! Random point covering the grid and some margin around it
+  std::vector<double> random_point(unsigned int *seed) const {
+    std::vector<double> point(2);
+    for (size_t d = 0; d < 2; ++d) {
+      const double lower = interpolator->axis_values[d].front();
+      const double upper = interpolator->axis_values[d].back();
+      const double margin = 0.1 * (upper - lower);
+      const double r = static_cast<double>(rand_r(seed)) / RAND_MAX;
+      point[d] = lower - margin + r * (upper - lower + 2 * margin);
+    }
+    return point;
+  }
+};
+
+TEST(WarpedAxisTest, Locate) {
+  const std::vector<double> points = {-1.0, 0.0, 0.01, 0.02, 0.5, 3.0};
+  WarpedAxis axis(points);
+  ASSERT_EQ(axis.size(), 6);
+
+  // Same cells as a binary search
+  unsigned int seed = 42;
+  for (int trial = 0; trial < 10000; ++trial) {
+    const double x = -1.5 + 5.0 * rand_r(&seed) / RAND_MAX;
+    const double clamped = std::clamp(x, points.front(), points.back());
+    const size_t expected =
+        std::upper_bound(points.begin() + 1, points.end() - 1, clamped) -
+        points.begin() - 1;
+    double t;
+    ASSERT_EQ(axis.locate(x, &t), expected) << "x = " << x;
+    ASSERT_GE(t, 0.0);
+    ASSERT_LE(t, 1.0);
+  }
+
+  // Breakpoints start their cell, except the last one
+  double t;
+  ASSERT_EQ(axis.locate(0.01, &t), 2);
+  ASSERT_EQ(t, 0.0);
+  ASSERT_EQ(axis.locate(3.0, &t), 4);
+  ASSERT_EQ(t, 1.0);
+
+  ASSERT_THROW(WarpedAxis({0.0}), std::invalid_argument);
+  ASSERT_THROW(WarpedAxis({0.0, 1.0, 1.0}), std::invalid_argument);
+}
+
+TEST(WarpedAxisTest, BilinearInterpolation) {
+  // Bilinear values are reproduced exactly on any grid
+  const std::vector<double> x_axis = {0.0, 0.1, 1.0};
+  const std::vector<double> y_axis = {-1.0, 1.5, 2.0};
+  std::vector<double> nodes;
+  for (double x : x_axis) {
+    for (double y : y_axis) {
+      nodes.push_back(x + 10.0 * y);
+      nodes.push_back(x * y);
+    }
+  }
+  WarpedGrid2d grid(x_axis, y_axis, 2, nodes.data());
+  double values[2];
+  grid.interpolate(0.3, 1.7, values);
+  ASSERT_NEAR(values[0], 17.3, kNearTolerance);
+  ASSERT_NEAR(values[1], 0.51, kNearTolerance);
+
+  // Constant extrapolation
+  grid.interpolate(-1.0, 5.0, values);
+  ASSERT_NEAR(values[0], 20.0, kNearTolerance);
+  ASSERT_NEAR(values[1], 0.0, kNearTolerance);
+}
+
+TEST_F(WarpedGrid2dTest, AdaptGrid) {
+  constexpr double kTolerance = 1e-3;
+  std::unique_ptr<NpzInterpolator> adapted = load();
+  const std::vector<double> errors = adapted->adapt_grid(kTolerance);
+  ASSERT_TRUE(adapted->has_warped_grid());
+  ASSERT_FALSE(adapted->has_uniform_grid());
+
+  // The reduced grid is much smaller
+  const size_t full_size = vec_prod(interpolator->axis_sizes);
+  const size_t adapted_size = vec_prod(adapted->axis_sizes);
+  ASSERT_LT(3 * adapted_size, full_size);
+
+  // Errors are within tolerance everywhere, not only at grid nodes
+  std::vector<double> ranges(2);
+  for (size_t v = 0; v < 2; ++v) {
+    ASSERT_GT(errors[v], 0.0);
+    double min_value = 0.0;
+    double max_value = 0.0;
+    for (double x : interpolator->axis_values[0]) {
+      for (double y : interpolator->axis_values[1]) {
+        const double value = interpolator->interpolate({x, y})[v];
+        min_value = std::min(min_value, value);
+        max_value = std::max(max_value, value);
+      }
+    }
+    ranges[v] = max_value - min_value;
+    ASSERT_LE(errors[v], kTolerance * ranges[v]);
+  }
+  unsigned int seed = 42;
+  double values[2], expected_values[2];
+  for (int trial = 0; trial < 10000; ++trial) {
+    const std::vector<double> point = random_point(&seed);
+    adapted->interpolate(point, values);
+    interpolator->interpolate(point, expected_values);
+    for (size_t v = 0; v < 2; ++v) {
+      ASSERT_LE(std::abs(values[v] - expected_values[v]),
+                errors[v] + kNearTolerance);
+    }
+
+    // Btwxt agrees on the reduced grid
+    const std::vector<double> btwxt_values = (*adapted)(point);
+    ASSERT_NEAR(values[0], btwxt_values[0], kNearTolerance);
+    ASSERT_NEAR(values[1], btwxt_values[1], kNearTolerance);
+  }
+}
+
+TEST_F(WarpedGrid2dTest, CompiledModel) {
+  interpolator->adapt_grid(1e-3);
+  const std::string compiled_path =
+      testing::TempDir() + "adaptive_measurement_model" + kModelFileExtension;
+  interpolator->save(compiled_path);
+  NpzInterpolator compiled(compiled_path, {"wheel_torque", "knee_torque"},
+                           {"contact_likelihood", "no_contact_likelihood"});
+  ASSERT_TRUE(compiled.has_warped_grid());
+
+  unsigned int seed = 42;
+  double values[2], expected_values[2];
+  for (int trial = 0; trial < 1000; ++trial) {
+    const std::vector<double> point = random_point(&seed);
+    compiled.interpolate(point, values);
+    interpolator->interpolate(point, expected_values);
+    ASSERT_EQ(values[0], expected_values[0]);
+    ASSERT_EQ(values[1], expected_values[1]);
+  }
+}
+
+TEST_F(WarpedGrid2dTest, InvalidTolerance) {
+  ASSERT_THROW(interpolator->adapt_grid(0.0), std::invalid_argument);
+}
+
+}  // namespace
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: Apache-2.0
+// Copyright 2024 Inria
+#include <stdlib.h>
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "observers/ContactFilter.h"
+#include "observers/WheelContactFilter.h"
+#include "palimpsest/Dictionary.h"
+
+constexpr double kNearTolerance = 1e-9;
+
+namespace {
+
+//! Uniform random number between zero and one
+double uniform(unsigned int *seed) {
+  return static_cast<double>(rand_r(seed)) / RAND_MAX;
+}
+
+/*! Write the inputs of the wheel contact filter.
+ *
+ * \param[in] left_ratio Log-likelihood ratio of the left leg.
+ * \param[in] right_ratio Log-likelihood ratio of the right leg.
+ * \param[in] p_switch Probability of a contact switch.
+ * \param[in] p_landing Probability of landing, conditioned on a switch.
+ * \param[out] observation Observation dictionary.
+ */
+void write_inputs(double left_ratio, double right_ratio, double p_switch,
+                  double p_landing, Dictionary &observation) {
+  observation("measurement_model")("left")("log_likelihood_ratio") =
+      left_ratio;
+  observation("measurement_model")("right")("log_likelihood_ratio") =
+      right_ratio;
+  observation("transition_model")("p_switch") = p_switch;
+  observation("transition_model")("p_landing") = p_landing;
+}
+
+/*! Write the inputs of a single-leg contact filter.
+ *
+ * \param[in] log_likelihood_ratio Log-likelihood ratio of the leg.
+ * \param[in] p_switch Probability of a contact switch.
+ * \param[in] p_landing Probability of landing, conditioned on a switch.
+ * \param[out] observation Observation dictionary.
+ */
+void write_leg_inputs(double log_likelihood_ratio, double p_switch,
+                      double p_landing, Dictionary &observation) {
+  observation("measurement_model")("log_likelihood_ratio") =
+      log_likelihood_ratio;
+  observation("transition_model")("p_switch") = p_switch;
+  observation("transition_model")("p_landing") = p_landing;
+  observation("transition_model")("power") = 0.0;
+}
+
+TEST(WheelContactFilterTest, IndependentLegsMatchContactFilters) {
+  WheelContactFilter wheel_filter(WheelContactFilter::Parameters{});
+  ContactFilter left_filter(0.5, /* log_odds = */ true);
+  ContactFilter right_filter(0.5, /* log_odds = */ true);
+  Dictionary observation, left_observation, right_observation;
+  unsigned int seed = 42;
+  for (int i = 0; i < 1000; ++i) {
+    const double left_ratio = 4.0 * (uniform(&seed) - 0.5);
+    const double right_ratio = 4.0 * (uniform(&seed) - 0.5);
+    const double p_switch = 0.1 * uniform(&seed);
+    const double p_landing = uniform(&seed);
+    write_inputs(left_ratio, right_ratio, p_switch, p_landing, observation);
+    write_leg_inputs(left_ratio, p_switch, p_landing, left_observation);
+    write_leg_inputs(right_ratio, p_switch, p_landing, right_observation);
+    wheel_filter.read(observation);
+    left_filter.read(left_observation);
+    right_filter.read(right_observation);
+    ASSERT_NEAR(wheel_filter.p_contact[0], left_filter.p_contact,
+                kNearTolerance);
+    ASSERT_NEAR(wheel_filter.p_contact[1], right_filter.p_contact,
+                kNearTolerance);
+  }
+
+  wheel_filter.write(observation);
+  ASSERT_EQ(observation("contact_filter")("p_contact").as<double>(),
+            wheel_filter.p_contact[0]);
+  ASSERT_EQ(observation("contact_filter")("right")("p_contact").as<double>(),
+            wheel_filter.p_contact[1]);
+}
+
+TEST(WheelContactFilterTest, CoupledLanding) {
+  // Both wheels in the air, then a landing where only the left wheel has
+  // informative torques
+  WheelContactFilter::Parameters params;
+  params.p_contact = 0.01;
+  WheelContactFilter independent(params);
+  params.coupling = 1.0;
+  WheelContactFilter coupled(params);
+  Dictionary observation;
+  for (int i = 0; i < 20; ++i) {
+    write_inputs(/* left_ratio = */ 1.0, /* right_ratio = */ 0.0,
+                 /* p_switch = */ 0.2, /* p_landing = */ 0.9, observation);
+    independent.read(observation);
+    coupled.read(observation);
+  }
+  ASSERT_NEAR(coupled.p_contact[0], independent.p_contact[0], 0.1);
+  ASSERT_GT(coupled.p_contact[1], independent.p_contact[1] + 0.1);
+
+  // Transitions from the joint belief keep legs together
+  const auto &belief = coupled.belief();
+  ASSERT_GT(belief(3), belief(1) + belief(2));
+}
+
+TEST(WheelContactFilterTest, TransitionMatrix) {
+  // Legs that switch together, or independently, as single legs do
+  const double p_switch = 0.1, p_landing = 0.7;
+  const auto coupled = WheelContactFilter::transition(p_switch, p_landing, 1.0);
+  ASSERT_DOUBLE_EQ(coupled(3, 0), p_switch * p_landing);
+  ASSERT_DOUBLE_EQ(coupled(0, 3), p_switch * (1.0 - p_landing));
+  ASSERT_DOUBLE_EQ(coupled(1, 0), 0.0);
+  ASSERT_DOUBLE_EQ(coupled(3, 3), 1.0 - p_switch);
+  const auto independent =
+      WheelContactFilter::transition(p_switch, p_landing, 0.0);
+  ASSERT_DOUBLE_EQ(independent(1, 0),
+                   p_switch * p_landing * (1.0 - p_switch));
+  ASSERT_DOUBLE_EQ(independent(3, 0), std::pow(p_switch * p_landing, 2));
+}
+
+TEST(WheelContactFilterTest, InvalidParameters) {
+  WheelContactFilter::Parameters params;
+  params.leg_names = {"left"};
+  ASSERT_THROW(WheelContactFilter{params}, std::invalid_argument);
+  params.leg_names = {"left", "right"};
+  params.coupling = 1.5;
+  ASSERT_THROW(WheelContactFilter{params}, std::invalid_argument);
+}
+
+}  // namespace
@@ -4,6 +4,7 @@
 #include "observers/utils.h"
 
 #include <memory>
+#include <stdexcept>
 
 #include "spdlog/spdlog.h"
 #include "tools/cpp/runfiles/runfiles.h"
@@ -22,3 +23,16 @@ std::string find_model_path(const std::string &argv0,
 
   return runfiles->Rlocation(model_name);
 }
+
+std::function<std::string(const std::string &)> runfiles_resolver(
+    const std::string &argv0) {
+  std::string error;
+  std::shared_ptr<Runfiles> runfiles(Runfiles::Create(argv0, &error));
+  if (runfiles == nullptr) {
+    spdlog::error("Failed to load runfiles: {}", error);
+    throw std::runtime_error("Failed to load runfiles: " + error);
+  }
+  return [runfiles](const std::string &model_name) {
+    return runfiles->Rlocation(model_name);
+  };
+}
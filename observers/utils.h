@@ -2,7 +2,21 @@
 // Copyright 2024 Inria
 #pragma once
 
+#include <functional>
 #include <string>
 
 std::string find_model_path(const std::string &argv0,
                             const std::string &model_name);
+
+/*! Resolve model paths in the runfiles of a binary, e.g. for
+ * MeasurementModel::Parameters::resolve_model_path.
+ *
+ * Runfiles are only loaded once, when the resolver is created, so that
+ * resolving paths later on cannot fail.
+ *
+ * \param[in] argv0 Path to the executable.
+ * \return Function from model names to their paths in the runfiles.
+ * \throw std::runtime_error If runfiles cannot be loaded.
+ */
+std::function<std::string(const std::string &)> runfiles_resolver(
+    const std::string &argv0);
@@ -33,6 +33,7 @@
 #include "observers/ContactFilter.h"
 #include "observers/MeasurementModel.h"
 #include "observers/TransitionModel.h"
+#include "observers/utils.h"
 
 namespace spines::bullet {
 
@@ -251,9 +252,10 @@ int main(const char* argv0, const CommandLineArguments& args) {
 
   // Observation: Measurement model
   MeasurementModel::Parameters measurement_model_params;
-  measurement_model_params.argv0 = argv0;
+  measurement_model_params.resolve_model_path = runfiles_resolver(argv0);
   measurement_model_params.dt = 1.0 / args.spine_frequency;
   measurement_model_params.cutoff_periods = {0.025, 0.025};
+  measurement_model_params.hot_reload = true;
   auto measurement_model =
       std::make_shared<MeasurementModel>(measurement_model_params);
   observation.append_observer(measurement_model);
@@ -16,6 +16,7 @@
 #include "observers/ContactFilter.h"
 #include "observers/MeasurementModel.h"
 #include "observers/TransitionModel.h"
+#include "observers/data/embedded_simulation_measurement_model.h"
 #include "upkie/cpp/actuation/Pi3HatInterface.h"
 #include "upkie/cpp/model/joints.h"
 #include "upkie/cpp/model/servo_layout.h"
@@ -218,8 +219,15 @@ int main(const char* argv0, const CommandLineArguments& args) {
 
   // Observation: Measurement model
   MeasurementModel::Parameters measurement_model_params;
-  measurement_model_params.argv0 = argv0;
   measurement_model_params.dt = 1.0 / args.spine_frequency;
+  measurement_model_params.model_file =
+      ModelFile::embedded(embedded_simulation_measurement_model());
+  measurement_model_params.lock_tables = true;
+
+  // The embedded model has no file to watch, reload models the agent sends,
+  // whose paths are used as given since the robot has no runfiles
+  measurement_model_params.hot_reload = true;
+  measurement_model_params.reload_period = 0.0;
   auto measurement_model =
       std::make_shared<MeasurementModel>(measurement_model_params);
   observation.append_observer(measurement_model);